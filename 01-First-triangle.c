@@ -17,7 +17,15 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <frame_stats.h>
+#include <scheduler.h>
+#include <startup.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The simulation runs at a fixed rate whatever the frame rate is. */
+#define SIMULATION_RATE	60.0
 
 void processInput(GLFWwindow *window)
 {
@@ -27,10 +35,22 @@ void processInput(GLFWwindow *window)
 }
 
 
-int main()
+int main(int argc, char *argv[])
 {
+	/* With --startup-only, stop after the first frame to time the startup. */
+	int startupOnly = startupOnlyRequested(argc, argv);
+
+	/* --swap-interval 0 turns vsync off, 2 presents every other blank. */
+	int swapInterval = 1;
+	for(int i = 1; i + 1 < argc; i++){
+		if(strcmp(argv[i], "--swap-interval") == 0)
+			swapInterval = atoi(argv[i + 1]);
+	}
+
 	/* Initialize GLFW */
+	startupBegin("glfwInit");
 	glfwInit();
+	startupEnd();
 
 	/* Set minimum openGL version to 3.0 */
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -38,17 +58,22 @@ int main()
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
 
 	/* Create GLFW window. */
+	startupBegin("create window");
 	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGl", NULL, NULL);
 	if(window == NULL){
 		glfwTerminate();
 		perror("Failed to create GLFW window.\n");
 		return -1;
 	}
+	startupEnd();
+
 	/* Make the current thread's main context the same ad the window's one. */
+	startupBegin("glfwMakeContextCurrent");
 	glfwMakeContextCurrent(window);
+	startupEnd();
 
 	/* Load openGL functions with GLAD. */
-	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+	if(!startupLoadGL((GLADloadproc) glfwGetProcAddress)){
 		perror("Could not load openGL functions.\n Failed to initialize GLAD.\n");
 		return -1;
 	}
@@ -72,6 +97,7 @@ int main()
 	/*	- Associated VBO and configuration.			*/
 	/*	- Associated EBO.					*/
 	/* Note: 1 specifies a size, not an id. Ids are assigned by openGL not the user. */
+	startupBegin("buffers");
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);
 
@@ -101,6 +127,7 @@ int main()
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
 	/* Enable vertex attribue 0. By default they are all disabled. */
 	glEnableVertexAttribArray(0);
+	startupEnd();
 
 	/* since VAO was currently bound all this was connected to it. */
 
@@ -109,6 +136,7 @@ int main()
 
 	/* ----------------------------------VERTEX SHADER-------------------------------- */
 
+	startupBegin("shaders");
 	unsigned int vertexShader;
 	vertexShader = glCreateShader(GL_VERTEX_SHADER);
 	/* gl_Postition is a predefined vec4. */
@@ -116,9 +144,10 @@ int main()
 	const char *vertexShaderSource = 
 		 "#version 130\n"
 		 "in vec3 aPos;\n"
+		 "uniform vec2 offset;\n"
 		 "void main()\n"
 		 "{\n"
-		 "	gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
+		 "	gl_Position = vec4(aPos.x + offset.x, aPos.y + offset.y, aPos.z, 1.0);\n"
 		 "}\0";
 
 	/* Attach shader with shader object and compile. */
@@ -184,19 +213,57 @@ int main()
 	/* Every shader and rendering call will use now use this new shaderProgram. */
 	glUseProgram(shaderProgram);
 
+	/* Where the simulation moves the triangle to. */
+	int offsetLocation = glGetUniformLocation(shaderProgram, "offset");
+
 	/* No need to keep them. */
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
+	startupEnd();
 
 	
 	/* ----------------------------------RENDERING----------------------------------- */
 
 	glBindVertexArray(VAO);
 
+	/* Frame, swap and event times, summarized when closing. */
+	struct FrameStats *frameStats = frameStatsCreate();
+	if(frameStats == NULL){
+		fprintf(stderr, "ERROR: Could not create the frame statistics.\n");
+		return -1;
+	}
+
+	/* Steps the simulation at a fixed rate and paces the frames. */
+	struct Scheduler scheduler;
+	schedulerInit(&scheduler, SIMULATION_RATE, 0.0);
+	schedulerSetSwapInterval(&scheduler, swapInterval);
+
+	/* The triangle slides left and right. Drawing in between the last */
+	/* two positions keeps it smooth at any frame rate.		   */
+	float previousX = 0.0f, x = 0.0f, velocity = 0.5f;
+
 	/* Render loop. */
 	while(!glfwWindowShouldClose(window)){
+		/* Sleeps until late in the frame, so the input is as fresh as */
+		/* it can be. Not counted in the frame statistics.	       */
+		schedulerWaitForInput(&scheduler);
+		frameStatsBeginFrame(frameStats);
+
+		/* Checks for any event and call appropriate callback. */
+		frameStatsPhase(frameStats, FRAME_PHASE_EVENTS);
+		glfwPollEvents();
+		frameStatsPhase(frameStats, FRAME_PHASE_CPU);
 		processInput(window);
 
+		for(unsigned int steps = schedulerBeginFrame(&scheduler); steps > 0; steps--){
+			previousX = x;
+			x += velocity / SIMULATION_RATE;
+			if(x > 0.5f || x < -0.5f)
+				velocity = -velocity;
+		}
+		float alpha = schedulerAlpha(&scheduler);
+		glUniform2f(offsetLocation, previousX + (x - previousX) * alpha, 0.0f);
+
 		glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
@@ -204,12 +271,22 @@ int main()
 		/* 3	- How many vertices to draw.	*/
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
+		schedulerEndFrame(&scheduler);
+		frameStatsPhase(frameStats, FRAME_PHASE_SWAP);
 		/* Swap front and back buffer in double buffering. */
 		glfwSwapBuffers(window);
-		/* Checks for any event and call appropriate callback. */
-		glfwPollEvents();
+		schedulerPresented(&scheduler);
+		if(startupFrame() && startupOnly)
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+		frameStatsEndFrame(frameStats);
+		frameStatsCollect(frameStats);
 	}
 
+	startupPrint(stdout);
+	frameStatsPrint(frameStats, stdout);
+	frameStatsDestroy(frameStats);
+
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteProgram(shaderProgram);
@@ -17,12 +17,85 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <bvh.h>
+#include <frame_stats.h>
+#include <input_queue.h>
+#include <startup.h>
+#include <timer.h>
+#include <trace.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
+
+/* What process_key needs to find the triangle under the cursor. */
+struct Picking {
+	const float *vertices;
+	const unsigned int *indices;
+	struct BoundsTable bounds;
+	struct BVH bvh;
+};
+
+/* Moller-Trumbore ray/triangle intersection, used by bvhRaycast on the */
+/* triangles whose boxes the ray goes through.				*/
+int hit_triangle(void *user, unsigned int triangle, const float *origin,
+		 const float *direction, float *distance){
+	struct Picking *picking = user;
+	const float *p[3];
+	for(int k = 0; k < 3; k++)
+		p[k] = picking->vertices + 3 * picking->indices[3 * triangle + k];
+
+	float e1[3], e2[3], s[3], h[3], q[3];
+	for(int k = 0; k < 3; k++){
+		e1[k] = p[1][k] - p[0][k];
+		e2[k] = p[2][k] - p[0][k];
+		s[k] = origin[k] - p[0][k];
+	}
+	h[0] = direction[1] * e2[2] - direction[2] * e2[1];
+	h[1] = direction[2] * e2[0] - direction[0] * e2[2];
+	h[2] = direction[0] * e2[1] - direction[1] * e2[0];
+
+	float a = e1[0] * h[0] + e1[1] * h[1] + e1[2] * h[2];
+	if(a > -1e-8f && a < 1e-8f)
+		return 0;
+
+	float u = (s[0] * h[0] + s[1] * h[1] + s[2] * h[2]) / a;
+	q[0] = s[1] * e1[2] - s[2] * e1[1];
+	q[1] = s[2] * e1[0] - s[0] * e1[2];
+	q[2] = s[0] * e1[1] - s[1] * e1[0];
+	float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) / a;
+	if(u < 0.0f || v < 0.0f || u + v > 1.0f)
+		return 0;
+
+	*distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / a;
+	return *distance >= 0.0f;
+}
 
-void process_key(GLFWwindow *window, int key, int scancode, int action, int mods){
-	if(action == GLFW_RELEASE){
-		switch(key){
+void pick(struct Picking *picking, double x, double y, int width, int height){
+	/* There are no transforms yet, so the ray starts at the near plane */
+	/* in normalized device coordinates and goes straight in.	    */
+	float origin[3] = { 2.0f * x / width - 1.0f, 1.0f - 2.0f * y / height, -1.0f };
+	float direction[3] = { 0.0f, 0.0f, 1.0f };
+	float distance;
+
+	long triangle = bvhRaycast(&picking->bvh, &picking->bounds, origin, direction,
+				   hit_triangle, picking, &distance);
+	if(triangle == -1)
+		printf("Nothing under the cursor.\n");
+	else
+		printf("Picked triangle %ld.\n", triangle);
+}
+
+/* On the thread owning the context, as it changes GL state. */
+void handle_key(GLFWwindow *window, const struct InputEvent *event){
+	if(event->action == GLFW_RELEASE){
+		switch(event->key){
 			case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE);
+						/* Wake the event thread if it is waiting. */
+						glfwPostEmptyEvent();
+						break;
+			case GLFW_KEY_SPACE: pick(glfwGetWindowUserPointer(window), event->cursorX,
+						  event->cursorY, event->windowWidth, event->windowHeight);
 						break;
 			case GLFW_KEY_ENTER:
 				{static unsigned int view_state = 1;
@@ -38,11 +111,87 @@ void process_key(GLFWwindow *window, int key, int scancode, int action, int mods
 	}
 }
 
+/* With --render-thread, the main thread only runs the GLFW event loop	*/
+/* and queues the input for a render thread owning the context.		*/
+struct RenderThread {
+	GLFWwindow *window;
+	struct FrameStats *frameStats;
+	struct InputQueue input;
+	atomic_int running;
+	int startupOnly;
+	uint64_t maxInputLatency;	/* From the event to the swap after it was handled. */
+};
+
+static struct RenderThread *renderThread;
+
+/* On the main thread, as GLFW calls callbacks from glfwPollEvents(). */
+void process_key(GLFWwindow *window, int key, int scancode, int action, int mods){
+	struct InputEvent event = {
+		.type = INPUT_EVENT_KEY, .key = key, .scancode = scancode, .action = action, .mods = mods
+	};
+	glfwGetCursorPos(window, &event.cursorX, &event.cursorY);
+	glfwGetWindowSize(window, &event.windowWidth, &event.windowHeight);
+
+	if(renderThread != NULL)
+		inputQueuePush(&renderThread->input, &event);
+	else
+		handle_key(window, &event);
+}
+
+void *render_main(void *arg){
+	struct RenderThread *thread = arg;
+	TRACE_THREAD_NAME("render");
+	glfwMakeContextCurrent(thread->window);
+
+	while(atomic_load_explicit(&thread->running, memory_order_acquire)){
+		frameStatsBeginFrame(thread->frameStats);
+
+		/* Handle the input first so it shows in this frame. */
+		struct InputEvent event;
+		uint64_t oldest = 0;
+		while(inputQueuePop(&thread->input, &event)){
+			if(oldest == 0)
+				oldest = event.time;
+			handle_key(thread->window, &event);
+		}
+
+		glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+		frameStatsPhase(thread->frameStats, FRAME_PHASE_SWAP);
+		glfwSwapBuffers(thread->window);
+		if(oldest != 0 && timerNow() - oldest > thread->maxInputLatency)
+			thread->maxInputLatency = timerNow() - oldest;
+		if(startupFrame() && thread->startupOnly){
+			glfwSetWindowShouldClose(thread->window, GLFW_TRUE);
+			glfwPostEmptyEvent();
+		}
+
+		frameStatsEndFrame(thread->frameStats);
+		frameStatsCollect(thread->frameStats);
+	}
+
+	/* Hand the context back for the clean up. */
+	glfwMakeContextCurrent(NULL);
+	return NULL;
+}
 
-int main()
+
+int main(int argc, char *argv[])
 {
+	/* With --startup-only, stop after the first frame to time the startup. */
+	int startupOnly = startupOnlyRequested(argc, argv);
+
+	int threaded = 0;
+	for(int i = 1; i < argc; i++)
+		if(strcmp(argv[i], "--render-thread") == 0)
+			threaded = 1;
+
 	/* Initialize GLFW */
+	startupBegin("glfwInit");
 	glfwInit();
+	startupEnd();
 
 	/* Set minimum openGL version to 3.0 */
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -50,19 +199,24 @@ int main()
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
 
 	/* Create GLFW window. */
+	startupBegin("create window");
 	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGl", NULL, NULL);
 	if(window == NULL){
 		glfwTerminate();
 		perror("Failed to create GLFW window.\n");
 		return -1;
 	}
+	startupEnd();
+
 	/* Make the current thread's main context the same ad the window's one. */
+	startupBegin("glfwMakeContextCurrent");
 	glfwMakeContextCurrent(window);
+	startupEnd();
 
 	glfwSetKeyCallback(window, process_key);
 
 	/* Load openGL functions with GLAD. */
-	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+	if(!startupLoadGL((GLADloadproc) glfwGetProcAddress)){
 		perror("Could not load openGL functions.\n Failed to initialize GLAD.\n");
 		return -1;
 	}
@@ -90,6 +244,7 @@ int main()
 	/*	- Associated VBO and configuration.			*/
 	/*	- Associated EBO.					*/
 	/* Note: 1 specifies a size, not an id. Ids are assigned by openGL not the user. */
+	startupBegin("buffers");
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);
 
@@ -115,15 +270,38 @@ int main()
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
 	glEnableVertexAttribArray(0);
+	startupEnd();
 
 
 	/* since VAO was currently bound all this was connected to it. */
 
+	/* A box around every triangle and a BVH over them, to pick with space. */
+	struct Picking picking = { .vertices = vertices, .indices = indices };
+	for(unsigned int t = 0; t < sizeof(indices) / sizeof(indices[0]) / 3; t++){
+		float min[3], max[3], center[3], extent[3];
+		for(int k = 0; k < 3; k++){
+			min[k] = max[k] = vertices[3 * indices[3 * t] + k];
+			for(int corner = 1; corner < 3; corner++){
+				float value = vertices[3 * indices[3 * t + corner] + k];
+				min[k] = value < min[k] ? value : min[k];
+				max[k] = value > max[k] ? value : max[k];
+			}
+			center[k] = (min[k] + max[k]) * 0.5f;
+			extent[k] = (max[k] - min[k]) * 0.5f;
+		}
+		boundsTableAdd(&picking.bounds, center, extent);
+	}
+	if(bvhBuild(&picking.bvh, &picking.bounds) == -1){
+		fprintf(stderr, "ERROR: Could not build the BVH.\n");
+		return -1;
+	}
+	glfwSetWindowUserPointer(window, &picking);
 
 	/* We need to dynamically compile shaders because hardware implementations differ. */
 
 	/* ----------------------------------VERTEX SHADER-------------------------------- */
 
+	startupBegin("shaders");
 	unsigned int vertexShader;
 	vertexShader = glCreateShader(GL_VERTEX_SHADER);
 	/* gl_Postition is a predefined vec4. */
@@ -202,6 +380,7 @@ int main()
 	/* No need to keep them. */
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
+	startupEnd();
 
 	
 	/* ----------------------------------RENDERING----------------------------------- */
@@ -209,9 +388,51 @@ int main()
 	glBindVertexArray(VAO);
 
 	printf("Press enter and see!\n");
+	printf("Press space to pick the triangle under the cursor.\n");
+
+	/* Frame, swap and event times, summarized when closing. */
+	struct FrameStats *frameStats = frameStatsCreate();
+	if(frameStats == NULL){
+		fprintf(stderr, "ERROR: Could not create the frame statistics.\n");
+		return -1;
+	}
+
+	/* Hand the context over to the render thread and wait for events, */
+	/* falling back to one thread if it cannot be started.		   */
+	struct RenderThread thread = {
+		.window = window, .frameStats = frameStats, .startupOnly = startupOnly
+	};
+	pthread_t renderId;
+	if(threaded){
+		inputQueueInit(&thread.input);
+		atomic_init(&thread.running, 1);
+		renderThread = &thread;
+
+		glfwMakeContextCurrent(NULL);
+		if(pthread_create(&renderId, NULL, render_main, &thread) != 0){
+			fprintf(stderr, "ERROR: Could not start the render thread.\n");
+			renderThread = NULL;
+			glfwMakeContextCurrent(window);
+		}
+	}
+
+	if(renderThread != NULL){
+		while(!glfwWindowShouldClose(window))
+			glfwWaitEvents();
+
+		atomic_store_explicit(&thread.running, 0, memory_order_release);
+		pthread_join(renderId, NULL);
+		renderThread = NULL;
+		glfwMakeContextCurrent(window);
+
+		printf("Input to present: %.3f ms at most.\n", TIMER_MILLISECONDS(thread.maxInputLatency));
+		if(thread.input.dropped > 0)
+			printf("%llu input events dropped.\n", (unsigned long long) thread.input.dropped);
+	}
 
 	/* Render loop. */
 	while(!glfwWindowShouldClose(window)){
+		frameStatsBeginFrame(frameStats);
 		glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
@@ -219,16 +440,31 @@ int main()
 		/* 3	- How many vertices to draw.	*/
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+		frameStatsPhase(frameStats, FRAME_PHASE_SWAP);
 		/* Swap front and back buffer in double buffering. */
 		glfwSwapBuffers(window);
+		if(startupFrame() && startupOnly)
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+		frameStatsPhase(frameStats, FRAME_PHASE_EVENTS);
 		/* Checks for any event and call appropriate callback. */
 		glfwPollEvents();
+
+		frameStatsEndFrame(frameStats);
+		frameStatsCollect(frameStats);
 	}
 
+	startupPrint(stdout);
+	frameStatsPrint(frameStats, stdout);
+	frameStatsDestroy(frameStats);
+
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteProgram(shaderProgram);
 
+	bvhFree(&picking.bvh);
+	boundsTableFree(&picking.bounds);
+
 	glfwTerminate();
 	return 0;
 }
@@ -17,7 +17,21 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <frame_arena.h>
+#include <frame_stats.h>
+#include <gl_handles.h>
+#include <profiler.h>
+#include <scene.h>
+#include <startup.h>
+#include <trace.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+/* One entry of the frame's draw list. */
+struct Draw {
+	unsigned int VAO;
+	uint32_t node;		/* Where in the scene, for the model matrix. */
+};
 
 GLFWwindow * getGLFWwindow(){
 	/* Set minimum openGL version to 3.0 */
@@ -29,33 +43,36 @@ GLFWwindow * getGLFWwindow(){
 	return glfwCreateWindow(800, 600, "LearnOpenGl", NULL, NULL);
 }
 
-unsigned int createVAO(float vertices[], size_t length){
+/* The VAO and VBO belong to handles, the VBO is returned through VBO so */
+/* both can be released.						 */
+VertexArrayHandle createVAO(struct GLHandles *handles, float vertices[], size_t length, BufferHandle *VBO){
 	/* Create a vertex array object with id of VAO.			*/
 	/* It will contain:						*/
 	/* 	- Setting of (enabled/disabled) vertex attribute.	*/
 	/*	- Associated VBO and configuration.			*/
 	/*	- Associated EBO.					*/
 	/* Note: 1 specifies a size, not an id.				*/
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
+	TRACE_BEGIN("createVAO");
+	VertexArrayHandle VAO = handlesCreateVertexArray(handles);
 
 	/* Create a vertex buffer object with id of VBO. */
 	/* Its type is: GL_ARRAY_BUFFER */
 	/* OpenGL allows only one type of buffer to be assigned at one time. */
 	/* Note: There are many types of buffer objects. */
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
+	*VBO = handlesCreateBuffer(handles);
 
 	/* Bind VBO to VAO. */
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindVertexArray(handlesVertexArray(handles, VAO));
+	glBindBuffer(GL_ARRAY_BUFFER, handlesBuffer(handles, *VBO));
 
 	glBufferData(GL_ARRAY_BUFFER, length, vertices, GL_STATIC_DRAW);
 
+	TRACE_END();
 	return VAO;
 }
 
 int createShader(int type, const char* source){
+	TRACE_BEGIN("createShader");
 	int shader;
 	shader = glCreateShader(type);
 
@@ -71,27 +88,42 @@ int createShader(int type, const char* source){
 	if(!success){
 		glGetShaderInfoLog(shader, 512, NULL, infoLog);
 		fprintf(stdout, "ERROR:  Shader compilation.\n%s", infoLog);
+		TRACE_END();
 		return -1;
 	}
 
+	TRACE_END();
 	return shader;
 }
 
-int main(){
+int main(int argc, char *argv[]){
+	/* With --startup-only, stop after the first frame to time the startup. */
+	int startupOnly = startupOnlyRequested(argc, argv);
+
+	/* Set C_OPENGL_TRACE to a file name to get a Chrome trace of the run. */
+	traceStart(getenv("C_OPENGL_TRACE"));
+	TRACE_THREAD_NAME("main");
+
 	/* Initialize GLFW */
+	startupBegin("glfwInit");
 	glfwInit();
+	startupEnd();
 
+	startupBegin("create window");
 	GLFWwindow * window = getGLFWwindow();
 	if(window == NULL){
 		glfwTerminate();
 		perror("Failed to create GLFW window.\n");
 		return -1;
 	}
+	startupEnd();
 
+	startupBegin("glfwMakeContextCurrent");
 	glfwMakeContextCurrent(window);
+	startupEnd();
 
 	/* Load openGL functions with GLAD. */
-	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+	if(!startupLoadGL((GLADloadproc) glfwGetProcAddress)){
 		perror( "Could not load openGL functions.\n"
 			"Failed to initialize GLAD.\n");
 		return -1;
@@ -99,13 +131,20 @@ int main(){
 
 	glViewport(0, 0, 800, 600);
 
+	/* Triangles around their own origin, the scene places them. */
 	float leftTriangle[] = {
-		-0.75f,	-0.5f,	0.0f,
-		-0.25f,	-0.5f,	0.0f,
-		-0.5f ,	 0.0f,	0.0f
+		-0.25f,	-0.25f,	0.0f,
+		 0.25f,	-0.25f,	0.0f,
+		 0.0f ,	 0.25f,	0.0f
 	};
 
-	unsigned int VAO1 = createVAO(leftTriangle, sizeof(leftTriangle));
+	/* Owns every VAO and VBO, deleting them once the GPU is done. */
+	struct GLHandles handles;
+	handlesInit(&handles);
+
+	startupBegin("buffers");
+	BufferHandle VBO1, VBO2;
+	VertexArrayHandle VAO1 = createVAO(&handles, leftTriangle, sizeof(leftTriangle), &VBO1);
 	glVertexAttribPointer(	0,	/* Vertex attribute index */
 				3,
 				GL_FLOAT,
@@ -116,12 +155,12 @@ int main(){
 	glEnableVertexAttribArray(0);
 
 	float rightTriangle[] = {
-		0.75f,	0.0f,	0.0f,
-		0.25f,	0.0f,	0.0f,
-		0.5f,	-0.5f,	0.0f
+		 0.25f,	 0.25f,	0.0f,
+		-0.25f,	 0.25f,	0.0f,
+		 0.0f,	-0.25f,	0.0f
 	};
 
-	unsigned int VAO2 = createVAO(rightTriangle, sizeof(rightTriangle));
+	VertexArrayHandle VAO2 = createVAO(&handles, rightTriangle, sizeof(rightTriangle), &VBO2);
 	glVertexAttribPointer(	0,	/* Vertex attribute index */
 				3,
 				GL_FLOAT,
@@ -130,17 +169,30 @@ int main(){
 				(void*) 0);
 
 	glEnableVertexAttribArray(0);
+	startupEnd();
+
+	/* A node for the pair with one child per triangle. */
+	struct SceneGraph scene = {0};
+	long pair = sceneAddNode(&scene, SCENE_NO_PARENT, vec3(0.0f, 0.0f, 0.0f), quatIdentity(), vec3(1, 1, 1));
+	long leftNode = sceneAddNode(&scene, pair, vec3(-0.5f, -0.25f, 0.0f), quatIdentity(), vec3(1, 1, 1));
+	long rightNode = sceneAddNode(&scene, pair, vec3(0.5f, -0.25f, 0.0f), quatIdentity(), vec3(1, 1, 1));
+	if(pair == -1 || leftNode == -1 || rightNode == -1){
+		fprintf(stderr, "ERROR: Could not create the scene.\n");
+		return -1;
+	}
 
 
 	/* ------------------------------SHADERS----------------------------- */
 
+	startupBegin("shaders");
 	const char *vertexShaderSource = 
 		 "#version 130\n"
 		 "in vec3 aPos;\n"
+		 "uniform mat4 model;\n"
 		 "out vec4 colour;\n"
 		 "void main()\n"
 		 "{\n"
-		 "	gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
+		 "	gl_Position = model * vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
 		 	"colour = gl_Position;\n"
 		 "}\0";
 	int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
@@ -160,6 +212,9 @@ int main(){
 	if(fragmentShader == -1)
 		return -1;
 
+	startupEnd();
+
+	startupBegin("link");
 	unsigned int shaderProgram;
 	shaderProgram = glCreateProgram();
 
@@ -184,33 +239,107 @@ int main(){
 
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
+	startupEnd();
 
-	/* -----------------------------RENDERING--------------------------- */
+	/* Where each triangle goes, from its node's world matrix. */
+	int modelLocation = glGetUniformLocation(shaderProgram, "model");
 
-	while(!glfwWindowShouldClose(window)){
+	/* -----------------------------RENDERING--------------------------- */
 
-		glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+	/* Times every pass on the GPU and the CPU, printed when closing. */
+	struct Profiler *profiler = profilerCreate();
+	if(profiler == NULL){
+		fprintf(stderr, "ERROR: Could not create the profiler.\n");
+		return -1;
+	}
 
-		glBindVertexArray(VAO1);
-		/* 0	- vertex attribute to use.	*/
-		/* 3	- How many vertices to draw.	*/
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+	/* Frame, swap and event times, summarized when closing. */
+	struct FrameStats *frameStats = frameStatsCreate();
+	if(frameStats == NULL){
+		fprintf(stderr, "ERROR: Could not create the frame statistics.\n");
+		return -1;
+	}
 
-		glBindVertexArray(VAO2);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+	/* Per frame data comes from here rather than malloc. */
+	struct FrameArena arena;
+	if(frameArenaInit(&arena, 64 * 1024) == -1)
+		return -1;
 
+	while(!glfwWindowShouldClose(window)){
+		TRACE_BEGIN("frame");
+		frameStatsBeginFrame(frameStats);
+		profilerBeginFrame(profiler);
+		frameArenaBeginFrame(&arena);
+
+		/* Only recomputes nodes that moved, so nothing after the first frame. */
+		sceneUpdate(&scene);
+
+		/* What to draw this frame. */
+		unsigned int drawCount = 2;
+		struct Draw *drawList = FRAME_ARENA_NEW(&arena, struct Draw, drawCount);
+		if(drawList == NULL)
+			drawCount = 0;
+		else {
+			drawList[0] = (struct Draw) { handlesVertexArray(&handles, VAO1), leftNode };
+			drawList[1] = (struct Draw) { handlesVertexArray(&handles, VAO2), rightNode };
+		}
+
+		profilerBegin(profiler, "clear");
+		glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		profilerEnd(profiler);
+
+		profilerBegin(profiler, "triangles");
+		for(unsigned int i = 0; i < drawCount; i++){
+			glBindVertexArray(drawList[i].VAO);
+			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, scene.worlds[drawList[i].node].m);
+			/* 0	- vertex attribute to use.	*/
+			/* 3	- How many vertices to draw.	*/
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		profilerEnd(profiler);
+
+		profilerEndFrame(profiler);
+		frameArenaEndFrame(&arena);
+		handlesEndFrame(&handles);
+
+		frameStatsPhase(frameStats, FRAME_PHASE_SWAP);
 		/* Swap front and back buffer in double buffering. */
+		TRACE_BEGIN("swap");
 		glfwSwapBuffers(window);
+		if(startupFrame() && startupOnly)
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		TRACE_END();
 
+		frameStatsPhase(frameStats, FRAME_PHASE_EVENTS);
 		glfwPollEvents();
+
+		frameStatsEndFrame(frameStats);
+		frameStatsCollect(frameStats);
+		TRACE_END();
 	}
 
-	glDeleteVertexArrays(1, &VAO1);
-	//TODO: delete VBO
+	startupPrint(stdout);
+	frameStatsPrint(frameStats, stdout);
+	frameStatsDestroy(frameStats);
+
+	profilerPrint(profiler, stdout);
+	profilerDestroy(profiler);
+
+	frameArenaPrint(&arena, stdout);
+	frameArenaFree(&arena);
+
+	handlesReleaseVertexArray(&handles, VAO1);
+	handlesReleaseVertexArray(&handles, VAO2);
+	handlesReleaseBuffer(&handles, VBO1);
+	handlesReleaseBuffer(&handles, VBO2);
+	handlesPrint(&handles, stdout);
+	handlesDestroy(&handles);
+	sceneFree(&scene);
 	glDeleteProgram(shaderProgram);
 
 	glfwTerminate();
 
+	traceStop();
 	return 0;
 }
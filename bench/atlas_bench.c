@@ -0,0 +1,91 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* How full and how fast each packer gets on the same random images:	*/
+/* MaxRects packing them all at once, as atlas_bake does, against the	*/
+/* skyline allocator taking them one at a time, as at run time.		*/
+/* Usage: atlas_bench [images] [page size]				*/
+
+#include <atlas.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define PADDING	2
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, double seconds, size_t count, unsigned int pages, size_t area,
+		   unsigned int size){
+	printf("%-9s %8.2f ms %8.2f us/image %4u pages %6.1f%% used\n", name, seconds * 1e3, seconds * 1e6 / count,
+	       pages, 100.0 * area / ((double) size * size * pages));
+}
+
+int main(int argc, char *argv[]){
+	size_t count = argc > 1 ? (size_t) atol(argv[1]) : 5000;
+	unsigned int size = argc > 2 ? (unsigned int) atoi(argv[2]) : 2048;
+	if(count == 0 || size < 256){
+		fprintf(stderr, "ERROR: need at least one image and pages of 256 or more.\n");
+		return -1;
+	}
+
+	struct AtlasRect *rects = malloc(count * sizeof(struct AtlasRect));
+	if(rects == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	/* Mostly small sprites and glyphs, with a few larger images. */
+	size_t area = 0;
+	srand(1);
+	for(size_t i = 0; i < count; i++){
+		unsigned int limit = rand() % 10 == 0 ? 200 : 48;
+		rects[i] = (struct AtlasRect) { 0, 0, 4 + (unsigned int) rand() % limit, 4 + (unsigned int) rand() % limit, 0 };
+		area += (size_t) (rects[i].width + 2 * PADDING) * (rects[i].height + 2 * PADDING);
+	}
+	printf("%zu images, %ux%u pages, %d pixel gutters\n", count, size, size, PADDING);
+
+	unsigned int pages;
+	double start = now();
+	if(atlasPack(rects, count, size, size, PADDING, &pages) == -1)
+		return -1;
+	report("maxrects", now() - start, count, pages, area, size);
+
+	/* A new page whenever the current one is full. */
+	struct AtlasAllocator allocator;
+	if(atlasAllocatorInit(&allocator, size, size, PADDING) == -1)
+		return -1;
+	pages = 1;
+	start = now();
+	for(size_t i = 0; i < count; i++){
+		if(atlasAllocate(&allocator, &rects[i]) == -1){
+			atlasAllocatorReset(&allocator);
+			pages++;
+			if(atlasAllocate(&allocator, &rects[i]) == -1)
+				return -1;
+		}
+	}
+	report("skyline", now() - start, count, pages, area, size);
+
+	atlasAllocatorFree(&allocator);
+	free(rects);
+	return 0;
+}
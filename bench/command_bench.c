@@ -0,0 +1,191 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Frame preparation spread over threads with command buffers: each	*/
+/* thread culls its share of the objects, writes their matrices and	*/
+/* draws, then sorts its buffer. Only recording is timed, the replay	*/
+/* needs a context and stays on one thread whatever the thread count.	*/
+/* Usage: command_bench [objects] [max threads] [iterations]		*/
+
+#include <command_buffer.h>
+#include <cull.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGRAMS	4
+#define VERTEX_ARRAYS	16
+
+struct Scene {
+	struct BoundsTable bounds;
+	struct Frustum frustum;
+	float viewProjection[16];
+	unsigned int threads;
+	unsigned int **visible;		/* One scratch array per thread. */
+};
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+/* Column major perspective projection looking down -z from the origin. */
+static void perspective(float *m, float fovy, float aspect, float near, float far){
+	float f = 1.0f / tanf(fovy * 0.5f);
+	for(int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (far + near) / (near - far);
+	m[11] = -1.0f;
+	m[14] = 2.0f * far * near / (near - far);
+}
+
+static void recordRange(void *user, unsigned int index, struct CommandBuffer *buffer){
+	struct Scene *scene = user;
+	/* Slices start on a multiple of 8 objects, as culling loads whole	*/
+	/* aligned vectors.							*/
+	size_t count = scene->bounds.count;
+	size_t first = count * index / scene->threads & ~(size_t) 7;
+	size_t last = index + 1 == scene->threads ? count : count * (index + 1) / scene->threads & ~(size_t) 7;
+
+	/* Cull only this thread's slice by viewing it as a table of its own. */
+	struct BoundsTable slice = scene->bounds;
+	slice.centerX += first;
+	slice.centerY += first;
+	slice.centerZ += first;
+	slice.radius += first;
+	slice.extentX += first;
+	slice.extentY += first;
+	slice.extentZ += first;
+	slice.count = last - first;
+
+	unsigned int *visible = scene->visible[index];
+	size_t visibleCount = cullSpheres(&slice, &scene->frustum, visible);
+
+	for(size_t v = 0; v < visibleCount; v++){
+		size_t object = first + visible[v];
+		GLuint program = 1 + object % PROGRAMS, vertexArray = 1 + object % VERTEX_ARRAYS;
+		float x = scene->bounds.centerX[object];
+		float y = scene->bounds.centerY[object];
+		float z = scene->bounds.centerZ[object];
+
+		/* viewProjection * translate(x, y, z) */
+		const float *m = scene->viewProjection;
+		float model[16];
+		for(int i = 0; i < 12; i++)
+			model[i] = m[i];
+		for(int r = 0; r < 4; r++)
+			model[12 + r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r];
+
+		float depth = -z;
+		commandBufferBegin(buffer, COMMAND_SORT_KEY(program, vertexArray, (uint32_t) (depth * 1000.0f)));
+		commandUseProgram(buffer, program);
+		commandBindVertexArray(buffer, vertexArray);
+		commandUniformMatrix4(buffer, 0, model);
+		commandDrawElements(buffer, GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+	}
+}
+
+int main(int argc, char *argv[]){
+	size_t objects = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int maxThreads = argc > 2 ? (unsigned int) atoi(argv[2]) : (online > 0 ? (unsigned int) online : 1);
+	int iterations = argc > 3 ? atoi(argv[3]) : 10;
+	if(maxThreads < 1)
+		maxThreads = 1;
+
+	struct Scene scene = {0};
+	if(boundsTableReserve(&scene.bounds, objects) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	srand(1);
+	for(size_t i = 0; i < objects; i++){
+		float center[3] = { randomRange(-500, 500), randomRange(-500, 500), randomRange(-1000, 0) };
+		float extent[3] = { 1, 1, 1 };
+		boundsTableAdd(&scene.bounds, center, extent);
+	}
+	perspective(scene.viewProjection, 1.2f, 16.0f / 9.0f, 0.1f, 1000.0f);
+	frustumFromMatrix(&scene.frustum, scene.viewProjection);
+
+	struct CommandBuffer *buffers = calloc(maxThreads, sizeof(struct CommandBuffer));
+	scene.visible = calloc(maxThreads, sizeof(unsigned int *));
+	if(buffers == NULL || scene.visible == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	for(unsigned int t = 0; t < maxThreads; t++){
+		scene.visible[t] = malloc(objects * sizeof(unsigned int));
+		if(scene.visible[t] == NULL){
+			fprintf(stderr, "ERROR: Out of memory.\n");
+			return -1;
+		}
+	}
+
+	printf("%zu objects, %d iterations\n", objects, iterations);
+	printf("threads\tms/frame\tspeedup\titems\n");
+
+	double single = 0.0;
+	for(unsigned int threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads){
+		scene.threads = threads;
+		struct JobSystem *jobs = jobSystemCreate(threads);
+		if(jobs == NULL)
+			return -1;
+
+		/* One untimed pass so the buffers have grown to size. */
+		commandBuffersRecord(jobs, buffers, threads, recordRange, &scene);
+
+		double start = now();
+		for(int i = 0; i < iterations; i++)
+			commandBuffersRecord(jobs, buffers, threads, recordRange, &scene);
+		double milliseconds = (now() - start) * 1000.0 / iterations;
+		jobSystemDestroy(jobs);
+
+		size_t items = 0;
+		for(unsigned int t = 0; t < threads; t++){
+			if(buffers[t].failed){
+				fprintf(stderr, "ERROR: Out of memory.\n");
+				return -1;
+			}
+			items += buffers[t].itemCount;
+		}
+
+		if(threads == 1)
+			single = milliseconds;
+		printf("%u\t%.2f\t\t%.2fx\t%zu\n", threads, milliseconds, single / milliseconds, items);
+
+		if(threads == maxThreads)
+			break;
+	}
+
+	for(unsigned int t = 0; t < maxThreads; t++){
+		commandBufferFree(&buffers[t]);
+		free(scene.visible[t]);
+	}
+	free(buffers);
+	free(scene.visible);
+	boundsTableFree(&scene.bounds);
+	return 0;
+}
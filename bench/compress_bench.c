@@ -0,0 +1,152 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Block compression speed for each format on one thread and across	*/
+/* the job system, decompression speed, and the quality that comes out.	*/
+/* Usage: compress_bench [size] [iterations]				*/
+
+#include <texture_compress.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* Smooth gradients with a little noise and some hard edges, closer to	*/
+/* real textures than pure noise, which no block format can hold.	*/
+static void fillImage(struct Image *image){
+	srand(1);
+	for(unsigned int y = 0; y < image->height; y++){
+		for(unsigned int x = 0; x < image->width; x++){
+			unsigned char *pixel = image->pixels + ((size_t) y * image->width + x) * 4;
+			float noise = (float) (rand() % 9 - 4);
+			int edge = ((x / 64) + (y / 64)) % 2;
+			pixel[0] = (unsigned char) (128 + 90 * sinf(x * 0.05f) * cosf(y * 0.03f) + noise);
+			pixel[1] = (unsigned char) (edge ? 200 : 60 + 40 * sinf((x + y) * 0.02f) + noise);
+			pixel[2] = (unsigned char) (100 + 60 * cosf(x * 0.07f - y * 0.04f) + noise);
+			pixel[3] = (unsigned char) (edge ? 255 : 128 + 100 * sinf(y * 0.01f));
+		}
+	}
+}
+
+/* Which pixels psnr() looks at, by their source alpha. BC1 cuts out	*/
+/* those under half and decodes them to black, so its colour is only	*/
+/* comparable over the rest.						*/
+enum Texels {
+	TEXELS_ALL,
+	TEXELS_OPAQUE,
+	TEXELS_CUT
+};
+
+/* Over channels first to first + count - 1 of the chosen pixels. Colour	*/
+/* and alpha are apart since BC1 keeps alpha as one bit only.		*/
+static double psnr(const struct Image *image, const unsigned char *decoded, unsigned int first, unsigned int count,
+		enum Texels texels){
+	double error = 0.0;
+	size_t used = 0;
+	for(size_t i = 0; i < IMAGE_SIZE(image); i += 4){
+		if((texels == TEXELS_OPAQUE && image->pixels[i + 3] < 128) ||
+		   (texels == TEXELS_CUT && image->pixels[i + 3] >= 128))
+			continue;
+		for(unsigned int c = first; c < first + count; c++)
+			error += (double) (image->pixels[i + c] - decoded[i + c]) * (image->pixels[i + c] - decoded[i + c]);
+		used++;
+	}
+	if(used == 0)
+		return NAN;
+	error /= (double) used * count;
+	return error > 0.0 ? 10.0 * log10(255.0 * 255.0 / error) : INFINITY;
+}
+
+static void run(const struct Image *image, enum BlockFormat format, const char *name, struct JobSystem *jobs,
+		int iterations){
+	size_t size = textureCompressedSize(format, image->width, image->height);
+	unsigned char *blocks = malloc(size), *decoded = malloc(IMAGE_SIZE(image));
+	if(blocks == NULL || decoded == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		free(blocks);
+		return;
+	}
+
+	double pixels = (double) image->width * image->height;
+	double single = 0.0, parallel = 0.0, decode = 0.0;
+	for(int i = 0; i < iterations; i++){
+		double start = now();
+		textureCompress(image, format, NULL, blocks);
+		single += now() - start;
+
+		if(jobs){
+			start = now();
+			textureCompress(image, format, jobs, blocks);
+			parallel += now() - start;
+		}
+
+		start = now();
+		textureDecompress(blocks, format, image->width, image->height, NULL, decoded);
+		decode += now() - start;
+	}
+	single /= iterations;
+	parallel /= iterations;
+	decode /= iterations;
+
+	printf("%-4s %6.1f Mpx/s", name, pixels / single * 1e-6);
+	if(jobs)
+		printf(" %7.1f Mpx/s jobs (%.2fx)", pixels / parallel * 1e-6, single / parallel);
+	/* For BC1 the cut out pixels get a column of their own, so the black	*/
+	/* they decode to does not hide how well the colour itself holds up.	*/
+	int cuts = format == BLOCK_BC1;
+	printf(" %7.1f Mpx/s decode, RGB %6.2f dB, A %6.2f dB", pixels / decode * 1e-6,
+	       psnr(image, decoded, 0, 3, cuts ? TEXELS_OPAQUE : TEXELS_ALL), psnr(image, decoded, 3, 1, TEXELS_ALL));
+	if(cuts)
+		printf(", cut RGB %6.2f dB", psnr(image, decoded, 0, 3, TEXELS_CUT));
+	printf(", %5.1f:1\n", (double) IMAGE_SIZE(image) / size);
+	free(decoded);
+	free(blocks);
+}
+
+int main(int argc, char *argv[]){
+	unsigned int size = argc > 1 ? (unsigned int) atoi(argv[1]) : 1024;
+	int iterations = argc > 2 ? atoi(argv[2]) : 3;
+	if(size == 0 || size > IMAGE_MAX_DIMENSION){
+		fprintf(stderr, "ERROR: size must be 1 to %d.\n", IMAGE_MAX_DIMENSION);
+		return -1;
+	}
+
+	struct Image image = { malloc((size_t) size * size * 4), size, size };
+	if(image.pixels == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	fillImage(&image);
+
+	struct JobSystem *jobs = jobSystemCreate(0);
+	printf("%ux%u RGBA, %d iterations, %u threads\n", size, size, iterations, jobs ? jobSystemThreads(jobs) : 1);
+
+	run(&image, BLOCK_BC1, "bc1", jobs, iterations);
+	run(&image, BLOCK_BC3, "bc3", jobs, iterations);
+	run(&image, BLOCK_BC7, "bc7", jobs, iterations);
+
+	if(jobs)
+		jobSystemDestroy(jobs);
+	imageFree(&image);
+	return 0;
+}
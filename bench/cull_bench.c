@@ -0,0 +1,107 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Frustum culling throughput of every path the CPU supports.	*/
+/* Usage: cull_bench [objects] [iterations]			*/
+
+#include <cull.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* Column major perspective projection looking down -z from the origin. */
+static void perspective(float *m, float fovy, float aspect, float near, float far){
+	float f = 1.0f / tanf(fovy * 0.5f);
+	for(int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (far + near) / (near - far);
+	m[11] = -1.0f;
+	m[14] = 2.0f * far * near / (near - far);
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+int main(int argc, char *argv[]){
+	size_t objects = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 50;
+
+	struct BoundsTable table = {0};
+	if(boundsTableReserve(&table, objects) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	/* Objects spread all around the camera, so about a tenth is visible. */
+	srand(1);
+	for(size_t i = 0; i < objects; i++){
+		float center[3] = { randomRange(-500, 500), randomRange(-500, 500), randomRange(-500, 500) };
+		float extent[3] = { randomRange(0.5f, 4), randomRange(0.5f, 4), randomRange(0.5f, 4) };
+		boundsTableAdd(&table, center, extent);
+	}
+
+	float projection[16];
+	perspective(projection, 1.2f, 800.0f / 600.0f, 0.1f, 1000.0f);
+	struct Frustum frustum;
+	frustumFromMatrix(&frustum, projection);
+
+	unsigned int *visible = malloc(objects * sizeof(unsigned int));
+	if(visible == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	static const struct { enum CullPath path; const char *name; } paths[] = {
+		{ CULL_PATH_SCALAR, "scalar" }, { CULL_PATH_SSE, "sse" }, { CULL_PATH_AVX2, "avx2" }
+	};
+
+	printf("%zu objects, %d iterations\n", objects, iterations);
+	for(size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++){
+		if(cullSetPath(paths[p].path) == -1){
+			printf("%-8s not supported\n", paths[p].name);
+			continue;
+		}
+
+		for(int test = 0; test < 2; test++){
+			size_t (*cull)(const struct BoundsTable *, const struct Frustum *, unsigned int *) =
+				test == 0 ? cullSpheres : cullBoxes;
+			size_t count = cull(&table, &frustum, visible);
+
+			double start = now();
+			for(int i = 0; i < iterations; i++)
+				count = cull(&table, &frustum, visible);
+			double seconds = (now() - start) / iterations;
+
+			printf("%-8s %-7s %8zu visible %9.3f ms %8.2f Mobjects/s\n", paths[p].name,
+			       test == 0 ? "spheres" : "boxes", count, seconds * 1e3, objects / seconds * 1e-6);
+		}
+	}
+
+	free(visible);
+	boundsTableFree(&table);
+	return 0;
+}
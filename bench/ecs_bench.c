@@ -0,0 +1,213 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* One frame's worth of object work over a large world, kept as an	*/
+/* array of objects and as ECS archetypes: move every object, rebuild	*/
+/* matrices and world boxes, cull against the camera and gather draw	*/
+/* keys for what is left. The ECS frame is also timed across jobs.	*/
+/* Usage: ecs_bench [entities] [iterations]				*/
+
+#include <ecs.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RENDERABLE	(ECS_HAS(ECS_TRANSFORM) | ECS_HAS(ECS_BOUNDS) | ECS_HAS(ECS_MESH) | ECS_HAS(ECS_MATERIAL))
+#define GRAIN		4096
+
+/* The whole object in one struct, the way main() keeps it today. */
+struct Object {
+	struct Vec3 translation;
+	struct Quat rotation;
+	struct Vec3 scale;
+	float localCenter[3];
+	float localExtent[3];
+	struct Mat4 world;
+	float center[3];
+	float extent[3];
+	struct EcsMesh mesh;
+	uint32_t material;
+};
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+static uint64_t drawKey(const struct EcsMesh *mesh, uint32_t material){
+	return (uint64_t) material << 32 | mesh->vertexArray.value;
+}
+
+/* Same test as cullBoxes(). */
+static int boxVisible(const struct Frustum *frustum, const float *center, const float *extent){
+	for(int p = 0; p < 6; p++){
+		const float *plane = frustum->planes[p];
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		float reach = fabsf(plane[0]) * extent[0] + fabsf(plane[1]) * extent[1] + fabsf(plane[2]) * extent[2];
+		if(distance + reach < 0.0f)
+			return 0;
+	}
+	return 1;
+}
+
+static size_t objectsFrame(struct Object *objects, size_t count, const struct Frustum *frustum, uint64_t *keys){
+	size_t drawn = 0;
+	for(size_t i = 0; i < count; i++){
+		struct Object *object = &objects[i];
+		object->translation.y += 0.01f;
+		mat4FromTRS(&object->world, object->translation, object->rotation, object->scale);
+
+		const float *m = object->world.m;
+		for(int r = 0; r < 3; r++){
+			object->center[r] = m[r] * object->localCenter[0] + m[4 + r] * object->localCenter[1] +
+					    m[8 + r] * object->localCenter[2] + m[12 + r];
+			object->extent[r] = fabsf(m[r]) * object->localExtent[0] + fabsf(m[4 + r]) * object->localExtent[1] +
+					    fabsf(m[8 + r]) * object->localExtent[2];
+		}
+	}
+	for(size_t i = 0; i < count; i++)
+		if(boxVisible(frustum, objects[i].center, objects[i].extent))
+			keys[drawn++] = drawKey(&objects[i].mesh, objects[i].material);
+	return drawn;
+}
+
+struct Move {
+	float step;
+};
+
+static void moveRows(void *user, struct EcsArchetype *archetype, size_t first, size_t last){
+	const struct Move *move = user;
+	float *y = archetype->transforms[1];
+	for(size_t i = first; i < last; i++)
+		y[i] += move->step;
+	ecsMarkChanged(archetype, first, last);
+}
+
+static size_t ecsFrame(struct EcsWorld *world, struct JobSystem *jobs, const struct Frustum *frustum,
+		       unsigned int *visible, uint64_t *keys){
+	struct Move move = { 0.01f };
+	/* ecsMarkChanged() is not thread safe, so the move stays on one thread. */
+	ecsForEach(world, NULL, ECS_HAS(ECS_TRANSFORM), 0, GRAIN, moveRows, &move);
+	ecsUpdateTransforms(world, jobs);
+
+	size_t drawn = 0;
+	struct EcsQuery query = ecsQuery(RENDERABLE, 0);
+	struct EcsArchetype *archetype;
+	while((archetype = ecsQueryNext(world, &query)) != NULL){
+		size_t count = cullBoxes(&archetype->bounds, frustum, visible);
+		for(size_t i = 0; i < count; i++)
+			keys[drawn++] = drawKey(&archetype->meshes[visible[i]], archetype->materials[visible[i]]);
+	}
+	return drawn;
+}
+
+int main(int argc, char *argv[]){
+	size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+	if(count > ECS_MAX_ENTITIES)
+		count = ECS_MAX_ENTITIES;
+
+	struct Object *objects = malloc(count * sizeof(struct Object));
+	uint64_t *keys = malloc(count * sizeof(uint64_t));
+	unsigned int *visible = malloc(count * sizeof(unsigned int));
+	struct EcsWorld world;
+	ecsInit(&world);
+	if(objects == NULL || keys == NULL || visible == NULL || ecsReserve(&world, RENDERABLE, count) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	/* Objects scattered around the camera, which sees about a quarter. */
+	srand(1);
+	double start = now();
+	for(size_t i = 0; i < count; i++){
+		struct Object *object = &objects[i];
+		object->translation = vec3(randomRange(-500, 500), randomRange(-20, 20), randomRange(-500, 500));
+		object->rotation = quatFromAxisAngle(vec3(0, 1, 0), randomRange(0, 6.28f));
+		object->scale = vec3(1, 1, 1);
+		for(int k = 0; k < 3; k++){
+			object->localCenter[k] = 0.0f;
+			object->localExtent[k] = randomRange(0.5f, 2.0f);
+		}
+		object->mesh = (struct EcsMesh) { { (uint32_t) (rand() % 64 + 1) }, 0, 36 };
+		object->material = (uint32_t) (rand() % 16);
+	}
+	double built = now() - start;
+
+	start = now();
+	for(size_t i = 0; i < count; i++){
+		const struct Object *object = &objects[i];
+		Entity entity = ecsCreate(&world, RENDERABLE);
+		ecsSetTransform(&world, entity, object->translation, object->rotation, object->scale);
+		ecsSetBounds(&world, entity, object->localCenter, object->localExtent);
+		ecsSetMesh(&world, entity, object->mesh);
+		ecsSetMaterial(&world, entity, object->material);
+	}
+	printf("%zu entities, %d iterations, created in %.1f ms (objects %.1f ms)\n", count, iterations,
+	       (now() - start) * 1e3, built * 1e3);
+
+	struct Mat4 projection, view, viewProjection;
+	mat4Perspective(&projection, 1.0f, 16.0f / 9.0f, 0.1f, 400.0f);
+	mat4LookAt(&view, vec3(0, 10, 0), vec3(0, 10, -1), vec3(0, 1, 0));
+	mat4Multiply(&viewProjection, &projection, &view);
+	struct Frustum frustum;
+	frustumFromMatrix(&frustum, viewProjection.m);
+
+	size_t drawn = 0;
+	double total = 0.0;
+	for(int i = 0; i < iterations; i++){
+		start = now();
+		drawn = objectsFrame(objects, count, &frustum, keys);
+		total += now() - start;
+	}
+	printf("%-10s %8zu drawn %9.3f ms\n", "objects", drawn, total / iterations * 1e3);
+
+	/* The first ECS frame also builds everything created above. */
+	ecsFrame(&world, NULL, &frustum, visible, keys);
+	total = 0.0;
+	for(int i = 0; i < iterations; i++){
+		start = now();
+		drawn = ecsFrame(&world, NULL, &frustum, visible, keys);
+		total += now() - start;
+	}
+	printf("%-10s %8zu drawn %9.3f ms\n", "ecs", drawn, total / iterations * 1e3);
+
+	struct JobSystem *jobs = jobSystemCreate(0);
+	if(jobs != NULL){
+		total = 0.0;
+		for(int i = 0; i < iterations; i++){
+			start = now();
+			drawn = ecsFrame(&world, jobs, &frustum, visible, keys);
+			total += now() - start;
+		}
+		printf("%-10s %8zu drawn %9.3f ms, %u threads\n", "ecs jobs", drawn, total / iterations * 1e3,
+		       jobSystemThreads(jobs));
+		jobSystemDestroy(jobs);
+	}
+
+	ecsFree(&world);
+	free(visible);
+	free(keys);
+	free(objects);
+	return 0;
+}
@@ -0,0 +1,106 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Job system overhead and scaling: the cost of an empty job, then a	*/
+/* parallel for over independent work at increasing thread counts.	*/
+/* Usage: job_bench [max threads] [jobs]				*/
+
+#include <jobs.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATCH	256
+#define ITEMS	(1 << 20)
+#define GRAIN	4096
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void empty(void *data){
+	(void) data;
+}
+
+/* Enough arithmetic per item for the ranges to be worth spreading. */
+static void work(void *data, size_t first, size_t last){
+	float *values = data;
+	for(size_t i = first; i < last; i++){
+		float x = values[i];
+		for(int k = 0; k < 16; k++)
+			x = sqrtf(x * x + 1.0f) * 0.5f;
+		values[i] = x;
+	}
+}
+
+int main(int argc, char *argv[]){
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int maxThreads = argc > 1 ? (unsigned int) atoi(argv[1]) : (online > 0 ? (unsigned int) online : 1);
+	size_t jobCount = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+	if(maxThreads < 1)
+		maxThreads = 1;
+
+	float *values = malloc(ITEMS * sizeof(float));
+	if(values == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	for(size_t i = 0; i < ITEMS; i++)
+		values[i] = (float) i;
+
+	struct Job batch[BATCH];
+	for(int i = 0; i < BATCH; i++)
+		batch[i] = (struct Job) { empty, NULL };
+
+	printf("threads\tns/job\tparallel for ms\tspeedup\n");
+
+	double single = 0.0;
+	for(unsigned int threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads){
+		struct JobSystem *jobs = jobSystemCreate(threads);
+		if(jobs == NULL)
+			return -1;
+
+		struct JobCounter counter;
+		jobCounterInit(&counter);
+		double start = now();
+		for(size_t done = 0; done < jobCount; done += BATCH){
+			jobRun(jobs, batch, BATCH, &counter);
+			jobWait(jobs, &counter);
+		}
+		double perJob = (now() - start) * 1e9 / ((jobCount + BATCH - 1) / BATCH * BATCH);
+		jobCounterDestroy(&counter);
+
+		start = now();
+		jobParallelFor(jobs, ITEMS, GRAIN, work, values);
+		double milliseconds = (now() - start) * 1000.0;
+		if(threads == 1)
+			single = milliseconds;
+
+		printf("%u\t%.1f\t%.2f\t\t%.2fx\n", threads, perJob, milliseconds, single / milliseconds);
+		jobSystemDestroy(jobs);
+
+		if(threads == maxThreads)
+			break;
+	}
+
+	free(values);
+	return 0;
+}
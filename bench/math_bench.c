@@ -0,0 +1,174 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Batched transform throughput of every path the CPU supports, next	*/
+/* to the same loops written plainly, as a compiler sees code that does	*/
+/* not use the library.							*/
+/* Usage: math_bench [items] [iterations]				*/
+
+#include <vecmath.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+/* Array of structures baselines, one item at a time. */
+static void plainTransform(const struct Mat4 *m, const struct Vec3 *in, struct Vec3 *out, size_t count){
+	for(size_t i = 0; i < count; i++)
+		out[i] = mat4TransformPoint(m, in[i]);
+}
+
+static void plainMultiply(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count){
+	for(size_t i = 0; i < count; i++){
+		for(int column = 0; column < 4; column++)
+			for(int row = 0; row < 4; row++){
+				float sum = 0.0f;
+				for(int k = 0; k < 4; k++)
+					sum += a[i].m[4 * k + row] * b[i].m[4 * column + k];
+				out[i].m[4 * column + row] = sum;
+			}
+	}
+}
+
+static void plainCompose(struct Mat4 *out, const struct Vec3 *t, const struct Quat *r, const struct Vec3 *s, size_t count){
+	for(size_t i = 0; i < count; i++)
+		mat4FromTRS(&out[i], t[i], r[i], s[i]);
+}
+
+static void report(const char *path, const char *test, double seconds, size_t items, double baseline){
+	printf("%-8s %-10s %9.3f ms %9.2f Mitems/s %6.2fx\n", path, test, seconds * 1e3,
+	       items / seconds * 1e-6, baseline / seconds);
+}
+
+int main(int argc, char *argv[]){
+	size_t items = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+	float *soa = malloc(16 * items * sizeof(float));
+	struct Vec3 *points = malloc(items * sizeof(struct Vec3));
+	struct Vec3 *transformed = malloc(items * sizeof(struct Vec3));
+	struct Vec3 *scales = malloc(items * sizeof(struct Vec3));
+	struct Quat *rotations = malloc(items * sizeof(struct Quat));
+	struct Mat4 *a = malloc(items * sizeof(struct Mat4));
+	struct Mat4 *b = malloc(items * sizeof(struct Mat4));
+	struct Mat4 *out = malloc(items * sizeof(struct Mat4));
+	if(!soa || !points || !transformed || !scales || !rotations || !a || !b || !out){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	/* x, y, z in, x, y, z out, then the TRS columns. */
+	float *in[3] = { soa, soa + items, soa + 2 * items };
+	float *result[3] = { soa + 3 * items, soa + 4 * items, soa + 5 * items };
+	struct TRSArrays trs = {
+		{ in[0], in[1], in[2] },
+		{ soa + 6 * items, soa + 7 * items, soa + 8 * items, soa + 9 * items },
+		{ soa + 10 * items, soa + 11 * items, soa + 12 * items }
+	};
+
+	srand(1);
+	for(size_t i = 0; i < items; i++){
+		points[i] = vec3(randomRange(-100, 100), randomRange(-100, 100), randomRange(-100, 100));
+		rotations[i] = quatNormalize((struct Quat) { randomRange(-1, 1), randomRange(-1, 1),
+							     randomRange(-1, 1), randomRange(-1, 1) });
+		scales[i] = vec3(randomRange(0.5f, 2), randomRange(0.5f, 2), randomRange(0.5f, 2));
+
+		in[0][i] = points[i].x;
+		in[1][i] = points[i].y;
+		in[2][i] = points[i].z;
+		((float *) trs.rotation[0])[i] = rotations[i].x;
+		((float *) trs.rotation[1])[i] = rotations[i].y;
+		((float *) trs.rotation[2])[i] = rotations[i].z;
+		((float *) trs.rotation[3])[i] = rotations[i].w;
+		((float *) trs.scale[0])[i] = scales[i].x;
+		((float *) trs.scale[1])[i] = scales[i].y;
+		((float *) trs.scale[2])[i] = scales[i].z;
+		for(int k = 0; k < 16; k++){
+			a[i].m[k] = randomRange(-1, 1);
+			b[i].m[k] = randomRange(-1, 1);
+		}
+	}
+
+	struct Mat4 view;
+	mat4LookAt(&view, vec3(0, 10, 50), vec3(0, 0, 0), vec3(0, 1, 0));
+
+	printf("%zu items, %d iterations\n", items, iterations);
+
+	double start = now();
+	for(int i = 0; i < iterations; i++)
+		plainTransform(&view, points, transformed, items);
+	double baseTransform = (now() - start) / iterations;
+	report("plain", "transform", baseTransform, items, baseTransform);
+
+	start = now();
+	for(int i = 0; i < iterations; i++)
+		plainMultiply(out, a, b, items);
+	double baseMultiply = (now() - start) / iterations;
+	report("plain", "multiply", baseMultiply, items, baseMultiply);
+
+	start = now();
+	for(int i = 0; i < iterations; i++)
+		plainCompose(out, points, rotations, scales, items);
+	double baseCompose = (now() - start) / iterations;
+	report("plain", "compose", baseCompose, items, baseCompose);
+
+	static const struct { enum MathPath path; const char *name; } paths[] = {
+		{ MATH_PATH_SCALAR, "scalar" }, { MATH_PATH_SSE, "sse" },
+		{ MATH_PATH_AVX2, "avx2" }, { MATH_PATH_NEON, "neon" }
+	};
+
+	for(size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++){
+		if(mathSetPath(paths[p].path) == -1){
+			printf("%-8s not supported\n", paths[p].name);
+			continue;
+		}
+
+		start = now();
+		for(int i = 0; i < iterations; i++)
+			mathTransformPoints(&view, (const float *const *) in, result, items);
+		report(paths[p].name, "transform", (now() - start) / iterations, items, baseTransform);
+
+		start = now();
+		for(int i = 0; i < iterations; i++)
+			mathMultiplyMatrices(out, a, b, items);
+		report(paths[p].name, "multiply", (now() - start) / iterations, items, baseMultiply);
+
+		start = now();
+		for(int i = 0; i < iterations; i++)
+			mathComposeTRS(out, &trs, items);
+		report(paths[p].name, "compose", (now() - start) / iterations, items, baseCompose);
+	}
+
+	free(soa);
+	free(points);
+	free(transformed);
+	free(scales);
+	free(rotations);
+	free(a);
+	free(b);
+	free(out);
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Mip chain build time for each filter, on the scalar and SIMD paths,	*/
+/* on one thread and across the job system.				*/
+/* Usage: mipmap_bench [size] [iterations]				*/
+
+#include <mipmap.h>
+#include <vecmath.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void run(const struct Image *image, enum MipFilter filter, enum MathPath path,
+		struct JobSystem *jobs, int iterations, double *baseline){
+	if(mathSetPath(path) == -1)
+		return;
+
+	double total = 0.0;
+	for(int i = 0; i < iterations; i++){
+		struct MipChain chain;
+		double start = now();
+		if(mipmapBuild(image, filter, MIPMAP_SRGB, jobs, &chain) == -1)
+			return;
+		total += now() - start;
+		mipmapFree(&chain);
+	}
+
+	double seconds = total / iterations;
+	if(*baseline == 0.0)
+		*baseline = seconds;
+	printf("%-7s %-7s %-9s %9.2f ms %6.2fx\n", filter == MIP_FILTER_BOX ? "box" : "kaiser",
+	       mathGetPath() == MATH_PATH_SCALAR ? "scalar" : "simd", jobs ? "jobs" : "1 thread", seconds * 1e3,
+	       *baseline / seconds);
+}
+
+int main(int argc, char *argv[]){
+	unsigned int size = argc > 1 ? (unsigned int) atoi(argv[1]) : 2048;
+	int iterations = argc > 2 ? atoi(argv[2]) : 3;
+	if(size == 0 || size > IMAGE_MAX_DIMENSION){
+		fprintf(stderr, "ERROR: size must be 1 to %d.\n", IMAGE_MAX_DIMENSION);
+		return -1;
+	}
+
+	struct Image image = { malloc((size_t) size * size * 4), size, size };
+	if(image.pixels == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	srand(1);
+	for(size_t i = 0; i < IMAGE_SIZE(&image); i++)
+		image.pixels[i] = (unsigned char) rand();
+
+	struct JobSystem *jobs = jobSystemCreate(0);
+	printf("%ux%u sRGB, %d iterations, %u threads\n", size, size, iterations, jobs ? jobSystemThreads(jobs) : 1);
+
+	enum MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+	for(int f = 0; f < 2; f++){
+		double baseline = 0.0;
+		run(&image, filters[f], MATH_PATH_SCALAR, NULL, iterations, &baseline);
+		run(&image, filters[f], MATH_PATH_AUTO, NULL, iterations, &baseline);
+		if(jobs)
+			run(&image, filters[f], MATH_PATH_AUTO, jobs, iterations, &baseline);
+	}
+
+	if(jobs)
+		jobSystemDestroy(jobs);
+	imageFree(&image);
+	return 0;
+}
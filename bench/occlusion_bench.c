@@ -0,0 +1,134 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Software occlusion culling cost and effect on a dense interior:	*/
+/* rows of walls with objects scattered between them.			*/
+/* Usage: occlusion_bench [objects] [iterations]			*/
+
+#include <occlusion.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define WIDTH	256
+#define HEIGHT	128
+#define WALLS	40
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* Column major perspective projection looking down -z from the origin. */
+static void perspective(float *m, float fovy, float aspect, float near, float far){
+	float f = 1.0f / tanf(fovy * 0.5f);
+	for(int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (far + near) / (near - far);
+	m[11] = -1.0f;
+	m[14] = 2.0f * far * near / (near - far);
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+int main(int argc, char *argv[]){
+	size_t objects = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 50;
+
+	/* Walls facing the camera with gaps between them, further and further away. */
+	float vertices[WALLS * 4 * 3];
+	unsigned int indices[WALLS * 6];
+	srand(1);
+	for(int w = 0; w < WALLS; w++){
+		float x = randomRange(-60, 60), y = randomRange(-10, 0), z = -10.0f - w * 5.0f;
+		float width = randomRange(10, 40), height = randomRange(10, 30);
+		float corners[4][3] = {
+			{ x, y, z }, { x + width, y, z }, { x + width, y + height, z }, { x, y + height, z }
+		};
+		for(int c = 0; c < 4; c++)
+			for(int k = 0; k < 3; k++)
+				vertices[(w * 4 + c) * 3 + k] = corners[c][k];
+
+		static const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for(int i = 0; i < 6; i++)
+			indices[w * 6 + i] = w * 4 + quad[i];
+	}
+
+	struct BoundsTable table = {0};
+	if(boundsTableReserve(&table, objects) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	for(size_t i = 0; i < objects; i++){
+		float center[3] = { randomRange(-80, 80), randomRange(-10, 20), randomRange(-220, -5) };
+		float extent[3] = { randomRange(0.2f, 2), randomRange(0.2f, 2), randomRange(0.2f, 2) };
+		boundsTableAdd(&table, center, extent);
+	}
+
+	float projection[16];
+	perspective(projection, 1.2f, 800.0f / 600.0f, 0.1f, 1000.0f);
+	struct Frustum frustum;
+	frustumFromMatrix(&frustum, projection);
+
+	struct OcclusionBuffer buffer;
+	unsigned int *candidates = malloc(objects * sizeof(unsigned int));
+	unsigned int *visible = malloc(objects * sizeof(unsigned int));
+	if(candidates == NULL || visible == NULL || occlusionCreate(&buffer, WIDTH, HEIGHT) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	double rasterize = 0.0, pyramid = 0.0, test = 0.0;
+	size_t inFrustum = 0, kept = 0;
+	for(int i = 0; i < iterations; i++){
+		inFrustum = cullBoxes(&table, &frustum, candidates);
+
+		double start = now();
+		occlusionClear(&buffer);
+		occlusionRasterize(&buffer, projection, vertices, 3, indices, WALLS * 6);
+		double rasterized = now();
+		occlusionBuildHiZ(&buffer);
+		double built = now();
+		kept = occlusionCull(&buffer, projection, &table, candidates, inFrustum, visible);
+		double tested = now();
+
+		rasterize += rasterized - start;
+		pyramid += built - rasterized;
+		test += tested - built;
+	}
+
+	printf("%zu objects, %d occluders, %dx%d depth, %d iterations\n",
+	       objects, WALLS * 2, WIDTH, HEIGHT, iterations);
+	printf("rasterize %9.3f ms\n", rasterize / iterations * 1e3);
+	printf("hi-z      %9.3f ms\n", pyramid / iterations * 1e3);
+	printf("test      %9.3f ms %8.2f Mobjects/s\n", test / iterations * 1e3,
+	       inFrustum / (test / iterations) * 1e-6);
+	printf("%zu in the frustum, %zu left to draw (%.1f%% occluded)\n", inFrustum, kept,
+	       inFrustum ? 100.0 * (inFrustum - kept) / inFrustum : 0.0);
+
+	occlusionFree(&buffer);
+	free(visible);
+	free(candidates);
+	boundsTableFree(&table);
+	return 0;
+}
@@ -0,0 +1,489 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Rendering benchmark over scenes taken from the samples, drawn in a	*/
+/* hidden window for a fixed number of frames, run under Xvfb without a	*/
+/* display. Prints one JSON object per line on stdout.			*/
+/*									*/
+/* Usage: render_bench [options]					*/
+/*	--scenario NAME		only run this scenario			*/
+/*	--frames N		frames per scenario instead of the defaults	*/
+/*	--baseline FILE		compare with a stored baseline, exit with 1	*/
+/*				on any regression			*/
+/*	--threshold F		allowed relative regression, default 0.10	*/
+/*	--write-baseline FILE	store this run as the baseline		*/
+/*									*/
+/* A baseline line is "scenario metric value [threshold]", where metric	*/
+/* is fps (higher is better) or startup_ms (lower is better) and the	*/
+/* optional threshold overrides --threshold for that line.		*/
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <frame_stats.h>
+#include <timer.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH			800
+#define HEIGHT			600
+#define DEFAULT_THRESHOLD	0.10
+#define MAX_BASELINE		64
+
+enum Shape {
+	SHAPE_TRIANGLE,		/* 01: glDrawArrays of one triangle. */
+	SHAPE_RECTANGLE,	/* 02: glDrawElements of two triangles. */
+	SHAPE_TWO_VAO		/* 03: two VAOs drawn one after the other. */
+};
+
+struct Scenario {
+	const char *name;
+	enum Shape shape;
+	unsigned int objects;	/* Draw calls per frame. */
+	unsigned int frames;
+};
+
+/* Fewer frames for the big ones, so the whole suite runs in seconds. */
+static const struct Scenario scenarios[] = {
+	{ "triangle",		SHAPE_TRIANGLE,		1,	2000 },
+	{ "rectangle",		SHAPE_RECTANGLE,	1,	2000 },
+	{ "two-vao",		SHAPE_TWO_VAO,		2,	2000 },
+	{ "triangle-10k",	SHAPE_TRIANGLE,		10000,	100 },
+	{ "rectangle-10k",	SHAPE_RECTANGLE,	10000,	100 },
+	{ "two-vao-10k",	SHAPE_TWO_VAO,		10000,	100 },
+	{ "triangle-100k",	SHAPE_TRIANGLE,		100000,	20 },
+	{ "rectangle-100k",	SHAPE_RECTANGLE,	100000,	20 },
+	{ "two-vao-100k",	SHAPE_TWO_VAO,		100000,	20 },
+	{ "triangle-1m",	SHAPE_TRIANGLE,		1000000, 5 },
+	{ "rectangle-1m",	SHAPE_RECTANGLE,	1000000, 5 },
+	{ "two-vao-1m",		SHAPE_TWO_VAO,		1000000, 5 }
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/* What startup_ms is measured on, whichever scenarios are run after. */
+static const struct Scenario startupScenario = { "startup", SHAPE_TRIANGLE, 1, 1 };
+
+struct Result {
+	const char *scenario;
+	const char *metric;
+	double value;
+};
+
+struct Baseline {
+	char scenario[64];
+	char metric[32];
+	double value;
+	double threshold;	/* Negative to use --threshold. */
+};
+
+/* Every object is the sample's shape, scaled down and moved to its own */
+/* cell of a grid by two uniforms, so each is a draw call of its own.   */
+static const char *vertexShaderSource =
+	"#version 130\n"
+	"in vec3 aPos;\n"
+	"uniform vec2 offset;\n"
+	"uniform float scale;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(aPos.xy * scale + offset, aPos.z, 1.0);\n"
+	"}\0";
+
+static const char *fragmentShaderSource =
+	"#version 130\n"
+	"out vec4 FragColor;\n"
+	"void main(){\n"
+	"	FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
+	"}\0";
+
+struct Scene {
+	unsigned int program;
+	int offsetLocation;
+	int scaleLocation;
+	unsigned int VAO[2];
+	unsigned int VBO[2];
+	unsigned int EBO;
+};
+
+static unsigned int createShader(int type, const char *source){
+	unsigned int shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	int success;
+	char infoLog[512];
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if(!success){
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		fprintf(stderr, "ERROR: Shader compilation.\n%s", infoLog);
+		return 0;
+	}
+	return shader;
+}
+
+static int createProgram(struct Scene *scene){
+	unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
+	unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+	if(vertexShader == 0 || fragmentShader == 0)
+		return -1;
+
+	scene->program = glCreateProgram();
+	glAttachShader(scene->program, vertexShader);
+	glAttachShader(scene->program, fragmentShader);
+	glBindAttribLocation(scene->program, 0, "aPos");
+	glLinkProgram(scene->program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	int success;
+	char infoLog[512];
+	glGetProgramiv(scene->program, GL_LINK_STATUS, &success);
+	if(!success){
+		glGetProgramInfoLog(scene->program, 512, NULL, infoLog);
+		fprintf(stderr, "ERROR: Linking shaders.\n%s", infoLog);
+		return -1;
+	}
+
+	scene->offsetLocation = glGetUniformLocation(scene->program, "offset");
+	scene->scaleLocation = glGetUniformLocation(scene->program, "scale");
+	return 0;
+}
+
+static unsigned int createVAO(unsigned int *VBO, const float *vertices, size_t size){
+	unsigned int VAO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, *VBO);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
+	glEnableVertexAttribArray(0);
+	return VAO;
+}
+
+/* The vertices of the samples, as they are there. */
+static void createScene(struct Scene *scene, enum Shape shape){
+	static const float triangle[] = {
+		-0.5f, -0.5f, 0.0f,
+		 0.5f, -0.5f, 0.0f,
+		 0.0f,  0.5f, 0.0f
+	};
+	static const float rectangle[] = {
+		 0.5f,  0.5f, 0.0f,
+		 0.5f, -0.5f, 0.0f,
+		-0.5f, -0.5f, 0.0f,
+		-0.5f,  0.5f, 0.0f
+	};
+	static const unsigned int indices[] = {
+		0, 1, 3,
+		1, 2, 3
+	};
+	static const float leftTriangle[] = {
+		-0.75f, -0.5f, 0.0f,
+		-0.25f, -0.5f, 0.0f,
+		-0.5f,   0.0f, 0.0f
+	};
+	static const float rightTriangle[] = {
+		0.75f,  0.0f, 0.0f,
+		0.25f,  0.0f, 0.0f,
+		0.5f,  -0.5f, 0.0f
+	};
+
+	memset(scene->VAO, 0, sizeof(scene->VAO));
+	memset(scene->VBO, 0, sizeof(scene->VBO));
+	scene->EBO = 0;
+
+	switch(shape){
+		case SHAPE_TRIANGLE:
+			scene->VAO[0] = createVAO(&scene->VBO[0], triangle, sizeof(triangle));
+			break;
+		case SHAPE_RECTANGLE:
+			scene->VAO[0] = createVAO(&scene->VBO[0], rectangle, sizeof(rectangle));
+			glGenBuffers(1, &scene->EBO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene->EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+			break;
+		case SHAPE_TWO_VAO:
+			scene->VAO[0] = createVAO(&scene->VBO[0], leftTriangle, sizeof(leftTriangle));
+			scene->VAO[1] = createVAO(&scene->VBO[1], rightTriangle, sizeof(rightTriangle));
+			break;
+	}
+	glBindVertexArray(0);
+}
+
+static void deleteScene(struct Scene *scene){
+	glDeleteVertexArrays(2, scene->VAO);
+	glDeleteBuffers(2, scene->VBO);
+	glDeleteBuffers(1, &scene->EBO);
+}
+
+static void drawFrame(const struct Scene *scene, const struct Scenario *scenario){
+	unsigned int columns = (unsigned int) ceil(sqrt((double) scenario->objects));
+	float cell = 2.0f / columns;
+
+	glClearColor(0.2f, 0.3f, 0.2f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glUniform1f(scene->scaleLocation, cell);
+
+	if(scenario->shape != SHAPE_TWO_VAO)
+		glBindVertexArray(scene->VAO[0]);
+
+	for(unsigned int i = 0; i < scenario->objects; i++){
+		glUniform2f(scene->offsetLocation, -1.0f + cell * (i % columns + 0.5f),
+			    -1.0f + cell * (i / columns + 0.5f));
+		switch(scenario->shape){
+			case SHAPE_TRIANGLE:
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				break;
+			case SHAPE_RECTANGLE:
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+				break;
+			case SHAPE_TWO_VAO:
+				glBindVertexArray(scene->VAO[i & 1]);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				break;
+		}
+	}
+}
+
+/* -----------------------------------BASELINE-------------------------------- */
+
+static int readBaseline(const char *path, struct Baseline *baseline, unsigned int *count){
+	FILE *file = fopen(path, "r");
+	if(file == NULL){
+		perror("ERROR: Could not open the baseline");
+		return -1;
+	}
+
+	char line[256];
+	*count = 0;
+	while(fgets(line, sizeof(line), file) != NULL && *count < MAX_BASELINE){
+		struct Baseline *entry = &baseline[*count];
+		if(line[0] == '#')
+			continue;
+
+		int fields = sscanf(line, "%63s %31s %lf %lf", entry->scenario, entry->metric,
+				    &entry->value, &entry->threshold);
+		if(fields < 3)
+			continue;
+		if(fields == 3)
+			entry->threshold = -1.0;
+		(*count)++;
+	}
+	fclose(file);
+	return 0;
+}
+
+static int writeBaseline(const char *path, const struct Result *results, unsigned int count){
+	FILE *file = fopen(path, "w");
+	if(file == NULL){
+		perror("ERROR: Could not open the baseline");
+		return -1;
+	}
+
+	fprintf(file, "# scenario metric value [threshold]\n");
+	for(unsigned int i = 0; i < count; i++)
+		fprintf(file, "%s %s %.3f\n", results[i].scenario, results[i].metric, results[i].value);
+
+	if(fclose(file) != 0){
+		perror("ERROR: Could not write the baseline");
+		return -1;
+	}
+	return 0;
+}
+
+/* Returns how many results regressed beyond their threshold, counting	*/
+/* those whose baseline is zero or not a number.				*/
+static int compare(const struct Baseline *baseline, unsigned int baselineCount,
+		   const struct Result *results, unsigned int count, double threshold){
+	int regressions = 0;
+	for(unsigned int b = 0; b < baselineCount; b++){
+		const struct Baseline *entry = &baseline[b];
+		for(unsigned int r = 0; r < count; r++){
+			if(strcmp(entry->scenario, results[r].scenario) != 0 || strcmp(entry->metric, results[r].metric) != 0)
+				continue;
+
+			/* Nothing to take a relative change from, the baseline needs writing again. */
+			if(!(entry->value > 0.0) || !isfinite(entry->value)){
+				fprintf(stderr, "ERROR: Baseline %s %s is %g, not a positive number.\n", entry->scenario,
+					entry->metric, entry->value);
+				regressions++;
+				continue;
+			}
+
+			double allowed = entry->threshold >= 0.0 ? entry->threshold : threshold;
+			int lowerIsBetter = strcmp(entry->metric, "startup_ms") == 0;
+			double change = (results[r].value - entry->value) / entry->value;
+			if(lowerIsBetter)
+				change = -change;
+
+			int regressed = change < -allowed;
+			regressions += regressed;
+			printf("{\"compare\":\"%s\",\"metric\":\"%s\",\"baseline\":%.3f,\"value\":%.3f,"
+			       "\"change\":%.4f,\"threshold\":%.4f,\"regressed\":%s}\n", entry->scenario,
+			       entry->metric, entry->value, results[r].value, change, allowed,
+			       regressed ? "true" : "false");
+		}
+	}
+	return regressions;
+}
+
+/* -------------------------------------MAIN---------------------------------- */
+
+int main(int argc, char *argv[]){
+	uint64_t processStart = timerNow();
+
+	const char *only = NULL, *baselinePath = NULL, *writePath = NULL;
+	unsigned int frames = 0;
+	double threshold = DEFAULT_THRESHOLD;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--scenario") == 0 && i + 1 < argc)
+			only = argv[++i];
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = strtod(argv[++i], NULL);
+		else if(strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc)
+			writePath = argv[++i];
+		else {
+			fprintf(stderr, "ERROR: Unknown option %s.\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if(only != NULL){
+		size_t s = 0;
+		while(s < SCENARIO_COUNT && strcmp(only, scenarios[s].name) != 0)
+			s++;
+		if(s == SCENARIO_COUNT){
+			fprintf(stderr, "ERROR: No scenario named %s.\n", only);
+			return -1;
+		}
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "render_bench", NULL, NULL);
+	if(window == NULL){
+		glfwTerminate();
+		fprintf(stderr, "ERROR: Failed to create GLFW window.\n");
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+		fprintf(stderr, "ERROR: Failed to initialize GLAD.\n");
+		return -1;
+	}
+
+	/* Frames as fast as they can go, not at the refresh rate. */
+	glfwSwapInterval(0);
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	struct Scene scene;
+	if(createProgram(&scene) == -1)
+		return -1;
+	glUseProgram(scene.program);
+
+	struct Result results[SCENARIO_COUNT + 1];
+	unsigned int resultCount = 0;
+
+	/* Process start to the first frame presented, like a sample. */
+	createScene(&scene, startupScenario.shape);
+	drawFrame(&scene, &startupScenario);
+	glfwSwapBuffers(window);
+	glFinish();
+	results[resultCount++] = (struct Result) {
+		"startup", "startup_ms", TIMER_MILLISECONDS((double) (timerNow() - processStart))
+	};
+	printf("{\"scenario\":\"startup\",\"startup_ms\":%.3f}\n", results[resultCount - 1].value);
+	deleteScene(&scene);
+
+	for(size_t s = 0; s < SCENARIO_COUNT; s++){
+		const struct Scenario *scenario = &scenarios[s];
+		if(only != NULL && strcmp(only, scenario->name) != 0)
+			continue;
+
+		struct FrameStats *stats = frameStatsCreate();
+		if(stats == NULL){
+			fprintf(stderr, "ERROR: Out of memory.\n");
+			return -1;
+		}
+
+		createScene(&scene, scenario->shape);
+
+		/* One frame untimed, for the driver to settle on the new state. */
+		drawFrame(&scene, scenario);
+		glfwSwapBuffers(window);
+		glFinish();
+
+		unsigned int count = frames > 0 ? frames : scenario->frames;
+		uint64_t start = timerNow();
+		for(unsigned int f = 0; f < count; f++){
+			frameStatsBeginFrame(stats);
+			drawFrame(&scene, scenario);
+			frameStatsPhase(stats, FRAME_PHASE_SWAP);
+			glfwSwapBuffers(window);
+			frameStatsPhase(stats, FRAME_PHASE_EVENTS);
+			glfwPollEvents();
+			frameStatsEndFrame(stats);
+			frameStatsCollect(stats);
+		}
+		glFinish();
+		double seconds = (timerNow() - start) * 1e-9;
+
+		struct FrameSummary summary;
+		frameStatsSummary(stats, FRAME_PHASE_TOTAL, &summary);
+		double fps = count / seconds;
+		printf("{\"scenario\":\"%s\",\"objects\":%u,\"frames\":%u,\"fps\":%.3f,\"draws_per_second\":%.1f,"
+		       "\"frame_ms_p50\":%.3f,\"frame_ms_p99\":%.3f,\"frame_ms_max\":%.3f}\n",
+		       scenario->name, scenario->objects, count, fps, fps * scenario->objects,
+		       summary.p50, summary.p99, summary.max);
+		fflush(stdout);
+		results[resultCount++] = (struct Result) { scenario->name, "fps", fps };
+
+		deleteScene(&scene);
+		frameStatsDestroy(stats);
+	}
+
+	glDeleteProgram(scene.program);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	if(writePath != NULL && writeBaseline(writePath, results, resultCount) == -1)
+		return -1;
+
+	if(baselinePath != NULL){
+		struct Baseline baseline[MAX_BASELINE];
+		unsigned int baselineCount;
+		if(readBaseline(baselinePath, baseline, &baselineCount) == -1)
+			return -1;
+		if(compare(baseline, baselineCount, results, resultCount, threshold) > 0){
+			fprintf(stderr, "Performance regressed beyond the thresholds.\n");
+			return 1;
+		}
+	}
+	return 0;
+}
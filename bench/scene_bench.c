@@ -0,0 +1,106 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Scene graph update cost for a large, mostly static scene: groups of	*/
+/* objects, each a root with children and grandchildren, updated after	*/
+/* moving nothing, a few leaves, a few roots and everything.		*/
+/* Usage: scene_bench [nodes] [iterations]				*/
+
+#include <scene.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define GROUP_SIZE	200
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static float randomRange(float low, float high){
+	return low + (high - low) * (float) rand() / (float) RAND_MAX;
+}
+
+/* Moves count random nodes, or the roots of random groups, then updates. */
+static void run(struct SceneGraph *graph, const char *name, size_t count, int roots, int iterations){
+	size_t updated = 0;
+	double total = 0.0;
+
+	for(int i = 0; i < iterations; i++){
+		for(size_t k = 0; k < count; k++){
+			uint32_t node = (uint32_t) (rand() % graph->count);
+			if(roots)
+				node -= node % GROUP_SIZE;
+			sceneSetTranslation(graph, node, vec3(randomRange(-100, 100), 0, randomRange(-100, 100)));
+		}
+
+		double start = now();
+		updated = sceneUpdate(graph);
+		total += now() - start;
+	}
+	printf("%-12s %8zu moved %8zu updated %9.3f ms\n", name, count, updated, total / iterations * 1e3);
+}
+
+int main(int argc, char *argv[]){
+	size_t nodes = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+	struct SceneGraph graph = {0};
+	if(sceneReserve(&graph, nodes) == -1){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	/* Node 0 of a group is its root, the next few its children, the	*/
+	/* rest hang off those.						*/
+	srand(1);
+	for(size_t i = 0; i < nodes; i++){
+		size_t local = i % GROUP_SIZE;
+		uint32_t parent = local == 0 ? SCENE_NO_PARENT : (uint32_t) (i - local + (local < 8 ? 0 : local % 8));
+		struct Quat rotation = quatFromAxisAngle(vec3(0, 1, 0), randomRange(0, 6.28f));
+		sceneAddNode(&graph, parent, vec3(randomRange(-10, 10), randomRange(-10, 10), randomRange(-10, 10)),
+			     rotation, vec3(1, 1, 1));
+	}
+
+	printf("%zu nodes, %d iterations, %s\n", nodes, iterations,
+	       mathGetPath() == MATH_PATH_SCALAR ? "scalar" : "simd");
+
+	double start = now();
+	size_t updated = sceneUpdate(&graph);
+	printf("%-12s %8zu moved %8zu updated %9.3f ms\n", "build", nodes, updated, (now() - start) * 1e3);
+
+	run(&graph, "static", 0, 0, iterations);
+	run(&graph, "leaves", nodes / 100, 0, iterations);
+	run(&graph, "roots", 10, 1, iterations);
+
+	/* Everything, like the first update after loading. */
+	double total = 0.0;
+	for(int i = 0; i < iterations; i++){
+		for(uint32_t k = 0; k < nodes; k++)
+			sceneSetTranslation(&graph, k, vec3(graph.transforms[0][k], graph.transforms[1][k],
+							    graph.transforms[2][k]));
+		start = now();
+		updated = sceneUpdate(&graph);
+		total += now() - start;
+	}
+	printf("%-12s %8zu moved %8zu updated %9.3f ms\n", "everything", nodes, updated, total / iterations * 1e3);
+
+	sceneFree(&graph);
+	return 0;
+}
@@ -0,0 +1,191 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Frame times while textures stream in: decoding and uploading one	*/
+/* texture per frame on the render thread, against the texture loader	*/
+/* with the render loop only polling. Images are written to a temporary	*/
+/* directory first, alternating TGA and PPM.				*/
+/* Usage: texture_bench [textures] [size]				*/
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <texture_loader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WIDTH	800
+#define HEIGHT	600
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static int writeImage(const char *path, unsigned int size, unsigned int seed, int tga){
+	FILE *file = fopen(path, "wb");
+	if(file == NULL){
+		perror(path);
+		return -1;
+	}
+
+	if(tga){
+		unsigned char header[18] = { 0, 0, 2 };
+		header[12] = size & 0xFF;
+		header[13] = size >> 8;
+		header[14] = size & 0xFF;
+		header[15] = size >> 8;
+		header[16] = 32;
+		header[17] = 8;
+		fwrite(header, 1, sizeof(header), file);
+	} else
+		fprintf(file, "P6\n%u %u\n255\n", size, size);
+
+	unsigned int channels = tga ? 4 : 3;
+	unsigned char *row = malloc(size * channels);
+	for(unsigned int y = 0; y < size; y++){
+		for(unsigned int x = 0; x < size; x++){
+			unsigned char *pixel = row + x * channels;
+			pixel[0] = (unsigned char) (x + seed);
+			pixel[1] = (unsigned char) (y * 3);
+			pixel[2] = (unsigned char) ((x ^ y) + seed);
+			if(tga)
+				pixel[3] = 255;
+		}
+		fwrite(row, 1, size * channels, file);
+	}
+	free(row);
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+static void report(const char *name, unsigned int count, int frames, double total, double longest){
+	printf("%-8s %4u textures %8.1f ms total %5d frames, longest %7.2f ms\n",
+	       name, count, total * 1e3, frames, longest * 1e3);
+}
+
+static double frame(GLFWwindow *window, double *start){
+	glClear(GL_COLOR_BUFFER_BIT);
+	glfwSwapBuffers(window);
+	glfwPollEvents();
+
+	double end = now(), length = end - *start;
+	*start = end;
+	return length;
+}
+
+int main(int argc, char *argv[]){
+	unsigned int count = argc > 1 ? (unsigned int) atoi(argv[1]) : 32;
+	unsigned int size = argc > 2 ? (unsigned int) atoi(argv[2]) : 1024;
+
+	char directory[] = "/tmp/texture_bench.XXXXXX";
+	if(mkdtemp(directory) == NULL){
+		perror("mkdtemp");
+		return -1;
+	}
+	char (*paths)[64] = malloc(count * sizeof(*paths));
+	for(unsigned int i = 0; i < count; i++){
+		snprintf(paths[i], sizeof(paths[i]), "%s/%u.%s", directory, i, i % 2 ? "ppm" : "tga");
+		if(writeImage(paths[i], size, i, i % 2 == 0) == -1)
+			return -1;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "texture_bench", NULL, NULL);
+	if(window == NULL){
+		glfwTerminate();
+		fprintf(stderr, "ERROR: Failed to create GLFW window.\n");
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+		fprintf(stderr, "ERROR: Failed to initialize GLAD.\n");
+		return -1;
+	}
+	glfwSwapInterval(0);
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	unsigned int *textures = malloc(count * sizeof(unsigned int));
+	printf("%u x %ux%u\n", count, size, size);
+
+	/* Everything on the render thread, one texture per frame. */
+	double begin = now(), start = begin, longest = 0.0;
+	int frames = 0;
+	for(unsigned int i = 0; i < count; i++){
+		struct Image image;
+		if(imageImportFile(paths[i], &image) == -1)
+			return -1;
+		glGenTextures(1, &textures[i]);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei) image.width, (GLsizei) image.height, 0,
+			     GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+		imageFree(&image);
+
+		double length = frame(window, &start);
+		longest = length > longest ? length : longest;
+		frames++;
+	}
+	glFinish();
+	report("sync", count, frames, now() - begin, longest);
+	glDeleteTextures((GLsizei) count, textures);
+
+	struct TextureLoader *loader = textureLoaderCreate(window, 0);
+	if(loader == NULL)
+		return -1;
+
+	/* The render loop only polls. */
+	begin = now();
+	start = begin;
+	longest = 0.0;
+	frames = 0;
+	for(unsigned int i = 0; i < count; i++)
+		textureLoaderRequest(loader, paths[i], 0, &textures[i]);
+	while(textureLoaderPending(loader) > 0){
+		struct LoadedTexture loaded;
+		while(textureLoaderPoll(loader, &loaded)){
+			if(loaded.failed)
+				return -1;
+			*(unsigned int *) loaded.user = loaded.texture;
+		}
+
+		double length = frame(window, &start);
+		longest = length > longest ? length : longest;
+		frames++;
+	}
+	report("loader", count, frames, now() - begin, longest);
+	glDeleteTextures((GLsizei) count, textures);
+
+	textureLoaderDestroy(loader);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	for(unsigned int i = 0; i < count; i++)
+		unlink(paths[i]);
+	rmdir(directory);
+	free(paths);
+	free(textures);
+	return 0;
+}
@@ -0,0 +1,368 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Flies over a large texture, panning and zooming, drawn through a	*/
+/* virtual texture with a small page cache. Prints the cache traffic	*/
+/* and frame times, then holds still until every page is in and	*/
+/* compares the picture with the same texture fully resident.		*/
+/* Without a file a synthetic texture of size texels square is baked	*/
+/* to vt_bench.vtex first.						*/
+/* Usage: vt_bench [file.vtex | size] [slots] [frames]			*/
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <mipmap.h>
+#include <virtual_texture.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WIDTH		800
+#define HEIGHT		600
+#define FEEDBACK_SCALE	8
+#define SETTLE_FRAMES	120
+
+static const char *vertexShaderSource =
+	"#version 130\n"
+	"in vec2 aPos;\n"
+	"uniform vec2 offset;\n"
+	"uniform float zoom;\n"
+	"out vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"	uv = (aPos * 0.5 + 0.5) * zoom + offset;\n"
+	"	gl_Position = vec4(aPos, 0.0, 1.0);\n"
+	"}\0";
+
+static const char *feedbackShaderSource =
+	"in vec2 uv;\n"
+	"out vec4 FragColor;\n"
+	"void main(){\n"
+	"	FragColor = vtFeedback(uv);\n"
+	"}\0";
+
+static const char *sampleShaderSource =
+	"in vec2 uv;\n"
+	"out vec4 FragColor;\n"
+	"void main(){\n"
+	"	FragColor = vtSample(uv);\n"
+	"}\0";
+
+static const char *referenceShaderSource =
+	"#version 130\n"
+	"in vec2 uv;\n"
+	"uniform sampler2D image;\n"
+	"uniform vec2 scale;\n"
+	"out vec4 FragColor;\n"
+	"void main(){\n"
+	"	FragColor = texture(image, clamp(uv, 0.0, 1.0) * scale);\n"
+	"}\0";
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* Rings and a grid, detailed enough that every level looks different. */
+static void makeImage(struct Image *image, unsigned int size){
+	image->width = image->height = size;
+	image->pixels = malloc((size_t) size * size * 4);
+	for(unsigned int y = 0; y < size; y++){
+		for(unsigned int x = 0; x < size; x++){
+			unsigned char *pixel = image->pixels + ((size_t) y * size + x) * 4;
+			float dx = (float) x - size * 0.5f, dy = (float) y - size * 0.5f;
+			pixel[0] = (unsigned char) (127.5f + 127.5f * sinf(sqrtf(dx * dx + dy * dy) * 0.05f));
+			pixel[1] = (unsigned char) ((x / 64 + y / 64) % 2 ? 200 : 40);
+			pixel[2] = (unsigned char) (x ^ y);
+			pixel[3] = 255;
+		}
+	}
+}
+
+static unsigned int createShader(int type, const char *prefix, const char *source){
+	const char *sources[3] = { "#version 130\n", prefix, source };
+	unsigned int shader = glCreateShader(type);
+	if(prefix != NULL)
+		glShaderSource(shader, 3, sources, NULL);
+	else
+		glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	int success;
+	char infoLog[512];
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if(!success){
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		fprintf(stderr, "ERROR: Shader compilation.\n%s", infoLog);
+		return 0;
+	}
+	return shader;
+}
+
+static unsigned int createProgram(const char *prefix, const char *fragmentSource){
+	unsigned int vertexShader = createShader(GL_VERTEX_SHADER, NULL, vertexShaderSource);
+	unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, prefix, fragmentSource);
+	if(vertexShader == 0 || fragmentShader == 0)
+		return 0;
+
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glBindAttribLocation(program, 0, "aPos");
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	int success;
+	char infoLog[512];
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if(!success){
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		fprintf(stderr, "ERROR: Linking shaders.\n%s", infoLog);
+		return 0;
+	}
+	return program;
+}
+
+/* The whole texture the usual way, to compare with. */
+static unsigned int loadReference(const char *path){
+	FILE *file = fopen(path, "rb");
+	struct VTFileHeader header;
+	if(file == NULL || fread(&header, sizeof(header), 1, file) != 1){
+		fprintf(stderr, "ERROR: Failed to read %s.\n", path);
+		return 0;
+	}
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) header.levelCount - 1);
+
+	/* Put the levels back together from the pages, borders left out. */
+	unsigned char *tile = malloc(VT_TILE_BYTES);
+	for(unsigned int level = 0; level < header.levelCount; level++){
+		const struct VTLevel *info = &header.levels[level];
+		unsigned int width = header.paddedWidth >> level, height = header.paddedHeight >> level;
+		width = width ? width : 1;
+		height = height ? height : 1;
+		glTexImage2D(GL_TEXTURE_2D, (GLint) level, header.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, (GLsizei) width,
+			     (GLsizei) height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, VT_TILE_SIZE);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, VT_PAGE_BORDER);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, VT_PAGE_BORDER);
+		fseek(file, (long) ((sizeof(header) + VT_FILE_ALIGNMENT - 1) / VT_FILE_ALIGNMENT * VT_FILE_ALIGNMENT +
+				    (size_t) info->firstTile * VT_TILE_BYTES), SEEK_SET);
+		for(unsigned int y = 0; y < info->pagesY; y++){
+			for(unsigned int x = 0; x < info->pagesX; x++){
+				if(fread(tile, VT_TILE_BYTES, 1, file) != 1){
+					fprintf(stderr, "ERROR: %s is truncated.\n", path);
+					return 0;
+				}
+				unsigned int left = x * VT_PAGE_SIZE, bottom = y * VT_PAGE_SIZE;
+				unsigned int w = width - left < VT_PAGE_SIZE ? width - left : VT_PAGE_SIZE;
+				unsigned int h = height - bottom < VT_PAGE_SIZE ? height - bottom : VT_PAGE_SIZE;
+				glTexSubImage2D(GL_TEXTURE_2D, (GLint) level, (GLint) left, (GLint) bottom, (GLsizei) w,
+						(GLsizei) h, GL_RGBA, GL_UNSIGNED_BYTE, tile);
+			}
+		}
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	free(tile);
+	fclose(file);
+	return texture;
+}
+
+/* uv across the screen is offset + zoom * [0, 1]. */
+static void setView(unsigned int program, float x, float y, float zoom){
+	glUniform2f(glGetUniformLocation(program, "offset"), x, y);
+	glUniform1f(glGetUniformLocation(program, "zoom"), zoom);
+}
+
+/* Across the texture and back, zooming in and out along the way. */
+static void flightView(int frame, int frames, float *x, float *y, float *zoom){
+	float t = (float) frame / (float) frames;
+	*zoom = 0.02f + 0.5f * (0.5f + 0.5f * cosf(t * 6.2831853f * 2.0f));
+	*x = (0.5f + 0.45f * sinf(t * 6.2831853f)) - *zoom * 0.5f;
+	*y = (0.5f + 0.45f * sinf(t * 6.2831853f * 1.5f)) - *zoom * 0.5f;
+}
+
+static void drawVirtual(struct VirtualTexture *vt, unsigned int feedbackProgram, unsigned int sampleProgram,
+			float x, float y, float zoom){
+	vtUpdate(vt);
+
+	vtBeginFeedback(vt);
+	glUseProgram(feedbackProgram);
+	vtBind(vt, feedbackProgram, 1, 1);
+	setView(feedbackProgram, x, y, zoom);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	vtEndFeedback(vt);
+
+	glUseProgram(sampleProgram);
+	vtBind(vt, sampleProgram, 1, 0);
+	setView(sampleProgram, x, y, zoom);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+static double meanDifference(const unsigned char *a, const unsigned char *b, size_t size){
+	double total = 0.0;
+	for(size_t i = 0; i < size; i++)
+		total += abs(a[i] - b[i]);
+	return total / size;
+}
+
+int main(int argc, char *argv[]){
+	const char *path = "vt_bench" VT_FILE_EXTENSION;
+	unsigned int size = 4096;
+	if(argc > 1 && strstr(argv[1], VT_FILE_EXTENSION))
+		path = argv[1];
+	else if(argc > 1)
+		size = (unsigned int) atoi(argv[1]);
+	unsigned int slots = argc > 2 ? (unsigned int) atoi(argv[2]) : 256;
+	int frames = argc > 3 ? atoi(argv[3]) : 600;
+
+	if(path != argv[1]){
+		struct Image image;
+		makeImage(&image, size);
+		struct JobSystem *jobs = jobSystemCreate(0);
+		double begin = now();
+		if(jobs == NULL || vtBake(&image, path, 0, jobs) == -1)
+			return -1;
+		printf("baked %ux%u in %.1f ms\n", size, size, (now() - begin) * 1e3);
+		jobSystemDestroy(jobs);
+		imageFree(&image);
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "vt_bench", NULL, NULL);
+	if(window == NULL){
+		glfwTerminate();
+		fprintf(stderr, "ERROR: Failed to create GLFW window.\n");
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if(!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)){
+		fprintf(stderr, "ERROR: Failed to initialize GLAD.\n");
+		return -1;
+	}
+	glfwSwapInterval(0);
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	unsigned int feedbackProgram = createProgram(vtShaderSource, feedbackShaderSource);
+	unsigned int sampleProgram = createProgram(vtShaderSource, sampleShaderSource);
+	unsigned int referenceProgram = createProgram(NULL, referenceShaderSource);
+	if(feedbackProgram == 0 || sampleProgram == 0 || referenceProgram == 0)
+		return -1;
+
+	static const float quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	unsigned int VAO, VBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *) 0);
+	glEnableVertexAttribArray(0);
+
+	struct VirtualTexture *vt = vtCreate(path, slots, WIDTH, HEIGHT, FEEDBACK_SCALE);
+	if(vt == NULL)
+		return -1;
+
+	double begin = now(), start = begin, longest = 0.0;
+	for(int i = 0; i < frames; i++){
+		float x, y, zoom;
+		flightView(i, frames, &x, &y, &zoom);
+		drawVirtual(vt, feedbackProgram, sampleProgram, x, y, zoom);
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		double end = now();
+		longest = end - start > longest ? end - start : longest;
+		start = end;
+	}
+	double total = now() - begin;
+
+	struct VTStats stats;
+	vtGetStats(vt, &stats);
+	FILE *file = fopen(path, "rb");
+	struct VTFileHeader header;
+	if(file == NULL || fread(&header, sizeof(header), 1, file) != 1)
+		return -1;
+	fclose(file);
+	unsigned int slotsX = (unsigned int) ceil(sqrt((double) stats.slots));
+	unsigned int slotsY = (unsigned int) ((stats.slots + slotsX - 1) / slotsX);
+	printf("%ux%u, %u levels, %u pages, %zu slots\n", header.width, header.height, header.levelCount,
+	       header.tileCount, stats.slots);
+	printf("cache %.1f MB, whole texture %.1f MB\n",
+	       (double) slotsX * slotsY * VT_TILE_BYTES / (1 << 20), header.width * (double) header.height * 4.0 *
+	       4.0 / 3.0 / (1 << 20));
+	printf("%d frames %.2f ms average, longest %.2f ms\n", frames, total * 1e3 / frames, longest * 1e3);
+	printf("%llu requested, %llu uploaded, %llu evicted, %zu resident\n",
+	       (unsigned long long) stats.requested, (unsigned long long) stats.uploaded,
+	       (unsigned long long) stats.evicted, stats.resident);
+
+	/* Hold the last view until the pages stop coming, then compare. */
+	float x, y, zoom;
+	flightView(frames / 3, frames, &x, &y, &zoom);
+	for(int i = 0; i < SETTLE_FRAMES; i++){
+		drawVirtual(vt, feedbackProgram, sampleProgram, x, y, zoom);
+		glfwSwapBuffers(window);
+	}
+	drawVirtual(vt, feedbackProgram, sampleProgram, x, y, zoom);
+	unsigned char *pixels = malloc(WIDTH * HEIGHT * 4 * 2);
+	glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	unsigned int reference = loadReference(path);
+	if(reference == 0)
+		return -1;
+	glUseProgram(referenceProgram);
+	glBindTexture(GL_TEXTURE_2D, reference);
+	glUniform1i(glGetUniformLocation(referenceProgram, "image"), 0);
+	glUniform2f(glGetUniformLocation(referenceProgram, "scale"), (float) header.width / header.paddedWidth,
+		    (float) header.height / header.paddedHeight);
+	setView(referenceProgram, x, y, zoom);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels + WIDTH * HEIGHT * 4);
+	printf("after %d still frames, mean difference from the resident texture %.3f\n", SETTLE_FRAMES,
+	       meanDifference(pixels, pixels + WIDTH * HEIGHT * 4, WIDTH * HEIGHT * 4));
+
+	free(pixels);
+	glDeleteTextures(1, &reference);
+	vtDestroy(vt);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteProgram(feedbackProgram);
+	glDeleteProgram(sampleProgram);
+	glDeleteProgram(referenceProgram);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
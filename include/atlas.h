@@ -0,0 +1,162 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <image.h>
+#include <mesh.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Texture atlases: many small images in a few large textures, so meshes	*/
+/* using different images can still share one bind and one draw. Each	*/
+/* image keeps a gutter of its own edge pixels around it, so filtering	*/
+/* never reads a neighbour. Texture coordinates must stay in [0, 1]:	*/
+/* repeating across an image needs a texture of its own.		*/
+
+struct AtlasRect {
+	unsigned int x;			/* Of the image, inside its gutter. */
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+	unsigned int page;
+};
+
+/* ------------------------------------OFFLINE-------------------------------- */
+
+/* MaxRects with best short side fit, biggest images first. Fills in x,	*/
+/* y and page of every rect from its width and height, opening as many	*/
+/* pages as it takes. Returns 0 on success, -1 if a rect is too big for	*/
+/* a page or out of memory.						*/
+int atlasPack(struct AtlasRect *rects, size_t count, unsigned int pageWidth, unsigned int pageHeight,
+	      unsigned int padding, unsigned int *pageCount);
+
+/* Copy the image to (x, y) of an RGBA8 target, then repeat its edge	*/
+/* pixels outwards over padding pixels on every side.			*/
+void atlasCopy(unsigned char *target, unsigned int targetWidth, const struct Image *image,
+	       unsigned int x, unsigned int y, unsigned int padding);
+
+/* ------------------------------------RUNTIME-------------------------------- */
+
+/* Skyline bottom left allocator for images that come and go at run	*/
+/* time, such as glyphs or thumbnails. Single rects are never freed:	*/
+/* once full, reset it and add back what is still needed.		*/
+struct SkylineNode {
+	unsigned int x;
+	unsigned int y;
+	unsigned int width;
+};
+
+struct AtlasAllocator {
+	unsigned int width;
+	unsigned int height;
+	unsigned int padding;
+	struct SkylineNode *nodes;
+	size_t nodeCount;
+	size_t nodeCapacity;
+	size_t used;			/* Pixels taken, gutters included. */
+};
+
+int atlasAllocatorInit(struct AtlasAllocator *allocator, unsigned int width, unsigned int height,
+		       unsigned int padding);
+
+/* Sets x and y of rect from its width and height. Returns -1 if full. */
+int atlasAllocate(struct AtlasAllocator *allocator, struct AtlasRect *rect);
+
+void atlasAllocatorReset(struct AtlasAllocator *allocator);
+void atlasAllocatorFree(struct AtlasAllocator *allocator);
+
+/* An RGBA8 texture filled by an allocator with glTexSubImage2D(). */
+struct AtlasTexture {
+	unsigned int texture;
+	struct AtlasAllocator allocator;
+	unsigned char *scratch;		/* One image with its gutter. */
+	size_t scratchSize;
+};
+
+/* Needs a current context. Returns 0 on success, -1 on failure. */
+int atlasTextureCreate(struct AtlasTexture *atlas, unsigned int width, unsigned int height,
+		       unsigned int padding);
+
+/* Allocate room for the image and upload it. Returns -1 when the atlas	*/
+/* is full, after which atlasTextureReset() starts over.		*/
+int atlasTextureAdd(struct AtlasTexture *atlas, const struct Image *image, struct AtlasRect *rect);
+
+/* Forget every image. Their pixels stay until overwritten, so draws	*/
+/* already submitted are unaffected.					*/
+void atlasTextureReset(struct AtlasTexture *atlas);
+void atlasTextureDestroy(struct AtlasTexture *atlas);
+
+/* ------------------------------------REMAP---------------------------------- */
+
+/* Where an image's [0, 1] texture coordinates land in its page, as a	*/
+/* scale and offset: { sx, sy, ox, oy }, uv' = uv * s + o. Meant for a	*/
+/* uniform or an instance attribute.					*/
+void atlasTransform(const struct AtlasRect *rect, unsigned int pageWidth, unsigned int pageHeight,
+		    float *transform);
+
+/* Apply a transform to the texture coordinates of a mesh, so it can be	*/
+/* merged with other meshes of the same page into one draw.		*/
+void atlasRemapMesh(struct Mesh *mesh, const float *transform);
+
+/* ------------------------------------FILE----------------------------------- */
+
+/* The table atlas_bake writes beside the pages. Page n of foo.atlas	*/
+/* is the texture file foo.n.tex.					*/
+#define ATLAS_FILE_MAGIC	"CGLA"
+#define ATLAS_FILE_VERSION	1
+#define ATLAS_FILE_EXTENSION	".atlas"
+#define ATLAS_NAME_SIZE		64
+
+struct AtlasFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t pageWidth;
+	uint32_t pageHeight;
+	uint32_t pageCount;
+	uint32_t entryCount;
+};
+
+struct AtlasEntry {
+	char name[ATLAS_NAME_SIZE];	/* Image file name without the directory. */
+	uint32_t page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+	float transform[4];		/* As from atlasTransform(). */
+};
+
+struct AtlasFile {
+	struct AtlasFileHeader header;
+	struct AtlasEntry *entries;
+};
+
+/* Both return 0 on success, -1 on failure with the reason on stderr. */
+int atlasFileWrite(const char *path, const struct AtlasFileHeader *header, const struct AtlasEntry *entries);
+int atlasFileRead(const char *path, struct AtlasFile *file);
+
+/* Linear search, meant for load time. NULL if there is no such image. */
+const struct AtlasEntry *atlasFileFind(const struct AtlasFile *file, const char *name);
+
+/* Path of a page's texture file. Returns -1 if it does not fit. */
+int atlasPagePath(const char *path, unsigned int page, char *buffer, size_t size);
+
+void atlasFileFree(struct AtlasFile *file);
+
+#endif
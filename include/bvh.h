@@ -0,0 +1,71 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <cull.h>
+
+/* Bounding volume hierarchy over the boxes of a BoundsTable.		*/
+/* Node 0 is the root. The children of an inner node are next to each	*/
+/* other at first and first + 1. A leaf holds count objects, listed at	*/
+/* objects[first] onwards.						*/
+struct BVHNode {
+	float min[3];
+	float max[3];
+	unsigned int first;
+	unsigned int count;	/* 0 for inner nodes. */
+};
+
+struct BVH {
+	struct BVHNode *nodes;
+	unsigned int nodeCount;
+
+	unsigned int *objects;
+	unsigned int objectCount;
+
+	/* Needed to refit only the parts of the tree that moved. */
+	unsigned int *parents;
+	unsigned int *leafOf;
+};
+
+/* Binned SAH build. Returns 0 on success, -1 if out of memory. */
+int bvhBuild(struct BVH *bvh, const struct BoundsTable *bounds);
+
+/* Grow the boxes to the objects' current bounds, keeping the tree shape.	*/
+/* The whole tree, or only the paths from the moved objects to the root.	*/
+/* Rebuild once objects have moved far enough for the boxes to overlap a lot. */
+void bvhRefit(struct BVH *bvh, const struct BoundsTable *bounds);
+void bvhRefitObjects(struct BVH *bvh, const struct BoundsTable *bounds,
+		     const unsigned int *moved, size_t count);
+
+/* Same contract as cullBoxes() except that visible is in tree order. */
+size_t bvhCullFrustum(const struct BVH *bvh, const struct BoundsTable *bounds,
+		      const struct Frustum *frustum, unsigned int *visible);
+
+/* Exact test for one object, for picking triangles rather than boxes.	*/
+/* Returns 1 and sets distance if the ray hits the object.		*/
+typedef int (*BVHRayTest)(void *user, unsigned int object, const float *origin,
+			  const float *direction, float *distance);
+
+/* Nearest object hit by the ray, or -1. test may be NULL to pick by box. */
+long bvhRaycast(const struct BVH *bvh, const struct BoundsTable *bounds, const float *origin,
+		const float *direction, BVHRayTest test, void *user, float *distance);
+
+void bvhFree(struct BVH *bvh);
+
+#endif
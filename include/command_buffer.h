@@ -0,0 +1,92 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <glad/glad.h>
+#include <jobs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* GL calls recorded into memory, so any thread can prepare a part of	*/
+/* the frame while only the thread owning the context replays them.	*/
+/*									*/
+/* A buffer is a sequence of items, each a short run of commands with	*/
+/* a sort key, typically the state and uniforms of one object and its	*/
+/* draw. commandBufferSort() orders the items by key, keeping recording	*/
+/* order for equal keys, and commandBuffersExecute() replays buffer	*/
+/* after buffer, skipping binds of what is already bound. A buffer is	*/
+/* only ever used by one thread at a time and keeps its memory between	*/
+/* frames, so recording is a linear allocation once it has warmed up.	*/
+
+/* Sorting by program, then vertex array, then front to back is a good	*/
+/* default. Keys of 0 sort first, e.g. for a clear.			*/
+#define COMMAND_SORT_KEY(program, vertexArray, depth) \
+	(((uint64_t) ((program) & 0xFFFF) << 48) | ((uint64_t) ((vertexArray) & 0xFFFF) << 32) | (uint32_t) (depth))
+
+struct CommandItem {
+	uint64_t key;
+	uint32_t offset;
+	uint32_t size;
+};
+
+struct CommandBuffer {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+
+	struct CommandItem *items;
+	size_t itemCount;
+	size_t itemCapacity;
+
+	int failed;		/* Ran out of memory since the last reset. */
+};
+
+/* Forget the commands, keeping the memory. A zeroed buffer is empty. */
+void commandBufferReset(struct CommandBuffer *buffer);
+void commandBufferFree(struct CommandBuffer *buffer);
+
+/* Start a new item. Commands recorded before any item go into one with	*/
+/* a key of 0.								*/
+void commandBufferBegin(struct CommandBuffer *buffer, uint64_t key);
+void commandBufferSort(struct CommandBuffer *buffer);
+
+void commandClear(struct CommandBuffer *buffer, GLbitfield mask, float r, float g, float b, float a);
+void commandUseProgram(struct CommandBuffer *buffer, GLuint program);
+void commandBindVertexArray(struct CommandBuffer *buffer, GLuint vertexArray);
+/* count is 1 to 4 floats. */
+void commandUniform(struct CommandBuffer *buffer, GLint location, unsigned int count, const float *values);
+void commandUniformMatrix4(struct CommandBuffer *buffer, GLint location, const float *matrix);
+void commandDrawArrays(struct CommandBuffer *buffer, GLenum mode, GLint first, GLsizei count);
+void commandDrawElements(struct CommandBuffer *buffer, GLenum mode, GLsizei count, GLenum type, size_t offset);
+/* The data is copied into the buffer. */
+void commandBufferSubData(struct CommandBuffer *buffer, GLenum target, GLuint object,
+			  size_t offset, size_t size, const void *data);
+
+/* Record into count buffers at once, record(user, index, buffer) as a	*/
+/* job each, or one after the other if jobs is NULL. Buffers are reset	*/
+/* first and sorted after.						*/
+typedef void (*CommandRecordFunction)(void *user, unsigned int index, struct CommandBuffer *buffer);
+void commandBuffersRecord(struct JobSystem *jobs, struct CommandBuffer *buffers, unsigned int count,
+			  CommandRecordFunction record, void *user);
+
+/* On the GL thread. Returns the number of draws, or -1 if a buffer ran	*/
+/* out of memory while recording, in which case nothing is replayed.	*/
+long commandBuffersExecute(struct CommandBuffer *buffers, unsigned int count);
+
+#endif
@@ -0,0 +1,81 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef CULL_H
+#define CULL_H
+
+#include <stddef.h>
+
+/* Planes as (a, b, c, d) with unit normals pointing inside:	*/
+/*	a * x + b * y + c * z + d >= 0 for points inside.	*/
+enum FrustumPlane {
+	FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP, FRUSTUM_NEAR, FRUSTUM_FAR
+};
+
+struct Frustum {
+	float planes[6][4];
+};
+
+/* Extract the planes from a column major matrix, as glUniformMatrix4fv	*/
+/* takes it without transposing. With a view-projection matrix the planes	*/
+/* are in world space, with only a projection they are in view space.	*/
+void frustumFromMatrix(struct Frustum *frustum, const float *matrix);
+
+/* Object bounds kept as structure of arrays, so one SIMD load reads the	*/
+/* same field of several objects. Every object has a bounding sphere and	*/
+/* an axis aligned box, both around the same center.			*/
+struct BoundsTable {
+	float *centerX;
+	float *centerY;
+	float *centerZ;
+	float *radius;
+	float *extentX;		/* Half sizes of the box. */
+	float *extentY;
+	float *extentZ;
+	size_t count;
+	size_t capacity;
+};
+
+int boundsTableReserve(struct BoundsTable *table, size_t capacity);
+
+/* Returns the index of the new object, or -1 if out of memory. */
+long boundsTableAdd(struct BoundsTable *table, const float *center, const float *extent);
+
+/* The radius is worked out from the extents. */
+void boundsTableSet(struct BoundsTable *table, size_t index, const float *center, const float *extent);
+
+void boundsTableFree(struct BoundsTable *table);
+
+enum CullPath {
+	CULL_PATH_AUTO,		/* Fastest the CPU supports. */
+	CULL_PATH_SCALAR,
+	CULL_PATH_SSE,
+	CULL_PATH_AVX2
+};
+
+/* Mostly for benchmarks. Returns -1 if the CPU cannot run the path. */
+int cullSetPath(enum CullPath path);
+enum CullPath cullGetPath(void);
+
+/* Write the indices of the objects touching the frustum to visible,	*/
+/* which must have room for table->count of them, in increasing order.	*/
+/* Returns how many were written. Spheres are the cheaper test, boxes	*/
+/* cull more for long thin objects.					*/
+size_t cullSpheres(const struct BoundsTable *table, const struct Frustum *frustum, unsigned int *visible);
+size_t cullBoxes(const struct BoundsTable *table, const struct Frustum *frustum, unsigned int *visible);
+
+#endif
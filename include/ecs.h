@@ -0,0 +1,175 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef ECS_H
+#define ECS_H
+
+#include <cull.h>
+#include <gl_handles.h>
+#include <jobs.h>
+#include <vecmath.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Renderable objects as entities with components, stored by archetype:	*/
+/* every entity with the same set of components lives in the same table,	*/
+/* one array per field, so a system touching one field of a million	*/
+/* entities streams through one contiguous array instead of striding	*/
+/* over whole objects. Adding or removing a component moves the entity	*/
+/* to another table, removing one moves the last row into the hole.	*/
+/*									*/
+/* Entities are referred to by handles with a generation, as in		*/
+/* gl_handles.h, so a destroyed entity's handle is caught.		*/
+#define ECS_INDEX_BITS		22
+#define ECS_MAX_ENTITIES	(1u << ECS_INDEX_BITS)
+
+/* A value of 0 is never a valid entity. */
+typedef struct { uint32_t value; } Entity;
+
+enum EcsComponent {
+	ECS_TRANSFORM,		/* Translation, rotation and scale, and the matrix. */
+	ECS_BOUNDS,		/* Box in object space, and in world space for culling. */
+	ECS_MESH,
+	ECS_MATERIAL,
+	ECS_COMPONENT_COUNT
+};
+
+#define ECS_HAS(component)	(1u << (component))
+#define ECS_ARCHETYPES		(1u << ECS_COMPONENT_COUNT)
+
+struct EcsMesh {
+	VertexArrayHandle vertexArray;
+	uint32_t first;			/* Range of indices to draw. */
+	uint32_t count;
+};
+
+/* Rows [0, count) are entities, columns of components outside mask are	*/
+/* NULL. Columns are 32 byte aligned and capacity is a multiple of 8,	*/
+/* as cull.h wants.							*/
+struct EcsArchetype {
+	uint32_t mask;
+	size_t count;
+	size_t capacity;
+
+	Entity *entities;
+
+	/* ECS_TRANSFORM, in the order of struct TRSArrays, and the matrix	*/
+	/* made from them by ecsUpdateTransforms().				*/
+	float *transforms[10];
+	struct Mat4 *worlds;
+
+	/* ECS_BOUNDS: center x, y, z and half sizes x, y, z in object	*/
+	/* space. bounds is the box around them in world space, kept up to	*/
+	/* date by ecsUpdateTransforms() and ready for cullBoxes(); its	*/
+	/* count is always the archetype's.					*/
+	float *localBounds[6];
+	struct BoundsTable bounds;
+
+	struct EcsMesh *meshes;
+	uint32_t *materials;
+
+	/* Rows whose transform or bounds changed, [dirtyFirst, dirtyEnd). */
+	size_t dirtyFirst;
+	size_t dirtyEnd;
+};
+
+struct EcsWorld {
+	struct EcsArchetype archetypes[ECS_ARCHETYPES];	/* By mask. */
+
+	/* By entity index. */
+	uint32_t *generations;
+	uint32_t *rows;
+	unsigned char *masks;
+	uint32_t *freeSlots;
+	size_t freeCount;
+	size_t count;			/* Slots ever used. */
+	size_t capacity;
+	size_t live;
+};
+
+void ecsInit(struct EcsWorld *world);
+
+/* Room for capacity entities in all and capacity rows in the archetype	*/
+/* for mask, so creating them does not reallocate. Returns 0 on success, */
+/* -1 if out of memory.							*/
+int ecsReserve(struct EcsWorld *world, uint32_t mask, size_t capacity);
+
+/* New entity with the components in mask: an identity transform, empty	*/
+/* bounds, no mesh and material 0. Returns an entity of 0 if out of	*/
+/* memory or slots.							*/
+Entity ecsCreate(struct EcsWorld *world, uint32_t mask);
+
+/* Returns -1 and prints an error if the entity was already stale. */
+int ecsDestroy(struct EcsWorld *world, Entity entity);
+
+int ecsAlive(const struct EcsWorld *world, Entity entity);
+
+/* Move the entity to the archetype with or without the components in	*/
+/* mask. Added components get the defaults ecsCreate() gives. Returns	*/
+/* -1 if the entity is stale or out of memory.				*/
+int ecsAddComponents(struct EcsWorld *world, Entity entity, uint32_t mask);
+int ecsRemoveComponents(struct EcsWorld *world, Entity entity, uint32_t mask);
+
+/* The archetype and row the entity is in until it is next moved, or	*/
+/* NULL if stale.							*/
+struct EcsArchetype *ecsLocate(struct EcsWorld *world, Entity entity, size_t *row);
+
+/* Return -1 if the entity is stale or does not have the component. */
+int ecsSetTransform(struct EcsWorld *world, Entity entity, struct Vec3 translation,
+		    struct Quat rotation, struct Vec3 scale);
+int ecsSetBounds(struct EcsWorld *world, Entity entity, const float *center, const float *extent);
+int ecsSetMesh(struct EcsWorld *world, Entity entity, struct EcsMesh mesh);
+int ecsSetMaterial(struct EcsWorld *world, Entity entity, uint32_t material);
+
+/* Flag rows whose transform or bounds columns a system wrote directly,	*/
+/* for the next ecsUpdateTransforms(). Not safe to call from several	*/
+/* threads on the same archetype.					*/
+void ecsMarkChanged(struct EcsArchetype *archetype, size_t first, size_t last);
+
+/* Archetypes with every component in required and none in excluded	*/
+/* and at least one entity:						*/
+/*	struct EcsQuery query = ecsQuery(required, excluded);		*/
+/*	struct EcsArchetype *archetype;					*/
+/*	while((archetype = ecsQueryNext(world, &query)) != NULL)	*/
+/*		for(size_t i = 0; i < archetype->count; i++) ...	*/
+struct EcsQuery {
+	uint32_t required;
+	uint32_t excluded;
+	uint32_t next;
+};
+
+static inline struct EcsQuery ecsQuery(uint32_t required, uint32_t excluded){
+	return (struct EcsQuery) { required, excluded, 0 };
+}
+
+struct EcsArchetype *ecsQueryNext(struct EcsWorld *world, struct EcsQuery *query);
+
+/* function(user, archetype, first, last) over the rows of every	*/
+/* archetype the query matches, split in ranges of grain rows across	*/
+/* jobs, or in one call per archetype if jobs is NULL. Keep grain a	*/
+/* multiple of 8 to hand ranges of bounds to the SIMD cull paths.	*/
+typedef void (*EcsRangeFunction)(void *user, struct EcsArchetype *archetype, size_t first, size_t last);
+void ecsForEach(struct EcsWorld *world, struct JobSystem *jobs, uint32_t required, uint32_t excluded,
+		size_t grain, EcsRangeFunction function, void *user);
+
+/* Rebuild the matrices and world bounds of the rows that changed since	*/
+/* the last call. jobs may be NULL. Returns how many rows were updated.	*/
+size_t ecsUpdateTransforms(struct EcsWorld *world, struct JobSystem *jobs);
+
+void ecsFree(struct EcsWorld *world);
+
+#endif
@@ -0,0 +1,34 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef FENCE_H
+#define FENCE_H
+
+#include <glad/glad.h>
+
+/* Fences put with glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0). A NULL	*/
+/* fence, what callers keep without GL_ARB_sync, counts as passed.	*/
+
+/* 1 if the GPU has passed fence. Never waits. */
+int fenceSignaled(GLsync fence);
+
+/* Block until the GPU has passed fence, flushing it first in case it	*/
+/* was never submitted. Returns 1 if it had to wait, 0 if the fence had	*/
+/* already passed, -1 if waiting failed, printed to stderr.		*/
+int fenceWait(GLsync fence);
+
+#endif
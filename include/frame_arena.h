@@ -0,0 +1,69 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <glad/glad.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Memory for data living one frame, such as draw lists and visible	*/
+/* sets. Allocating is bumping an offset, freeing is resetting it. There	*/
+/* is one region per frame in flight: a region is only reused once the	*/
+/* fence put after its frame has passed, so the GPU may still read what	*/
+/* was allocated last frame while this one is being prepared. Without	*/
+/* GL_ARB_sync the regions are reused without waiting.			*/
+#define FRAME_ARENA_FRAMES	2
+
+struct FrameArena {
+	unsigned char *regions[FRAME_ARENA_FRAMES];
+	GLsync fences[FRAME_ARENA_FRAMES];
+	size_t capacity;		/* Per region. */
+	unsigned int frame;		/* Region in use. */
+	atomic_size_t used;
+	atomic_size_t overflow;		/* Bytes asked for that did not fit. */
+
+	/* Statistics. */
+	size_t highWater;		/* Most asked for in one frame, fitting or not. */
+	uint64_t frames;
+	uint64_t stalls;		/* Frames that waited on their fence. */
+	atomic_uint_least64_t failed;	/* Allocations that did not fit. */
+};
+
+/* capacity is per frame. Returns 0 on success, -1 if out of memory. */
+int frameArenaInit(struct FrameArena *arena, size_t capacity);
+
+/* On the GL thread. Begin waits for the region's fence if the GPU is	*/
+/* still behind, end puts the fence for this frame.			*/
+void frameArenaBeginFrame(struct FrameArena *arena);
+void frameArenaEndFrame(struct FrameArena *arena);
+
+/* From any thread between begin and end. alignment is any power of 2. */
+/* Returns NULL when the region is full rather than fall back to malloc, */
+/* size the arena from the high-water mark.				*/
+void *frameArenaAlloc(struct FrameArena *arena, size_t size, size_t alignment);
+
+#define FRAME_ARENA_NEW(arena, type, count) \
+	((type *) frameArenaAlloc((arena), (count) * sizeof(type), _Alignof(type)))
+
+void frameArenaPrint(const struct FrameArena *arena, FILE *file);
+void frameArenaFree(struct FrameArena *arena);
+
+#endif
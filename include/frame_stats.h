@@ -0,0 +1,75 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Where the time of a frame goes. A frame is split into phases by	*/
+/* frameStatsPhase(), the total is from begin to end.			*/
+enum FramePhase {
+	FRAME_PHASE_CPU,	/* Input, simulation, issuing GL calls. */
+	FRAME_PHASE_SWAP,	/* glfwSwapBuffers(). */
+	FRAME_PHASE_EVENTS,	/* glfwPollEvents(). */
+	FRAME_PHASE_TOTAL,
+	FRAME_PHASE_COUNT
+};
+
+/* Samples go from the render thread into a lock-free single producer,	*/
+/* single consumer ring. frameStatsCollect() drains it into histograms,	*/
+/* from the render thread or any one other thread. When the ring is full	*/
+/* the render thread drops the sample rather than wait.			*/
+#define FRAME_STATS_RING_SIZE	1024	/* Power of 2. */
+
+/* Histograms are log-linear like HDR histograms: exact below 64 ns,	*/
+/* then 32 buckets per power of 2, so about 3% relative precision.	*/
+#define FRAME_STATS_SUB_BITS	6
+
+struct FrameSummary {
+	uint64_t count;
+	double p50;		/* Milliseconds. */
+	double p95;
+	double p99;
+	double max;
+};
+
+struct FrameStats;
+
+/* Returns NULL if out of memory. */
+struct FrameStats *frameStatsCreate(void);
+
+/* Render thread only. Begin starts the FRAME_PHASE_CPU phase. */
+void frameStatsBeginFrame(struct FrameStats *stats);
+void frameStatsPhase(struct FrameStats *stats, enum FramePhase phase);
+void frameStatsEndFrame(struct FrameStats *stats);
+
+/* Consumer side. */
+void frameStatsCollect(struct FrameStats *stats);
+void frameStatsSummary(const struct FrameStats *stats, enum FramePhase phase, struct FrameSummary *summary);
+
+/* Percentiles of every phase, then the histogram of the total. */
+void frameStatsPrint(const struct FrameStats *stats, FILE *file);
+
+/* Every non empty bucket as phase,low_ms,high_ms,count. Returns 0 on	*/
+/* success, -1 if the file could not be written.			*/
+int frameStatsWriteCSV(const struct FrameStats *stats, const char *path);
+
+void frameStatsDestroy(struct FrameStats *stats);
+
+#endif
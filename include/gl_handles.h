@@ -0,0 +1,102 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef GL_HANDLES_H
+#define GL_HANDLES_H
+
+#include <glad/glad.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* GL objects owned by pools and referred to by handles rather than	*/
+/* names. A handle is an index into the pool's dense arrays and the	*/
+/* generation of the slot when it was created; releasing an object bumps	*/
+/* the generation, so using the handle afterwards is caught instead of	*/
+/* silently touching whatever object reuses the name.			*/
+/*									*/
+/* Released objects are not deleted straight away. Their names wait	*/
+/* until the fences of every frame that may still use them have passed,	*/
+/* then each pool deletes all of them with one glDelete* call.		*/
+#define HANDLE_INDEX_BITS	20
+#define HANDLE_MAX_OBJECTS	(1u << HANDLE_INDEX_BITS)
+
+/* Frames the GPU may be behind before handlesEndFrame() waits. */
+#define HANDLE_FRAMES_IN_FLIGHT	4
+
+/* Distinct types so a buffer handle cannot be passed as a vertex	*/
+/* array. A value of 0 is never a valid handle.				*/
+typedef struct { uint32_t value; } BufferHandle;
+typedef struct { uint32_t value; } VertexArrayHandle;
+
+enum HandleType {
+	HANDLE_BUFFER,
+	HANDLE_VERTEX_ARRAY,
+	HANDLE_TYPE_COUNT
+};
+
+struct HandlePool {
+	GLuint *names;
+	uint32_t *generations;
+	uint32_t *freeSlots;		/* Stack of unused indices. */
+	size_t freeCount;
+	size_t count;			/* Slots ever used. */
+	size_t capacity;
+	size_t live;
+
+	/* Released names in the order they were released, with the frame. */
+	GLuint *pendingNames;
+	uint64_t *pendingFrames;
+	size_t pendingCount;
+	size_t pendingCapacity;
+
+	uint64_t deleteCalls;
+	uint64_t deleted;
+};
+
+struct GLHandles {
+	struct HandlePool pools[HANDLE_TYPE_COUNT];
+	GLsync fences[HANDLE_FRAMES_IN_FLIGHT];
+	uint64_t frame;			/* Frames ended so far. */
+	uint64_t completed;		/* Frames the GPU is known to be done with. */
+};
+
+void handlesInit(struct GLHandles *handles);
+
+/* Create the object. Returns a handle of 0 if out of memory or slots. */
+BufferHandle handlesCreateBuffer(struct GLHandles *handles);
+VertexArrayHandle handlesCreateVertexArray(struct GLHandles *handles);
+
+/* The name to bind, or 0 if the handle is stale. */
+GLuint handlesBuffer(const struct GLHandles *handles, BufferHandle handle);
+GLuint handlesVertexArray(const struct GLHandles *handles, VertexArrayHandle handle);
+
+/* The handle is invalid from here on, the object is deleted later.	*/
+/* Returns -1 and prints an error if the handle was already stale.	*/
+int handlesReleaseBuffer(struct GLHandles *handles, BufferHandle handle);
+int handlesReleaseVertexArray(struct GLHandles *handles, VertexArrayHandle handle);
+
+/* After the last GL call of a frame: fences the frame and deletes what	*/
+/* the GPU has finished with. Only waits when HANDLE_FRAMES_IN_FLIGHT	*/
+/* frames are still running.						*/
+void handlesEndFrame(struct GLHandles *handles);
+
+void handlesPrint(const struct GLHandles *handles, FILE *file);
+
+/* Deletes every object, released or not. */
+void handlesDestroy(struct GLHandles *handles);
+
+#endif
@@ -0,0 +1,53 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+
+enum ImageFormat {
+	IMAGE_FORMAT_UNKNOWN = 0,
+	IMAGE_FORMAT_PPM,	/* P2, P3, P5 and P6 netpbm. */
+	IMAGE_FORMAT_TGA	/* Uncompressed and RLE true colour or grey. */
+};
+
+/* Larger images are rejected before anything is allocated. */
+#define IMAGE_MAX_DIMENSION	16384
+
+/* Decoded image ready for glTexImage2D() with GL_RGBA and		*/
+/* GL_UNSIGNED_BYTE: 4 bytes per pixel, rows packed, first row at the	*/
+/* bottom whatever order the file stored them in.			*/
+struct Image {
+	unsigned char *pixels;
+	unsigned int width;
+	unsigned int height;
+};
+
+#define IMAGE_SIZE(image)	((size_t) (image)->width * (image)->height * 4)
+
+/* Returns 0 on success, -1 on failure with the reason printed to stderr. */
+int imageImportMemory(const void *data, size_t size, enum ImageFormat format, struct Image *image);
+
+/* Map the file and decode it. The format is picked from the file extension. */
+int imageImportFile(const char *path, struct Image *image);
+
+enum ImageFormat imageFormatFromPath(const char *path);
+
+void imageFree(struct Image *image);
+
+#endif
@@ -0,0 +1,68 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Input handed from the thread running GLFW's event loop, which GLFW	*/
+/* requires to be the main thread, to the thread that owns the context.	*/
+/* A lock-free single producer, single consumer ring: neither side ever	*/
+/* waits on the other, so a long frame does not stall the event loop	*/
+/* and a burst of events does not delay a frame.				*/
+#define INPUT_QUEUE_SIZE	256	/* Power of 2. */
+
+enum InputEventType {
+	INPUT_EVENT_KEY
+};
+
+/* Anything the consumer would otherwise have to ask GLFW for on the	*/
+/* main thread is captured with the event, such as where the cursor	*/
+/* was when a key was pressed.						*/
+struct InputEvent {
+	enum InputEventType type;
+	int key;
+	int scancode;
+	int action;
+	int mods;
+	double cursorX;
+	double cursorY;
+	int windowWidth;
+	int windowHeight;
+	uint64_t time;		/* timerNow() when it was pushed. */
+};
+
+struct InputQueue {
+	_Alignas(64) atomic_size_t head;
+	_Alignas(64) atomic_size_t tail;
+	struct InputEvent events[INPUT_QUEUE_SIZE];
+	uint64_t dropped;	/* Producer side, events lost to a full queue. */
+};
+
+void inputQueueInit(struct InputQueue *queue);
+
+/* Producer. Sets the event's time. Returns -1 and drops the event if	*/
+/* the queue is full.							*/
+int inputQueuePush(struct InputQueue *queue, struct InputEvent *event);
+
+/* Consumer. Returns 1 and fills event, or 0 if the queue is empty. */
+int inputQueuePop(struct InputQueue *queue, struct InputEvent *event);
+
+#endif
@@ -0,0 +1,83 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Work stealing job system. Every worker thread, and the thread that	*/
+/* created the system, owns a Chase-Lev deque: it pushes and pops jobs	*/
+/* at the bottom without locking, idle workers steal from the top of	*/
+/* the others'. Jobs should be small, from a few microseconds up; a	*/
+/* job that blocks on anything but jobWait() takes a worker with it.	*/
+#define JOB_DEQUE_SIZE	4096	/* Power of 2. Jobs beyond it run inline. */
+
+typedef void (*JobFunction)(void *data);
+
+struct Job {
+	JobFunction function;
+	void *data;
+};
+
+struct JobDeferred;
+
+/* Counts the unfinished jobs of a batch. jobWait() returns once it is	*/
+/* 0, jobRunAfter() starts jobs then. A counter can be reused once it	*/
+/* has been waited on.							*/
+struct JobCounter {
+	atomic_long pending;
+	pthread_mutex_t lock;
+	struct JobDeferred *waiting;
+};
+
+void jobCounterInit(struct JobCounter *counter);
+void jobCounterDestroy(struct JobCounter *counter);
+
+struct JobSystem;
+
+/* threads counts the calling thread, 0 picks one per online CPU.	*/
+/* Returns NULL on failure with the reason printed to stderr.		*/
+struct JobSystem *jobSystemCreate(unsigned int threads);
+unsigned int jobSystemThreads(const struct JobSystem *system);
+
+/* Every job has to have finished. */
+void jobSystemDestroy(struct JobSystem *system);
+
+/* Queue count jobs, adding them to counter, which may be NULL. From	*/
+/* any thread; workers push to their own deque, other threads to a	*/
+/* shared queue.							*/
+void jobRun(struct JobSystem *system, const struct Job *jobs, size_t count, struct JobCounter *counter);
+
+/* As jobRun(), once dependency has dropped to 0. The jobs are copied.	*/
+/* Returns -1 if out of memory, in which case nothing is queued.	*/
+int jobRunAfter(struct JobSystem *system, const struct Job *jobs, size_t count,
+		struct JobCounter *counter, struct JobCounter *dependency);
+
+/* Run other jobs until counter is 0. Safe to call from inside a job. */
+void jobWait(struct JobSystem *system, struct JobCounter *counter);
+
+/* function(data, first, last) over [0, count) in ranges of grain	*/
+/* items, the last possibly shorter, and wait for them all. Ranges are	*/
+/* handed out as workers ask for them, so uneven ranges balance out.	*/
+typedef void (*JobRangeFunction)(void *data, size_t first, size_t last);
+void jobParallelFor(struct JobSystem *system, size_t count, size_t grain,
+		    JobRangeFunction function, void *data);
+
+#endif
@@ -0,0 +1,68 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <stddef.h>
+
+/* Optional vertex attributes, in the order they are interleaved. */
+#define MESH_ATTRIB_NORMAL	0x1
+#define MESH_ATTRIB_TEXCOORD	0x2
+
+enum MeshFormat {
+	MESH_FORMAT_UNKNOWN = 0,
+	MESH_FORMAT_OBJ,
+	MESH_FORMAT_PLY
+};
+
+/* Indexed triangle mesh ready to be given to createVAO() and an EBO.	*/
+/* Each vertex is stride floats:					*/
+/*	- position	3 floats, always present.			*/
+/*	- normal	3 floats, if MESH_ATTRIB_NORMAL is set.		*/
+/*	- texcoord	2 floats, if MESH_ATTRIB_TEXCOORD is set.	*/
+struct Mesh {
+	float *vertices;
+	size_t vertexCount;
+	unsigned int stride;
+	unsigned int attributes;
+
+	unsigned int *indices;
+	size_t indexCount;
+};
+
+/* Size in bytes of the vertex and index arrays, as glBufferData wants them. */
+#define MESH_VERTICES_SIZE(mesh)	((mesh)->vertexCount * (mesh)->stride * sizeof(float))
+#define MESH_INDICES_SIZE(mesh)		((mesh)->indexCount * sizeof(unsigned int))
+
+/* Parse a mesh already in memory. The data does not need to be NUL terminated.	*/
+/* threads is the number of worker threads to use, 0 picks one per online CPU.	*/
+/* Returns 0 on success, -1 on failure with the reason printed to stderr.	*/
+int meshImportMemory(const char *data, size_t size, enum MeshFormat format,
+		     struct Mesh *mesh, unsigned int threads);
+
+/* Map the file and parse it. The format is picked from the file extension. */
+int meshImportFile(const char *path, struct Mesh *mesh, unsigned int threads);
+
+enum MeshFormat meshFormatFromPath(const char *path);
+
+/* Axis aligned box around the positions, as a center and half sizes. */
+void meshComputeBounds(const struct Mesh *mesh, float *center, float *extent);
+
+void meshFree(struct Mesh *mesh);
+
+#endif
@@ -0,0 +1,65 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <mesh.h>
+
+/* Background mesh loading:						*/
+/*	I/O thread	- reads the file into memory.			*/
+/*	decode thread	- parses it with meshImportMemory().		*/
+/*	upload thread	- owns a hidden context sharing objects with the	*/
+/*			  window and fills the VBO and EBO, then fences.	*/
+/* Buffers are shared between contexts but VAOs are not, so the VAO is	*/
+/* made by meshLoaderPoll() on the render thread once the fence passed.	*/
+
+/* Vertex attribute locations the VAO is set up with. */
+#define MESH_LOADER_POSITION_LOCATION	0
+#define MESH_LOADER_NORMAL_LOCATION	1
+#define MESH_LOADER_TEXCOORD_LOCATION	2
+
+struct MeshLoader;
+
+struct LoadedMesh {
+	unsigned int VAO;
+	unsigned int VBO;
+	unsigned int EBO;
+	size_t vertexCount;
+	size_t indexCount;
+	unsigned int attributes;
+	void *user;		/* As given to meshLoaderRequest(). */
+	int failed;		/* Nothing was created if set. */
+};
+
+/* Must be called on the thread owning window, with its context current. */
+struct MeshLoader *meshLoaderCreate(GLFWwindow *window);
+
+/* Queue a file, never blocks. Returns -1 if the loader is shutting down. */
+int meshLoaderRequest(struct MeshLoader *loader, const char *path, void *user);
+
+/* Returns 1 and fills mesh if a load finished, 0 if nothing is ready.	*/
+/* Never waits on the GPU, call it once per frame from the render loop.	*/
+int meshLoaderPoll(struct MeshLoader *loader, struct LoadedMesh *mesh);
+
+/* Stops the threads. Meshes not yet returned by meshLoaderPoll() are freed,	*/
+/* so call it from the render thread before the window is destroyed.		*/
+void meshLoaderDestroy(struct MeshLoader *loader);
+
+#endif
@@ -0,0 +1,52 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <mesh.h>
+
+/* A level of detail is a range of the mesh's index array. All levels use	*/
+/* the same vertices, so one VAO with one EBO draws any of them:		*/
+/*	glDrawElements(GL_TRIANGLES, lod->indexCount, GL_UNSIGNED_INT,	*/
+/*		       MESH_LOD_OFFSET(lod));					*/
+struct MeshLOD {
+	unsigned int indexOffset;	/* In indices, not bytes. */
+	unsigned int indexCount;
+	float error;			/* Object space distance it is off by,	*/
+					/* as an area weighted RMS over faces.	*/
+};
+
+#define MESH_LOD_OFFSET(lod)	((void*) ((size_t) (lod)->indexOffset * sizeof(unsigned int)))
+
+/* Simplify with quadric error metrics, each level keeping about ratio of	*/
+/* the triangles of the one before. Level 0 is the mesh as it is. The new	*/
+/* levels are appended to mesh->indices. Vertices on attribute seams and	*/
+/* open borders are kept so the levels do not crack.			*/
+/* Returns the number of levels written to lods, or -1 on failure.	*/
+int meshGenerateLODs(struct Mesh *mesh, struct MeshLOD *lods, unsigned int maxLods, float ratio);
+
+/* Pixels covered by one object space unit at distance 1:		*/
+/*	viewportHeight / (2 * tan(fovy / 2))				*/
+float meshLODProjectionScale(float fovy, float viewportHeight);
+
+/* Coarsest level whose error, projected at distance, stays under	*/
+/* maxPixelError. Objects closer than the near plane get level 0.	*/
+unsigned int meshSelectLOD(const struct MeshLOD *lods, unsigned int count, float distance,
+			   float projectionScale, float maxPixelError);
+
+#endif
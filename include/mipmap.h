@@ -0,0 +1,57 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <image.h>
+#include <jobs.h>
+
+/* Mip chains built on the CPU, for textures preprocessed offline		*/
+/* instead of glGenerateMipmap() at load time, whose quality depends on	*/
+/* the driver. Each level is filtered from the one above it in linear	*/
+/* float, one pixel per SIMD register on the path mathGetPath() picks.	*/
+
+/* Enough for IMAGE_MAX_DIMENSION down to 1x1. */
+#define MIPMAP_MAX_LEVELS	15
+
+/* Colours are sRGB: filter in linear light and convert back, so the	*/
+/* smaller levels do not get darker. Alpha is always linear.		*/
+#define MIPMAP_SRGB		0x1
+/* The texture repeats, filter across the edges instead of clamping. */
+#define MIPMAP_WRAP		0x2
+
+enum MipFilter {
+	MIP_FILTER_BOX,		/* Average of the pixels each one covers. */
+	MIP_FILTER_KAISER	/* Kaiser windowed sinc, sharper. */
+};
+
+/* Level 0 is a copy of the image, every level after it half the size	*/
+/* rounded down, down to 1x1.						*/
+struct MipChain {
+	struct Image levels[MIPMAP_MAX_LEVELS];
+	unsigned int levelCount;
+};
+
+/* Splits the rows of every level across jobs, which may be NULL.	*/
+/* Returns 0 on success, -1 if out of memory.				*/
+int mipmapBuild(const struct Image *image, enum MipFilter filter, unsigned int flags,
+		struct JobSystem *jobs, struct MipChain *chain);
+
+void mipmapFree(struct MipChain *chain);
+
+#endif
@@ -0,0 +1,75 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <cull.h>
+
+/* The depth buffer is stored tile after tile, every tile row major, so	*/
+/* one tile is a few cache lines and one SIMD register covers a row half.	*/
+#define OCCLUSION_TILE_WIDTH	8
+#define OCCLUSION_TILE_HEIGHT	4
+#define OCCLUSION_MAX_LEVELS	16
+
+/* Small CPU depth buffer the occluders are drawn into, with depths from	*/
+/* 0 at the near plane to 1 at the far plane and y going up like in GL.	*/
+/* Level 0 of the hierarchical-Z pyramid has one texel per tile holding	*/
+/* the farthest depth in it, every next level halves both sizes.	*/
+struct OcclusionBuffer {
+	unsigned int width;		/* Rounded up to whole tiles. */
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	float *depth;
+
+	float *levels[OCCLUSION_MAX_LEVELS];
+	unsigned int levelWidth[OCCLUSION_MAX_LEVELS];
+	unsigned int levelHeight[OCCLUSION_MAX_LEVELS];
+	unsigned int levelCount;
+};
+
+/* Returns 0 on success, -1 if out of memory. */
+int occlusionCreate(struct OcclusionBuffer *buffer, unsigned int width, unsigned int height);
+
+/* Start a frame with nothing drawn. */
+void occlusionClear(struct OcclusionBuffer *buffer);
+
+/* Draw indexed triangles with a column major view-projection matrix.	*/
+/* Positions are the first 3 floats of every stride floats, so a Mesh	*/
+/* can be given as is. Both windings are drawn and triangles crossing	*/
+/* the near plane are clipped. Pick big, simple meshes: walls, floors.	*/
+void occlusionRasterize(struct OcclusionBuffer *buffer, const float *matrix, const float *vertices,
+			unsigned int stride, const unsigned int *indices, size_t indexCount);
+
+/* Call once all occluders are drawn, before testing. */
+void occlusionBuildHiZ(struct OcclusionBuffer *buffer);
+
+/* Returns 0 if the box is hidden behind the occluders or off screen, 1	*/
+/* otherwise. Boxes crossing the near plane are always visible.		*/
+int occlusionTestBox(const struct OcclusionBuffer *buffer, const float *matrix,
+		     const float *center, const float *extent);
+
+/* Keep the candidates whose boxes are not hidden, e.g. what cullBoxes()	*/
+/* or bvhCullFrustum() left. visible may be candidates. Returns the count.	*/
+size_t occlusionCull(const struct OcclusionBuffer *buffer, const float *matrix,
+		     const struct BoundsTable *bounds, const unsigned int *candidates,
+		     size_t count, unsigned int *visible);
+
+void occlusionFree(struct OcclusionBuffer *buffer);
+
+#endif
@@ -0,0 +1,68 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <stdio.h>
+
+/* GPU and CPU time of named scopes around render passes.		*/
+/* Every scope writes a GL_TIMESTAMP query when it begins and ends, so	*/
+/* scopes can nest, which GL_TIME_ELAPSED queries cannot. The queries	*/
+/* of a frame are read PROFILER_FRAME_LATENCY frames later, when the GPU	*/
+/* has long finished them, so reading never stalls the pipeline.	*/
+/* Without GL 3.3 or GL_ARB_timer_query only CPU times are reported,	*/
+/* which is said once on stderr. While a trace is recording, the GPU	*/
+/* times also go to its GPU timeline.					*/
+
+#define PROFILER_MAX_SCOPES	32
+#define PROFILER_FRAME_LATENCY	4
+
+struct ProfilerScope {
+	const char *name;
+	unsigned int depth;		/* Nesting, 0 at the top. */
+	double gpuMilliseconds;		/* Latest frame read back, -1 if unknown. */
+	double cpuMilliseconds;
+	double gpuTotal;		/* Sums over every frame read back. */
+	double cpuTotal;
+	unsigned long gpuFrames;
+	unsigned long cpuFrames;
+};
+
+struct Profiler;
+
+/* Needs a current context. Returns NULL if out of memory. */
+struct Profiler *profilerCreate(void);
+
+/* Bracket every frame. profilerBeginFrame() reads back the oldest frame. */
+void profilerBeginFrame(struct Profiler *profiler);
+void profilerEndFrame(struct Profiler *profiler);
+
+/* name must stay valid while the profiler is alive, a string literal is best. */
+void profilerBegin(struct Profiler *profiler, const char *name);
+void profilerEnd(struct Profiler *profiler);
+
+/* Scopes seen so far, in the order they were first begun. */
+const struct ProfilerScope *profilerScopes(const struct Profiler *profiler, unsigned int *count);
+
+/* Table of the latest and average times per scope. */
+void profilerPrint(const struct Profiler *profiler, FILE *file);
+
+void profilerDestroy(struct Profiler *profiler);
+
+#endif
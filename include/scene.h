@@ -0,0 +1,75 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vecmath.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCENE_NO_PARENT	UINT32_MAX
+
+/* Node hierarchy kept as flat arrays indexed by node. A node can only	*/
+/* be added after its parent, so parents always come before their	*/
+/* children and one pass in index order updates the whole tree.		*/
+/*									*/
+/* Setting a transform only flags the node. sceneUpdate() recomputes	*/
+/* the flagged nodes and everything under them, starting from the first */
+/* flagged node, so a mostly static scene costs next to nothing.	*/
+/* World matrices are contiguous, ready to go to a uniform or instance	*/
+/* buffer, and the range that changed is kept for a partial upload.	*/
+struct SceneGraph {
+	uint32_t *parents;
+
+	/* Local transforms as structure of arrays, in the order of		*/
+	/* struct TRSArrays: translation x, y, z, rotation x, y, z, w, scale	*/
+	/* x, y, z.								*/
+	float *transforms[10];
+
+	struct Mat4 *locals;
+	struct Mat4 *worlds;
+	unsigned char *flags;
+
+	size_t count;
+	size_t capacity;
+	size_t firstDirty;		/* No node before it is flagged. */
+
+	/* Worlds changed by the last sceneUpdate(), [changedFirst, changedEnd). */
+	size_t changedFirst;
+	size_t changedEnd;
+};
+
+/* A zeroed graph is empty. Returns 0 on success, -1 if out of memory. */
+int sceneReserve(struct SceneGraph *graph, size_t capacity);
+
+/* parent is SCENE_NO_PARENT or an existing node. Returns the new node,	*/
+/* or -1 if out of memory or the parent does not exist.			*/
+long sceneAddNode(struct SceneGraph *graph, uint32_t parent, struct Vec3 translation,
+		  struct Quat rotation, struct Vec3 scale);
+
+void sceneSetTransform(struct SceneGraph *graph, uint32_t node, struct Vec3 translation,
+		       struct Quat rotation, struct Vec3 scale);
+void sceneSetTranslation(struct SceneGraph *graph, uint32_t node, struct Vec3 translation);
+void sceneSetRotation(struct SceneGraph *graph, uint32_t node, struct Quat rotation);
+
+/* Returns how many world matrices were recomputed. */
+size_t sceneUpdate(struct SceneGraph *graph);
+
+void sceneFree(struct SceneGraph *graph);
+
+#endif
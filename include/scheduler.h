@@ -0,0 +1,87 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/* Fixed timestep simulation under variable rate rendering. Every frame	*/
+/* runs as many simulation steps as the elapsed time is worth and draws	*/
+/* the state interpolated between the last two steps by schedulerAlpha().	*/
+/*									*/
+/* Frames are paced on a period, the frame rate cap if there is one,	*/
+/* else the measured swap interval when vsync is on. With a period the	*/
+/* loop sleeps until just late enough to poll input and still make the	*/
+/* next present, which is what keeps input latency down:		*/
+/*									*/
+/*	while(!glfwWindowShouldClose(window)){				*/
+/*		schedulerWaitForInput(&scheduler);			*/
+/*		glfwPollEvents();					*/
+/*		for(n = schedulerBeginFrame(&scheduler); n > 0; n--)	*/
+/*			simulate(SIMULATION_STEP);			*/
+/*		draw(schedulerAlpha(&scheduler));			*/
+/*		schedulerEndFrame(&scheduler);				*/
+/*		glfwSwapBuffers(window);				*/
+/*		schedulerPresented(&scheduler);				*/
+/*	}								*/
+
+/* Steps run in one frame at most, so a long stall does not make the	*/
+/* simulation spend every next frame catching up.			*/
+#define SCHEDULER_MAX_STEPS	8
+
+struct Scheduler {
+	uint64_t step;			/* Simulation step, nanoseconds. */
+	uint64_t accumulator;		/* Time not simulated yet. */
+	uint64_t lastFrame;
+
+	uint64_t cap;			/* Frame period of the cap, 0 for none. */
+	int swapInterval;
+	uint64_t swapPeriod;		/* Measured between swaps. */
+	uint64_t lastSwap;
+
+	uint64_t deadline;		/* When the next frame should be done. */
+	uint64_t frameCost;		/* Input to swap call, running estimate. */
+	uint64_t inputTime;
+	uint64_t oversleep;		/* How late sleeps wake, running estimate. */
+};
+
+/* stepRate in steps per second, frameCap in frames per second, 0 for none. */
+void schedulerInit(struct Scheduler *scheduler, double stepRate, double frameCap);
+
+/* glfwSwapInterval() on the current context, 0 for vsync off. */
+void schedulerSetSwapInterval(struct Scheduler *scheduler, int interval);
+
+/* Sleeps when the frames are paced and there is time to spare. */
+void schedulerWaitForInput(struct Scheduler *scheduler);
+
+/* Returns the number of simulation steps to run this frame. */
+unsigned int schedulerBeginFrame(struct Scheduler *scheduler);
+
+/* Between 0 and 1: how far past the last step the frame is drawn at. */
+float schedulerAlpha(const struct Scheduler *scheduler);
+
+/* Right before glfwSwapBuffers(), which may block on vsync and so is */
+/* not part of what the frame costs, and right after it.		   */
+void schedulerEndFrame(struct Scheduler *scheduler);
+void schedulerPresented(struct Scheduler *scheduler);
+
+/* Sleep until the monotonic time of timerNow(), waking close to it by	*/
+/* sleeping short of it and spinning the rest.				*/
+void schedulerSleepUntil(struct Scheduler *scheduler, uint64_t time);
+
+#endif
@@ -0,0 +1,48 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <glad/glad.h>
+#include <stdio.h>
+
+/* Time from process start to the first presented frame, broken into	*/
+/* named phases that may nest. The clock starts when the program is	*/
+/* loaded, before main(). Phases are also traced when a trace records.	*/
+
+#define STARTUP_MAX_PHASES	64
+#define STARTUP_MAX_DEPTH	8
+
+void startupBegin(const char *phase);
+void startupEnd(void);
+
+/* gladLoadGLLoader() as a phase, with its steps (find_coreGL, the	*/
+/* version loads, find_extensionsGL, the extension loads) nested in it.	*/
+/* Returns what it does.							*/
+int startupLoadGL(GLADloadproc load);
+
+/* Call after every glfwSwapBuffers(). Returns 1 the first time only. */
+int startupFrame(void);
+
+/* 1 if --startup-only is in the arguments: exit after the first frame. */
+int startupOnlyRequested(int argc, char *argv[]);
+
+/* Table of the phases with their start and duration. */
+void startupPrint(FILE *file);
+
+#endif
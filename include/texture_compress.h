@@ -0,0 +1,53 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <image.h>
+#include <jobs.h>
+#include <stddef.h>
+
+/* Block compression for textures baked offline. Every format stores	*/
+/* 4x4 pixel blocks, one row of blocks after the other in the same	*/
+/* order as the image rows, which is the order GL takes them in.	*/
+enum BlockFormat {
+	BLOCK_BC1,	/* 8 bytes: two 5:6:5 colours, 1 bit alpha.	*/
+	BLOCK_BC3,	/* 16 bytes: BC1 colours and 8 bit alpha.	*/
+	BLOCK_BC7	/* 16 bytes: RGBA with 7 bit endpoints.		*/
+};
+
+#define BLOCK_BYTES(format)	((format) == BLOCK_BC1 ? 8 : 16)
+
+/* Bytes the blocks of a width x height image take. Blocks past the	*/
+/* right and bottom edges repeat the last column and row.		*/
+size_t textureCompressedSize(enum BlockFormat format, unsigned int width, unsigned int height);
+
+/* Encode the image into blocks, textureCompressedSize() bytes long.	*/
+/* BC1 uses its 1 bit alpha only for blocks with pixels under half	*/
+/* alpha. BC7 is always written in mode 6, a single RGBA line per	*/
+/* block. Rows of blocks are split across jobs, which may be NULL.	*/
+void textureCompress(const struct Image *image, enum BlockFormat format, struct JobSystem *jobs,
+		     void *blocks);
+
+/* Decode into RGBA8 pixels, for drivers without the format. BC7 blocks	*/
+/* in the partitioned modes 0 to 3 and 7, which textureCompress() never	*/
+/* writes, decode as transparent black like the reserved mode.		*/
+void textureDecompress(const void *blocks, enum BlockFormat format, unsigned int width, unsigned int height,
+		       struct JobSystem *jobs, unsigned char *pixels);
+
+#endif
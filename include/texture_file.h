@@ -0,0 +1,97 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef TEXTURE_FILE_H
+#define TEXTURE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Preprocessed textures with their whole mip chain, laid out so a	*/
+/* mapped file can be handed to GL as it is: a fixed size header, then	*/
+/* every level largest first, each starting on a TEXTURE_FILE_ALIGNMENT	*/
+/* boundary. The header is read in place, so files only move between	*/
+/* little endian machines.						*/
+#define TEXTURE_FILE_MAGIC		"CGLT"
+#define TEXTURE_FILE_VERSION		1
+#define TEXTURE_FILE_EXTENSION		".tex"
+#define TEXTURE_FILE_ALIGNMENT		64
+#define TEXTURE_FILE_MAX_LEVELS		16
+
+/* The block formats are those of texture_compress.h, each in a linear	*/
+/* and an sRGB flavour.							*/
+enum TextureFileFormat {
+	TEXTURE_FILE_RGBA8 = 1,
+	TEXTURE_FILE_SRGB8_ALPHA8,
+	TEXTURE_FILE_BC1,
+	TEXTURE_FILE_BC1_SRGB,
+	TEXTURE_FILE_BC3,
+	TEXTURE_FILE_BC3_SRGB,
+	TEXTURE_FILE_BC7,
+	TEXTURE_FILE_BC7_SRGB
+};
+
+struct TextureFileLevel {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;		/* From the start of the file. */
+	uint64_t size;
+};
+
+struct TextureFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t format;
+	uint32_t levelCount;
+	struct TextureFileLevel levels[TEXTURE_FILE_MAX_LEVELS];
+};
+
+/* A level to write. */
+struct TextureLevel {
+	unsigned int width;
+	unsigned int height;
+	const void *data;
+	size_t size;
+};
+
+/* Returns 0 on success, -1 on failure with the reason printed to stderr. */
+int textureFileWrite(const char *path, enum TextureFileFormat format,
+		     const struct TextureLevel *levels, unsigned int levelCount);
+
+/* A file mapped read only. The header is checked on opening, so every	*/
+/* level lies inside the file and has the size its format needs.	*/
+struct TextureFile {
+	const struct TextureFileHeader *header;
+	const unsigned char *data;
+	size_t size;
+};
+
+int textureFileOpen(const char *path, struct TextureFile *file);
+
+static inline const void *textureFileLevelData(const struct TextureFile *file, unsigned int level){
+	return file->data + file->header->levels[level].offset;
+}
+
+/* Bytes a level of the format takes, 0 for an unknown format. */
+size_t textureFileLevelSize(enum TextureFileFormat format, unsigned int width, unsigned int height);
+
+int textureFileIsCompressed(enum TextureFileFormat format);
+int textureFileIsSRGB(enum TextureFileFormat format);
+
+void textureFileClose(struct TextureFile *file);
+
+#endif
@@ -0,0 +1,74 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <image.h>
+#include <stddef.h>
+
+/* Background texture loading:						*/
+/*	decode threads	- decode images with imageImportFile(), or map	*/
+/*			  texture files, which need no decoding and	*/
+/*			  bring their own mip levels. Block compressed	*/
+/*			  files the driver cannot take are decompressed	*/
+/*			  here to RGBA8.				*/
+/*	upload thread	- owns a hidden context sharing objects with the	*/
+/*			  window. Copies the pixels into a pixel unpack	*/
+/*			  buffer and creates the texture from it, so		*/
+/*			  glTexImage2D() returns straight away and the GPU	*/
+/*			  copies into the texture later, then fences.	*/
+/* Textures are shared between contexts, so once the fence has passed	*/
+/* textureLoaderPoll() hands the texture over as it is.			*/
+
+/* Flags for textureLoaderRequest(). */
+#define TEXTURE_LOAD_MIPMAPS	0x1	/* Generate mipmaps if the file has none. */
+#define TEXTURE_LOAD_SRGB	0x2	/* Colours are sRGB, decode when sampling. */
+
+struct TextureLoader;
+
+struct LoadedTexture {
+	unsigned int texture;		/* GL_TEXTURE_2D, RGBA8 or a block format, maybe sRGB. */
+	unsigned int width;
+	unsigned int height;
+	void *user;			/* As given to textureLoaderRequest(). */
+	int failed;			/* Nothing was created if set. */
+};
+
+/* Must be called on the thread owning window, with its context current.	*/
+/* threads is the number of decode threads, 0 picks half the online CPUs.	*/
+struct TextureLoader *textureLoaderCreate(GLFWwindow *window, unsigned int threads);
+
+/* Queue a file, never blocks. Returns -1 if the loader is shutting down. */
+int textureLoaderRequest(struct TextureLoader *loader, const char *path, unsigned int flags, void *user);
+
+/* Returns 1 and fills texture if a load finished, 0 if nothing is ready.	*/
+/* Never waits on the GPU or on decoding, call it once per frame from the	*/
+/* render loop. Until a texture comes out here it must not be bound.	*/
+int textureLoaderPoll(struct TextureLoader *loader, struct LoadedTexture *texture);
+
+/* Requests not yet returned by textureLoaderPoll(), for a loading screen. */
+size_t textureLoaderPending(struct TextureLoader *loader);
+
+/* Stops the threads. Textures not yet returned by textureLoaderPoll() are	*/
+/* deleted, so call it from the render thread before the window is	*/
+/* destroyed.								*/
+void textureLoaderDestroy(struct TextureLoader *loader);
+
+#endif
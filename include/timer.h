@@ -0,0 +1,30 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/* Monotonic clock in nanoseconds from an unspecified start. Only the	*/
+/* differences mean anything, but they are never thrown off by changes	*/
+/* to the wall clock.							*/
+uint64_t timerNow(void);
+
+#define TIMER_MILLISECONDS(nanoseconds)	((nanoseconds) * 1e-6)
+
+#endif
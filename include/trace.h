@@ -0,0 +1,67 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Timeline of named scopes from every thread, written as Chrome	*/
+/* trace-event JSON, which chrome://tracing and ui.perfetto.dev open.	*/
+/* Every thread records into its own ring buffer, allocated on its	*/
+/* first event and freed after it exits, so recording takes no lock and	*/
+/* short lived threads do not pile up. When a ring is full the		*/
+/* oldest events of that thread are overwritten.			*/
+/* Build with -DTRACE_DISABLED to compile the macros out entirely.	*/
+
+#define TRACE_BUFFER_EVENTS	16384
+#define TRACE_MAX_DEPTH		64
+
+/* Pseudo thread for the GPU timeline filled by the profiler. */
+#define TRACE_TRACK_GPU		1
+
+#ifdef TRACE_DISABLED
+#define TRACE_BEGIN(name)
+#define TRACE_END()
+#define TRACE_THREAD_NAME(name)
+#else
+/* name must be a string literal, or at least outlive traceStop(). */
+#define TRACE_BEGIN(name)	do { if(traceActive) traceBegin(name); } while(0)
+#define TRACE_END()		do { if(traceActive) traceEnd(); } while(0)
+#define TRACE_THREAD_NAME(name)	traceThreadName(name)
+#endif
+
+extern _Atomic int traceActive;
+
+/* Start recording, to be written to path by traceStop(). A NULL path	*/
+/* leaves tracing off, so traceStart(getenv(...)) is enough to make it	*/
+/* optional. Returns 0 on success, -1 if already recording.		*/
+int traceStart(const char *path);
+
+/* Stop and write the file. Threads other than the caller must be done	*/
+/* tracing, e.g. joined. Returns 0 on success, -1 if it could not write. */
+int traceStop(void);
+
+void traceBegin(const char *name);
+void traceEnd(void);
+void traceThreadName(const char *name);
+
+/* An event measured elsewhere, like GPU timestamps, with start in	*/
+/* timerNow() time. track is a TRACE_TRACK_ pseudo thread.		*/
+void traceComplete(const char *name, unsigned int track, uint64_t start, uint64_t duration);
+
+#endif
@@ -0,0 +1,194 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include <math.h>
+#include <stddef.h>
+
+/* Vectors, quaternions and 4x4 matrices for transforms. Matrices are	*/
+/* column major, m[4 * column + row], as glUniformMatrix4fv takes them	*/
+/* without transposing, and multiply column vectors: a * b applies b	*/
+/* first.								*/
+/*									*/
+/* One-off operations are plain C. The batched ones at the end work on	*/
+/* arrays of thousands of items and go through SSE, AVX2 or NEON when	*/
+/* the CPU has it, the same way as culling.				*/
+
+struct Vec3 {
+	float x, y, z;
+};
+
+struct Vec4 {
+	float x, y, z, w;
+};
+
+/* Rotation as a unit quaternion, w being the real part. */
+struct Quat {
+	float x, y, z, w;
+};
+
+struct Mat4 {
+	_Alignas(16) float m[16];
+};
+
+/* -----------------------------------VECTORS--------------------------------- */
+
+static inline struct Vec3 vec3(float x, float y, float z){
+	return (struct Vec3) { x, y, z };
+}
+
+static inline struct Vec3 vec3Add(struct Vec3 a, struct Vec3 b){
+	return vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+static inline struct Vec3 vec3Sub(struct Vec3 a, struct Vec3 b){
+	return vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline struct Vec3 vec3Scale(struct Vec3 v, float s){
+	return vec3(v.x * s, v.y * s, v.z * s);
+}
+
+static inline float vec3Dot(struct Vec3 a, struct Vec3 b){
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline struct Vec3 vec3Cross(struct Vec3 a, struct Vec3 b){
+	return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+static inline float vec3Length(struct Vec3 v){
+	return sqrtf(vec3Dot(v, v));
+}
+
+/* Returns v unchanged if it has no length. */
+static inline struct Vec3 vec3Normalize(struct Vec3 v){
+	float length = vec3Length(v);
+	return length > 0.0f ? vec3Scale(v, 1.0f / length) : v;
+}
+
+static inline struct Vec4 vec4(float x, float y, float z, float w){
+	return (struct Vec4) { x, y, z, w };
+}
+
+static inline float vec4Dot(struct Vec4 a, struct Vec4 b){
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+/* ---------------------------------QUATERNIONS------------------------------- */
+
+static inline struct Quat quatIdentity(void){
+	return (struct Quat) { 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+/* angle in radians around a unit axis. */
+static inline struct Quat quatFromAxisAngle(struct Vec3 axis, float angle){
+	float s = sinf(angle * 0.5f);
+	return (struct Quat) { axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f) };
+}
+
+/* Rotation by b, then by a. */
+static inline struct Quat quatMultiply(struct Quat a, struct Quat b){
+	return (struct Quat) {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+	};
+}
+
+static inline struct Quat quatNormalize(struct Quat q){
+	float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	if(length == 0.0f)
+		return quatIdentity();
+	float s = 1.0f / length;
+	return (struct Quat) { q.x * s, q.y * s, q.z * s, q.w * s };
+}
+
+static inline struct Vec3 quatRotate(struct Quat q, struct Vec3 v){
+	/* v + 2w (u x v) + 2 u x (u x v), with u the vector part. */
+	struct Vec3 u = vec3(q.x, q.y, q.z);
+	struct Vec3 t = vec3Scale(vec3Cross(u, v), 2.0f);
+	return vec3Add(vec3Add(v, vec3Scale(t, q.w)), vec3Cross(u, t));
+}
+
+/* Normalized linear interpolation along the shorter arc. Close enough	*/
+/* to a slerp for the small steps of an animation, and much cheaper.	*/
+static inline struct Quat quatNlerp(struct Quat a, struct Quat b, float t){
+	float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f ? -1.0f : 1.0f;
+	float s = 1.0f - t, u = t * sign;
+	return quatNormalize((struct Quat) {
+		a.x * s + b.x * u, a.y * s + b.y * u, a.z * s + b.z * u, a.w * s + b.w * u
+	});
+}
+
+/* ----------------------------------MATRICES--------------------------------- */
+
+void mat4Identity(struct Mat4 *out);
+
+/* out = a * b. out may be a or b. */
+void mat4Multiply(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b);
+
+/* Translation * rotation * scale, the usual order for a node. */
+void mat4FromTRS(struct Mat4 *out, struct Vec3 translation, struct Quat rotation, struct Vec3 scale);
+
+/* Right handed, looking down -z, depth to [-1, 1] as in OpenGL. */
+void mat4Perspective(struct Mat4 *out, float fovy, float aspect, float near, float far);
+void mat4LookAt(struct Mat4 *out, struct Vec3 eye, struct Vec3 target, struct Vec3 up);
+
+/* Inverse of a matrix made only of rotations, translations and scales. */
+void mat4InverseAffine(struct Mat4 *out, const struct Mat4 *m);
+
+struct Vec4 mat4Transform(const struct Mat4 *m, struct Vec4 v);
+
+/* With w = 1 and no perspective divide. */
+struct Vec3 mat4TransformPoint(const struct Mat4 *m, struct Vec3 p);
+
+/* -----------------------------------BATCHED--------------------------------- */
+
+enum MathPath {
+	MATH_PATH_AUTO,		/* Fastest the CPU supports. */
+	MATH_PATH_SCALAR,
+	MATH_PATH_SSE,
+	MATH_PATH_AVX2,
+	MATH_PATH_NEON
+};
+
+/* Mostly for benchmarks. Returns -1 if the CPU cannot run the path. */
+int mathSetPath(enum MathPath path);
+enum MathPath mathGetPath(void);
+
+/* Points kept as structure of arrays, transformed as by			*/
+/* mat4TransformPoint(). out may be the same arrays as in.		*/
+void mathTransformPoints(const struct Mat4 *m, const float *const in[3], float *const out[3], size_t count);
+
+/* out[i] = a[i] * b[i]. out may be a or b. */
+void mathMultiplyMatrices(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count);
+
+/* Translations, rotations and scales as structure of arrays. */
+struct TRSArrays {
+	const float *translation[3];
+	const float *rotation[4];	/* x, y, z, w of unit quaternions. */
+	const float *scale[3];
+};
+
+/* out[i] = mat4FromTRS() of item i. */
+void mathComposeTRS(struct Mat4 *out, const struct TRSArrays *trs, size_t count);
+
+#endif
@@ -0,0 +1,137 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <glad/glad.h>
+#include <image.h>
+#include <jobs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Virtual texturing: a texture far larger than the GPU should hold, cut	*/
+/* into pages, of which only those the camera sees are in memory.	*/
+/*	file		- every page of every mip level, baked offline by	*/
+/*			  vt_bake and mapped, never read whole.		*/
+/*	cache		- a fixed set of page slots in one texture. The	*/
+/*			  least recently seen page makes room for new ones.	*/
+/*	page table	- one texel per page of every level, pointing at	*/
+/*			  the page's slot, or at the slot of the closest	*/
+/*			  coarser page that is in when it is not.		*/
+/*	feedback	- the scene drawn small with vtFeedback() writing	*/
+/*			  the page each pixel wants, read back a few frames	*/
+/*			  later without stalling.				*/
+/*	loader thread	- copies requested pages out of the mapping, so	*/
+/*			  the render thread never waits on the disk.		*/
+/* GPU memory is the cache and the page table, whatever the file's size. */
+/* Sampling is bilinear inside one level: no trilinear, no wrapping.	*/
+
+/* Texels of a page, and of the border copied from its neighbours so	*/
+/* filtering at the edge of a page reads the right texels.		*/
+#define VT_PAGE_SIZE		128
+#define VT_PAGE_BORDER		4
+#define VT_TILE_SIZE		(VT_PAGE_SIZE + 2 * VT_PAGE_BORDER)
+#define VT_TILE_BYTES		(VT_TILE_SIZE * VT_TILE_SIZE * 4)
+
+/* Feedback stores page coordinates in 8 bits. */
+#define VT_MAX_PAGES		256
+#define VT_MAX_LEVELS		16
+
+#define VT_FILE_MAGIC		"CGLV"
+#define VT_FILE_VERSION		1
+#define VT_FILE_EXTENSION	".vtex"
+#define VT_FILE_ALIGNMENT	4096
+
+/* Readbacks in flight, so mapping one never waits on the GPU. */
+#define VT_FEEDBACK_BUFFERS	3
+
+/* Pages the loader holds at once, requested or loaded. */
+#define VT_MAX_IN_FLIGHT	64
+
+struct VTLevel {
+	uint32_t pagesX;
+	uint32_t pagesY;
+	uint32_t firstTile;		/* Tiles are stored level by level, row by row. */
+};
+
+/* The image is padded by repeating its edges to VT_PAGE_SIZE times a	*/
+/* power of two on each side, so every level is exactly half the one	*/
+/* before it and a page's parent is at half its coordinates. The last	*/
+/* level is a single page. Tiles start on the first VT_FILE_ALIGNMENT	*/
+/* boundary after the header, VT_TILE_BYTES each.			*/
+struct VTFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;			/* Of the image. */
+	uint32_t height;
+	uint32_t paddedWidth;
+	uint32_t paddedHeight;
+	uint32_t srgb;
+	uint32_t levelCount;
+	uint32_t tileCount;
+	struct VTLevel levels[VT_MAX_LEVELS];
+};
+
+/* Build the mip chain of the image, jobs may be NULL, and write every	*/
+/* page of it. Returns 0 on success, -1 on failure with the reason on	*/
+/* stderr.								*/
+int vtBake(const struct Image *image, const char *path, int srgb, struct JobSystem *jobs);
+
+/* Pages uploaded per vtUpdate() at most, to bound the time it takes. */
+#define VT_UPLOADS_PER_FRAME	8
+
+struct VirtualTexture;
+
+struct VTStats {
+	size_t resident;		/* Pages in the cache. */
+	size_t slots;
+	uint64_t requested;		/* Since creation. */
+	uint64_t uploaded;
+	uint64_t evicted;
+};
+
+/* Map the file and create a cache of slots pages, at least 2, the page	*/
+/* table and a feedback target of a scale-th of the screen on each side,	*/
+/* 8 or 16 is plenty. Needs a current context. Returns NULL on failure.	*/
+struct VirtualTexture *vtCreate(const char *path, unsigned int slots, unsigned int screenWidth,
+				unsigned int screenHeight, unsigned int scale);
+
+/* Once per frame before drawing: reads back the oldest finished	*/
+/* feedback, uploads up to VT_UPLOADS_PER_FRAME loaded pages, evicting	*/
+/* the least recently seen ones, then updates the page table.		*/
+void vtUpdate(struct VirtualTexture *vt);
+
+/* Draw the scene between these with programs calling vtFeedback(). */
+void vtBeginFeedback(struct VirtualTexture *vt);
+void vtEndFeedback(struct VirtualTexture *vt);
+
+/* Bind the page table and cache to texture units unit and unit + 1,	*/
+/* and set the vt uniforms of program, which must be in use.		*/
+void vtBind(const struct VirtualTexture *vt, GLuint program, unsigned int unit, int feedback);
+
+void vtGetStats(const struct VirtualTexture *vt, struct VTStats *stats);
+
+void vtDestroy(struct VirtualTexture *vt);
+
+/* GLSL 1.30 to paste before a fragment shader using the virtual	*/
+/* texture, declaring its uniforms and:					*/
+/*	vec4 vtSample(vec2 uv)		colour at uv, from the best page in. */
+/*	vec4 vtFeedback(vec2 uv)	what to write in the feedback pass.	*/
+extern const char vtShaderSource[];
+
+#endif
@@ -0,0 +1,520 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <atlas.h>
+#include <texture_file.h>
+#include <glad/glad.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------MAXRECTS------------------------------- */
+
+/* Every page keeps the largest empty rects, overlapping each other. */
+struct FreeRect {
+	unsigned int x;
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+};
+
+struct Page {
+	struct FreeRect *free;
+	size_t count;
+	size_t capacity;
+};
+
+struct Order {
+	size_t index;
+	unsigned int longer;
+	unsigned int shorter;
+};
+
+static int pushFree(struct Page *page, struct FreeRect rect){
+	if(page->count == page->capacity){
+		size_t capacity = page->capacity ? page->capacity * 2 : 64;
+		struct FreeRect *grown = realloc(page->free, capacity * sizeof(*grown));
+		if(grown == NULL)
+			return -1;
+		page->free = grown;
+		page->capacity = capacity;
+	}
+	page->free[page->count++] = rect;
+	return 0;
+}
+
+static int contains(const struct FreeRect *outer, const struct FreeRect *inner){
+	return inner->x >= outer->x && inner->y >= outer->y && inner->x + inner->width <= outer->x + outer->width &&
+	       inner->y + inner->height <= outer->y + outer->height;
+}
+
+/* The free rect leaving the least room on its shorter side, then on	*/
+/* its longer one. Returns -1 if none is big enough.			*/
+static long bestFit(const struct Page *page, unsigned int width, unsigned int height, unsigned long *score){
+	unsigned long bestShort = ULONG_MAX, bestLong = ULONG_MAX;
+	long best = -1;
+
+	for(size_t i = 0; i < page->count; i++){
+		const struct FreeRect *rect = &page->free[i];
+		if(rect->width < width || rect->height < height)
+			continue;
+
+		unsigned long across = rect->width - width, up = rect->height - height;
+		unsigned long shorter = across < up ? across : up, longer = across < up ? up : across;
+		if(shorter < bestShort || (shorter == bestShort && longer < bestLong)){
+			bestShort = shorter;
+			bestLong = longer;
+			best = (long) i;
+		}
+	}
+	*score = bestShort;
+	return best;
+}
+
+/* Cut the used rect out of every free rect it overlaps, keeping the	*/
+/* up to four maximal rects around it, then drop the ones inside others. */
+static int placeRect(struct Page *page, const struct FreeRect *used){
+	size_t count = page->count;
+	for(size_t i = 0; i < count;){
+		struct FreeRect rect = page->free[i];
+		if(used->x >= rect.x + rect.width || used->x + used->width <= rect.x ||
+		   used->y >= rect.y + rect.height || used->y + used->height <= rect.y){
+			i++;
+			continue;
+		}
+
+		struct FreeRect parts[4];
+		int partCount = 0;
+		if(used->x > rect.x)
+			parts[partCount++] = (struct FreeRect) { rect.x, rect.y, used->x - rect.x, rect.height };
+		if(used->x + used->width < rect.x + rect.width)
+			parts[partCount++] = (struct FreeRect) { used->x + used->width, rect.y,
+								 rect.x + rect.width - used->x - used->width, rect.height };
+		if(used->y > rect.y)
+			parts[partCount++] = (struct FreeRect) { rect.x, rect.y, rect.width, used->y - rect.y };
+		if(used->y + used->height < rect.y + rect.height)
+			parts[partCount++] = (struct FreeRect) { rect.x, used->y + used->height, rect.width,
+								 rect.y + rect.height - used->y - used->height };
+
+		/* Parts go after the rects still to look at, they never	*/
+		/* overlap used so they need no second look.			*/
+		count--;
+		page->free[i] = page->free[count];
+		page->free[count] = page->free[--page->count];
+		for(int p = 0; p < partCount; p++)
+			if(pushFree(page, parts[p]) == -1)
+				return -1;
+	}
+
+	/* The rest were already pruned, so only the new parts can be	*/
+	/* inside another rect or hold one. Dropped rects get no width.	*/
+	for(size_t i = count; i < page->count; i++){
+		for(size_t j = 0; j < page->count; j++){
+			if(i == j || page->free[j].width == 0)
+				continue;
+			if(contains(&page->free[j], &page->free[i])){
+				page->free[i].width = 0;
+				break;
+			}
+			if(j < count && contains(&page->free[i], &page->free[j]))
+				page->free[j].width = 0;
+		}
+	}
+
+	size_t kept = 0;
+	for(size_t i = 0; i < page->count; i++)
+		if(page->free[i].width != 0)
+			page->free[kept++] = page->free[i];
+	page->count = kept;
+	return 0;
+}
+
+static int compareOrder(const void *a, const void *b){
+	const struct Order *first = a, *second = b;
+	if(first->longer != second->longer)
+		return first->longer > second->longer ? -1 : 1;
+	if(first->shorter != second->shorter)
+		return first->shorter > second->shorter ? -1 : 1;
+	return first->index < second->index ? -1 : first->index > second->index;
+}
+
+int atlasPack(struct AtlasRect *rects, size_t count, unsigned int pageWidth, unsigned int pageHeight,
+	      unsigned int padding, unsigned int *pageCount){
+	struct Order *order = malloc((count ? count : 1) * sizeof(*order));
+	struct Page *pages = NULL;
+	unsigned int used = 0;
+	int status = -1;
+
+	*pageCount = 0;
+	if(order == NULL){
+		fprintf(stderr, "ERROR: Out of memory packing the atlas.\n");
+		return -1;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		unsigned int width = rects[i].width + 2 * padding, height = rects[i].height + 2 * padding;
+		if(rects[i].width == 0 || rects[i].height == 0 || width > pageWidth || height > pageHeight){
+			fprintf(stderr, "ERROR: A %ux%u image does not fit a %ux%u atlas page.\n", rects[i].width,
+				rects[i].height, pageWidth, pageHeight);
+			goto done;
+		}
+		order[i] = (struct Order) { i, width > height ? width : height, width > height ? height : width };
+	}
+	qsort(order, count, sizeof(*order), compareOrder);
+
+	/* Only ever goes up to one page per rect. */
+	if(count > 0 && (pages = calloc(count, sizeof(*pages))) == NULL){
+		fprintf(stderr, "ERROR: Out of memory packing the atlas.\n");
+		goto done;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		struct AtlasRect *rect = &rects[order[i].index];
+		unsigned int width = rect->width + 2 * padding, height = rect->height + 2 * padding;
+		unsigned long score;
+		long fit = -1;
+		unsigned int page = 0;
+
+		for(; page < used; page++)
+			if((fit = bestFit(&pages[page], width, height, &score)) != -1)
+				break;
+		if(fit == -1){
+			struct FreeRect whole = { 0, 0, pageWidth, pageHeight };
+			if(pushFree(&pages[used], whole) == -1){
+				fprintf(stderr, "ERROR: Out of memory packing the atlas.\n");
+				goto done;
+			}
+			page = used++;
+			fit = 0;
+		}
+
+		struct FreeRect placed = { pages[page].free[fit].x, pages[page].free[fit].y, width, height };
+		if(placeRect(&pages[page], &placed) == -1){
+			fprintf(stderr, "ERROR: Out of memory packing the atlas.\n");
+			goto done;
+		}
+		rect->x = placed.x + padding;
+		rect->y = placed.y + padding;
+		rect->page = page;
+	}
+
+	*pageCount = used;
+	status = 0;
+done:
+	for(unsigned int i = 0; i < used; i++)
+		free(pages[i].free);
+	free(pages);
+	free(order);
+	return status;
+}
+
+void atlasCopy(unsigned char *target, unsigned int targetWidth, const struct Image *image,
+	       unsigned int x, unsigned int y, unsigned int padding){
+	size_t rowSize = (size_t) image->width * 4;
+
+	for(unsigned int row = 0; row < image->height + 2 * padding; row++){
+		unsigned int source = row < padding ? 0 : row - padding >= image->height ? image->height - 1 : row - padding;
+		const unsigned char *in = image->pixels + source * rowSize;
+		unsigned char *out = target + ((size_t) (y - padding + row) * targetWidth + x - padding) * 4;
+
+		for(unsigned int i = 0; i < padding; i++){
+			memcpy(out + i * 4, in, 4);
+			memcpy(out + (padding + image->width + i) * 4, in + rowSize - 4, 4);
+		}
+		memcpy(out + padding * 4, in, rowSize);
+	}
+}
+
+/* ------------------------------------SKYLINE-------------------------------- */
+
+int atlasAllocatorInit(struct AtlasAllocator *allocator, unsigned int width, unsigned int height,
+		       unsigned int padding){
+	memset(allocator, 0, sizeof(*allocator));
+	allocator->nodeCapacity = 64;
+	allocator->nodes = malloc(allocator->nodeCapacity * sizeof(struct SkylineNode));
+	if(allocator->nodes == NULL){
+		fprintf(stderr, "ERROR: Out of memory creating the atlas allocator.\n");
+		return -1;
+	}
+
+	allocator->width = width;
+	allocator->height = height;
+	allocator->padding = padding;
+	atlasAllocatorReset(allocator);
+	return 0;
+}
+
+void atlasAllocatorReset(struct AtlasAllocator *allocator){
+	allocator->nodes[0] = (struct SkylineNode) { 0, 0, allocator->width };
+	allocator->nodeCount = 1;
+	allocator->used = 0;
+}
+
+/* Height the rect would sit at if its left edge is on the node, or	*/
+/* UINT_MAX if it sticks out of the atlas there.			*/
+static unsigned int skylineFit(const struct AtlasAllocator *allocator, size_t node, unsigned int width,
+			       unsigned int height){
+	const struct SkylineNode *nodes = allocator->nodes;
+	if(nodes[node].x + width > allocator->width)
+		return UINT_MAX;
+
+	unsigned int y = 0, left = width;
+	for(size_t i = node; left > 0; i++){
+		y = nodes[i].y > y ? nodes[i].y : y;
+		if(y + height > allocator->height)
+			return UINT_MAX;
+		left = nodes[i].width >= left ? 0 : left - nodes[i].width;
+	}
+	return y;
+}
+
+int atlasAllocate(struct AtlasAllocator *allocator, struct AtlasRect *rect){
+	unsigned int width = rect->width + 2 * allocator->padding, height = rect->height + 2 * allocator->padding;
+	unsigned int bestY = UINT_MAX, bestWidth = UINT_MAX;
+	size_t best = 0;
+
+	/* Lowest spot, then the narrowest node to waste the least beside it. */
+	for(size_t i = 0; i < allocator->nodeCount; i++){
+		unsigned int y = skylineFit(allocator, i, width, height);
+		if(y < bestY || (y == bestY && y != UINT_MAX && allocator->nodes[i].width < bestWidth)){
+			bestY = y;
+			bestWidth = allocator->nodes[i].width;
+			best = i;
+		}
+	}
+	if(bestY == UINT_MAX)
+		return -1;
+
+	if(allocator->nodeCount == allocator->nodeCapacity){
+		size_t capacity = allocator->nodeCapacity * 2;
+		struct SkylineNode *grown = realloc(allocator->nodes, capacity * sizeof(*grown));
+		if(grown == NULL)
+			return -1;
+		allocator->nodes = grown;
+		allocator->nodeCapacity = capacity;
+	}
+
+	struct SkylineNode *nodes = allocator->nodes;
+	struct SkylineNode placed = { nodes[best].x, bestY + height, width };
+	memmove(&nodes[best + 1], &nodes[best], (allocator->nodeCount - best) * sizeof(*nodes));
+	nodes[best] = placed;
+	allocator->nodeCount++;
+
+	/* Cut what the new node covers off the nodes after it. */
+	size_t next = best + 1;
+	while(next < allocator->nodeCount && nodes[next].x < placed.x + placed.width){
+		unsigned int covered = placed.x + placed.width - nodes[next].x;
+		if(covered < nodes[next].width){
+			nodes[next].x += covered;
+			nodes[next].width -= covered;
+			break;
+		}
+		memmove(&nodes[next], &nodes[next + 1], (allocator->nodeCount - next - 1) * sizeof(*nodes));
+		allocator->nodeCount--;
+	}
+
+	for(size_t i = 0; i + 1 < allocator->nodeCount;){
+		if(nodes[i].y == nodes[i + 1].y){
+			nodes[i].width += nodes[i + 1].width;
+			memmove(&nodes[i + 1], &nodes[i + 2], (allocator->nodeCount - i - 2) * sizeof(*nodes));
+			allocator->nodeCount--;
+		} else
+			i++;
+	}
+
+	rect->x = placed.x + allocator->padding;
+	rect->y = bestY + allocator->padding;
+	rect->page = 0;
+	allocator->used += (size_t) width * height;
+	return 0;
+}
+
+void atlasAllocatorFree(struct AtlasAllocator *allocator){
+	free(allocator->nodes);
+	memset(allocator, 0, sizeof(*allocator));
+}
+
+/* ------------------------------------TEXTURE-------------------------------- */
+
+int atlasTextureCreate(struct AtlasTexture *atlas, unsigned int width, unsigned int height,
+		       unsigned int padding){
+	memset(atlas, 0, sizeof(*atlas));
+	if(atlasAllocatorInit(&atlas->allocator, width, height, padding) == -1)
+		return -1;
+
+	glGenTextures(1, &atlas->texture);
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei) width, (GLsizei) height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return 0;
+}
+
+int atlasTextureAdd(struct AtlasTexture *atlas, const struct Image *image, struct AtlasRect *rect){
+	unsigned int padding = atlas->allocator.padding;
+	rect->width = image->width;
+	rect->height = image->height;
+	if(atlasAllocate(&atlas->allocator, rect) == -1)
+		return -1;
+
+	/* One upload for the image and its gutter. */
+	unsigned int width = image->width + 2 * padding, height = image->height + 2 * padding;
+	size_t size = (size_t) width * height * 4;
+	if(size > atlas->scratchSize){
+		unsigned char *grown = realloc(atlas->scratch, size);
+		if(grown == NULL){
+			fprintf(stderr, "ERROR: Out of memory adding to the atlas.\n");
+			return -1;
+		}
+		atlas->scratch = grown;
+		atlas->scratchSize = size;
+	}
+	atlasCopy(atlas->scratch, width, image, padding, padding, padding);
+
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint) (rect->x - padding), (GLint) (rect->y - padding), (GLsizei) width,
+			(GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, atlas->scratch);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return 0;
+}
+
+void atlasTextureReset(struct AtlasTexture *atlas){
+	atlasAllocatorReset(&atlas->allocator);
+}
+
+void atlasTextureDestroy(struct AtlasTexture *atlas){
+	if(atlas->texture)
+		glDeleteTextures(1, &atlas->texture);
+	atlasAllocatorFree(&atlas->allocator);
+	free(atlas->scratch);
+	memset(atlas, 0, sizeof(*atlas));
+}
+
+/* ------------------------------------REMAP---------------------------------- */
+
+void atlasTransform(const struct AtlasRect *rect, unsigned int pageWidth, unsigned int pageHeight,
+		    float *transform){
+	transform[0] = (float) rect->width / pageWidth;
+	transform[1] = (float) rect->height / pageHeight;
+	transform[2] = (float) rect->x / pageWidth;
+	transform[3] = (float) rect->y / pageHeight;
+}
+
+void atlasRemapMesh(struct Mesh *mesh, const float *transform){
+	if(!(mesh->attributes & MESH_ATTRIB_TEXCOORD))
+		return;
+
+	unsigned int offset = mesh->attributes & MESH_ATTRIB_NORMAL ? 6 : 3;
+	for(size_t i = 0; i < mesh->vertexCount; i++){
+		float *texcoord = mesh->vertices + i * mesh->stride + offset;
+		texcoord[0] = texcoord[0] * transform[0] + transform[2];
+		texcoord[1] = texcoord[1] * transform[1] + transform[3];
+	}
+}
+
+/* ------------------------------------FILE----------------------------------- */
+
+int atlasFileWrite(const char *path, const struct AtlasFileHeader *header, const struct AtlasEntry *entries){
+	FILE *file = fopen(path, "wb");
+	if(file == NULL){
+		perror(path);
+		return -1;
+	}
+
+	struct AtlasFileHeader written = *header;
+	memcpy(written.magic, ATLAS_FILE_MAGIC, sizeof(written.magic));
+	written.version = ATLAS_FILE_VERSION;
+	int failed = fwrite(&written, sizeof(written), 1, file) != 1 ||
+		     fwrite(entries, sizeof(*entries), header->entryCount, file) != header->entryCount;
+
+	if(fclose(file) != 0 || failed){
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+int atlasFileRead(const char *path, struct AtlasFile *file){
+	memset(file, 0, sizeof(*file));
+
+	FILE *stream = fopen(path, "rb");
+	if(stream == NULL){
+		perror(path);
+		return -1;
+	}
+
+	struct AtlasFileHeader *header = &file->header;
+	if(fread(header, sizeof(*header), 1, stream) != 1 ||
+	   memcmp(header->magic, ATLAS_FILE_MAGIC, sizeof(header->magic)) != 0){
+		fprintf(stderr, "ERROR: %s is not an atlas file.\n", path);
+		fclose(stream);
+		return -1;
+	}
+	if(header->version != ATLAS_FILE_VERSION){
+		fprintf(stderr, "ERROR: %s is version %u, only %d is supported.\n", path, header->version,
+			ATLAS_FILE_VERSION);
+		fclose(stream);
+		return -1;
+	}
+
+	file->entries = malloc((header->entryCount ? header->entryCount : 1) * sizeof(struct AtlasEntry));
+	if(file->entries == NULL ||
+	   fread(file->entries, sizeof(struct AtlasEntry), header->entryCount, stream) != header->entryCount){
+		fprintf(stderr, "ERROR: %s is truncated.\n", path);
+		fclose(stream);
+		atlasFileFree(file);
+		return -1;
+	}
+	fclose(stream);
+
+	for(uint32_t i = 0; i < header->entryCount; i++){
+		struct AtlasEntry *entry = &file->entries[i];
+		entry->name[ATLAS_NAME_SIZE - 1] = '\0';
+		if(entry->page >= header->pageCount || entry->x + entry->width > header->pageWidth ||
+		   entry->y + entry->height > header->pageHeight){
+			fprintf(stderr, "ERROR: %s: entry %u is corrupt.\n", path, i);
+			atlasFileFree(file);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+const struct AtlasEntry *atlasFileFind(const struct AtlasFile *file, const char *name){
+	for(uint32_t i = 0; i < file->header.entryCount; i++)
+		if(strcmp(file->entries[i].name, name) == 0)
+			return &file->entries[i];
+	return NULL;
+}
+
+int atlasPagePath(const char *path, unsigned int page, char *buffer, size_t size){
+	size_t length = strlen(path), extension = strlen(ATLAS_FILE_EXTENSION);
+	if(length >= extension && strcmp(path + length - extension, ATLAS_FILE_EXTENSION) == 0)
+		length -= extension;
+
+	int written = snprintf(buffer, size, "%.*s.%u%s", (int) length, path, page, TEXTURE_FILE_EXTENSION);
+	return written < 0 || (size_t) written >= size ? -1 : 0;
+}
+
+void atlasFileFree(struct AtlasFile *file){
+	free(file->entries);
+	memset(file, 0, sizeof(*file));
+}
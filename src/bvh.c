@@ -0,0 +1,458 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <bvh.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIN_COUNT	16
+#define MAX_LEAF_SIZE	4
+#define MAX_DEPTH	64
+
+/* Relative costs used by the surface area heuristic. */
+#define TRAVERSAL_COST	1.0f
+#define OBJECT_COST	1.0f
+
+struct Box {
+	float min[3];
+	float max[3];
+};
+
+static void boxEmpty(struct Box *box){
+	for(int k = 0; k < 3; k++){
+		box->min[k] = FLT_MAX;
+		box->max[k] = -FLT_MAX;
+	}
+}
+
+static void boxGrow(struct Box *box, const float *min, const float *max){
+	for(int k = 0; k < 3; k++){
+		box->min[k] = fminf(box->min[k], min[k]);
+		box->max[k] = fmaxf(box->max[k], max[k]);
+	}
+}
+
+static float boxArea(const struct Box *box){
+	float dx = box->max[0] - box->min[0];
+	float dy = box->max[1] - box->min[1];
+	float dz = box->max[2] - box->min[2];
+	if(dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static void objectBox(const struct BoundsTable *bounds, unsigned int object, float *min, float *max){
+	min[0] = bounds->centerX[object] - bounds->extentX[object];
+	min[1] = bounds->centerY[object] - bounds->extentY[object];
+	min[2] = bounds->centerZ[object] - bounds->extentZ[object];
+	max[0] = bounds->centerX[object] + bounds->extentX[object];
+	max[1] = bounds->centerY[object] + bounds->extentY[object];
+	max[2] = bounds->centerZ[object] + bounds->extentZ[object];
+}
+
+static float objectCenter(const struct BoundsTable *bounds, unsigned int object, int axis){
+	const float *centers[3] = { bounds->centerX, bounds->centerY, bounds->centerZ };
+	return centers[axis][object];
+}
+
+/* -----------------------------------BUILD----------------------------------- */
+
+struct Bin {
+	struct Box box;
+	unsigned int count;
+};
+
+static void setLeaf(struct BVH *bvh, unsigned int node, unsigned int first, unsigned int count){
+	bvh->nodes[node].first = first;
+	bvh->nodes[node].count = count;
+	for(unsigned int i = first; i < first + count; i++)
+		bvh->leafOf[bvh->objects[i]] = node;
+}
+
+static void fitNode(struct BVH *bvh, const struct BoundsTable *bounds, unsigned int node,
+		    unsigned int first, unsigned int count){
+	struct Box box;
+	float min[3], max[3];
+
+	boxEmpty(&box);
+	for(unsigned int i = first; i < first + count; i++){
+		objectBox(bounds, bvh->objects[i], min, max);
+		boxGrow(&box, min, max);
+	}
+	memcpy(bvh->nodes[node].min, box.min, sizeof(box.min));
+	memcpy(bvh->nodes[node].max, box.max, sizeof(box.max));
+}
+
+/* Pick the split with the lowest SAH cost over BIN_COUNT buckets of the	*/
+/* centroid range, on every axis. Returns the number of objects that go left,	*/
+/* or 0 if keeping them together in a leaf is cheaper.			*/
+static unsigned int splitNode(struct BVH *bvh, const struct BoundsTable *bounds, unsigned int node,
+			      unsigned int first, unsigned int count){
+	struct Box centroids;
+	boxEmpty(&centroids);
+	for(unsigned int i = first; i < first + count; i++){
+		float c[3];
+		for(int k = 0; k < 3; k++)
+			c[k] = objectCenter(bounds, bvh->objects[i], k);
+		boxGrow(&centroids, c, c);
+	}
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for(int axis = 0; axis < 3; axis++){
+		float low = centroids.min[axis], high = centroids.max[axis];
+		if(high <= low)
+			continue;
+
+		struct Bin bins[BIN_COUNT];
+		for(int b = 0; b < BIN_COUNT; b++){
+			boxEmpty(&bins[b].box);
+			bins[b].count = 0;
+		}
+
+		float scale = BIN_COUNT / (high - low);
+		for(unsigned int i = first; i < first + count; i++){
+			unsigned int object = bvh->objects[i];
+			int b = (int) ((objectCenter(bounds, object, axis) - low) * scale);
+			b = b < BIN_COUNT ? b : BIN_COUNT - 1;
+			float min[3], max[3];
+			objectBox(bounds, object, min, max);
+			boxGrow(&bins[b].box, min, max);
+			bins[b].count++;
+		}
+
+		/* Sweep from the right keeping the area and count of each suffix. */
+		float rightArea[BIN_COUNT];
+		unsigned int rightCount[BIN_COUNT];
+		struct Box box;
+		unsigned int total = 0;
+		boxEmpty(&box);
+		for(int b = BIN_COUNT - 1; b > 0; b--){
+			boxGrow(&box, bins[b].box.min, bins[b].box.max);
+			total += bins[b].count;
+			rightArea[b] = boxArea(&box);
+			rightCount[b] = total;
+		}
+
+		boxEmpty(&box);
+		total = 0;
+		for(int b = 0; b < BIN_COUNT - 1; b++){
+			boxGrow(&box, bins[b].box.min, bins[b].box.max);
+			total += bins[b].count;
+			if(total == 0 || rightCount[b + 1] == 0)
+				continue;
+			float cost = boxArea(&box) * total + rightArea[b + 1] * rightCount[b + 1];
+			if(cost < bestCost){
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	struct BVHNode *n = &bvh->nodes[node];
+	struct Box nodeBox;
+	memcpy(nodeBox.min, n->min, sizeof(nodeBox.min));
+	memcpy(nodeBox.max, n->max, sizeof(nodeBox.max));
+	float area = boxArea(&nodeBox);
+
+	/* All centroids in one spot: halve the list so the tree still ends. */
+	if(bestAxis == -1)
+		return count > MAX_LEAF_SIZE ? count / 2 : 0;
+
+	float leafCost = OBJECT_COST * count;
+	float splitCost = area > 0.0f ? TRAVERSAL_COST + OBJECT_COST * bestCost / area : TRAVERSAL_COST;
+	if(count <= MAX_LEAF_SIZE && leafCost <= splitCost)
+		return 0;
+
+	/* Partition the objects around the chosen bin boundary. */
+	float low = centroids.min[bestAxis];
+	float scale = BIN_COUNT / (centroids.max[bestAxis] - low);
+	unsigned int left = first, right = first + count;
+	while(left < right){
+		int b = (int) ((objectCenter(bounds, bvh->objects[left], bestAxis) - low) * scale);
+		b = b < BIN_COUNT ? b : BIN_COUNT - 1;
+		if(b <= bestBin){
+			left++;
+		} else {
+			unsigned int swap = bvh->objects[left];
+			bvh->objects[left] = bvh->objects[--right];
+			bvh->objects[right] = swap;
+		}
+	}
+
+	unsigned int leftCount = left - first;
+	if(leftCount == 0 || leftCount == count)
+		return count > MAX_LEAF_SIZE ? count / 2 : 0;
+	return leftCount;
+}
+
+static void buildNode(struct BVH *bvh, const struct BoundsTable *bounds, unsigned int node,
+		      unsigned int first, unsigned int count, unsigned int depth){
+	fitNode(bvh, bounds, node, first, count);
+
+	unsigned int leftCount = depth < MAX_DEPTH ? splitNode(bvh, bounds, node, first, count) : 0;
+	if(leftCount == 0){
+		setLeaf(bvh, node, first, count);
+		return;
+	}
+
+	unsigned int left = bvh->nodeCount;
+	bvh->nodeCount += 2;
+	bvh->nodes[node].first = left;
+	bvh->nodes[node].count = 0;
+	bvh->parents[left] = node;
+	bvh->parents[left + 1] = node;
+
+	buildNode(bvh, bounds, left, first, leftCount, depth + 1);
+	buildNode(bvh, bounds, left + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+int bvhBuild(struct BVH *bvh, const struct BoundsTable *bounds){
+	unsigned int count = (unsigned int) bounds->count;
+	/* A binary tree with at least one object per leaf. */
+	unsigned int maxNodes = count > 0 ? 2 * count - 1 : 1;
+
+	memset(bvh, 0, sizeof(*bvh));
+	bvh->nodes = malloc(maxNodes * sizeof(*bvh->nodes));
+	bvh->parents = malloc(maxNodes * sizeof(*bvh->parents));
+	bvh->objects = malloc((count + 1) * sizeof(*bvh->objects));
+	bvh->leafOf = malloc((count + 1) * sizeof(*bvh->leafOf));
+	if(bvh->nodes == NULL || bvh->parents == NULL || bvh->objects == NULL || bvh->leafOf == NULL){
+		bvhFree(bvh);
+		return -1;
+	}
+
+	for(unsigned int i = 0; i < count; i++)
+		bvh->objects[i] = i;
+	bvh->objectCount = count;
+	bvh->nodeCount = 1;
+	bvh->parents[0] = 0;
+
+	buildNode(bvh, bounds, 0, 0, count, 0);
+	return 0;
+}
+
+/* -----------------------------------REFIT----------------------------------- */
+
+static void unionChildren(struct BVH *bvh, unsigned int node){
+	const struct BVHNode *left = &bvh->nodes[bvh->nodes[node].first];
+	const struct BVHNode *right = left + 1;
+	struct BVHNode *n = &bvh->nodes[node];
+
+	for(int k = 0; k < 3; k++){
+		n->min[k] = fminf(left->min[k], right->min[k]);
+		n->max[k] = fmaxf(left->max[k], right->max[k]);
+	}
+}
+
+void bvhRefit(struct BVH *bvh, const struct BoundsTable *bounds){
+	/* Children always come after their parent, so walking backwards */
+	/* visits every node after both of its children.                 */
+	for(unsigned int node = bvh->nodeCount; node-- > 0;){
+		if(bvh->nodes[node].count > 0)
+			fitNode(bvh, bounds, node, bvh->nodes[node].first, bvh->nodes[node].count);
+		else
+			unionChildren(bvh, node);
+	}
+}
+
+void bvhRefitObjects(struct BVH *bvh, const struct BoundsTable *bounds,
+		     const unsigned int *moved, size_t count){
+	for(size_t i = 0; i < count; i++){
+		unsigned int node = bvh->leafOf[moved[i]];
+		fitNode(bvh, bounds, node, bvh->nodes[node].first, bvh->nodes[node].count);
+
+		/* Stop as soon as a parent's box comes out the same. */
+		while(node != 0){
+			node = bvh->parents[node];
+			struct BVHNode before = bvh->nodes[node];
+			unionChildren(bvh, node);
+			if(memcmp(before.min, bvh->nodes[node].min, sizeof(before.min)) == 0 &&
+			   memcmp(before.max, bvh->nodes[node].max, sizeof(before.max)) == 0)
+				break;
+		}
+	}
+}
+
+/* ----------------------------------QUERIES---------------------------------- */
+
+enum { OUTSIDE, INTERSECTS, INSIDE };
+
+/* planeMask has a bit for every plane the box is not known to be inside of. */
+static int classifyBox(const float *min, const float *max, const struct Frustum *frustum,
+		       unsigned int *planeMask){
+	float center[3], extent[3];
+	for(int k = 0; k < 3; k++){
+		center[k] = (min[k] + max[k]) * 0.5f;
+		extent[k] = (max[k] - min[k]) * 0.5f;
+	}
+
+	for(int p = 0; p < 6; p++){
+		if(!(*planeMask & (1u << p)))
+			continue;
+
+		const float *plane = frustum->planes[p];
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		float reach = fabsf(plane[0]) * extent[0] + fabsf(plane[1]) * extent[1] + fabsf(plane[2]) * extent[2];
+		if(distance < -reach)
+			return OUTSIDE;
+		if(distance >= reach)
+			*planeMask &= ~(1u << p);
+	}
+
+	return *planeMask ? INTERSECTS : INSIDE;
+}
+
+size_t bvhCullFrustum(const struct BVH *bvh, const struct BoundsTable *bounds,
+		      const struct Frustum *frustum, unsigned int *visible){
+	struct { unsigned int node; unsigned int planeMask; } stack[MAX_DEPTH * 2 + 2];
+	unsigned int top = 0;
+	size_t count = 0;
+
+	if(bvh->objectCount == 0)
+		return 0;
+
+	stack[top].node = 0;
+	stack[top++].planeMask = 0x3f;
+
+	while(top > 0){
+		top--;
+		const struct BVHNode *node = &bvh->nodes[stack[top].node];
+		unsigned int planeMask = stack[top].planeMask;
+
+		int result = classifyBox(node->min, node->max, frustum, &planeMask);
+		if(result == OUTSIDE)
+			continue;
+
+		if(node->count == 0){
+			stack[top].node = node->first;
+			stack[top++].planeMask = planeMask;
+			stack[top].node = node->first + 1;
+			stack[top++].planeMask = planeMask;
+			continue;
+		}
+
+		for(unsigned int i = node->first; i < node->first + node->count; i++){
+			unsigned int object = bvh->objects[i];
+			unsigned int objectMask = planeMask;
+			float min[3], max[3];
+
+			/* Inside a box that is inside the frustum: no tests left. */
+			if(result == INSIDE){
+				visible[count++] = object;
+				continue;
+			}
+
+			objectBox(bounds, object, min, max);
+			if(classifyBox(min, max, frustum, &objectMask) != OUTSIDE)
+				visible[count++] = object;
+		}
+	}
+
+	return count;
+}
+
+/* Slab test. Returns the entry distance, or INFINITY for a miss. */
+static float rayBox(const float *min, const float *max, const float *origin, const float *inverse, float limit){
+	float near = 0.0f, far = limit;
+
+	for(int k = 0; k < 3; k++){
+		float t0 = (min[k] - origin[k]) * inverse[k];
+		float t1 = (max[k] - origin[k]) * inverse[k];
+		if(t0 > t1){
+			float swap = t0;
+			t0 = t1;
+			t1 = swap;
+		}
+		/* NaN from 0 * inf compares false and leaves the bound alone. */
+		near = t0 > near ? t0 : near;
+		far = t1 < far ? t1 : far;
+		if(near > far)
+			return INFINITY;
+	}
+	return near;
+}
+
+long bvhRaycast(const struct BVH *bvh, const struct BoundsTable *bounds, const float *origin,
+		const float *direction, BVHRayTest test, void *user, float *distance){
+	unsigned int stack[MAX_DEPTH * 2 + 2];
+	unsigned int top = 0;
+	float inverse[3];
+	float best = INFINITY;
+	long hit = -1;
+
+	if(bvh->objectCount == 0)
+		return -1;
+
+	for(int k = 0; k < 3; k++)
+		inverse[k] = 1.0f / direction[k];
+
+	stack[top++] = 0;
+	while(top > 0){
+		const struct BVHNode *node = &bvh->nodes[stack[--top]];
+		if(rayBox(node->min, node->max, origin, inverse, best) == INFINITY)
+			continue;
+
+		if(node->count == 0){
+			/* Visit the nearer child first so the far one is more often skipped. */
+			const struct BVHNode *left = &bvh->nodes[node->first];
+			float leftDistance = rayBox(left->min, left->max, origin, inverse, best);
+			float rightDistance = rayBox(left[1].min, left[1].max, origin, inverse, best);
+			unsigned int near = node->first, far = node->first + 1;
+			if(rightDistance < leftDistance){
+				near = far;
+				far = node->first;
+			}
+			stack[top++] = far;
+			stack[top++] = near;
+			continue;
+		}
+
+		for(unsigned int i = node->first; i < node->first + node->count; i++){
+			unsigned int object = bvh->objects[i];
+			float min[3], max[3], t;
+
+			objectBox(bounds, object, min, max);
+			t = rayBox(min, max, origin, inverse, best);
+			if(t == INFINITY)
+				continue;
+			if(test != NULL && !test(user, object, origin, direction, &t))
+				continue;
+			if(t < best){
+				best = t;
+				hit = object;
+			}
+		}
+	}
+
+	if(hit != -1 && distance != NULL)
+		*distance = best;
+	return hit;
+}
+
+void bvhFree(struct BVH *bvh){
+	free(bvh->nodes);
+	free(bvh->objects);
+	free(bvh->parents);
+	free(bvh->leafOf);
+	memset(bvh, 0, sizeof(*bvh));
+}
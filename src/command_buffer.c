@@ -0,0 +1,368 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <command_buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Every command starts aligned to this, so its fields can be read in place. */
+#define COMMAND_ALIGNMENT	8
+#define INITIAL_CAPACITY	4096
+#define INITIAL_ITEMS		256
+
+enum CommandType {
+	COMMAND_CLEAR,
+	COMMAND_USE_PROGRAM,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_UNIFORM,
+	COMMAND_UNIFORM_MATRIX4,
+	COMMAND_DRAW_ARRAYS,
+	COMMAND_DRAW_ELEMENTS,
+	COMMAND_BUFFER_SUB_DATA
+};
+
+struct CommandHeader {
+	uint32_t type;
+	uint32_t size;		/* Including the header and padding. */
+};
+
+struct ClearCommand {
+	struct CommandHeader header;
+	GLbitfield mask;
+	float colour[4];
+};
+
+struct BindCommand {
+	struct CommandHeader header;
+	GLuint object;
+};
+
+struct UniformCommand {
+	struct CommandHeader header;
+	GLint location;
+	uint32_t count;
+	float values[16];
+};
+
+struct DrawCommand {
+	struct CommandHeader header;
+	GLenum mode;
+	GLenum type;
+	GLint first;
+	GLsizei count;
+	uint64_t offset;
+};
+
+struct BufferSubDataCommand {
+	struct CommandHeader header;
+	GLenum target;
+	GLuint object;
+	uint64_t offset;
+	uint64_t size;
+	/* The data follows. */
+};
+
+/* ----------------------------------RECORDING-------------------------------- */
+
+void commandBufferReset(struct CommandBuffer *buffer){
+	buffer->size = 0;
+	buffer->itemCount = 0;
+	buffer->failed = 0;
+}
+
+void commandBufferFree(struct CommandBuffer *buffer){
+	free(buffer->data);
+	free(buffer->items);
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+void commandBufferBegin(struct CommandBuffer *buffer, uint64_t key){
+	if(buffer->itemCount == buffer->itemCapacity){
+		size_t capacity = buffer->itemCapacity ? buffer->itemCapacity * 2 : INITIAL_ITEMS;
+		struct CommandItem *items = realloc(buffer->items, capacity * sizeof(struct CommandItem));
+		if(items == NULL){
+			buffer->failed = 1;
+			return;
+		}
+		buffer->items = items;
+		buffer->itemCapacity = capacity;
+	}
+
+	buffer->items[buffer->itemCount++] = (struct CommandItem) { key, (uint32_t) buffer->size, 0 };
+}
+
+/* Space for a command of size bytes, or NULL once out of memory. */
+static void *allocate(struct CommandBuffer *buffer, enum CommandType type, size_t size){
+	if(buffer->failed)
+		return NULL;
+	if(buffer->itemCount == 0){
+		commandBufferBegin(buffer, 0);
+		if(buffer->failed)
+			return NULL;
+	}
+
+	size = (size + COMMAND_ALIGNMENT - 1) & ~(size_t) (COMMAND_ALIGNMENT - 1);
+	if(buffer->size + size > buffer->capacity){
+		size_t capacity = buffer->capacity ? buffer->capacity : INITIAL_CAPACITY;
+		while(capacity < buffer->size + size)
+			capacity *= 2;
+
+		/* Items store 32 bit offsets. */
+		unsigned char *data = capacity <= UINT32_MAX ? realloc(buffer->data, capacity) : NULL;
+		if(data == NULL){
+			buffer->failed = 1;
+			return NULL;
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+
+	struct CommandHeader *header = (struct CommandHeader *) (buffer->data + buffer->size);
+	header->type = type;
+	header->size = (uint32_t) size;
+	buffer->size += size;
+	buffer->items[buffer->itemCount - 1].size += (uint32_t) size;
+	return header;
+}
+
+void commandClear(struct CommandBuffer *buffer, GLbitfield mask, float r, float g, float b, float a){
+	struct ClearCommand *command = allocate(buffer, COMMAND_CLEAR, sizeof(*command));
+	if(command == NULL)
+		return;
+	command->mask = mask;
+	command->colour[0] = r;
+	command->colour[1] = g;
+	command->colour[2] = b;
+	command->colour[3] = a;
+}
+
+static void recordBind(struct CommandBuffer *buffer, enum CommandType type, GLuint object){
+	struct BindCommand *command = allocate(buffer, type, sizeof(*command));
+	if(command != NULL)
+		command->object = object;
+}
+
+void commandUseProgram(struct CommandBuffer *buffer, GLuint program){
+	recordBind(buffer, COMMAND_USE_PROGRAM, program);
+}
+
+void commandBindVertexArray(struct CommandBuffer *buffer, GLuint vertexArray){
+	recordBind(buffer, COMMAND_BIND_VERTEX_ARRAY, vertexArray);
+}
+
+/* Only as many values as are used are stored. */
+static void recordUniform(struct CommandBuffer *buffer, enum CommandType type, GLint location,
+			  unsigned int count, const float *values){
+	size_t size = offsetof(struct UniformCommand, values) + count * sizeof(float);
+	struct UniformCommand *command = allocate(buffer, type, size);
+	if(command == NULL)
+		return;
+	command->location = location;
+	command->count = count;
+	memcpy(command->values, values, count * sizeof(float));
+}
+
+void commandUniform(struct CommandBuffer *buffer, GLint location, unsigned int count, const float *values){
+	if(count >= 1 && count <= 4)
+		recordUniform(buffer, COMMAND_UNIFORM, location, count, values);
+}
+
+void commandUniformMatrix4(struct CommandBuffer *buffer, GLint location, const float *matrix){
+	recordUniform(buffer, COMMAND_UNIFORM_MATRIX4, location, 16, matrix);
+}
+
+void commandDrawArrays(struct CommandBuffer *buffer, GLenum mode, GLint first, GLsizei count){
+	struct DrawCommand *command = allocate(buffer, COMMAND_DRAW_ARRAYS, sizeof(*command));
+	if(command == NULL)
+		return;
+	command->mode = mode;
+	command->first = first;
+	command->count = count;
+}
+
+void commandDrawElements(struct CommandBuffer *buffer, GLenum mode, GLsizei count, GLenum type, size_t offset){
+	struct DrawCommand *command = allocate(buffer, COMMAND_DRAW_ELEMENTS, sizeof(*command));
+	if(command == NULL)
+		return;
+	command->mode = mode;
+	command->count = count;
+	command->type = type;
+	command->offset = offset;
+}
+
+void commandBufferSubData(struct CommandBuffer *buffer, GLenum target, GLuint object,
+			  size_t offset, size_t size, const void *data){
+	struct BufferSubDataCommand *command = allocate(buffer, COMMAND_BUFFER_SUB_DATA, sizeof(*command) + size);
+	if(command == NULL)
+		return;
+	command->target = target;
+	command->object = object;
+	command->offset = offset;
+	command->size = size;
+	memcpy(command + 1, data, size);
+}
+
+/* -----------------------------------SORTING--------------------------------- */
+
+/* Offsets grow in recording order, so using them to break ties makes	*/
+/* the sort stable.							*/
+static int compareItems(const void *a, const void *b){
+	const struct CommandItem *x = a, *y = b;
+	if(x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+void commandBufferSort(struct CommandBuffer *buffer){
+	qsort(buffer->items, buffer->itemCount, sizeof(struct CommandItem), compareItems);
+}
+
+struct RecordJob {
+	struct CommandBuffer *buffer;
+	unsigned int index;
+	CommandRecordFunction record;
+	void *user;
+};
+
+static void recordJob(void *arg){
+	struct RecordJob *job = arg;
+	commandBufferReset(job->buffer);
+	job->record(job->user, job->index, job->buffer);
+	commandBufferSort(job->buffer);
+}
+
+void commandBuffersRecord(struct JobSystem *jobs, struct CommandBuffer *buffers, unsigned int count,
+			  CommandRecordFunction record, void *user){
+	if(count == 0)
+		return;
+
+	struct RecordJob records[count];
+	struct Job work[count];
+	for(unsigned int i = 0; i < count; i++){
+		records[i] = (struct RecordJob) { &buffers[i], i, record, user };
+		work[i] = (struct Job) { recordJob, &records[i] };
+	}
+
+	if(jobs == NULL){
+		for(unsigned int i = 0; i < count; i++)
+			recordJob(&records[i]);
+		return;
+	}
+
+	struct JobCounter counter;
+	jobCounterInit(&counter);
+	jobRun(jobs, work, count, &counter);
+	jobWait(jobs, &counter);
+	jobCounterDestroy(&counter);
+}
+
+/* ----------------------------------EXECUTION-------------------------------- */
+
+long commandBuffersExecute(struct CommandBuffer *buffers, unsigned int count){
+	for(unsigned int b = 0; b < count; b++){
+		if(buffers[b].failed){
+			fprintf(stderr, "ERROR: Command buffer %u ran out of memory.\n", b);
+			return -1;
+		}
+	}
+
+	/* What is bound when the replay starts is not known. */
+	GLuint program = ~0u, vertexArray = ~0u;
+	long draws = 0;
+
+	for(unsigned int b = 0; b < count; b++){
+		struct CommandBuffer *buffer = &buffers[b];
+
+		for(size_t i = 0; i < buffer->itemCount; i++){
+			const unsigned char *command = buffer->data + buffer->items[i].offset;
+			const unsigned char *end = command + buffer->items[i].size;
+
+			for(; command < end; command += ((const struct CommandHeader *) command)->size){
+				switch(((const struct CommandHeader *) command)->type){
+					case COMMAND_CLEAR: {
+						const struct ClearCommand *clear = (const void *) command;
+						glClearColor(clear->colour[0], clear->colour[1], clear->colour[2], clear->colour[3]);
+						glClear(clear->mask);
+						break;
+					}
+					case COMMAND_USE_PROGRAM: {
+						const struct BindCommand *bind = (const void *) command;
+						if(bind->object != program){
+							glUseProgram(bind->object);
+							program = bind->object;
+						}
+						break;
+					}
+					case COMMAND_BIND_VERTEX_ARRAY: {
+						const struct BindCommand *bind = (const void *) command;
+						if(bind->object != vertexArray){
+							glBindVertexArray(bind->object);
+							vertexArray = bind->object;
+						}
+						break;
+					}
+					case COMMAND_UNIFORM: {
+						const struct UniformCommand *uniform = (const void *) command;
+						const float *v = uniform->values;
+						switch(uniform->count){
+							case 1: glUniform1f(uniform->location, v[0]); break;
+							case 2: glUniform2f(uniform->location, v[0], v[1]); break;
+							case 3: glUniform3f(uniform->location, v[0], v[1], v[2]); break;
+							case 4: glUniform4f(uniform->location, v[0], v[1], v[2], v[3]); break;
+						}
+						break;
+					}
+					case COMMAND_UNIFORM_MATRIX4: {
+						const struct UniformCommand *uniform = (const void *) command;
+						glUniformMatrix4fv(uniform->location, 1, GL_FALSE, uniform->values);
+						break;
+					}
+					case COMMAND_DRAW_ARRAYS: {
+						const struct DrawCommand *draw = (const void *) command;
+						glDrawArrays(draw->mode, draw->first, draw->count);
+						draws++;
+						break;
+					}
+					case COMMAND_DRAW_ELEMENTS: {
+						const struct DrawCommand *draw = (const void *) command;
+						glDrawElements(draw->mode, draw->count, draw->type, (void *) (uintptr_t) draw->offset);
+						draws++;
+						break;
+					}
+					case COMMAND_BUFFER_SUB_DATA: {
+						const struct BufferSubDataCommand *upload = (const void *) command;
+						/* The index buffer binding belongs to the VAO, so	*/
+						/* upload with none bound and put it back after.	*/
+						/* GL 3.0 has no GL_COPY_WRITE_BUFFER to use instead. */
+						int elements = upload->target == GL_ELEMENT_ARRAY_BUFFER && vertexArray != 0;
+						if(elements)
+							glBindVertexArray(0);
+						glBindBuffer(upload->target, upload->object);
+						glBufferSubData(upload->target, upload->offset, upload->size, upload + 1);
+						if(elements && vertexArray != ~0u)
+							glBindVertexArray(vertexArray);
+						else if(elements)
+							vertexArray = 0;
+						break;
+					}
+				}
+			}
+		}
+	}
+	return draws;
+}
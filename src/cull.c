@@ -0,0 +1,381 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <cull.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CULL_X86 1
+#endif
+
+/* Arrays are padded to this many floats, so the widest path can always	*/
+/* load a whole register. Objects in the padding are masked out.	*/
+#define SIMD_WIDTH 8
+#define ALIGNMENT 32
+
+/* -----------------------------------FRUSTUM--------------------------------- */
+
+void frustumFromMatrix(struct Frustum *frustum, const float *m){
+	/* Rows of the matrix. A clip space point is inside when -w <= x <= w	*/
+	/* and so on, so every plane is the last row plus or minus another one. */
+	for(int i = 0; i < 3; i++){
+		for(int k = 0; k < 4; k++){
+			frustum->planes[2 * i][k] = m[4 * k + 3] + m[4 * k + i];
+			frustum->planes[2 * i + 1][k] = m[4 * k + 3] - m[4 * k + i];
+		}
+	}
+
+	/* Unit normals make the plane equation a distance, which spheres need. */
+	for(int p = 0; p < 6; p++){
+		float *plane = frustum->planes[p];
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if(length > 0.0f){
+			for(int k = 0; k < 4; k++)
+				plane[k] /= length;
+		}
+	}
+}
+
+/* -----------------------------------BOUNDS---------------------------------- */
+
+static void tableArrays(struct BoundsTable *table, float **arrays[7]){
+	arrays[0] = &table->centerX;
+	arrays[1] = &table->centerY;
+	arrays[2] = &table->centerZ;
+	arrays[3] = &table->radius;
+	arrays[4] = &table->extentX;
+	arrays[5] = &table->extentY;
+	arrays[6] = &table->extentZ;
+}
+
+int boundsTableReserve(struct BoundsTable *table, size_t capacity){
+	if(capacity <= table->capacity)
+		return 0;
+
+	capacity = (capacity + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+	float **arrays[7];
+	float *fresh[7];
+	tableArrays(table, arrays);
+
+	for(int i = 0; i < 7; i++){
+		fresh[i] = aligned_alloc(ALIGNMENT, capacity * sizeof(float));
+		if(fresh[i] == NULL){
+			while(i-- > 0)
+				free(fresh[i]);
+			return -1;
+		}
+		if(table->count)
+			memcpy(fresh[i], *arrays[i], table->count * sizeof(float));
+		memset(fresh[i] + table->count, 0, (capacity - table->count) * sizeof(float));
+	}
+
+	for(int i = 0; i < 7; i++){
+		free(*arrays[i]);
+		*arrays[i] = fresh[i];
+	}
+	table->capacity = capacity;
+	return 0;
+}
+
+void boundsTableSet(struct BoundsTable *table, size_t index, const float *center, const float *extent){
+	table->centerX[index] = center[0];
+	table->centerY[index] = center[1];
+	table->centerZ[index] = center[2];
+	table->extentX[index] = extent[0];
+	table->extentY[index] = extent[1];
+	table->extentZ[index] = extent[2];
+	table->radius[index] = sqrtf(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]);
+}
+
+long boundsTableAdd(struct BoundsTable *table, const float *center, const float *extent){
+	if(table->count == table->capacity &&
+	   boundsTableReserve(table, table->capacity ? table->capacity * 2 : 1024) == -1)
+		return -1;
+
+	boundsTableSet(table, table->count, center, extent);
+	return (long) table->count++;
+}
+
+void boundsTableFree(struct BoundsTable *table){
+	float **arrays[7];
+	tableArrays(table, arrays);
+	for(int i = 0; i < 7; i++)
+		free(*arrays[i]);
+	memset(table, 0, sizeof(*table));
+}
+
+/* -----------------------------------SCALAR---------------------------------- */
+
+static size_t cullSpheresScalar(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	size_t count = 0;
+
+	for(size_t i = 0; i < t->count; i++){
+		int inside = 1;
+		for(int p = 0; p < 6; p++){
+			const float *plane = f->planes[p];
+			float distance = plane[0] * t->centerX[i] + plane[1] * t->centerY[i] +
+					 plane[2] * t->centerZ[i] + plane[3];
+			inside &= distance >= -t->radius[i];
+		}
+		/* Written every time, only kept if inside. Avoids a branch per object. */
+		visible[count] = (unsigned int) i;
+		count += inside;
+	}
+	return count;
+}
+
+static size_t cullBoxesScalar(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	size_t count = 0;
+
+	for(size_t i = 0; i < t->count; i++){
+		int inside = 1;
+		for(int p = 0; p < 6; p++){
+			const float *plane = f->planes[p];
+			float distance = plane[0] * t->centerX[i] + plane[1] * t->centerY[i] +
+					 plane[2] * t->centerZ[i] + plane[3];
+			float reach = fabsf(plane[0]) * t->extentX[i] + fabsf(plane[1]) * t->extentY[i] +
+				      fabsf(plane[2]) * t->extentZ[i];
+			inside &= distance >= -reach;
+		}
+		visible[count] = (unsigned int) i;
+		count += inside;
+	}
+	return count;
+}
+
+#ifdef CULL_X86
+
+/* Append the objects whose bits are set in mask, first is the lowest bit. */
+static inline size_t compact(unsigned int mask, size_t first, unsigned int *visible, size_t count){
+	while(mask){
+		visible[count++] = (unsigned int) first + (unsigned int) __builtin_ctz(mask);
+		mask &= mask - 1;
+	}
+	return count;
+}
+
+static inline unsigned int tailMask(size_t remaining, unsigned int width){
+	return remaining >= width ? (1u << width) - 1 : (1u << remaining) - 1;
+}
+
+/* ------------------------------------SSE------------------------------------ */
+
+__attribute__((target("sse2")))
+static size_t cullSpheresSSE(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	__m128 planes[6][4];
+	size_t count = 0;
+
+	for(int p = 0; p < 6; p++){
+		for(int k = 0; k < 4; k++)
+			planes[p][k] = _mm_set1_ps(f->planes[p][k]);
+	}
+
+	for(size_t i = 0; i < t->count; i += 4){
+		__m128 x = _mm_load_ps(t->centerX + i);
+		__m128 y = _mm_load_ps(t->centerY + i);
+		__m128 z = _mm_load_ps(t->centerZ + i);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(t->radius + i));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++){
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+						     _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		unsigned int mask = (unsigned int) _mm_movemask_ps(inside) & tailMask(t->count - i, 4);
+		count = compact(mask, i, visible, count);
+	}
+	return count;
+}
+
+__attribute__((target("sse2")))
+static size_t cullBoxesSSE(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	__m128 planes[6][4];
+	__m128 absPlanes[6][3];
+	size_t count = 0;
+
+	for(int p = 0; p < 6; p++){
+		for(int k = 0; k < 4; k++)
+			planes[p][k] = _mm_set1_ps(f->planes[p][k]);
+		for(int k = 0; k < 3; k++)
+			absPlanes[p][k] = _mm_set1_ps(fabsf(f->planes[p][k]));
+	}
+
+	for(size_t i = 0; i < t->count; i += 4){
+		__m128 x = _mm_load_ps(t->centerX + i);
+		__m128 y = _mm_load_ps(t->centerY + i);
+		__m128 z = _mm_load_ps(t->centerZ + i);
+		__m128 ex = _mm_load_ps(t->extentX + i);
+		__m128 ey = _mm_load_ps(t->extentY + i);
+		__m128 ez = _mm_load_ps(t->extentZ + i);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++){
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+						     _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absPlanes[p][0], ex), _mm_mul_ps(absPlanes[p][1], ey)),
+						  _mm_mul_ps(absPlanes[p][2], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+
+		unsigned int mask = (unsigned int) _mm_movemask_ps(inside) & tailMask(t->count - i, 4);
+		count = compact(mask, i, visible, count);
+	}
+	return count;
+}
+
+/* ------------------------------------AVX2----------------------------------- */
+
+__attribute__((target("avx2,fma")))
+static size_t cullSpheresAVX2(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	__m256 planes[6][4];
+	size_t count = 0;
+
+	for(int p = 0; p < 6; p++){
+		for(int k = 0; k < 4; k++)
+			planes[p][k] = _mm256_set1_ps(f->planes[p][k]);
+	}
+
+	for(size_t i = 0; i < t->count; i += 8){
+		__m256 x = _mm256_load_ps(t->centerX + i);
+		__m256 y = _mm256_load_ps(t->centerY + i);
+		__m256 z = _mm256_load_ps(t->centerZ + i);
+		__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_load_ps(t->radius + i));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++){
+			__m256 distance = _mm256_fmadd_ps(planes[p][0], x,
+					  _mm256_fmadd_ps(planes[p][1], y,
+					  _mm256_fmadd_ps(planes[p][2], z, planes[p][3])));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+
+		unsigned int mask = (unsigned int) _mm256_movemask_ps(inside) & tailMask(t->count - i, 8);
+		count = compact(mask, i, visible, count);
+	}
+	return count;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t cullBoxesAVX2(const struct BoundsTable *t, const struct Frustum *f, unsigned int *visible){
+	__m256 planes[6][4];
+	__m256 absPlanes[6][3];
+	size_t count = 0;
+
+	for(int p = 0; p < 6; p++){
+		for(int k = 0; k < 4; k++)
+			planes[p][k] = _mm256_set1_ps(f->planes[p][k]);
+		for(int k = 0; k < 3; k++)
+			absPlanes[p][k] = _mm256_set1_ps(fabsf(f->planes[p][k]));
+	}
+
+	for(size_t i = 0; i < t->count; i += 8){
+		__m256 x = _mm256_load_ps(t->centerX + i);
+		__m256 y = _mm256_load_ps(t->centerY + i);
+		__m256 z = _mm256_load_ps(t->centerZ + i);
+		__m256 ex = _mm256_load_ps(t->extentX + i);
+		__m256 ey = _mm256_load_ps(t->extentY + i);
+		__m256 ez = _mm256_load_ps(t->extentZ + i);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++){
+			__m256 distance = _mm256_fmadd_ps(planes[p][0], x,
+					  _mm256_fmadd_ps(planes[p][1], y,
+					  _mm256_fmadd_ps(planes[p][2], z, planes[p][3])));
+			__m256 reach = _mm256_fmadd_ps(absPlanes[p][0], ex,
+				       _mm256_fmadd_ps(absPlanes[p][1], ey,
+				       _mm256_mul_ps(absPlanes[p][2], ez)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach),
+								     _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		unsigned int mask = (unsigned int) _mm256_movemask_ps(inside) & tailMask(t->count - i, 8);
+		count = compact(mask, i, visible, count);
+	}
+	return count;
+}
+
+#endif
+
+/* -----------------------------------DISPATCH-------------------------------- */
+
+typedef size_t (*CullFunction)(const struct BoundsTable *, const struct Frustum *, unsigned int *);
+
+static enum CullPath activePath = CULL_PATH_AUTO;
+
+static int pathSupported(enum CullPath path){
+	switch(path){
+		case CULL_PATH_SCALAR: return 1;
+#ifdef CULL_X86
+		case CULL_PATH_SSE: return __builtin_cpu_supports("sse2");
+		case CULL_PATH_AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+		default: return 0;
+	}
+}
+
+int cullSetPath(enum CullPath path){
+	if(path == CULL_PATH_AUTO){
+		if(pathSupported(CULL_PATH_AVX2))
+			path = CULL_PATH_AVX2;
+		else if(pathSupported(CULL_PATH_SSE))
+			path = CULL_PATH_SSE;
+		else
+			path = CULL_PATH_SCALAR;
+	}
+
+	if(!pathSupported(path))
+		return -1;
+
+	activePath = path;
+	return 0;
+}
+
+enum CullPath cullGetPath(void){
+	if(activePath == CULL_PATH_AUTO)
+		cullSetPath(CULL_PATH_AUTO);
+	return activePath;
+}
+
+size_t cullSpheres(const struct BoundsTable *table, const struct Frustum *frustum, unsigned int *visible){
+	CullFunction cull = cullSpheresScalar;
+#ifdef CULL_X86
+	switch(cullGetPath()){
+		case CULL_PATH_SSE: cull = cullSpheresSSE; break;
+		case CULL_PATH_AVX2: cull = cullSpheresAVX2; break;
+		default: break;
+	}
+#endif
+	return cull(table, frustum, visible);
+}
+
+size_t cullBoxes(const struct BoundsTable *table, const struct Frustum *frustum, unsigned int *visible){
+	CullFunction cull = cullBoxesScalar;
+#ifdef CULL_X86
+	switch(cullGetPath()){
+		case CULL_PATH_SSE: cull = cullBoxesSSE; break;
+		case CULL_PATH_AVX2: cull = cullBoxesAVX2; break;
+		default: break;
+	}
+#endif
+	return cull(table, frustum, visible);
+}
@@ -0,0 +1,544 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <ecs.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MASK		(ECS_MAX_ENTITIES - 1)
+#define GENERATION_MASK		(0xFFFFFFFFu >> ECS_INDEX_BITS)
+
+/* Columns are padded and aligned as cull.c wants its bounds tables. */
+#define SIMD_WIDTH		8
+#define ALIGNMENT		32
+
+/* Rows per job when updating transforms. */
+#define UPDATE_GRAIN		2048
+
+/* The entity column, which every archetype has. */
+#define COLUMN_ENTITIES		ECS_COMPONENT_COUNT
+
+/* Most columns of one component, and of a whole archetype. */
+#define MAX_COLUMNS		13
+#define MAX_ARCHETYPE_COLUMNS	(1 + 11 + 13 + 1 + 1)
+
+struct Column {
+	void **array;
+	size_t size;
+};
+
+void ecsInit(struct EcsWorld *world){
+	memset(world, 0, sizeof(*world));
+	for(uint32_t mask = 0; mask < ECS_ARCHETYPES; mask++)
+		world->archetypes[mask].mask = mask;
+}
+
+/* ----------------------------------COLUMNS---------------------------------- */
+
+static int componentColumns(struct EcsArchetype *archetype, unsigned int component, struct Column *columns){
+	int count = 0;
+	switch(component){
+		case ECS_TRANSFORM:
+			for(int i = 0; i < 10; i++)
+				columns[count++] = (struct Column) { (void **) &archetype->transforms[i], sizeof(float) };
+			columns[count++] = (struct Column) { (void **) &archetype->worlds, sizeof(struct Mat4) };
+			break;
+		case ECS_BOUNDS: {
+			float **world[7] = {
+				&archetype->bounds.centerX, &archetype->bounds.centerY, &archetype->bounds.centerZ,
+				&archetype->bounds.radius,
+				&archetype->bounds.extentX, &archetype->bounds.extentY, &archetype->bounds.extentZ
+			};
+			for(int i = 0; i < 6; i++)
+				columns[count++] = (struct Column) { (void **) &archetype->localBounds[i], sizeof(float) };
+			for(int i = 0; i < 7; i++)
+				columns[count++] = (struct Column) { (void **) world[i], sizeof(float) };
+			break;
+		}
+		case ECS_MESH:
+			columns[count++] = (struct Column) { (void **) &archetype->meshes, sizeof(struct EcsMesh) };
+			break;
+		case ECS_MATERIAL:
+			columns[count++] = (struct Column) { (void **) &archetype->materials, sizeof(uint32_t) };
+			break;
+		default:
+			columns[count++] = (struct Column) { (void **) &archetype->entities, sizeof(Entity) };
+			break;
+	}
+	return count;
+}
+
+static int archetypeColumns(struct EcsArchetype *archetype, struct Column *columns){
+	int count = componentColumns(archetype, COLUMN_ENTITIES, columns);
+	for(unsigned int component = 0; component < ECS_COMPONENT_COUNT; component++)
+		if(archetype->mask & ECS_HAS(component))
+			count += componentColumns(archetype, component, columns + count);
+	return count;
+}
+
+static int reserveRows(struct EcsArchetype *archetype, size_t capacity){
+	if(capacity <= archetype->capacity)
+		return 0;
+
+	capacity = (capacity + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+	struct Column columns[MAX_ARCHETYPE_COLUMNS];
+	int count = archetypeColumns(archetype, columns);
+	void *fresh[MAX_ARCHETYPE_COLUMNS];
+
+	/* All or nothing, so a failure leaves the archetype as it was. */
+	for(int i = 0; i < count; i++){
+		fresh[i] = aligned_alloc(ALIGNMENT, capacity * columns[i].size);
+		if(fresh[i] == NULL){
+			while(i-- > 0)
+				free(fresh[i]);
+			return -1;
+		}
+		if(archetype->count)
+			memcpy(fresh[i], *columns[i].array, archetype->count * columns[i].size);
+	}
+
+	for(int i = 0; i < count; i++){
+		free(*columns[i].array);
+		*columns[i].array = fresh[i];
+	}
+	archetype->capacity = capacity;
+	archetype->bounds.capacity = capacity;
+	return 0;
+}
+
+static void markDirty(struct EcsArchetype *archetype, size_t row){
+	if(archetype->dirtyFirst >= archetype->dirtyEnd){
+		archetype->dirtyFirst = row;
+		archetype->dirtyEnd = row + 1;
+	} else {
+		if(row < archetype->dirtyFirst)
+			archetype->dirtyFirst = row;
+		if(row >= archetype->dirtyEnd)
+			archetype->dirtyEnd = row + 1;
+	}
+}
+
+void ecsMarkChanged(struct EcsArchetype *archetype, size_t first, size_t last){
+	if(first >= last)
+		return;
+	markDirty(archetype, first);
+	markDirty(archetype, last - 1);
+}
+
+/* Without a transform the world box is the object space one. */
+static void boundsFromLocal(struct EcsArchetype *archetype, size_t row){
+	float *const *local = archetype->localBounds;
+	float center[3] = { local[0][row], local[1][row], local[2][row] };
+	float extent[3] = { local[3][row], local[4][row], local[5][row] };
+	boundsTableSet(&archetype->bounds, row, center, extent);
+}
+
+static void setDefaults(struct EcsArchetype *archetype, size_t row, uint32_t mask){
+	if(mask & ECS_HAS(ECS_TRANSFORM)){
+		static const float identity[10] = { 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 };
+		for(int i = 0; i < 10; i++)
+			archetype->transforms[i][row] = identity[i];
+		mat4Identity(&archetype->worlds[row]);
+		markDirty(archetype, row);
+	}
+	if(mask & ECS_HAS(ECS_BOUNDS)){
+		for(int i = 0; i < 6; i++)
+			archetype->localBounds[i][row] = 0.0f;
+		boundsFromLocal(archetype, row);
+	}
+	if(mask & ECS_HAS(ECS_MESH))
+		archetype->meshes[row] = (struct EcsMesh) {0};
+	if(mask & ECS_HAS(ECS_MATERIAL))
+		archetype->materials[row] = 0;
+}
+
+/* ------------------------------------ROWS----------------------------------- */
+
+/* Returns the row, or -1 if out of memory. */
+static long addRow(struct EcsWorld *world, uint32_t mask, uint32_t index){
+	struct EcsArchetype *archetype = &world->archetypes[mask];
+	if(archetype->count == archetype->capacity &&
+	   reserveRows(archetype, archetype->capacity ? archetype->capacity * 2 : 1024) == -1)
+		return -1;
+
+	size_t row = archetype->count++;
+	archetype->bounds.count = archetype->count;
+	archetype->entities[row] = (Entity) { world->generations[index] << ECS_INDEX_BITS | index };
+	world->rows[index] = (uint32_t) row;
+	world->masks[index] = (unsigned char) mask;
+	return (long) row;
+}
+
+/* Moves the last row into the hole. */
+static void removeRow(struct EcsWorld *world, struct EcsArchetype *archetype, size_t row){
+	size_t last = --archetype->count;
+	archetype->bounds.count = archetype->count;
+
+	if(row != last){
+		struct Column columns[MAX_ARCHETYPE_COLUMNS];
+		int count = archetypeColumns(archetype, columns);
+		for(int i = 0; i < count; i++){
+			char *array = *columns[i].array;
+			memcpy(array + row * columns[i].size, array + last * columns[i].size, columns[i].size);
+		}
+		world->rows[archetype->entities[row].value & INDEX_MASK] = (uint32_t) row;
+
+		if(last >= archetype->dirtyFirst && last < archetype->dirtyEnd)
+			markDirty(archetype, row);
+	}
+
+	if(archetype->dirtyEnd > archetype->count)
+		archetype->dirtyEnd = archetype->count;
+	if(archetype->dirtyFirst >= archetype->dirtyEnd)
+		archetype->dirtyFirst = archetype->dirtyEnd = 0;
+}
+
+/* ----------------------------------ENTITIES--------------------------------- */
+
+static int growSlots(struct EcsWorld *world, size_t capacity){
+	if(capacity > ECS_MAX_ENTITIES)
+		capacity = ECS_MAX_ENTITIES;
+	if(capacity <= world->capacity)
+		return -1;
+
+	uint32_t *generations = realloc(world->generations, capacity * sizeof(uint32_t));
+	if(generations == NULL)
+		return -1;
+	world->generations = generations;
+
+	uint32_t *rows = realloc(world->rows, capacity * sizeof(uint32_t));
+	if(rows == NULL)
+		return -1;
+	world->rows = rows;
+
+	unsigned char *masks = realloc(world->masks, capacity);
+	if(masks == NULL)
+		return -1;
+	world->masks = masks;
+
+	uint32_t *freeSlots = realloc(world->freeSlots, capacity * sizeof(uint32_t));
+	if(freeSlots == NULL)
+		return -1;
+	world->freeSlots = freeSlots;
+
+	world->capacity = capacity;
+	return 0;
+}
+
+int ecsReserve(struct EcsWorld *world, uint32_t mask, size_t capacity){
+	if(mask >= ECS_ARCHETYPES){
+		fprintf(stderr, "ERROR: Unknown components 0x%x.\n", mask);
+		return -1;
+	}
+	if(capacity > world->capacity && growSlots(world, capacity) == -1)
+		return -1;
+	return reserveRows(&world->archetypes[mask], capacity);
+}
+
+/* The entity's index, or -1 if the handle is stale. */
+static long lookup(const struct EcsWorld *world, Entity entity){
+	uint32_t index = entity.value & INDEX_MASK;
+	if(entity.value == 0 || index >= world->count ||
+	   world->generations[index] != entity.value >> ECS_INDEX_BITS)
+		return -1;
+	return index;
+}
+
+Entity ecsCreate(struct EcsWorld *world, uint32_t mask){
+	if(mask >= ECS_ARCHETYPES){
+		fprintf(stderr, "ERROR: Unknown components 0x%x.\n", mask);
+		return (Entity) {0};
+	}
+
+	uint32_t index;
+	if(world->freeCount > 0)
+		index = world->freeSlots[--world->freeCount];
+	else {
+		if(world->count == world->capacity &&
+		   growSlots(world, world->capacity ? world->capacity * 2 : 1024) == -1){
+			fprintf(stderr, "ERROR: No room for more entities.\n");
+			return (Entity) {0};
+		}
+		index = (uint32_t) world->count++;
+		world->generations[index] = 1;
+	}
+
+	long row = addRow(world, mask, index);
+	if(row == -1){
+		fprintf(stderr, "ERROR: Out of memory creating an entity.\n");
+		world->freeSlots[world->freeCount++] = index;
+		return (Entity) {0};
+	}
+
+	struct EcsArchetype *archetype = &world->archetypes[mask];
+	setDefaults(archetype, (size_t) row, mask);
+	world->live++;
+	return archetype->entities[row];
+}
+
+int ecsDestroy(struct EcsWorld *world, Entity entity){
+	long index = lookup(world, entity);
+	if(index == -1){
+		fprintf(stderr, "ERROR: Destroying a stale entity, 0x%08x.\n", entity.value);
+		return -1;
+	}
+
+	removeRow(world, &world->archetypes[world->masks[index]], world->rows[index]);
+
+	uint32_t generation = (world->generations[index] + 1) & GENERATION_MASK;
+	world->generations[index] = generation ? generation : 1;
+	world->freeSlots[world->freeCount++] = (uint32_t) index;
+	world->live--;
+	return 0;
+}
+
+int ecsAlive(const struct EcsWorld *world, Entity entity){
+	return lookup(world, entity) != -1;
+}
+
+struct EcsArchetype *ecsLocate(struct EcsWorld *world, Entity entity, size_t *row){
+	long index = lookup(world, entity);
+	if(index == -1)
+		return NULL;
+	*row = world->rows[index];
+	return &world->archetypes[world->masks[index]];
+}
+
+static int moveEntity(struct EcsWorld *world, Entity entity, uint32_t mask){
+	long index = lookup(world, entity);
+	if(index == -1){
+		fprintf(stderr, "ERROR: Changing the components of a stale entity, 0x%08x.\n", entity.value);
+		return -1;
+	}
+
+	uint32_t oldMask = world->masks[index];
+	if(mask == oldMask)
+		return 0;
+	struct EcsArchetype *from = &world->archetypes[oldMask];
+	struct EcsArchetype *to = &world->archetypes[mask];
+	size_t oldRow = world->rows[index];
+
+	long row = addRow(world, mask, (uint32_t) index);
+	if(row == -1){
+		fprintf(stderr, "ERROR: Out of memory changing the components of an entity.\n");
+		return -1;
+	}
+
+	for(unsigned int component = 0; component < ECS_COMPONENT_COUNT; component++){
+		if(!(mask & ECS_HAS(component)))
+			continue;
+		if(!(oldMask & ECS_HAS(component))){
+			setDefaults(to, (size_t) row, ECS_HAS(component));
+			continue;
+		}
+
+		struct Column source[MAX_COLUMNS], destination[MAX_COLUMNS];
+		int count = componentColumns(from, component, source);
+		componentColumns(to, component, destination);
+		for(int i = 0; i < count; i++)
+			memcpy((char *) *destination[i].array + row * destination[i].size,
+			       (char *) *source[i].array + oldRow * source[i].size, source[i].size);
+	}
+
+	/* The world box follows whichever of the two applies now. */
+	if(mask & ECS_HAS(ECS_TRANSFORM))
+		markDirty(to, (size_t) row);
+	else if(mask & ECS_HAS(ECS_BOUNDS))
+		boundsFromLocal(to, (size_t) row);
+
+	removeRow(world, from, oldRow);
+	return 0;
+}
+
+int ecsAddComponents(struct EcsWorld *world, Entity entity, uint32_t mask){
+	size_t row;
+	struct EcsArchetype *archetype = ecsLocate(world, entity, &row);
+	return moveEntity(world, entity, archetype ? (archetype->mask | mask) & (ECS_ARCHETYPES - 1) : 0);
+}
+
+int ecsRemoveComponents(struct EcsWorld *world, Entity entity, uint32_t mask){
+	size_t row;
+	struct EcsArchetype *archetype = ecsLocate(world, entity, &row);
+	return moveEntity(world, entity, archetype ? archetype->mask & ~mask : 0);
+}
+
+/* ----------------------------------SETTERS---------------------------------- */
+
+static struct EcsArchetype *locateWith(struct EcsWorld *world, Entity entity, unsigned int component, size_t *row){
+	struct EcsArchetype *archetype = ecsLocate(world, entity, row);
+	if(archetype == NULL || !(archetype->mask & ECS_HAS(component)))
+		return NULL;
+	return archetype;
+}
+
+int ecsSetTransform(struct EcsWorld *world, Entity entity, struct Vec3 translation,
+		    struct Quat rotation, struct Vec3 scale){
+	size_t row;
+	struct EcsArchetype *archetype = locateWith(world, entity, ECS_TRANSFORM, &row);
+	if(archetype == NULL)
+		return -1;
+
+	float values[10] = { translation.x, translation.y, translation.z,
+			     rotation.x, rotation.y, rotation.z, rotation.w,
+			     scale.x, scale.y, scale.z };
+	for(int i = 0; i < 10; i++)
+		archetype->transforms[i][row] = values[i];
+	markDirty(archetype, row);
+	return 0;
+}
+
+int ecsSetBounds(struct EcsWorld *world, Entity entity, const float *center, const float *extent){
+	size_t row;
+	struct EcsArchetype *archetype = locateWith(world, entity, ECS_BOUNDS, &row);
+	if(archetype == NULL)
+		return -1;
+
+	for(int i = 0; i < 3; i++){
+		archetype->localBounds[i][row] = center[i];
+		archetype->localBounds[3 + i][row] = extent[i];
+	}
+	if(archetype->mask & ECS_HAS(ECS_TRANSFORM))
+		markDirty(archetype, row);
+	else
+		boundsTableSet(&archetype->bounds, row, center, extent);
+	return 0;
+}
+
+int ecsSetMesh(struct EcsWorld *world, Entity entity, struct EcsMesh mesh){
+	size_t row;
+	struct EcsArchetype *archetype = locateWith(world, entity, ECS_MESH, &row);
+	if(archetype == NULL)
+		return -1;
+	archetype->meshes[row] = mesh;
+	return 0;
+}
+
+int ecsSetMaterial(struct EcsWorld *world, Entity entity, uint32_t material){
+	size_t row;
+	struct EcsArchetype *archetype = locateWith(world, entity, ECS_MATERIAL, &row);
+	if(archetype == NULL)
+		return -1;
+	archetype->materials[row] = material;
+	return 0;
+}
+
+/* -----------------------------------QUERIES--------------------------------- */
+
+struct EcsArchetype *ecsQueryNext(struct EcsWorld *world, struct EcsQuery *query){
+	while(query->next < ECS_ARCHETYPES){
+		struct EcsArchetype *archetype = &world->archetypes[query->next++];
+		if((archetype->mask & query->required) == query->required &&
+		   !(archetype->mask & query->excluded) && archetype->count > 0)
+			return archetype;
+	}
+	return NULL;
+}
+
+struct ForEach {
+	EcsRangeFunction function;
+	void *user;
+	struct EcsArchetype *archetype;
+	size_t offset;
+};
+
+static void forEachRange(void *data, size_t first, size_t last){
+	struct ForEach *each = data;
+	each->function(each->user, each->archetype, each->offset + first, each->offset + last);
+}
+
+void ecsForEach(struct EcsWorld *world, struct JobSystem *jobs, uint32_t required, uint32_t excluded,
+		size_t grain, EcsRangeFunction function, void *user){
+	struct EcsQuery query = ecsQuery(required, excluded);
+	struct EcsArchetype *archetype;
+	while((archetype = ecsQueryNext(world, &query)) != NULL){
+		if(jobs == NULL){
+			function(user, archetype, 0, archetype->count);
+			continue;
+		}
+		struct ForEach each = { function, user, archetype, 0 };
+		jobParallelFor(jobs, archetype->count, grain, forEachRange, &each);
+	}
+}
+
+/* ---------------------------------TRANSFORMS-------------------------------- */
+
+static void updateRows(void *user, struct EcsArchetype *archetype, size_t first, size_t last){
+	(void) user;
+	float *const *t = archetype->transforms;
+	struct TRSArrays trs = {
+		{ t[0] + first, t[1] + first, t[2] + first },
+		{ t[3] + first, t[4] + first, t[5] + first, t[6] + first },
+		{ t[7] + first, t[8] + first, t[9] + first }
+	};
+	mathComposeTRS(archetype->worlds + first, &trs, last - first);
+
+	if(!(archetype->mask & ECS_HAS(ECS_BOUNDS)))
+		return;
+
+	/* The box around the transformed box: each world axis gets the	*/
+	/* object space half sizes projected onto it.			*/
+	float *const *local = archetype->localBounds;
+	for(size_t i = first; i < last; i++){
+		const float *m = archetype->worlds[i].m;
+		float center[3], extent[3];
+		for(int r = 0; r < 3; r++){
+			center[r] = m[r] * local[0][i] + m[4 + r] * local[1][i] + m[8 + r] * local[2][i] + m[12 + r];
+			extent[r] = fabsf(m[r]) * local[3][i] + fabsf(m[4 + r]) * local[4][i] +
+				    fabsf(m[8 + r]) * local[5][i];
+		}
+		boundsTableSet(&archetype->bounds, i, center, extent);
+	}
+}
+
+size_t ecsUpdateTransforms(struct EcsWorld *world, struct JobSystem *jobs){
+	size_t updated = 0;
+	struct EcsQuery query = ecsQuery(ECS_HAS(ECS_TRANSFORM), 0);
+	struct EcsArchetype *archetype;
+
+	while((archetype = ecsQueryNext(world, &query)) != NULL){
+		size_t first = archetype->dirtyFirst, last = archetype->dirtyEnd;
+		if(first >= last)
+			continue;
+
+		if(jobs == NULL)
+			updateRows(NULL, archetype, first, last);
+		else {
+			struct ForEach each = { updateRows, NULL, archetype, first };
+			jobParallelFor(jobs, last - first, UPDATE_GRAIN, forEachRange, &each);
+		}
+		updated += last - first;
+		archetype->dirtyFirst = archetype->dirtyEnd = 0;
+	}
+	return updated;
+}
+
+void ecsFree(struct EcsWorld *world){
+	for(uint32_t mask = 0; mask < ECS_ARCHETYPES; mask++){
+		struct Column columns[MAX_ARCHETYPE_COLUMNS];
+		int count = archetypeColumns(&world->archetypes[mask], columns);
+		for(int i = 0; i < count; i++)
+			free(*columns[i].array);
+	}
+	free(world->generations);
+	free(world->rows);
+	free(world->masks);
+	free(world->freeSlots);
+	ecsInit(world);
+}
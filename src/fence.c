@@ -0,0 +1,48 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <fence.h>
+#include <stdio.h>
+
+/* How long to block per attempt, in nanoseconds. Waiting is retried	*/
+/* until it ends, the timeout only keeps a single call bounded.	*/
+#define FENCE_TIMEOUT		100000000
+
+int fenceSignaled(GLsync fence){
+	if(fence == NULL)
+		return 1;
+
+	/* No flags and no timeout: only asks, never waits. */
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+int fenceWait(GLsync fence){
+	if(fence == NULL)
+		return 0;
+
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	int waited = status == GL_TIMEOUT_EXPIRED;
+	while(status == GL_TIMEOUT_EXPIRED)
+		status = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+
+	if(status == GL_WAIT_FAILED){
+		fprintf(stderr, "ERROR: Waiting on a fence failed.\n");
+		return -1;
+	}
+	return waited;
+}
@@ -0,0 +1,110 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <frame_arena.h>
+#include <fence.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Regions start on a cache line, larger alignments are rare. */
+#define REGION_ALIGNMENT	64
+
+int frameArenaInit(struct FrameArena *arena, size_t capacity){
+	memset(arena, 0, sizeof(*arena));
+	capacity = (capacity + REGION_ALIGNMENT - 1) & ~(size_t) (REGION_ALIGNMENT - 1);
+
+	for(int i = 0; i < FRAME_ARENA_FRAMES; i++){
+		arena->regions[i] = aligned_alloc(REGION_ALIGNMENT, capacity);
+		if(arena->regions[i] == NULL){
+			fprintf(stderr, "ERROR: Out of memory creating the frame arena.\n");
+			frameArenaFree(arena);
+			return -1;
+		}
+	}
+	arena->capacity = capacity;
+	atomic_init(&arena->used, 0);
+	atomic_init(&arena->overflow, 0);
+	atomic_init(&arena->failed, 0);
+	return 0;
+}
+
+void frameArenaBeginFrame(struct FrameArena *arena){
+	arena->frame = (arena->frame + 1) % FRAME_ARENA_FRAMES;
+
+	GLsync fence = arena->fences[arena->frame];
+	if(fence != NULL){
+		if(fenceWait(fence) == 1)
+			arena->stalls++;
+		glDeleteSync(fence);
+		arena->fences[arena->frame] = NULL;
+	}
+
+	atomic_store_explicit(&arena->used, 0, memory_order_relaxed);
+	atomic_store_explicit(&arena->overflow, 0, memory_order_relaxed);
+}
+
+void frameArenaEndFrame(struct FrameArena *arena){
+	/* What did not fit counts too, it is what the arena is short of. */
+	size_t used = atomic_load_explicit(&arena->used, memory_order_relaxed) +
+		      atomic_load_explicit(&arena->overflow, memory_order_relaxed);
+	if(used > arena->highWater)
+		arena->highWater = used;
+	arena->frames++;
+
+	if(GLAD_GL_ARB_sync)
+		arena->fences[arena->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void *frameArenaAlloc(struct FrameArena *arena, size_t size, size_t alignment){
+	uintptr_t base = (uintptr_t) arena->regions[arena->frame];
+	size_t used = atomic_load_explicit(&arena->used, memory_order_relaxed);
+	size_t offset;
+
+	/* Aligns the address rather than the offset, regions are only	*/
+	/* REGION_ALIGNMENT aligned.					*/
+	do {
+		offset = (size_t) (((base + used + alignment - 1) & ~(uintptr_t) (alignment - 1)) - base);
+		if(offset + size > arena->capacity || offset < used || offset + size < offset){
+			atomic_fetch_add_explicit(&arena->overflow, size, memory_order_relaxed);
+			atomic_fetch_add_explicit(&arena->failed, 1, memory_order_relaxed);
+			return NULL;
+		}
+	} while(!atomic_compare_exchange_weak_explicit(&arena->used, &used, offset + size,
+						      memory_order_relaxed, memory_order_relaxed));
+
+	return arena->regions[arena->frame] + offset;
+}
+
+void frameArenaPrint(const struct FrameArena *arena, FILE *file){
+	fprintf(file, "frame arena: %zu of %zu bytes needed at most over %llu frames, %llu stalled on the GPU",
+		arena->highWater, arena->capacity, (unsigned long long) arena->frames,
+		(unsigned long long) arena->stalls);
+
+	uint64_t failed = atomic_load(&arena->failed);
+	if(failed > 0)
+		fprintf(file, ", %llu allocations did not fit", (unsigned long long) failed);
+	fprintf(file, "\n");
+}
+
+void frameArenaFree(struct FrameArena *arena){
+	for(int i = 0; i < FRAME_ARENA_FRAMES; i++){
+		if(arena->fences[i] != NULL)
+			glDeleteSync(arena->fences[i]);
+		free(arena->regions[i]);
+	}
+	memset(arena, 0, sizeof(*arena));
+}
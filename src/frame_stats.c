@@ -0,0 +1,248 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <frame_stats.h>
+#include <timer.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HALF_BUCKETS	(1u << (FRAME_STATS_SUB_BITS - 1))
+/* Longest time told apart, about 18 minutes. Longer ones go in the last bucket. */
+#define MAX_BITS	40
+#define BUCKET_COUNT	((MAX_BITS - FRAME_STATS_SUB_BITS + 3) * HALF_BUCKETS)
+
+struct Sample {
+	uint64_t phases[FRAME_PHASE_COUNT];
+};
+
+struct Histogram {
+	uint64_t buckets[BUCKET_COUNT];
+	uint64_t count;
+	uint64_t max;
+};
+
+struct FrameStats {
+	/* Written by the producer only, read by the consumer, and the other way around. */
+	_Alignas(64) atomic_size_t head;
+	_Alignas(64) atomic_size_t tail;
+	struct Sample ring[FRAME_STATS_RING_SIZE];
+
+	/* Producer side. */
+	struct Sample current;
+	uint64_t frameStart;
+	uint64_t phaseStart;
+	enum FramePhase phase;
+	uint64_t dropped;
+
+	/* Consumer side. */
+	struct Histogram histograms[FRAME_PHASE_COUNT];
+};
+
+static const char *phaseNames[FRAME_PHASE_COUNT] = { "cpu", "swap", "events", "total" };
+
+/* ---------------------------------HISTOGRAM--------------------------------- */
+
+static unsigned int bucketIndex(uint64_t value){
+	if(value < (1u << FRAME_STATS_SUB_BITS))
+		return (unsigned int) value;
+
+	unsigned int highest = 63 - __builtin_clzll(value);
+	unsigned int shift = highest - (FRAME_STATS_SUB_BITS - 1);
+	unsigned int index = shift * HALF_BUCKETS + (unsigned int) (value >> shift);
+	return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+}
+
+/* Smallest value of the bucket, and one past the largest. */
+static void bucketRange(unsigned int index, uint64_t *low, uint64_t *high){
+	if(index < (1u << FRAME_STATS_SUB_BITS)){
+		*low = index;
+		*high = index + 1;
+		return;
+	}
+	unsigned int shift = index / HALF_BUCKETS - 1;
+	uint64_t top = index % HALF_BUCKETS + HALF_BUCKETS;
+	*low = top << shift;
+	*high = (top + 1) << shift;
+}
+
+static void histogramAdd(struct Histogram *histogram, uint64_t value){
+	histogram->buckets[bucketIndex(value)]++;
+	histogram->count++;
+	if(value > histogram->max)
+		histogram->max = value;
+}
+
+/* Middle of the bucket holding the sample at that rank, never above the	*/
+/* largest sample seen.							*/
+static double histogramPercentile(const struct Histogram *histogram, double percentile){
+	if(histogram->count == 0)
+		return 0.0;
+
+	uint64_t rank = (uint64_t) (percentile / 100.0 * histogram->count + 0.5);
+	if(rank == 0)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for(unsigned int i = 0; i < BUCKET_COUNT; i++){
+		seen += histogram->buckets[i];
+		if(seen >= rank){
+			uint64_t low, high;
+			bucketRange(i, &low, &high);
+			double middle = (low + high - 1) * 0.5;
+			return middle < histogram->max ? middle : (double) histogram->max;
+		}
+	}
+	return (double) histogram->max;
+}
+
+/* -----------------------------------PRODUCER-------------------------------- */
+
+struct FrameStats *frameStatsCreate(void){
+	struct FrameStats *stats = aligned_alloc(64, (sizeof(struct FrameStats) + 63) / 64 * 64);
+	if(stats == NULL)
+		return NULL;
+
+	memset(stats, 0, sizeof(*stats));
+	atomic_init(&stats->head, 0);
+	atomic_init(&stats->tail, 0);
+	return stats;
+}
+
+void frameStatsBeginFrame(struct FrameStats *stats){
+	memset(&stats->current, 0, sizeof(stats->current));
+	stats->frameStart = stats->phaseStart = timerNow();
+	stats->phase = FRAME_PHASE_CPU;
+}
+
+void frameStatsPhase(struct FrameStats *stats, enum FramePhase phase){
+	uint64_t now = timerNow();
+	stats->current.phases[stats->phase] += now - stats->phaseStart;
+	stats->phaseStart = now;
+	stats->phase = phase;
+}
+
+void frameStatsEndFrame(struct FrameStats *stats){
+	uint64_t now = timerNow();
+	stats->current.phases[stats->phase] += now - stats->phaseStart;
+	stats->current.phases[FRAME_PHASE_TOTAL] = now - stats->frameStart;
+
+	size_t head = atomic_load_explicit(&stats->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&stats->tail, memory_order_acquire);
+	if(head - tail == FRAME_STATS_RING_SIZE){
+		stats->dropped++;
+		return;
+	}
+
+	stats->ring[head & (FRAME_STATS_RING_SIZE - 1)] = stats->current;
+	atomic_store_explicit(&stats->head, head + 1, memory_order_release);
+}
+
+/* -----------------------------------CONSUMER-------------------------------- */
+
+void frameStatsCollect(struct FrameStats *stats){
+	size_t tail = atomic_load_explicit(&stats->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&stats->head, memory_order_acquire);
+
+	for(; tail != head; tail++){
+		const struct Sample *sample = &stats->ring[tail & (FRAME_STATS_RING_SIZE - 1)];
+		for(int p = 0; p < FRAME_PHASE_COUNT; p++)
+			histogramAdd(&stats->histograms[p], sample->phases[p]);
+	}
+	atomic_store_explicit(&stats->tail, tail, memory_order_release);
+}
+
+void frameStatsSummary(const struct FrameStats *stats, enum FramePhase phase, struct FrameSummary *summary){
+	const struct Histogram *histogram = &stats->histograms[phase];
+	summary->count = histogram->count;
+	summary->p50 = TIMER_MILLISECONDS(histogramPercentile(histogram, 50.0));
+	summary->p95 = TIMER_MILLISECONDS(histogramPercentile(histogram, 95.0));
+	summary->p99 = TIMER_MILLISECONDS(histogramPercentile(histogram, 99.0));
+	summary->max = TIMER_MILLISECONDS((double) histogram->max);
+}
+
+void frameStatsPrint(const struct FrameStats *stats, FILE *file){
+	fprintf(file, "%-8s %8s %10s %10s %10s %10s\n", "phase", "frames", "p50 ms", "p95 ms", "p99 ms", "max ms");
+	for(int p = 0; p < FRAME_PHASE_COUNT; p++){
+		struct FrameSummary summary;
+		frameStatsSummary(stats, p, &summary);
+		fprintf(file, "%-8s %8llu %10.3f %10.3f %10.3f %10.3f\n", phaseNames[p],
+			(unsigned long long) summary.count, summary.p50, summary.p95, summary.p99, summary.max);
+	}
+	if(stats->dropped > 0)
+		fprintf(file, "%llu frames dropped, collect more often.\n", (unsigned long long) stats->dropped);
+
+	/* The total again, merged into one bar per power of 2 to stay short. */
+	/* frameStatsWriteCSV() has every bucket.				 */
+	const struct Histogram *total = &stats->histograms[FRAME_PHASE_TOTAL];
+	uint64_t octaves[BUCKET_COUNT / HALF_BUCKETS] = {0};
+	uint64_t fullest = 0;
+	for(unsigned int i = 0; i < BUCKET_COUNT; i++){
+		uint64_t *octave = &octaves[i / HALF_BUCKETS];
+		*octave += total->buckets[i];
+		if(*octave > fullest)
+			fullest = *octave;
+	}
+	if(fullest == 0)
+		return;
+
+	fprintf(file, "\nframe time histogram\n");
+	for(unsigned int o = 0; o < BUCKET_COUNT / HALF_BUCKETS; o++){
+		if(octaves[o] == 0)
+			continue;
+
+		uint64_t low, high, unused;
+		bucketRange(o * HALF_BUCKETS, &low, &unused);
+		bucketRange((o + 1) * HALF_BUCKETS - 1, &unused, &high);
+		int width = (int) (octaves[o] * 50 / fullest);
+		fprintf(file, "%9.3f - %9.3f ms %8llu |%.*s\n", TIMER_MILLISECONDS((double) low),
+			TIMER_MILLISECONDS((double) high), (unsigned long long) octaves[o], width > 0 ? width : 1,
+			"##################################################");
+	}
+}
+
+int frameStatsWriteCSV(const struct FrameStats *stats, const char *path){
+	FILE *file = fopen(path, "w");
+	if(file == NULL){
+		perror("ERROR: Could not open the frame statistics file");
+		return -1;
+	}
+
+	fprintf(file, "phase,low_ms,high_ms,count\n");
+	for(int p = 0; p < FRAME_PHASE_COUNT; p++){
+		const struct Histogram *histogram = &stats->histograms[p];
+		for(unsigned int i = 0; i < BUCKET_COUNT; i++){
+			if(histogram->buckets[i] == 0)
+				continue;
+
+			uint64_t low, high;
+			bucketRange(i, &low, &high);
+			fprintf(file, "%s,%.6f,%.6f,%llu\n", phaseNames[p], TIMER_MILLISECONDS((double) low),
+				TIMER_MILLISECONDS((double) high), (unsigned long long) histogram->buckets[i]);
+		}
+	}
+
+	if(fclose(file) != 0){
+		perror("ERROR: Could not write the frame statistics file");
+		return -1;
+	}
+	return 0;
+}
+
+void frameStatsDestroy(struct FrameStats *stats){
+	free(stats);
+}
@@ -0,0 +1,250 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <gl_handles.h>
+#include <fence.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MASK		(HANDLE_MAX_OBJECTS - 1)
+#define GENERATION_MASK		(0xFFFFFFFFu >> HANDLE_INDEX_BITS)
+
+static const char *typeNames[HANDLE_TYPE_COUNT] = { "buffers", "vertex arrays" };
+
+void handlesInit(struct GLHandles *handles){
+	memset(handles, 0, sizeof(*handles));
+}
+
+/* ------------------------------------POOLS---------------------------------- */
+
+static int growPool(struct HandlePool *pool){
+	size_t capacity = pool->capacity ? pool->capacity * 2 : 64;
+	if(capacity > HANDLE_MAX_OBJECTS)
+		capacity = HANDLE_MAX_OBJECTS;
+	if(capacity == pool->capacity)
+		return -1;
+
+	GLuint *names = realloc(pool->names, capacity * sizeof(GLuint));
+	if(names == NULL)
+		return -1;
+	pool->names = names;
+
+	uint32_t *generations = realloc(pool->generations, capacity * sizeof(uint32_t));
+	if(generations == NULL)
+		return -1;
+	pool->generations = generations;
+
+	uint32_t *freeSlots = realloc(pool->freeSlots, capacity * sizeof(uint32_t));
+	if(freeSlots == NULL)
+		return -1;
+	pool->freeSlots = freeSlots;
+
+	pool->capacity = capacity;
+	return 0;
+}
+
+static void genObject(enum HandleType type, GLuint *name){
+	if(type == HANDLE_BUFFER)
+		glGenBuffers(1, name);
+	else
+		glGenVertexArrays(1, name);
+}
+
+static void deleteObjects(enum HandleType type, size_t count, const GLuint *names){
+	if(count == 0)
+		return;
+	if(type == HANDLE_BUFFER)
+		glDeleteBuffers((GLsizei) count, names);
+	else
+		glDeleteVertexArrays((GLsizei) count, names);
+}
+
+static uint32_t createObject(struct HandlePool *pool, enum HandleType type){
+	uint32_t index;
+	if(pool->freeCount > 0)
+		index = pool->freeSlots[--pool->freeCount];
+	else {
+		if(pool->count == pool->capacity && growPool(pool) == -1){
+			fprintf(stderr, "ERROR: No room for more %s.\n", typeNames[type]);
+			return 0;
+		}
+		index = (uint32_t) pool->count++;
+		pool->generations[index] = 1;
+	}
+
+	genObject(type, &pool->names[index]);
+	pool->live++;
+	return pool->generations[index] << HANDLE_INDEX_BITS | index;
+}
+
+static GLuint lookup(const struct HandlePool *pool, uint32_t handle){
+	uint32_t index = handle & INDEX_MASK;
+	if(handle == 0 || index >= pool->count || pool->generations[index] != handle >> HANDLE_INDEX_BITS)
+		return 0;
+	return pool->names[index];
+}
+
+static int releaseObject(struct GLHandles *handles, enum HandleType type, uint32_t handle){
+	struct HandlePool *pool = &handles->pools[type];
+	GLuint name = lookup(pool, handle);
+	if(name == 0){
+		fprintf(stderr, "ERROR: Releasing a stale handle to %s, 0x%08x.\n", typeNames[type], handle);
+		return -1;
+	}
+
+	if(pool->pendingCount == pool->pendingCapacity){
+		size_t capacity = pool->pendingCapacity ? pool->pendingCapacity * 2 : 64;
+		GLuint *names = realloc(pool->pendingNames, capacity * sizeof(GLuint));
+		if(names != NULL)
+			pool->pendingNames = names;
+		uint64_t *frames = realloc(pool->pendingFrames, capacity * sizeof(uint64_t));
+		if(frames != NULL)
+			pool->pendingFrames = frames;
+
+		if(names == NULL || frames == NULL){
+			/* Better to wait on the GPU than to leak. */
+			fprintf(stderr, "ERROR: Out of memory deferring a delete, deleting now.\n");
+			glFinish();
+			deleteObjects(type, 1, &name);
+			goto invalidate;
+		}
+		pool->pendingCapacity = capacity;
+	}
+	pool->pendingNames[pool->pendingCount] = name;
+	pool->pendingFrames[pool->pendingCount] = handles->frame;
+	pool->pendingCount++;
+
+invalidate:;
+	uint32_t index = handle & INDEX_MASK;
+	uint32_t generation = (pool->generations[index] + 1) & GENERATION_MASK;
+	pool->generations[index] = generation ? generation : 1;
+	pool->names[index] = 0;
+	pool->freeSlots[pool->freeCount++] = index;
+	pool->live--;
+	return 0;
+}
+
+/* Released names are in frame order, so the ones the GPU is done with	*/
+/* are at the front.							*/
+static void deleteCompleted(struct HandlePool *pool, enum HandleType type, uint64_t completed){
+	size_t count = 0;
+	while(count < pool->pendingCount && pool->pendingFrames[count] < completed)
+		count++;
+	if(count == 0)
+		return;
+
+	deleteObjects(type, count, pool->pendingNames);
+	pool->deleteCalls++;
+	pool->deleted += count;
+
+	pool->pendingCount -= count;
+	memmove(pool->pendingNames, pool->pendingNames + count, pool->pendingCount * sizeof(GLuint));
+	memmove(pool->pendingFrames, pool->pendingFrames + count, pool->pendingCount * sizeof(uint64_t));
+}
+
+/* ------------------------------------TYPED---------------------------------- */
+
+BufferHandle handlesCreateBuffer(struct GLHandles *handles){
+	return (BufferHandle) { createObject(&handles->pools[HANDLE_BUFFER], HANDLE_BUFFER) };
+}
+
+VertexArrayHandle handlesCreateVertexArray(struct GLHandles *handles){
+	return (VertexArrayHandle) { createObject(&handles->pools[HANDLE_VERTEX_ARRAY], HANDLE_VERTEX_ARRAY) };
+}
+
+GLuint handlesBuffer(const struct GLHandles *handles, BufferHandle handle){
+	return lookup(&handles->pools[HANDLE_BUFFER], handle.value);
+}
+
+GLuint handlesVertexArray(const struct GLHandles *handles, VertexArrayHandle handle){
+	return lookup(&handles->pools[HANDLE_VERTEX_ARRAY], handle.value);
+}
+
+int handlesReleaseBuffer(struct GLHandles *handles, BufferHandle handle){
+	return releaseObject(handles, HANDLE_BUFFER, handle.value);
+}
+
+int handlesReleaseVertexArray(struct GLHandles *handles, VertexArrayHandle handle){
+	return releaseObject(handles, HANDLE_VERTEX_ARRAY, handle.value);
+}
+
+/* -----------------------------------FRAMES---------------------------------- */
+
+void handlesEndFrame(struct GLHandles *handles){
+	if(GLAD_GL_ARB_sync){
+		GLsync *slot = &handles->fences[handles->frame % HANDLE_FRAMES_IN_FLIGHT];
+
+		/* The GPU is a whole ring of frames behind, wait for the oldest. */
+		if(*slot != NULL){
+			fenceWait(*slot);
+			glDeleteSync(*slot);
+			*slot = NULL;
+			handles->completed = handles->frame - HANDLE_FRAMES_IN_FLIGHT + 1;
+		}
+		*slot = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		handles->frame++;
+
+		/* Then whatever else has finished, oldest first. */
+		while(handles->completed < handles->frame){
+			GLsync *fence = &handles->fences[handles->completed % HANDLE_FRAMES_IN_FLIGHT];
+			if(!fenceSignaled(*fence))
+				break;
+			if(*fence != NULL)
+				glDeleteSync(*fence);
+			*fence = NULL;
+			handles->completed++;
+		}
+	} else {
+		/* GL itself defers deleting objects still in use. */
+		handles->frame++;
+		handles->completed = handles->frame;
+	}
+
+	for(int type = 0; type < HANDLE_TYPE_COUNT; type++)
+		deleteCompleted(&handles->pools[type], type, handles->completed);
+}
+
+void handlesPrint(const struct GLHandles *handles, FILE *file){
+	for(int type = 0; type < HANDLE_TYPE_COUNT; type++){
+		const struct HandlePool *pool = &handles->pools[type];
+		fprintf(file, "%s: %zu live, %zu pending, %llu deleted in %llu calls\n", typeNames[type],
+			pool->live, pool->pendingCount, (unsigned long long) pool->deleted,
+			(unsigned long long) pool->deleteCalls);
+	}
+}
+
+void handlesDestroy(struct GLHandles *handles){
+	for(int type = 0; type < HANDLE_TYPE_COUNT; type++){
+		struct HandlePool *pool = &handles->pools[type];
+
+		/* Released slots have a name of 0, which glDelete* ignores. */
+		deleteObjects(type, pool->count, pool->names);
+		deleteObjects(type, pool->pendingCount, pool->pendingNames);
+
+		free(pool->names);
+		free(pool->generations);
+		free(pool->freeSlots);
+		free(pool->pendingNames);
+		free(pool->pendingFrames);
+	}
+
+	for(int i = 0; i < HANDLE_FRAMES_IN_FLIGHT; i++)
+		if(handles->fences[i] != NULL)
+			glDeleteSync(handles->fences[i]);
+
+	memset(handles, 0, sizeof(*handles));
+}
@@ -0,0 +1,359 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <image.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int allocatePixels(struct Image *image, unsigned long width, unsigned long height){
+	if(width == 0 || height == 0 || width > IMAGE_MAX_DIMENSION || height > IMAGE_MAX_DIMENSION){
+		fprintf(stderr, "ERROR: Unsupported image size %lux%lu.\n", width, height);
+		return -1;
+	}
+
+	image->width = (unsigned int) width;
+	image->height = (unsigned int) height;
+	image->pixels = malloc(IMAGE_SIZE(image));
+	if(image->pixels == NULL){
+		fprintf(stderr, "ERROR: Out of memory for a %lux%lu image.\n", width, height);
+		return -1;
+	}
+	return 0;
+}
+
+/* Where the row'th stored row goes, rows are kept bottom up. */
+static unsigned char *outputRow(const struct Image *image, size_t row, int topDown){
+	if(topDown)
+		row = image->height - 1 - row;
+	return image->pixels + row * image->width * 4;
+}
+
+/* -------------------------------------PPM----------------------------------- */
+
+static int isBlank(unsigned char c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* Blanks and comments may sit between any two fields. */
+static const unsigned char *ppmSkip(const unsigned char *p, const unsigned char *end){
+	while(p < end){
+		if(*p == '#'){
+			while(p < end && *p != '\n')
+				p++;
+		} else if(isBlank(*p))
+			p++;
+		else
+			break;
+	}
+	return p;
+}
+
+/* Returns NULL if there is no number or it is larger than any field can be. */
+static const unsigned char *ppmNumber(const unsigned char *p, const unsigned char *end, unsigned long *out){
+	p = ppmSkip(p, end);
+	if(p == end || *p < '0' || *p > '9')
+		return NULL;
+
+	unsigned long value = 0;
+	while(p < end && *p >= '0' && *p <= '9'){
+		value = value * 10 + (unsigned long) (*p++ - '0');
+		if(value > 0xFFFFFF)
+			return NULL;
+	}
+	*out = value;
+	return p;
+}
+
+static int importPPM(const unsigned char *p, size_t size, struct Image *image){
+	const unsigned char *end = p + size;
+	if(size < 2 || p[0] != 'P' || p[1] < '2' || p[1] > '6' || p[1] == '4'){
+		fprintf(stderr, "ERROR: Not a PPM or PGM file.\n");
+		return -1;
+	}
+	int ascii = p[1] == '2' || p[1] == '3';
+	unsigned int channels = p[1] == '3' || p[1] == '6' ? 3 : 1;
+
+	unsigned long width, height, maxValue;
+	p += 2;
+	if((p = ppmNumber(p, end, &width)) == NULL || (p = ppmNumber(p, end, &height)) == NULL ||
+	   (p = ppmNumber(p, end, &maxValue)) == NULL || maxValue == 0 || maxValue > 65535){
+		fprintf(stderr, "ERROR: Malformed PPM header.\n");
+		return -1;
+	}
+	if(allocatePixels(image, width, height) == -1)
+		return -1;
+
+	/* Exactly one blank ends the header of the binary formats. */
+	size_t sampleSize = maxValue > 255 ? 2 : 1;
+	if(!ascii && (p == end || (size_t) (end - ++p) < width * height * channels * sampleSize)){
+		fprintf(stderr, "ERROR: Truncated PPM data.\n");
+		return -1;
+	}
+
+	for(size_t row = 0; row < height; row++){
+		unsigned char *out = outputRow(image, row, 1);
+
+		/* The usual case, straight bytes. */
+		if(!ascii && channels == 3 && maxValue == 255){
+			for(size_t x = 0; x < width; x++, p += 3, out += 4){
+				out[0] = p[0];
+				out[1] = p[1];
+				out[2] = p[2];
+				out[3] = 255;
+			}
+			continue;
+		}
+
+		for(size_t x = 0; x < width; x++, out += 4){
+			unsigned long sample[3];
+			for(unsigned int c = 0; c < channels; c++){
+				if(ascii){
+					if((p = ppmNumber(p, end, &sample[c])) == NULL){
+						fprintf(stderr, "ERROR: Truncated PPM data.\n");
+						return -1;
+					}
+					if(sample[c] > maxValue)
+						sample[c] = maxValue;
+				} else if(sampleSize == 2){
+					sample[c] = (unsigned long) p[0] << 8 | p[1];
+					p += 2;
+				} else
+					sample[c] = *p++;
+			}
+			for(unsigned int c = 0; c < 3; c++){
+				unsigned long value = sample[channels == 3 ? c : 0];
+				out[c] = (unsigned char) (maxValue == 255 ? value : (value * 255 + maxValue / 2) / maxValue);
+			}
+			out[3] = 255;
+		}
+	}
+	return 0;
+}
+
+/* -------------------------------------TGA----------------------------------- */
+
+#define TGA_HEADER_SIZE		18
+#define TGA_TOP_DOWN		0x20
+#define TGA_RLE_REPEAT		0x80
+
+enum TgaType {
+	TGA_TRUE_COLOUR = 2,
+	TGA_GREY = 3,
+	TGA_RLE_TRUE_COLOUR = 10,
+	TGA_RLE_GREY = 11
+};
+
+/* Pixels are stored as BGR(A), 16 bit ones as ARRRRRGG GGGBBBBB. */
+static void tgaPixel(const unsigned char *in, unsigned int depth, unsigned char *out){
+	switch(depth){
+		case 8:
+			out[0] = out[1] = out[2] = in[0];
+			out[3] = 255;
+			break;
+		case 16: {
+			unsigned int value = (unsigned int) in[0] | (unsigned int) in[1] << 8;
+			out[0] = (unsigned char) (((value >> 10) & 31) * 255 / 31);
+			out[1] = (unsigned char) (((value >> 5) & 31) * 255 / 31);
+			out[2] = (unsigned char) ((value & 31) * 255 / 31);
+			out[3] = 255;
+			break;
+		}
+		case 24:
+			out[0] = in[2];
+			out[1] = in[1];
+			out[2] = in[0];
+			out[3] = 255;
+			break;
+		default:
+			out[0] = in[2];
+			out[1] = in[1];
+			out[2] = in[0];
+			out[3] = in[3];
+			break;
+	}
+}
+
+static int importTGA(const unsigned char *data, size_t size, struct Image *image){
+	if(size < TGA_HEADER_SIZE){
+		fprintf(stderr, "ERROR: Truncated TGA header.\n");
+		return -1;
+	}
+
+	unsigned int idLength = data[0], colourMapType = data[1], type = data[2];
+	unsigned int mapLength = (unsigned int) data[5] | (unsigned int) data[6] << 8, mapDepth = data[7];
+	unsigned long width = (unsigned long) data[12] | (unsigned long) data[13] << 8;
+	unsigned long height = (unsigned long) data[14] | (unsigned long) data[15] << 8;
+	unsigned int depth = data[16];
+	int topDown = data[17] & TGA_TOP_DOWN;
+
+	if(type != TGA_TRUE_COLOUR && type != TGA_GREY && type != TGA_RLE_TRUE_COLOUR && type != TGA_RLE_GREY){
+		fprintf(stderr, "ERROR: Unsupported TGA image type %u.\n", type);
+		return -1;
+	}
+	int grey = type == TGA_GREY || type == TGA_RLE_GREY;
+	if(grey ? depth != 8 : depth != 16 && depth != 24 && depth != 32){
+		fprintf(stderr, "ERROR: Unsupported TGA pixel depth %u.\n", depth);
+		return -1;
+	}
+
+	/* A colour map may be present even when the pixels do not use it. */
+	size_t offset = TGA_HEADER_SIZE + idLength + (colourMapType ? (size_t) mapLength * ((mapDepth + 7) / 8) : 0);
+	if(offset > size){
+		fprintf(stderr, "ERROR: Truncated TGA header.\n");
+		return -1;
+	}
+	if(allocatePixels(image, width, height) == -1)
+		return -1;
+
+	const unsigned char *p = data + offset, *end = data + size;
+	size_t bytes = depth / 8, total = width * height;
+
+	if(type == TGA_TRUE_COLOUR || type == TGA_GREY){
+		if((size_t) (end - p) < total * bytes){
+			fprintf(stderr, "ERROR: Truncated TGA data.\n");
+			return -1;
+		}
+		for(size_t row = 0; row < height; row++){
+			unsigned char *out = outputRow(image, row, topDown);
+			for(size_t x = 0; x < width; x++, p += bytes, out += 4)
+				tgaPixel(p, depth, out);
+		}
+		return 0;
+	}
+
+	/* Packets may run on from one row into the next. */
+	size_t row = 0, x = 0, done = 0;
+	unsigned char *out = outputRow(image, 0, topDown);
+	while(done < total){
+		if(p == end){
+			fprintf(stderr, "ERROR: Truncated TGA data.\n");
+			return -1;
+		}
+		unsigned int header = *p++;
+		int repeat = header & TGA_RLE_REPEAT;
+		size_t count = (header & ~TGA_RLE_REPEAT) + 1;
+		if(count > total - done)
+			count = total - done;
+		if((size_t) (end - p) < (repeat ? 1 : count) * bytes){
+			fprintf(stderr, "ERROR: Truncated TGA data.\n");
+			return -1;
+		}
+
+		unsigned char pixel[4];
+		if(repeat){
+			tgaPixel(p, depth, pixel);
+			p += bytes;
+		}
+		for(size_t i = 0; i < count; i++){
+			if(repeat)
+				memcpy(out, pixel, 4);
+			else {
+				tgaPixel(p, depth, out);
+				p += bytes;
+			}
+			out += 4;
+			if(++x == width){
+				x = 0;
+				if(++row < height)
+					out = outputRow(image, row, topDown);
+			}
+		}
+		done += count;
+	}
+	return 0;
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+enum ImageFormat imageFormatFromPath(const char *path){
+	const char *extension = strrchr(path, '.');
+	if(extension == NULL)
+		return IMAGE_FORMAT_UNKNOWN;
+	if(strcasecmp(extension, ".ppm") == 0 || strcasecmp(extension, ".pgm") == 0 ||
+	   strcasecmp(extension, ".pnm") == 0)
+		return IMAGE_FORMAT_PPM;
+	if(strcasecmp(extension, ".tga") == 0)
+		return IMAGE_FORMAT_TGA;
+	return IMAGE_FORMAT_UNKNOWN;
+}
+
+int imageImportMemory(const void *data, size_t size, enum ImageFormat format, struct Image *image){
+	int status;
+
+	memset(image, 0, sizeof(*image));
+
+	switch(format){
+		case IMAGE_FORMAT_PPM: status = importPPM(data, size, image); break;
+		case IMAGE_FORMAT_TGA: status = importTGA(data, size, image); break;
+		default:
+			fprintf(stderr, "ERROR: Unknown image format.\n");
+			return -1;
+	}
+
+	if(status == -1)
+		imageFree(image);
+	return status;
+}
+
+int imageImportFile(const char *path, struct Image *image){
+	enum ImageFormat format = imageFormatFromPath(path);
+	if(format == IMAGE_FORMAT_UNKNOWN){
+		fprintf(stderr, "ERROR: Unknown image format for %s.\n", path);
+		return -1;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1){
+		perror(path);
+		return -1;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1){
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	if(info.st_size == 0){
+		close(fd);
+		return imageImportMemory("", 0, format, image);
+	}
+
+	void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED){
+		perror(path);
+		return -1;
+	}
+	madvise(data, (size_t) info.st_size, MADV_SEQUENTIAL);
+
+	int status = imageImportMemory(data, (size_t) info.st_size, format, image);
+	munmap(data, (size_t) info.st_size);
+	return status;
+}
+
+void imageFree(struct Image *image){
+	free(image->pixels);
+	memset(image, 0, sizeof(*image));
+}
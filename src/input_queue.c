@@ -0,0 +1,50 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <input_queue.h>
+#include <timer.h>
+
+void inputQueueInit(struct InputQueue *queue){
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	queue->dropped = 0;
+}
+
+int inputQueuePush(struct InputQueue *queue, struct InputEvent *event){
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	if(head - tail == INPUT_QUEUE_SIZE){
+		queue->dropped++;
+		return -1;
+	}
+
+	event->time = timerNow();
+	queue->events[head & (INPUT_QUEUE_SIZE - 1)] = *event;
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+	return 0;
+}
+
+int inputQueuePop(struct InputQueue *queue, struct InputEvent *event){
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	if(tail == head)
+		return 0;
+
+	*event = queue->events[tail & (INPUT_QUEUE_SIZE - 1)];
+	atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+	return 1;
+}
@@ -0,0 +1,509 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <jobs.h>
+#include <trace.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Attempts at finding a job before a worker goes to sleep. */
+#define IDLE_SPINS	64
+
+/* A queued job. The fields are atomic because a thief may read a slot	*/
+/* while the owner is reusing it, in which case the thief's claim on it	*/
+/* fails and what it read is thrown away.				*/
+struct Slot {
+	_Atomic(JobFunction) function;
+	_Atomic(void *) data;
+	_Atomic(struct JobCounter *) counter;
+};
+
+struct Task {
+	JobFunction function;
+	void *data;
+	struct JobCounter *counter;
+};
+
+struct Worker {
+	/* Top is taken from by thieves, bottom pushed and popped by the owner. */
+	_Alignas(64) atomic_long top;
+	_Alignas(64) atomic_long bottom;
+	struct Slot slots[JOB_DEQUE_SIZE];
+
+	struct JobSystem *system;
+	uint32_t random;
+	pthread_t thread;
+};
+
+struct JobDeferred {
+	struct JobDeferred *next;
+	struct JobCounter *counter;
+	size_t count;
+	struct Job jobs[];
+};
+
+struct JobSystem {
+	struct Worker *workers;
+	unsigned int threads;
+
+	/* Jobs queued by threads without a deque, first in first out. */
+	pthread_mutex_t sharedLock;
+	struct Task *shared;
+	size_t sharedFirst;
+	size_t sharedCount;
+	size_t sharedCapacity;
+	atomic_size_t sharedPending;
+
+	pthread_mutex_t idleLock;
+	pthread_cond_t idle;
+	atomic_uint sleepers;
+	atomic_int stop;
+	uint64_t id;
+};
+
+/* The thread's worker, valid only while currentSystem is the id of a	*/
+/* live system. Comparing ids rather than currentWorker->system never	*/
+/* reads a worker freed by a system destroyed from another thread.	*/
+static _Thread_local struct Worker *currentWorker;
+static _Thread_local uint64_t currentSystem;
+static atomic_uint_least64_t nextSystemId = 1;
+
+static struct Worker *selfIn(const struct JobSystem *system){
+	return currentSystem == system->id ? currentWorker : NULL;
+}
+
+void jobCounterInit(struct JobCounter *counter){
+	atomic_init(&counter->pending, 0);
+	pthread_mutex_init(&counter->lock, NULL);
+	counter->waiting = NULL;
+}
+
+void jobCounterDestroy(struct JobCounter *counter){
+	pthread_mutex_destroy(&counter->lock);
+}
+
+/* ------------------------------------DEQUE---------------------------------- */
+
+/* Chase-Lev with the C11 orderings of Le, Pop, Cohen and Zappa Nardelli, */
+/* "Correct and Efficient Work-Stealing for Weak Memory Models".	  */
+
+static int dequePush(struct Worker *worker, const struct Task *task){
+	long bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+	long top = atomic_load_explicit(&worker->top, memory_order_acquire);
+	if(bottom - top >= JOB_DEQUE_SIZE)
+		return -1;
+
+	struct Slot *slot = &worker->slots[bottom & (JOB_DEQUE_SIZE - 1)];
+	atomic_store_explicit(&slot->function, task->function, memory_order_relaxed);
+	atomic_store_explicit(&slot->data, task->data, memory_order_relaxed);
+	atomic_store_explicit(&slot->counter, task->counter, memory_order_relaxed);
+	atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_release);
+	return 0;
+}
+
+static void readSlot(const struct Slot *slot, struct Task *task){
+	task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+	task->data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+	task->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+/* Owner only, newest first. */
+static int dequePop(struct Worker *worker, struct Task *task){
+	long bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&worker->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long top = atomic_load_explicit(&worker->top, memory_order_relaxed);
+
+	if(top > bottom){
+		atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+		return 0;
+	}
+
+	readSlot(&worker->slots[bottom & (JOB_DEQUE_SIZE - 1)], task);
+	if(top < bottom)
+		return 1;
+
+	/* The last job, race the thieves for it. */
+	int won = atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1,
+							  memory_order_seq_cst, memory_order_relaxed);
+	atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+	return won;
+}
+
+/* Any thread, oldest first. Also fails when losing a race for the job. */
+static int dequeSteal(struct Worker *worker, struct Task *task){
+	long top = atomic_load_explicit(&worker->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long bottom = atomic_load_explicit(&worker->bottom, memory_order_acquire);
+	if(top >= bottom)
+		return 0;
+
+	readSlot(&worker->slots[top & (JOB_DEQUE_SIZE - 1)], task);
+	return atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1,
+						       memory_order_seq_cst, memory_order_relaxed);
+}
+
+/* ---------------------------------SHARED QUEUE------------------------------ */
+
+static int sharedPush(struct JobSystem *system, const struct Task *task){
+	pthread_mutex_lock(&system->sharedLock);
+	if(system->sharedFirst + system->sharedCount == system->sharedCapacity){
+		/* Move what is left to the front before growing. */
+		memmove(system->shared, system->shared + system->sharedFirst, system->sharedCount * sizeof(struct Task));
+		system->sharedFirst = 0;
+
+		if(system->sharedCount == system->sharedCapacity){
+			size_t capacity = system->sharedCapacity ? system->sharedCapacity * 2 : 64;
+			struct Task *shared = realloc(system->shared, capacity * sizeof(struct Task));
+			if(shared == NULL){
+				pthread_mutex_unlock(&system->sharedLock);
+				return -1;
+			}
+			system->shared = shared;
+			system->sharedCapacity = capacity;
+		}
+	}
+	system->shared[system->sharedFirst + system->sharedCount++] = *task;
+	atomic_fetch_add(&system->sharedPending, 1);
+	pthread_mutex_unlock(&system->sharedLock);
+	return 0;
+}
+
+static int sharedPop(struct JobSystem *system, struct Task *task){
+	if(atomic_load_explicit(&system->sharedPending, memory_order_relaxed) == 0)
+		return 0;
+
+	int found = 0;
+	pthread_mutex_lock(&system->sharedLock);
+	if(system->sharedCount > 0){
+		*task = system->shared[system->sharedFirst++];
+		system->sharedCount--;
+		atomic_fetch_sub(&system->sharedPending, 1);
+		found = 1;
+	}
+	pthread_mutex_unlock(&system->sharedLock);
+	return found;
+}
+
+/* -----------------------------------RUNNING--------------------------------- */
+
+static void queueTasks(struct JobSystem *system, const struct Job *jobs, size_t count, struct JobCounter *counter);
+
+static void finishTask(struct JobSystem *system, struct JobCounter *counter){
+	if(counter == NULL)
+		return;
+
+	long pending = atomic_load_explicit(&counter->pending, memory_order_relaxed);
+	while(pending > 1)
+		if(atomic_compare_exchange_weak(&counter->pending, &pending, pending - 1))
+			return;
+
+	/* Possibly the last job of the batch. That is only seen under the	*/
+	/* lock, which jobWait() takes before returning, so the counter is	*/
+	/* not touched after its owner may have destroyed it.		*/
+	struct JobDeferred *deferred = NULL;
+	pthread_mutex_lock(&counter->lock);
+	if(atomic_fetch_sub(&counter->pending, 1) == 1){
+		deferred = counter->waiting;
+		counter->waiting = NULL;
+	}
+	pthread_mutex_unlock(&counter->lock);
+
+	while(deferred != NULL){
+		struct JobDeferred *next = deferred->next;
+		queueTasks(system, deferred->jobs, deferred->count, deferred->counter);
+		free(deferred);
+		deferred = next;
+	}
+}
+
+static void runTask(struct JobSystem *system, const struct Task *task){
+	task->function(task->data);
+	finishTask(system, task->counter);
+}
+
+static uint32_t nextRandom(uint32_t *state){
+	/* xorshift32 */
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static int findTask(struct JobSystem *system, struct Task *task){
+	struct Worker *self = selfIn(system);
+	if(self != NULL && dequePop(self, task))
+		return 1;
+	if(sharedPop(system, task))
+		return 1;
+
+	static _Thread_local uint32_t random = 0x9E3779B9u;
+	unsigned int start = nextRandom(self != NULL ? &self->random : &random) % system->threads;
+	for(unsigned int i = 0; i < system->threads; i++){
+		struct Worker *victim = &system->workers[(start + i) % system->threads];
+		if(victim != self && dequeSteal(victim, task))
+			return 1;
+	}
+	return 0;
+}
+
+static int anyWork(struct JobSystem *system){
+	if(atomic_load(&system->sharedPending) > 0)
+		return 1;
+	for(unsigned int i = 0; i < system->threads; i++)
+		if(atomic_load(&system->workers[i].bottom) > atomic_load(&system->workers[i].top))
+			return 1;
+	return 0;
+}
+
+static void wakeWorkers(struct JobSystem *system, size_t count){
+	/* Pairs with the fence in workerMain(), so either the sleeper sees */
+	/* the new jobs or this sees the sleeper.			    */
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&system->sleepers, memory_order_relaxed) == 0)
+		return;
+
+	pthread_mutex_lock(&system->idleLock);
+	if(count > 1)
+		pthread_cond_broadcast(&system->idle);
+	else
+		pthread_cond_signal(&system->idle);
+	pthread_mutex_unlock(&system->idleLock);
+}
+
+static void queueTasks(struct JobSystem *system, const struct Job *jobs, size_t count, struct JobCounter *counter){
+	struct Worker *self = selfIn(system);
+
+	for(size_t i = 0; i < count; i++){
+		struct Task task = { jobs[i].function, jobs[i].data, counter };
+		int queued = self != NULL ? dequePush(self, &task) : sharedPush(system, &task);
+
+		/* Rather than fail, run what does not fit. */
+		if(queued == -1)
+			runTask(system, &task);
+	}
+	wakeWorkers(system, count);
+}
+
+void jobRun(struct JobSystem *system, const struct Job *jobs, size_t count, struct JobCounter *counter){
+	if(count == 0)
+		return;
+	if(counter != NULL)
+		atomic_fetch_add(&counter->pending, (long) count);
+	queueTasks(system, jobs, count, counter);
+}
+
+int jobRunAfter(struct JobSystem *system, const struct Job *jobs, size_t count,
+		struct JobCounter *counter, struct JobCounter *dependency){
+	if(count == 0)
+		return 0;
+
+	struct JobDeferred *deferred = malloc(sizeof(struct JobDeferred) + count * sizeof(struct Job));
+	if(deferred == NULL)
+		return -1;
+	deferred->counter = counter;
+	deferred->count = count;
+	memcpy(deferred->jobs, jobs, count * sizeof(struct Job));
+
+	/* Counted from now, so waiting on counter also waits for dependency. */
+	if(counter != NULL)
+		atomic_fetch_add(&counter->pending, (long) count);
+
+	/* The count only drops to 0 under the lock, so the jobs are either	*/
+	/* seen as ready here or started by finishTask().			*/
+	pthread_mutex_lock(&dependency->lock);
+	if(atomic_load(&dependency->pending) > 0){
+		deferred->next = dependency->waiting;
+		dependency->waiting = deferred;
+		deferred = NULL;
+	}
+	pthread_mutex_unlock(&dependency->lock);
+
+	if(deferred != NULL){
+		queueTasks(system, deferred->jobs, count, counter);
+		free(deferred);
+	}
+	return 0;
+}
+
+void jobWait(struct JobSystem *system, struct JobCounter *counter){
+	struct Task task;
+	while(atomic_load_explicit(&counter->pending, memory_order_acquire) > 0){
+		if(findTask(system, &task))
+			runTask(system, &task);
+		else
+			sched_yield();
+	}
+
+	/* Let the last job finish with the counter. */
+	pthread_mutex_lock(&counter->lock);
+	pthread_mutex_unlock(&counter->lock);
+}
+
+struct ParallelFor {
+	JobRangeFunction function;
+	void *data;
+	size_t count;
+	size_t grain;
+	atomic_size_t next;
+};
+
+static void parallelForRanges(void *data){
+	struct ParallelFor *range = data;
+	size_t first;
+	while((first = atomic_fetch_add(&range->next, range->grain)) < range->count){
+		size_t last = range->count - first > range->grain ? first + range->grain : range->count;
+		range->function(range->data, first, last);
+	}
+}
+
+void jobParallelFor(struct JobSystem *system, size_t count, size_t grain,
+		    JobRangeFunction function, void *data){
+	if(grain == 0)
+		grain = 1;
+	size_t ranges = (count + grain - 1) / grain;
+	if(ranges <= 1){
+		if(count > 0)
+			function(data, 0, count);
+		return;
+	}
+
+	struct ParallelFor range = { function, data, count, grain, 0 };
+	struct JobCounter counter;
+	jobCounterInit(&counter);
+
+	/* One job per thread that could help, each taking ranges until	*/
+	/* none are left. The caller is one of them.			*/
+	size_t helpers = (ranges < system->threads ? ranges : system->threads) - 1;
+	struct Job job = { parallelForRanges, &range };
+	for(size_t i = 0; i < helpers; i++)
+		jobRun(system, &job, 1, &counter);
+
+	parallelForRanges(&range);
+	jobWait(system, &counter);
+	jobCounterDestroy(&counter);
+}
+
+/* -----------------------------------WORKERS--------------------------------- */
+
+static void *workerMain(void *arg){
+	struct Worker *worker = arg;
+	struct JobSystem *system = worker->system;
+	currentWorker = worker;
+	currentSystem = system->id;
+	TRACE_THREAD_NAME("job worker");
+
+	struct Task task;
+	while(!atomic_load_explicit(&system->stop, memory_order_acquire)){
+		int found = 0;
+		for(int spin = 0; spin < IDLE_SPINS && !found; spin++){
+			found = findTask(system, &task);
+			if(!found)
+				sched_yield();
+		}
+		if(found){
+			runTask(system, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&system->idleLock);
+		atomic_fetch_add(&system->sleepers, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		if(!atomic_load(&system->stop) && !anyWork(system))
+			pthread_cond_wait(&system->idle, &system->idleLock);
+		atomic_fetch_sub(&system->sleepers, 1);
+		pthread_mutex_unlock(&system->idleLock);
+	}
+	return NULL;
+}
+
+struct JobSystem *jobSystemCreate(unsigned int threads){
+	if(threads == 0){
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 0 ? (unsigned int) online : 1;
+	}
+
+	struct JobSystem *system = calloc(1, sizeof(struct JobSystem));
+	struct Worker *workers = aligned_alloc(64, threads * sizeof(struct Worker));
+	if(system == NULL || workers == NULL){
+		fprintf(stderr, "ERROR: Out of memory creating the job system.\n");
+		free(system);
+		free(workers);
+		return NULL;
+	}
+
+	system->workers = workers;
+	system->threads = threads;
+	pthread_mutex_init(&system->sharedLock, NULL);
+	pthread_mutex_init(&system->idleLock, NULL);
+	pthread_cond_init(&system->idle, NULL);
+	atomic_init(&system->sharedPending, 0);
+	atomic_init(&system->sleepers, 0);
+	atomic_init(&system->stop, 0);
+	system->id = atomic_fetch_add(&nextSystemId, 1);
+
+	for(unsigned int i = 0; i < threads; i++){
+		atomic_init(&workers[i].top, 0);
+		atomic_init(&workers[i].bottom, 0);
+		workers[i].system = system;
+		workers[i].random = 0x9E3779B9u * (i + 1);
+	}
+
+	/* The calling thread is worker 0. */
+	currentWorker = &workers[0];
+	currentSystem = system->id;
+	for(unsigned int i = 1; i < threads; i++){
+		if(pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]) != 0){
+			fprintf(stderr, "ERROR: Could not start job worker %u.\n", i);
+			system->threads = i;
+			jobSystemDestroy(system);
+			return NULL;
+		}
+	}
+	return system;
+}
+
+unsigned int jobSystemThreads(const struct JobSystem *system){
+	return system->threads;
+}
+
+void jobSystemDestroy(struct JobSystem *system){
+	pthread_mutex_lock(&system->idleLock);
+	atomic_store(&system->stop, 1);
+	pthread_cond_broadcast(&system->idle);
+	pthread_mutex_unlock(&system->idleLock);
+
+	for(unsigned int i = 1; i < system->threads; i++)
+		pthread_join(system->workers[i].thread, NULL);
+
+	if(currentSystem == system->id){
+		currentWorker = NULL;
+		currentSystem = 0;
+	}
+
+	pthread_mutex_destroy(&system->sharedLock);
+	pthread_mutex_destroy(&system->idleLock);
+	pthread_cond_destroy(&system->idle);
+	free(system->shared);
+	free(system->workers);
+	free(system);
+}
@@ -0,0 +1,1262 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <mesh.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Below this many bytes per thread, starting a thread costs more than it saves. */
+#define MIN_CHUNK_SIZE	(256 * 1024)
+
+/* ---------------------------------THREADING--------------------------------- */
+
+static unsigned int pickThreadCount(unsigned int threads, size_t size){
+	if(threads == 0){
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 0 ? (unsigned int) online : 1;
+	}
+
+	size_t maxThreads = size / MIN_CHUNK_SIZE + 1;
+	if(threads > maxThreads)
+		threads = (unsigned int) maxThreads;
+
+	return threads;
+}
+
+/* Run fn once per element of args on count threads, the last one on the caller. */
+/* If a thread cannot be started its chunk is simply run on the caller too.	 */
+static void runParallel(unsigned int count, void *(*fn)(void *), void *args, size_t argSize){
+	pthread_t threads[count];
+	int started[count];
+
+	for(unsigned int i = 0; i + 1 < count; i++)
+		started[i] = pthread_create(&threads[i], NULL, fn, (char *) args + i * argSize) == 0;
+
+	fn((char *) args + (count - 1) * argSize);
+
+	for(unsigned int i = 0; i + 1 < count; i++){
+		if(started[i])
+			pthread_join(threads[i], NULL);
+		else
+			fn((char *) args + i * argSize);
+	}
+}
+
+/* Split [0, size) into count ranges which all begin at the start of a line. */
+static void splitOnLines(const char *data, size_t size, unsigned int count, size_t *bounds){
+	bounds[0] = 0;
+	bounds[count] = size;
+
+	for(unsigned int i = 1; i < count; i++){
+		size_t pos = size / count * i;
+		if(pos < bounds[i - 1])
+			pos = bounds[i - 1];
+
+		const char *newline = memchr(data + pos, '\n', size - pos);
+		bounds[i] = newline ? (size_t) (newline - data) + 1 : size;
+	}
+}
+
+/* ----------------------------------NUMBERS---------------------------------- */
+
+/* strtof() goes through the locale and errno on every call, which dominates  */
+/* the parse time of large files. Numbers in mesh files are plain decimals,   */
+/* so accumulate the digits in an integer and scale once by a power of ten.   */
+
+static const double powersOf10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *skipBlanks(const char *p, const char *end){
+	while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	return p;
+}
+
+static const char *skipToken(const char *p, const char *end){
+	while(p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		p++;
+	return p;
+}
+
+/* Returns the character after the number, or NULL if there was no number. */
+static const char *parseFloat(const char *p, const char *end, float *out){
+	int negative = 0;
+	if(p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	int seenDigit = 0;
+
+	for(; p < end && *p >= '0' && *p <= '9'; p++){
+		seenDigit = 1;
+		if(digits < 19){
+			mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+			digits += mantissa != 0;
+		} else {
+			exponent++;
+		}
+	}
+
+	if(p < end && *p == '.'){
+		for(p++; p < end && *p >= '0' && *p <= '9'; p++){
+			seenDigit = 1;
+			if(digits < 19){
+				mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+
+	if(!seenDigit)
+		return NULL;
+
+	if(p < end && (*p == 'e' || *p == 'E')){
+		const char *q = p + 1;
+		int negativeExponent = 0;
+		if(q < end && (*q == '-' || *q == '+')){
+			negativeExponent = *q == '-';
+			q++;
+		}
+
+		if(q < end && *q >= '0' && *q <= '9'){
+			int value = 0;
+			for(; q < end && *q >= '0' && *q <= '9'; q++){
+				if(value < 10000)
+					value = value * 10 + (*q - '0');
+			}
+			exponent += negativeExponent ? -value : value;
+			p = q;
+		}
+	}
+
+	double value = (double) mantissa;
+	if(mantissa != 0){
+		for(; exponent > 22; exponent -= 22)
+			value *= 1e22;
+		for(; exponent < -22; exponent += 22)
+			value /= 1e22;
+		value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+	}
+
+	*out = (float) (negative ? -value : value);
+	return p;
+}
+
+static const char *parseInt(const char *p, const char *end, long *out){
+	int negative = 0;
+	if(p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+
+	if(p == end || *p < '0' || *p > '9')
+		return NULL;
+
+	long value = 0;
+	for(; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+
+	*out = negative ? -value : value;
+	return p;
+}
+
+/* ----------------------------------INDICES---------------------------------- */
+
+/* Growable array of ints, used for face corners and triangle indices. */
+struct IntArray {
+	int *data;
+	size_t count;
+	size_t capacity;
+};
+
+static int intArrayReserve(struct IntArray *array, size_t extra){
+	if(array->count + extra <= array->capacity)
+		return 0;
+
+	size_t capacity = array->capacity ? array->capacity * 2 : 4096;
+	while(capacity < array->count + extra)
+		capacity *= 2;
+
+	int *data = realloc(array->data, capacity * sizeof(int));
+	if(data == NULL)
+		return -1;
+
+	array->data = data;
+	array->capacity = capacity;
+	return 0;
+}
+
+/* ------------------------------------OBJ------------------------------------ */
+
+/* A face corner: position, texcoord and normal index, -1 when not given. */
+#define CORNER_SIZE 3
+
+struct ObjChunk {
+	const char *begin;
+	const char *end;
+
+	/* Counted by the first pass. */
+	size_t positionCount;
+	size_t texcoordCount;
+	size_t normalCount;
+
+	/* Where this chunk's elements go in the shared arrays. */
+	size_t positionOffset;
+	size_t texcoordOffset;
+	size_t normalOffset;
+	float *positions;
+	float *texcoords;
+	float *normals;
+
+	/* Triangulated face corners, with indices already made absolute. */
+	struct IntArray corners;
+	int usesTexcoords;
+	int usesNormals;
+
+	const char *error;
+	const char *errorAt;
+};
+
+enum ObjLine { OBJ_OTHER, OBJ_POSITION, OBJ_TEXCOORD, OBJ_NORMAL, OBJ_FACE };
+
+static enum ObjLine objLineType(const char **p, const char *end){
+	const char *q = skipBlanks(*p, end);
+	enum ObjLine type = OBJ_OTHER;
+	size_t length = 0;
+
+	if(end - q >= 2 && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t')){
+		type = OBJ_POSITION;
+		length = 1;
+	} else if(end - q >= 3 && q[0] == 'v' && q[1] == 't' && (q[2] == ' ' || q[2] == '\t')){
+		type = OBJ_TEXCOORD;
+		length = 2;
+	} else if(end - q >= 3 && q[0] == 'v' && q[1] == 'n' && (q[2] == ' ' || q[2] == '\t')){
+		type = OBJ_NORMAL;
+		length = 2;
+	} else if(end - q >= 2 && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t')){
+		type = OBJ_FACE;
+		length = 1;
+	}
+
+	*p = q + length;
+	return type;
+}
+
+static void *objCount(void *arg){
+	struct ObjChunk *chunk = arg;
+
+	for(const char *p = chunk->begin; p < chunk->end;){
+		const char *lineEnd = memchr(p, '\n', chunk->end - p);
+		if(lineEnd == NULL)
+			lineEnd = chunk->end;
+
+		switch(objLineType(&p, lineEnd)){
+			case OBJ_POSITION: chunk->positionCount++; break;
+			case OBJ_TEXCOORD: chunk->texcoordCount++; break;
+			case OBJ_NORMAL: chunk->normalCount++; break;
+			default: break;
+		}
+
+		p = lineEnd + 1;
+	}
+
+	return NULL;
+}
+
+/* OBJ indices are 1 based, negative ones count back from the last element. */
+static int objResolve(long index, size_t seen){
+	if(index > 0)
+		return (int) (index - 1);
+	if(index < 0 && (size_t) -index <= seen)
+		return (int) ((long) seen + index);
+	return -2;
+}
+
+/* Parse "v", "v/t", "v//n" or "v/t/n". */
+static const char *objParseCorner(const char *p, const char *end, const struct ObjChunk *chunk,
+				  size_t positions, size_t texcoords, size_t normals, int *corner){
+	long index;
+
+	corner[1] = corner[2] = -1;
+
+	if((p = parseInt(p, end, &index)) == NULL)
+		return NULL;
+	corner[0] = objResolve(index, chunk->positionOffset + positions);
+
+	if(p < end && *p == '/'){
+		p++;
+		if(p < end && *p != '/'){
+			if((p = parseInt(p, end, &index)) == NULL)
+				return NULL;
+			corner[1] = objResolve(index, chunk->texcoordOffset + texcoords);
+		}
+		if(p < end && *p == '/'){
+			if((p = parseInt(p + 1, end, &index)) == NULL)
+				return NULL;
+			corner[2] = objResolve(index, chunk->normalOffset + normals);
+		}
+	}
+
+	if(corner[0] == -2 || corner[1] == -2 || corner[2] == -2)
+		return NULL;
+
+	return p;
+}
+
+static int objParseFace(struct ObjChunk *chunk, const char *p, const char *end,
+			size_t positions, size_t texcoords, size_t normals){
+	int first[CORNER_SIZE];
+	int previous[CORNER_SIZE];
+	int corner[CORNER_SIZE];
+	unsigned int count = 0;
+
+	for(p = skipBlanks(p, end); p < end; p = skipBlanks(p, end)){
+		if(*p == '#')
+			break;
+
+		p = objParseCorner(p, end, chunk, positions, texcoords, normals, corner);
+		if(p == NULL)
+			return -1;
+
+		chunk->usesTexcoords |= corner[1] >= 0;
+		chunk->usesNormals |= corner[2] >= 0;
+
+		/* Polygons are triangulated as a fan around the first corner. */
+		if(count >= 2){
+			if(intArrayReserve(&chunk->corners, 3 * CORNER_SIZE) == -1)
+				return -1;
+			int *out = chunk->corners.data + chunk->corners.count;
+			memcpy(out, first, sizeof(first));
+			memcpy(out + CORNER_SIZE, previous, sizeof(previous));
+			memcpy(out + 2 * CORNER_SIZE, corner, sizeof(corner));
+			chunk->corners.count += 3 * CORNER_SIZE;
+		}
+
+		if(count == 0)
+			memcpy(first, corner, sizeof(corner));
+		memcpy(previous, corner, sizeof(corner));
+		count++;
+	}
+
+	return count >= 3 ? 0 : -1;
+}
+
+static const char *objParseFloats(const char *p, const char *end, float *out, unsigned int required,
+				  unsigned int count){
+	for(unsigned int i = 0; i < count; i++){
+		p = skipBlanks(p, end);
+		const char *next = parseFloat(p, end, &out[i]);
+		if(next == NULL){
+			if(i < required)
+				return NULL;
+			out[i] = 0.0f;
+			continue;
+		}
+		p = next;
+	}
+	return p;
+}
+
+static void *objParse(void *arg){
+	struct ObjChunk *chunk = arg;
+	size_t positions = 0, texcoords = 0, normals = 0;
+
+	for(const char *p = chunk->begin; p < chunk->end;){
+		const char *lineStart = p;
+		const char *lineEnd = memchr(p, '\n', chunk->end - p);
+		if(lineEnd == NULL)
+			lineEnd = chunk->end;
+
+		int failed = 0;
+		switch(objLineType(&p, lineEnd)){
+			case OBJ_POSITION:
+				failed = !objParseFloats(p, lineEnd,
+					chunk->positions + (chunk->positionOffset + positions++) * 3, 3, 3);
+				break;
+			case OBJ_TEXCOORD:
+				failed = !objParseFloats(p, lineEnd,
+					chunk->texcoords + (chunk->texcoordOffset + texcoords++) * 2, 1, 2);
+				break;
+			case OBJ_NORMAL:
+				failed = !objParseFloats(p, lineEnd,
+					chunk->normals + (chunk->normalOffset + normals++) * 3, 3, 3);
+				break;
+			case OBJ_FACE:
+				failed = objParseFace(chunk, p, lineEnd, positions, texcoords, normals) == -1;
+				break;
+			default:
+				break;
+		}
+
+		if(failed){
+			chunk->error = "malformed line";
+			chunk->errorAt = lineStart;
+			return NULL;
+		}
+
+		p = lineEnd + 1;
+	}
+
+	return NULL;
+}
+
+/* Open addressing map from a face corner to the vertex made for it. */
+struct CornerMap {
+	int *keys;
+	unsigned int *values;
+	size_t mask;
+};
+
+static size_t hashCorner(const int *corner){
+	uint64_t h = (uint32_t) corner[0] * 0x9E3779B97F4A7C15ull;
+	h ^= ((uint64_t) (uint32_t) corner[1] << 32 | (uint32_t) corner[2]) * 0xC2B2AE3D27D4EB4Full;
+	h ^= h >> 31;
+	return (size_t) h;
+}
+
+static int objBuildMesh(struct ObjChunk *chunks, unsigned int count, struct Mesh *mesh){
+	size_t positionCount = chunks[count - 1].positionOffset + chunks[count - 1].positionCount;
+	size_t texcoordCount = chunks[count - 1].texcoordOffset + chunks[count - 1].texcoordCount;
+	size_t normalCount = chunks[count - 1].normalOffset + chunks[count - 1].normalCount;
+	float *positions = chunks[0].positions;
+	float *texcoords = chunks[0].texcoords;
+	float *normals = chunks[0].normals;
+
+	size_t cornerCount = 0;
+	int usesTexcoords = 0, usesNormals = 0;
+	for(unsigned int i = 0; i < count; i++){
+		cornerCount += chunks[i].corners.count / CORNER_SIZE;
+		usesTexcoords |= chunks[i].usesTexcoords;
+		usesNormals |= chunks[i].usesNormals;
+	}
+
+	mesh->attributes = (usesNormals ? MESH_ATTRIB_NORMAL : 0) | (usesTexcoords ? MESH_ATTRIB_TEXCOORD : 0);
+	mesh->stride = 3 + (usesNormals ? 3 : 0) + (usesTexcoords ? 2 : 0);
+
+	/* A point cloud, the positions are the vertices. */
+	if(cornerCount == 0){
+		mesh->vertices = malloc(positionCount * 3 * sizeof(float) + 1);
+		if(mesh->vertices == NULL){
+			fprintf(stderr, "ERROR: Out of memory importing OBJ.\n");
+			return -1;
+		}
+		memcpy(mesh->vertices, positions, positionCount * 3 * sizeof(float));
+		mesh->vertexCount = positionCount;
+		mesh->stride = 3;
+		mesh->attributes = 0;
+		return 0;
+	}
+
+	struct CornerMap map;
+	size_t capacity = 16;
+	while(capacity < cornerCount * 2)
+		capacity *= 2;
+	map.mask = capacity - 1;
+	map.keys = malloc(capacity * CORNER_SIZE * sizeof(int));
+	map.values = malloc(capacity * sizeof(unsigned int));
+	mesh->vertices = malloc(cornerCount * mesh->stride * sizeof(float));
+	mesh->indices = malloc(cornerCount * sizeof(unsigned int));
+	if(map.keys == NULL || map.values == NULL || mesh->vertices == NULL || mesh->indices == NULL){
+		fprintf(stderr, "ERROR: Out of memory importing OBJ.\n");
+		free(map.keys);
+		free(map.values);
+		return -1;
+	}
+	/* Position indices are never negative, so -1 marks an empty slot. */
+	memset(map.keys, 0xff, capacity * CORNER_SIZE * sizeof(int));
+
+	int status = 0;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	for(unsigned int c = 0; c < count && status == 0; c++){
+		const int *corner = chunks[c].corners.data;
+		const int *last = corner + chunks[c].corners.count;
+
+		for(; corner < last; corner += CORNER_SIZE){
+			if((size_t) corner[0] >= positionCount ||
+			   (corner[1] >= 0 && (size_t) corner[1] >= texcoordCount) ||
+			   (corner[2] >= 0 && (size_t) corner[2] >= normalCount)){
+				fprintf(stderr, "ERROR: OBJ face index out of range.\n");
+				status = -1;
+				break;
+			}
+
+			size_t slot = hashCorner(corner) & map.mask;
+			int *key = map.keys + slot * CORNER_SIZE;
+			while(key[0] != -1 && memcmp(key, corner, CORNER_SIZE * sizeof(int)) != 0){
+				slot = (slot + 1) & map.mask;
+				key = map.keys + slot * CORNER_SIZE;
+			}
+
+			if(key[0] == -1){
+				memcpy(key, corner, CORNER_SIZE * sizeof(int));
+				map.values[slot] = (unsigned int) vertexCount;
+
+				float *vertex = mesh->vertices + vertexCount * mesh->stride;
+				memcpy(vertex, positions + (size_t) corner[0] * 3, 3 * sizeof(float));
+				vertex += 3;
+				if(usesNormals){
+					if(corner[2] >= 0)
+						memcpy(vertex, normals + (size_t) corner[2] * 3, 3 * sizeof(float));
+					else
+						memset(vertex, 0, 3 * sizeof(float));
+					vertex += 3;
+				}
+				if(usesTexcoords){
+					if(corner[1] >= 0)
+						memcpy(vertex, texcoords + (size_t) corner[1] * 2, 2 * sizeof(float));
+					else
+						memset(vertex, 0, 2 * sizeof(float));
+				}
+				vertexCount++;
+			}
+
+			mesh->indices[indexCount++] = map.values[slot];
+		}
+	}
+
+	free(map.keys);
+	free(map.values);
+
+	if(status == 0){
+		float *shrunk = realloc(mesh->vertices, vertexCount * mesh->stride * sizeof(float));
+		if(shrunk != NULL)
+			mesh->vertices = shrunk;
+		mesh->vertexCount = vertexCount;
+		mesh->indexCount = indexCount;
+	}
+
+	return status;
+}
+
+static int importOBJ(const char *data, size_t size, struct Mesh *mesh, unsigned int threads){
+	unsigned int count = pickThreadCount(threads, size);
+	struct ObjChunk chunks[count];
+	size_t bounds[count + 1];
+	int status = -1;
+
+	splitOnLines(data, size, count, bounds);
+	memset(chunks, 0, sizeof(chunks));
+	for(unsigned int i = 0; i < count; i++){
+		chunks[i].begin = data + bounds[i];
+		chunks[i].end = data + bounds[i + 1];
+	}
+
+	/* First pass only counts, so every chunk knows where its data goes. */
+	runParallel(count, objCount, chunks, sizeof(struct ObjChunk));
+
+	size_t positions = 0, texcoords = 0, normals = 0;
+	for(unsigned int i = 0; i < count; i++){
+		chunks[i].positionOffset = positions;
+		chunks[i].texcoordOffset = texcoords;
+		chunks[i].normalOffset = normals;
+		positions += chunks[i].positionCount;
+		texcoords += chunks[i].texcoordCount;
+		normals += chunks[i].normalCount;
+	}
+
+	float *positionData = malloc(positions * 3 * sizeof(float) + 1);
+	float *texcoordData = malloc(texcoords * 2 * sizeof(float) + 1);
+	float *normalData = malloc(normals * 3 * sizeof(float) + 1);
+	if(positionData == NULL || texcoordData == NULL || normalData == NULL){
+		fprintf(stderr, "ERROR: Out of memory importing OBJ.\n");
+		goto cleanup;
+	}
+
+	for(unsigned int i = 0; i < count; i++){
+		chunks[i].positions = positionData;
+		chunks[i].texcoords = texcoordData;
+		chunks[i].normals = normalData;
+	}
+
+	runParallel(count, objParse, chunks, sizeof(struct ObjChunk));
+
+	for(unsigned int i = 0; i < count; i++){
+		if(chunks[i].error != NULL){
+			fprintf(stderr, "ERROR: OBJ %s at byte %zu.\n", chunks[i].error,
+				(size_t) (chunks[i].errorAt - data));
+			goto cleanup;
+		}
+	}
+
+	status = objBuildMesh(chunks, count, mesh);
+
+cleanup:
+	for(unsigned int i = 0; i < count; i++)
+		free(chunks[i].corners.data);
+	free(positionData);
+	free(texcoordData);
+	free(normalData);
+	return status;
+}
+
+/* ------------------------------------PLY------------------------------------ */
+
+enum PlyType {
+	PLY_INVALID = 0,
+	PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+	PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+};
+
+enum PlyEncoding { PLY_ASCII, PLY_LITTLE_ENDIAN, PLY_BIG_ENDIAN };
+
+/* Slots of the vertex properties we know about, -1 for anything else. */
+enum PlySlot {
+	PLY_X, PLY_Y, PLY_Z, PLY_NX, PLY_NY, PLY_NZ, PLY_U, PLY_V, PLY_SLOTS
+};
+
+#define PLY_MAX_PROPERTIES 32
+
+struct PlyProperty {
+	enum PlyType type;
+	enum PlyType countType;	/* Only for lists. */
+	int isList;
+	int slot;
+};
+
+struct PlyElement {
+	char name[32];
+	size_t count;
+	struct PlyProperty properties[PLY_MAX_PROPERTIES];
+	unsigned int propertyCount;
+};
+
+struct PlyChunk {
+	const struct PlyElement *element;
+	enum PlyEncoding encoding;
+	const char *begin;
+	const char *end;
+	size_t first;		/* Index of the first vertex in the chunk. */
+	size_t count;		/* Number of records in the chunk. */
+	size_t recordSize;	/* Binary vertices only. */
+
+	const int *outputOffset;	/* Float offset in the vertex of each slot, -1 if dropped. */
+	float *vertices;
+	unsigned int stride;
+
+	struct IntArray indices;	/* Faces only. */
+
+	const char *error;
+};
+
+static enum PlyType plyType(const char *name, size_t length){
+	static const struct { const char *name; enum PlyType type; } types[] = {
+		{"char", PLY_INT8}, {"int8", PLY_INT8}, {"uchar", PLY_UINT8}, {"uint8", PLY_UINT8},
+		{"short", PLY_INT16}, {"int16", PLY_INT16}, {"ushort", PLY_UINT16}, {"uint16", PLY_UINT16},
+		{"int", PLY_INT32}, {"int32", PLY_INT32}, {"uint", PLY_UINT32}, {"uint32", PLY_UINT32},
+		{"float", PLY_FLOAT32}, {"float32", PLY_FLOAT32}, {"double", PLY_FLOAT64}, {"float64", PLY_FLOAT64}
+	};
+
+	for(size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++){
+		if(strlen(types[i].name) == length && memcmp(types[i].name, name, length) == 0)
+			return types[i].type;
+	}
+	return PLY_INVALID;
+}
+
+static size_t plyTypeSize(enum PlyType type){
+	switch(type){
+		case PLY_INT8: case PLY_UINT8: return 1;
+		case PLY_INT16: case PLY_UINT16: return 2;
+		case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+		case PLY_FLOAT64: return 8;
+		default: return 0;
+	}
+}
+
+static int plySlot(const char *name, size_t length){
+	static const struct { const char *name; int slot; } slots[] = {
+		{"x", PLY_X}, {"y", PLY_Y}, {"z", PLY_Z},
+		{"nx", PLY_NX}, {"ny", PLY_NY}, {"nz", PLY_NZ},
+		{"u", PLY_U}, {"s", PLY_U}, {"texture_u", PLY_U}, {"texture_s", PLY_U},
+		{"v", PLY_V}, {"t", PLY_V}, {"texture_v", PLY_V}, {"texture_t", PLY_V}
+	};
+
+	for(size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); i++){
+		if(strlen(slots[i].name) == length && memcmp(slots[i].name, name, length) == 0)
+			return slots[i].slot;
+	}
+	return -1;
+}
+
+static double plyRead(const unsigned char *p, enum PlyType type, int bigEndian){
+	unsigned char bytes[8];
+	size_t size = plyTypeSize(type);
+
+	for(size_t i = 0; i < size; i++)
+		bytes[i] = bigEndian ? p[size - 1 - i] : p[i];
+
+	switch(type){
+		case PLY_INT8: return (int8_t) bytes[0];
+		case PLY_UINT8: return bytes[0];
+		case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+		case PLY_FLOAT64: { double v; memcpy(&v, bytes, 8); return v; }
+		default: return 0.0;
+	}
+}
+
+/* Returns the first byte after the header, or NULL if the header is invalid. */
+static const char *plyParseHeader(const char *data, size_t size, enum PlyEncoding *encoding,
+				  struct PlyElement *elements, unsigned int *elementCount,
+				  unsigned int maxElements){
+	const char *end = data + size;
+	const char *p = data;
+	int seenFormat = 0;
+
+	*elementCount = 0;
+
+	for(unsigned int line = 0; p < end; line++){
+		const char *lineEnd = memchr(p, '\n', end - p);
+		if(lineEnd == NULL)
+			return NULL;
+
+		const char *words[8];
+		size_t lengths[8];
+		unsigned int wordCount = 0;
+		for(const char *q = skipBlanks(p, lineEnd); q < lineEnd && wordCount < 8; q = skipBlanks(q, lineEnd)){
+			const char *wordEnd = skipToken(q, lineEnd);
+			words[wordCount] = q;
+			lengths[wordCount++] = (size_t) (wordEnd - q);
+			q = wordEnd;
+		}
+		p = lineEnd + 1;
+
+#define WORD_IS(i, text) (lengths[i] == sizeof(text) - 1 && memcmp(words[i], text, sizeof(text) - 1) == 0)
+
+		if(line == 0){
+			if(wordCount != 1 || !WORD_IS(0, "ply"))
+				return NULL;
+			continue;
+		}
+		if(wordCount == 0 || WORD_IS(0, "comment") || WORD_IS(0, "obj_info"))
+			continue;
+
+		if(WORD_IS(0, "end_header"))
+			return seenFormat ? p : NULL;
+
+		if(WORD_IS(0, "format") && wordCount >= 2){
+			if(WORD_IS(1, "ascii"))
+				*encoding = PLY_ASCII;
+			else if(WORD_IS(1, "binary_little_endian"))
+				*encoding = PLY_LITTLE_ENDIAN;
+			else if(WORD_IS(1, "binary_big_endian"))
+				*encoding = PLY_BIG_ENDIAN;
+			else
+				return NULL;
+			seenFormat = 1;
+		} else if(WORD_IS(0, "element") && wordCount == 3){
+			if(*elementCount == maxElements)
+				return NULL;
+			struct PlyElement *element = &elements[(*elementCount)++];
+			memset(element, 0, sizeof(*element));
+			size_t length = lengths[1] < sizeof(element->name) - 1 ? lengths[1] : sizeof(element->name) - 1;
+			memcpy(element->name, words[1], length);
+			long count;
+			if(parseInt(words[2], words[2] + lengths[2], &count) == NULL || count < 0)
+				return NULL;
+			element->count = (size_t) count;
+		} else if(WORD_IS(0, "property") && *elementCount > 0){
+			struct PlyElement *element = &elements[*elementCount - 1];
+			if(element->propertyCount == PLY_MAX_PROPERTIES)
+				return NULL;
+			struct PlyProperty *property = &element->properties[element->propertyCount++];
+			property->slot = -1;
+
+			if(wordCount == 5 && WORD_IS(1, "list")){
+				property->isList = 1;
+				property->countType = plyType(words[2], lengths[2]);
+				property->type = plyType(words[3], lengths[3]);
+				if(property->countType == PLY_INVALID || property->countType == PLY_FLOAT32 ||
+				   property->countType == PLY_FLOAT64)
+					return NULL;
+				if(WORD_IS(4, "vertex_indices") || WORD_IS(4, "vertex_index"))
+					property->slot = 0;
+			} else if(wordCount == 3){
+				property->type = plyType(words[1], lengths[1]);
+				property->slot = plySlot(words[2], lengths[2]);
+			} else {
+				return NULL;
+			}
+
+			if(property->type == PLY_INVALID)
+				return NULL;
+		} else {
+			return NULL;
+		}
+#undef WORD_IS
+	}
+
+	return NULL;
+}
+
+/* Find where count ascii records starting at p end, and where each of the	*/
+/* chunks should begin so they all get about the same number of records.	*/
+static const char *plyAsciiSplit(const char *p, const char *end, size_t count,
+				 struct PlyChunk *chunks, unsigned int chunkCount){
+	unsigned int next = 0;
+
+	for(size_t record = 0; record < count; record++){
+		while(next < chunkCount && record == count / chunkCount * next){
+			chunks[next].begin = p;
+			chunks[next].first = record;
+			next++;
+		}
+
+		const char *lineEnd = memchr(p, '\n', end - p);
+		if(lineEnd == NULL){
+			if(record + 1 < count || p == end)
+				return NULL;
+			lineEnd = end;
+		}
+		p = lineEnd < end ? lineEnd + 1 : end;
+	}
+
+	for(; next < chunkCount; next++){
+		chunks[next].begin = p;
+		chunks[next].first = count;
+	}
+
+	for(unsigned int i = 0; i < chunkCount; i++){
+		chunks[i].end = i + 1 < chunkCount ? chunks[i + 1].begin : p;
+		chunks[i].count = (i + 1 < chunkCount ? chunks[i + 1].first : count) - chunks[i].first;
+	}
+
+	return p;
+}
+
+static void plyStoreVertex(struct PlyChunk *chunk, float *vertex, int slot, float value){
+	if(slot >= 0 && chunk->outputOffset[slot] >= 0)
+		vertex[chunk->outputOffset[slot]] = value;
+}
+
+static int plyAddPolygon(struct PlyChunk *chunk, const long *polygon, size_t count){
+	if(count < 3)
+		return 0;
+	if(intArrayReserve(&chunk->indices, (count - 2) * 3) == -1)
+		return -1;
+
+	for(size_t i = 2; i < count; i++){
+		int *out = chunk->indices.data + chunk->indices.count;
+		out[0] = (int) polygon[0];
+		out[1] = (int) polygon[i - 1];
+		out[2] = (int) polygon[i];
+		chunk->indices.count += 3;
+	}
+	return 0;
+}
+
+#define PLY_MAX_POLYGON 256
+
+static void *plyParseAscii(void *arg){
+	struct PlyChunk *chunk = arg;
+	const struct PlyElement *element = chunk->element;
+	int isVertex = chunk->vertices != NULL;
+	const char *p = chunk->begin;
+
+	for(size_t record = 0; record < chunk->count; record++){
+		const char *lineEnd = memchr(p, '\n', chunk->end - p);
+		if(lineEnd == NULL)
+			lineEnd = chunk->end;
+
+		float *vertex = isVertex ? chunk->vertices + (chunk->first + record) * chunk->stride : NULL;
+
+		for(unsigned int i = 0; i < element->propertyCount; i++){
+			const struct PlyProperty *property = &element->properties[i];
+			float value;
+
+			p = skipBlanks(p, lineEnd);
+			if(!property->isList){
+				if((p = parseFloat(p, lineEnd, &value)) == NULL)
+					goto malformed;
+				if(isVertex)
+					plyStoreVertex(chunk, vertex, property->slot, value);
+				continue;
+			}
+
+			long count;
+			if((p = parseInt(p, lineEnd, &count)) == NULL || count < 0)
+				goto malformed;
+
+			long polygon[PLY_MAX_POLYGON];
+			int keep = !isVertex && property->slot == 0;
+			if(keep && count > PLY_MAX_POLYGON){
+				chunk->error = "polygon with too many corners";
+				return NULL;
+			}
+
+			for(long j = 0; j < count; j++){
+				long index;
+				p = skipBlanks(p, lineEnd);
+				if((p = parseInt(p, lineEnd, &index)) == NULL)
+					goto malformed;
+				if(keep)
+					polygon[j] = index;
+			}
+
+			if(keep && plyAddPolygon(chunk, polygon, (size_t) count) == -1){
+				chunk->error = "out of memory";
+				return NULL;
+			}
+		}
+
+		p = lineEnd + 1;
+	}
+
+	return NULL;
+
+malformed:
+	chunk->error = "malformed record";
+	return NULL;
+}
+
+/* Binary vertices without lists all have the same size and are read in parallel. */
+static void *plyParseBinaryVertices(void *arg){
+	struct PlyChunk *chunk = arg;
+	const struct PlyElement *element = chunk->element;
+	int bigEndian = chunk->encoding == PLY_BIG_ENDIAN;
+	const unsigned char *p = (const unsigned char *) chunk->begin;
+
+	for(size_t record = 0; record < chunk->count; record++){
+		float *vertex = chunk->vertices + (chunk->first + record) * chunk->stride;
+		for(unsigned int i = 0; i < element->propertyCount; i++){
+			const struct PlyProperty *property = &element->properties[i];
+			plyStoreVertex(chunk, vertex, property->slot, (float) plyRead(p, property->type, bigEndian));
+			p += plyTypeSize(property->type);
+		}
+	}
+
+	return NULL;
+}
+
+/* Records with lists have variable sizes, so these are walked in order. */
+static const char *plyParseBinaryRecords(struct PlyChunk *chunk, const char *p, const char *end){
+	const struct PlyElement *element = chunk->element;
+	int bigEndian = chunk->encoding == PLY_BIG_ENDIAN;
+	int isVertex = chunk->vertices != NULL;
+	long polygon[PLY_MAX_POLYGON];
+
+	for(size_t record = 0; record < element->count; record++){
+		float *vertex = isVertex ? chunk->vertices + record * chunk->stride : NULL;
+
+		for(unsigned int i = 0; i < element->propertyCount; i++){
+			const struct PlyProperty *property = &element->properties[i];
+			size_t size = plyTypeSize(property->type);
+
+			if(!property->isList){
+				if((size_t) (end - p) < size)
+					return NULL;
+				if(isVertex)
+					plyStoreVertex(chunk, vertex, property->slot,
+						       (float) plyRead((const unsigned char *) p, property->type, bigEndian));
+				p += size;
+				continue;
+			}
+
+			size_t countSize = plyTypeSize(property->countType);
+			if((size_t) (end - p) < countSize)
+				return NULL;
+			double count = plyRead((const unsigned char *) p, property->countType, bigEndian);
+			p += countSize;
+			if(count < 0 || (size_t) (end - p) < (size_t) count * size)
+				return NULL;
+
+			int keep = !isVertex && property->slot == 0;
+			if(keep){
+				if(count > PLY_MAX_POLYGON)
+					return NULL;
+				for(size_t j = 0; j < (size_t) count; j++)
+					polygon[j] = (long) plyRead((const unsigned char *) p + j * size, property->type, bigEndian);
+				if(plyAddPolygon(chunk, polygon, (size_t) count) == -1)
+					return NULL;
+			}
+			p += (size_t) count * size;
+		}
+	}
+
+	return p;
+}
+
+static int importPLY(const char *data, size_t size, struct Mesh *mesh, unsigned int threads){
+	struct PlyElement elements[16];
+	unsigned int elementCount;
+	enum PlyEncoding encoding = PLY_ASCII;
+	const char *end = data + size;
+
+	const char *p = plyParseHeader(data, size, &encoding, elements, &elementCount, 16);
+	if(p == NULL){
+		fprintf(stderr, "ERROR: Invalid PLY header.\n");
+		return -1;
+	}
+
+	/* Work out the interleaved layout from the vertex properties present. */
+	const struct PlyElement *vertexElement = NULL;
+	for(unsigned int i = 0; i < elementCount; i++){
+		if(strcmp(elements[i].name, "vertex") == 0)
+			vertexElement = &elements[i];
+	}
+	if(vertexElement == NULL){
+		fprintf(stderr, "ERROR: PLY file has no vertex element.\n");
+		return -1;
+	}
+
+	int present[PLY_SLOTS] = {0};
+	for(unsigned int i = 0; i < vertexElement->propertyCount; i++){
+		if(vertexElement->properties[i].slot >= 0 && !vertexElement->properties[i].isList)
+			present[vertexElement->properties[i].slot] = 1;
+	}
+
+	int outputOffset[PLY_SLOTS] = {0, 1, 2, -1, -1, -1, -1, -1};
+	mesh->stride = 3;
+	mesh->attributes = 0;
+	if(present[PLY_NX] && present[PLY_NY] && present[PLY_NZ]){
+		outputOffset[PLY_NX] = (int) mesh->stride++;
+		outputOffset[PLY_NY] = (int) mesh->stride++;
+		outputOffset[PLY_NZ] = (int) mesh->stride++;
+		mesh->attributes |= MESH_ATTRIB_NORMAL;
+	}
+	if(present[PLY_U] && present[PLY_V]){
+		outputOffset[PLY_U] = (int) mesh->stride++;
+		outputOffset[PLY_V] = (int) mesh->stride++;
+		mesh->attributes |= MESH_ATTRIB_TEXCOORD;
+	}
+
+	mesh->vertexCount = vertexElement->count;
+	mesh->vertices = calloc(mesh->vertexCount * mesh->stride + 1, sizeof(float));
+	if(mesh->vertices == NULL){
+		fprintf(stderr, "ERROR: Out of memory importing PLY.\n");
+		return -1;
+	}
+
+	struct IntArray indices = {0};
+	int status = 0;
+
+	for(unsigned int e = 0; e < elementCount && status == 0; e++){
+		const struct PlyElement *element = &elements[e];
+		int isVertex = element == vertexElement;
+		int isFace = strcmp(element->name, "face") == 0;
+
+		unsigned int count = pickThreadCount(threads, (size_t) (end - p));
+		if(element->count < count)
+			count = element->count ? (unsigned int) element->count : 1;
+
+		struct PlyChunk chunks[count];
+		memset(chunks, 0, sizeof(chunks));
+		for(unsigned int i = 0; i < count; i++){
+			chunks[i].element = element;
+			chunks[i].encoding = encoding;
+			chunks[i].outputOffset = outputOffset;
+			chunks[i].vertices = isVertex ? mesh->vertices : NULL;
+			chunks[i].stride = mesh->stride;
+		}
+
+		if(encoding == PLY_ASCII){
+			const char *next = plyAsciiSplit(p, end, element->count, chunks, count);
+			if(next == NULL){
+				fprintf(stderr, "ERROR: PLY file is truncated.\n");
+				status = -1;
+				break;
+			}
+			/* Other elements are only skipped. */
+			if(isVertex || isFace)
+				runParallel(count, plyParseAscii, chunks, sizeof(struct PlyChunk));
+			p = next;
+		} else {
+			int fixedSize = 1;
+			size_t recordSize = 0;
+			for(unsigned int i = 0; i < element->propertyCount; i++){
+				fixedSize &= !element->properties[i].isList;
+				recordSize += plyTypeSize(element->properties[i].type);
+			}
+
+			if(fixedSize){
+				if((size_t) (end - p) / (recordSize ? recordSize : 1) < element->count){
+					fprintf(stderr, "ERROR: PLY file is truncated.\n");
+					status = -1;
+					break;
+				}
+				for(unsigned int i = 0; i < count; i++){
+					chunks[i].first = element->count / count * i;
+					chunks[i].count = (i + 1 < count ? element->count / count * (i + 1) : element->count) -
+							  chunks[i].first;
+					chunks[i].begin = p + chunks[i].first * recordSize;
+				}
+				if(isVertex)
+					runParallel(count, plyParseBinaryVertices, chunks, sizeof(struct PlyChunk));
+				p += element->count * recordSize;
+			} else {
+				const char *next = plyParseBinaryRecords(&chunks[0], p, end);
+				if(next == NULL){
+					fprintf(stderr, "ERROR: PLY file is truncated or malformed.\n");
+					status = -1;
+				}
+				p = next;
+				count = 1;
+			}
+		}
+
+		for(unsigned int i = 0; i < count; i++){
+			if(chunks[i].error != NULL && status == 0){
+				fprintf(stderr, "ERROR: PLY %s in element %s.\n", chunks[i].error, element->name);
+				status = -1;
+			}
+			if(status == 0 && isFace && chunks[i].indices.count > 0){
+				if(intArrayReserve(&indices, chunks[i].indices.count) == -1){
+					fprintf(stderr, "ERROR: Out of memory importing PLY.\n");
+					status = -1;
+				} else {
+					memcpy(indices.data + indices.count, chunks[i].indices.data,
+					       chunks[i].indices.count * sizeof(int));
+					indices.count += chunks[i].indices.count;
+				}
+			}
+			free(chunks[i].indices.data);
+		}
+	}
+
+	for(size_t i = 0; i < indices.count && status == 0; i++){
+		if(indices.data[i] < 0 || (size_t) indices.data[i] >= mesh->vertexCount){
+			fprintf(stderr, "ERROR: PLY face index out of range.\n");
+			status = -1;
+		}
+	}
+
+	if(status == 0){
+		mesh->indices = (unsigned int *) indices.data;
+		mesh->indexCount = indices.count;
+	} else {
+		free(indices.data);
+	}
+
+	return status;
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+enum MeshFormat meshFormatFromPath(const char *path){
+	const char *extension = strrchr(path, '.');
+	if(extension == NULL)
+		return MESH_FORMAT_UNKNOWN;
+	if(strcasecmp(extension, ".obj") == 0)
+		return MESH_FORMAT_OBJ;
+	if(strcasecmp(extension, ".ply") == 0)
+		return MESH_FORMAT_PLY;
+	return MESH_FORMAT_UNKNOWN;
+}
+
+int meshImportMemory(const char *data, size_t size, enum MeshFormat format,
+		     struct Mesh *mesh, unsigned int threads){
+	int status;
+
+	memset(mesh, 0, sizeof(*mesh));
+
+	switch(format){
+		case MESH_FORMAT_OBJ: status = importOBJ(data, size, mesh, threads); break;
+		case MESH_FORMAT_PLY: status = importPLY(data, size, mesh, threads); break;
+		default:
+			fprintf(stderr, "ERROR: Unknown mesh format.\n");
+			return -1;
+	}
+
+	if(status == -1)
+		meshFree(mesh);
+	return status;
+}
+
+int meshImportFile(const char *path, struct Mesh *mesh, unsigned int threads){
+	enum MeshFormat format = meshFormatFromPath(path);
+	if(format == MESH_FORMAT_UNKNOWN){
+		fprintf(stderr, "ERROR: Unknown mesh format for %s.\n", path);
+		return -1;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1){
+		perror(path);
+		return -1;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1){
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	if(info.st_size == 0){
+		close(fd);
+		return meshImportMemory("", 0, format, mesh, threads);
+	}
+
+	void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED){
+		perror(path);
+		return -1;
+	}
+	/* Every chunk is read twice, start paging it all in now. */
+	madvise(data, (size_t) info.st_size, MADV_WILLNEED);
+
+	int status = meshImportMemory(data, (size_t) info.st_size, format, mesh, threads);
+	munmap(data, (size_t) info.st_size);
+	return status;
+}
+
+void meshComputeBounds(const struct Mesh *mesh, float *center, float *extent){
+	float min[3] = {0.0f, 0.0f, 0.0f};
+	float max[3] = {0.0f, 0.0f, 0.0f};
+
+	for(size_t v = 0; v < mesh->vertexCount; v++){
+		const float *position = mesh->vertices + v * mesh->stride;
+		for(int k = 0; k < 3; k++){
+			if(v == 0 || position[k] < min[k])
+				min[k] = position[k];
+			if(v == 0 || position[k] > max[k])
+				max[k] = position[k];
+		}
+	}
+
+	for(int k = 0; k < 3; k++){
+		center[k] = (min[k] + max[k]) * 0.5f;
+		extent[k] = (max[k] - min[k]) * 0.5f;
+	}
+}
+
+void meshFree(struct Mesh *mesh){
+	free(mesh->vertices);
+	free(mesh->indices);
+	memset(mesh, 0, sizeof(*mesh));
+}
@@ -0,0 +1,401 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <mesh_loader.h>
+#include <fence.h>
+#include <trace.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The decode thread parses on its own, so the importer does not take	*/
+/* every core away from the render loop while geometry streams in.	*/
+#define DECODE_THREADS 1
+
+struct LoadJob {
+	struct LoadJob *next;
+	char *path;
+	void *user;
+
+	char *data;
+	size_t size;
+	struct Mesh mesh;
+
+	unsigned int VBO;
+	unsigned int EBO;
+	GLsync fence;
+	int failed;
+};
+
+struct JobQueue {
+	struct LoadJob *head;
+	struct LoadJob *tail;
+};
+
+struct MeshLoader {
+	GLFWwindow *context;
+
+	pthread_t ioThread;
+	pthread_t decodeThread;
+	pthread_t uploadThread;
+
+	/* One lock for all the queues, jobs only move a few times per mesh. */
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	struct JobQueue requested;
+	struct JobQueue read;
+	struct JobQueue decoded;
+	struct JobQueue uploaded;
+	int stopping;
+};
+
+static void pushJob(struct JobQueue *queue, struct LoadJob *job){
+	job->next = NULL;
+	if(queue->tail)
+		queue->tail->next = job;
+	else
+		queue->head = job;
+	queue->tail = job;
+}
+
+static struct LoadJob *popJob(struct JobQueue *queue){
+	struct LoadJob *job = queue->head;
+	if(job){
+		queue->head = job->next;
+		if(queue->head == NULL)
+			queue->tail = NULL;
+	}
+	return job;
+}
+
+static void freeJob(struct LoadJob *job){
+	free(job->path);
+	free(job->data);
+	meshFree(&job->mesh);
+	free(job);
+}
+
+/* Block until the queue has a job. Returns NULL once the loader is stopping. */
+static struct LoadJob *waitJob(struct MeshLoader *loader, struct JobQueue *queue){
+	struct LoadJob *job = NULL;
+	int stopping;
+
+	pthread_mutex_lock(&loader->lock);
+	while(!loader->stopping && (job = popJob(queue)) == NULL)
+		pthread_cond_wait(&loader->changed, &loader->lock);
+	stopping = loader->stopping;
+	pthread_mutex_unlock(&loader->lock);
+
+	if(stopping && job != NULL){
+		freeJob(job);
+		job = NULL;
+	}
+	return job;
+}
+
+static void stopThreads(struct MeshLoader *loader){
+	pthread_mutex_lock(&loader->lock);
+	loader->stopping = 1;
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+static void passJob(struct MeshLoader *loader, struct JobQueue *queue, struct LoadJob *job){
+	pthread_mutex_lock(&loader->lock);
+	pushJob(queue, job);
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/* ------------------------------------STAGES--------------------------------- */
+
+static int readFile(struct LoadJob *job){
+	int fd = open(job->path, O_RDONLY);
+	if(fd == -1){
+		perror(job->path);
+		return -1;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1 || (job->data = malloc((size_t) info.st_size + 1)) == NULL){
+		perror(job->path);
+		close(fd);
+		return -1;
+	}
+
+	while(job->size < (size_t) info.st_size){
+		ssize_t count = read(fd, job->data + job->size, (size_t) info.st_size - job->size);
+		if(count <= 0){
+			perror(job->path);
+			close(fd);
+			return -1;
+		}
+		job->size += (size_t) count;
+	}
+
+	close(fd);
+	return 0;
+}
+
+static void *ioMain(void *arg){
+	struct MeshLoader *loader = arg;
+	struct LoadJob *job;
+
+	TRACE_THREAD_NAME("mesh loader I/O");
+	while((job = waitJob(loader, &loader->requested)) != NULL){
+		TRACE_BEGIN("read");
+		job->failed = readFile(job) == -1;
+		TRACE_END();
+		passJob(loader, &loader->read, job);
+	}
+	return NULL;
+}
+
+static void *decodeMain(void *arg){
+	struct MeshLoader *loader = arg;
+	struct LoadJob *job;
+
+	TRACE_THREAD_NAME("mesh loader decode");
+	while((job = waitJob(loader, &loader->read)) != NULL){
+		if(!job->failed){
+			TRACE_BEGIN("decode");
+			job->failed = meshImportMemory(job->data, job->size, meshFormatFromPath(job->path),
+						       &job->mesh, DECODE_THREADS) == -1;
+			free(job->data);
+			job->data = NULL;
+			TRACE_END();
+		}
+		passJob(loader, &loader->decoded, job);
+	}
+	return NULL;
+}
+
+static void *uploadMain(void *arg){
+	struct MeshLoader *loader = arg;
+	struct LoadJob *job;
+
+	TRACE_THREAD_NAME("mesh loader upload");
+	glfwMakeContextCurrent(loader->context);
+
+	while((job = waitJob(loader, &loader->decoded)) != NULL){
+		if(!job->failed){
+			TRACE_BEGIN("upload");
+			/* Element arrays are VAO state and this context has no VAO, so both */
+			/* buffers are filled through GL_ARRAY_BUFFER. The target used to    */
+			/* upload does not matter for how the buffer is bound later on.      */
+			glGenBuffers(1, &job->VBO);
+			glBindBuffer(GL_ARRAY_BUFFER, job->VBO);
+			glBufferData(GL_ARRAY_BUFFER, MESH_VERTICES_SIZE(&job->mesh), job->mesh.vertices, GL_STATIC_DRAW);
+
+			if(job->mesh.indexCount > 0){
+				glGenBuffers(1, &job->EBO);
+				glBindBuffer(GL_ARRAY_BUFFER, job->EBO);
+				glBufferData(GL_ARRAY_BUFFER, MESH_INDICES_SIZE(&job->mesh), job->mesh.indices, GL_STATIC_DRAW);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			/* The flush makes sure the fence actually reaches the GPU, the */
+			/* render thread only ever polls it.			       */
+			if(GLAD_GL_ARB_sync){
+				job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				glFlush();
+			} else {
+				glFinish();
+			}
+
+			free(job->mesh.vertices);
+			free(job->mesh.indices);
+			job->mesh.vertices = NULL;
+			job->mesh.indices = NULL;
+			TRACE_END();
+		}
+		passJob(loader, &loader->uploaded, job);
+	}
+
+	glfwMakeContextCurrent(NULL);
+	return NULL;
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+struct MeshLoader *meshLoaderCreate(GLFWwindow *window){
+	struct MeshLoader *loader = calloc(1, sizeof(*loader));
+	if(loader == NULL)
+		return NULL;
+
+	/* Same hints as the window, so the contexts are compatible, but hidden. */
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	loader->context = glfwCreateWindow(1, 1, "Loader", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if(loader->context == NULL){
+		fprintf(stderr, "ERROR: Failed to create the loader context.\n");
+		free(loader);
+		return NULL;
+	}
+
+	pthread_mutex_init(&loader->lock, NULL);
+	pthread_cond_init(&loader->changed, NULL);
+
+	if(pthread_create(&loader->ioThread, NULL, ioMain, loader) != 0){
+		perror("Failed to start the loader I/O thread");
+		goto fail;
+	}
+	if(pthread_create(&loader->decodeThread, NULL, decodeMain, loader) != 0){
+		perror("Failed to start the loader decode thread");
+		stopThreads(loader);
+		pthread_join(loader->ioThread, NULL);
+		goto fail;
+	}
+	if(pthread_create(&loader->uploadThread, NULL, uploadMain, loader) != 0){
+		perror("Failed to start the loader upload thread");
+		stopThreads(loader);
+		pthread_join(loader->ioThread, NULL);
+		pthread_join(loader->decodeThread, NULL);
+		goto fail;
+	}
+
+	return loader;
+
+fail:
+	pthread_cond_destroy(&loader->changed);
+	pthread_mutex_destroy(&loader->lock);
+	glfwDestroyWindow(loader->context);
+	free(loader);
+	return NULL;
+}
+
+int meshLoaderRequest(struct MeshLoader *loader, const char *path, void *user){
+	struct LoadJob *job = calloc(1, sizeof(*job));
+	if(job == NULL || (job->path = strdup(path)) == NULL){
+		free(job);
+		return -1;
+	}
+	job->user = user;
+
+	pthread_mutex_lock(&loader->lock);
+	if(loader->stopping){
+		pthread_mutex_unlock(&loader->lock);
+		freeJob(job);
+		return -1;
+	}
+	pushJob(&loader->requested, job);
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+	return 0;
+}
+
+static void createMeshVAO(struct LoadJob *job, struct LoadedMesh *mesh){
+	unsigned int stride = job->mesh.stride * sizeof(float);
+	int previous;
+
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+
+	glGenVertexArrays(1, &mesh->VAO);
+	glBindVertexArray(mesh->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, job->VBO);
+	if(job->EBO)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, job->EBO);
+
+	glVertexAttribPointer(MESH_LOADER_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*) 0);
+	glEnableVertexAttribArray(MESH_LOADER_POSITION_LOCATION);
+
+	size_t offset = 3;
+	if(job->mesh.attributes & MESH_ATTRIB_NORMAL){
+		glVertexAttribPointer(MESH_LOADER_NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, stride,
+				      (void*) (offset * sizeof(float)));
+		glEnableVertexAttribArray(MESH_LOADER_NORMAL_LOCATION);
+		offset += 3;
+	}
+	if(job->mesh.attributes & MESH_ATTRIB_TEXCOORD){
+		glVertexAttribPointer(MESH_LOADER_TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, stride,
+				      (void*) (offset * sizeof(float)));
+		glEnableVertexAttribArray(MESH_LOADER_TEXCOORD_LOCATION);
+	}
+
+	glBindVertexArray((unsigned int) previous);
+}
+
+int meshLoaderPoll(struct MeshLoader *loader, struct LoadedMesh *mesh){
+	struct LoadJob *job, *previous = NULL;
+
+	pthread_mutex_lock(&loader->lock);
+	for(job = loader->uploaded.head; job; previous = job, job = job->next){
+		if(job->failed || fenceSignaled(job->fence))
+			break;
+	}
+	if(job){
+		if(previous)
+			previous->next = job->next;
+		else
+			loader->uploaded.head = job->next;
+		if(loader->uploaded.tail == job)
+			loader->uploaded.tail = previous;
+	}
+	pthread_mutex_unlock(&loader->lock);
+
+	if(job == NULL)
+		return 0;
+
+	memset(mesh, 0, sizeof(*mesh));
+	mesh->user = job->user;
+	mesh->failed = job->failed;
+	if(!job->failed){
+		createMeshVAO(job, mesh);
+		mesh->VBO = job->VBO;
+		mesh->EBO = job->EBO;
+		mesh->vertexCount = job->mesh.vertexCount;
+		mesh->indexCount = job->mesh.indexCount;
+		mesh->attributes = job->mesh.attributes;
+	}
+
+	if(job->fence)
+		glDeleteSync(job->fence);
+	freeJob(job);
+	return 1;
+}
+
+void meshLoaderDestroy(struct MeshLoader *loader){
+	stopThreads(loader);
+
+	pthread_join(loader->ioThread, NULL);
+	pthread_join(loader->decodeThread, NULL);
+	pthread_join(loader->uploadThread, NULL);
+
+	struct JobQueue *queues[] = { &loader->requested, &loader->read, &loader->decoded, &loader->uploaded };
+	for(size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++){
+		struct LoadJob *job;
+		while((job = popJob(queues[i])) != NULL){
+			/* Buffers are shared, so they can go from this context. */
+			if(job->VBO)
+				glDeleteBuffers(1, &job->VBO);
+			if(job->EBO)
+				glDeleteBuffers(1, &job->EBO);
+			if(job->fence)
+				glDeleteSync(job->fence);
+			freeJob(job);
+		}
+	}
+
+	glfwDestroyWindow(loader->context);
+	pthread_cond_destroy(&loader->changed);
+	pthread_mutex_destroy(&loader->lock);
+	free(loader);
+}
@@ -0,0 +1,544 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <mesh_lod.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Open borders get a plane through the edge, perpendicular to the face,	*/
+/* weighted so they are only collapsed along themselves.		*/
+#define BORDER_WEIGHT 1000.0
+
+/* Symmetric 4x4 matrix: a2 ab ac ad b2 bc bd c2 cd d2, and the sum of	*/
+/* the weights of its planes to turn it back into a squared distance.	*/
+struct Quadric {
+	double m[10];
+	double weight;
+};
+
+struct Collapse {
+	double cost;
+	unsigned int from;	/* Removed. */
+	unsigned int to;	/* Kept. */
+	unsigned int fromVersion;
+	unsigned int toVersion;
+};
+
+struct CollapseHeap {
+	struct Collapse *items;
+	size_t count;
+	size_t capacity;
+};
+
+/* Triangles around each vertex. Lists only grow; dead triangles are skipped. */
+struct TriangleList {
+	unsigned int *items;
+	unsigned int count;
+	unsigned int capacity;
+};
+
+struct Simplifier {
+	const struct Mesh *mesh;
+	unsigned int (*triangles)[3];
+	unsigned char *triangleDead;
+	size_t liveTriangles;
+
+	struct Quadric *quadrics;
+	struct TriangleList *adjacency;
+	unsigned int *version;
+	unsigned char *locked;
+	unsigned char *removed;
+
+	/* Neighbours already queued by pushIncidentEdges(), for this stamp. */
+	unsigned int *queued;
+	unsigned int queuedStamp;
+
+	struct CollapseHeap heap;
+};
+
+/* ----------------------------------QUADRICS--------------------------------- */
+
+static void quadricFromPlane(struct Quadric *q, double a, double b, double c, double d, double weight){
+	q->m[0] = a * a * weight; q->m[1] = a * b * weight; q->m[2] = a * c * weight; q->m[3] = a * d * weight;
+	q->m[4] = b * b * weight; q->m[5] = b * c * weight; q->m[6] = b * d * weight;
+	q->m[7] = c * c * weight; q->m[8] = c * d * weight;
+	q->m[9] = d * d * weight;
+	q->weight = weight;
+}
+
+static void quadricAdd(struct Quadric *to, const struct Quadric *q){
+	for(int i = 0; i < 10; i++)
+		to->m[i] += q->m[i];
+	to->weight += q->weight;
+}
+
+static double quadricError(const struct Quadric *a, const struct Quadric *b, const float *p){
+	double m[10];
+	for(int i = 0; i < 10; i++)
+		m[i] = a->m[i] + b->m[i];
+
+	double x = p[0], y = p[1], z = p[2];
+	double error = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+		     + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+		     + m[7] * z * z + 2 * m[8] * z
+		     + m[9];
+
+	/* The weighted mean of the squared distances to the planes, so it	*/
+	/* grows with the square of the mesh's scale like a distance would.	*/
+	double weight = a->weight + b->weight;
+	return error > 0.0 && weight > 0.0 ? error / weight : 0.0;
+}
+
+static const float *position(const struct Simplifier *s, unsigned int vertex){
+	return s->mesh->vertices + (size_t) vertex * s->mesh->stride;
+}
+
+static void cross(const double *a, const double *b, double *out){
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/* Unnormalised face normal, its length is twice the area. */
+static void faceNormal(const float *p0, const float *p1, const float *p2, double *normal){
+	double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	cross(e1, e2, normal);
+}
+
+/* ------------------------------------HEAP----------------------------------- */
+
+static int heapPush(struct CollapseHeap *heap, struct Collapse item){
+	if(heap->count == heap->capacity){
+		size_t capacity = heap->capacity ? heap->capacity * 2 : 1024;
+		struct Collapse *items = realloc(heap->items, capacity * sizeof(*items));
+		if(items == NULL)
+			return -1;
+		heap->items = items;
+		heap->capacity = capacity;
+	}
+
+	size_t i = heap->count++;
+	while(i > 0 && heap->items[(i - 1) / 2].cost > item.cost){
+		heap->items[i] = heap->items[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap->items[i] = item;
+	return 0;
+}
+
+static struct Collapse heapPop(struct CollapseHeap *heap){
+	struct Collapse top = heap->items[0];
+	struct Collapse last = heap->items[--heap->count];
+	size_t i = 0;
+
+	for(;;){
+		size_t child = 2 * i + 1;
+		if(child >= heap->count)
+			break;
+		if(child + 1 < heap->count && heap->items[child + 1].cost < heap->items[child].cost)
+			child++;
+		if(heap->items[child].cost >= last.cost)
+			break;
+		heap->items[i] = heap->items[child];
+		i = child;
+	}
+	if(heap->count > 0)
+		heap->items[i] = last;
+	return top;
+}
+
+/* ----------------------------------TOPOLOGY--------------------------------- */
+
+static int listAppend(struct TriangleList *list, unsigned int triangle){
+	if(list->count == list->capacity){
+		unsigned int capacity = list->capacity ? list->capacity * 2 : 8;
+		unsigned int *items = realloc(list->items, capacity * sizeof(*items));
+		if(items == NULL)
+			return -1;
+		list->items = items;
+		list->capacity = capacity;
+	}
+	list->items[list->count++] = triangle;
+	return 0;
+}
+
+static size_t hashPosition(const float *p){
+	uint32_t bits[3];
+	memcpy(bits, p, sizeof(bits));
+	uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull;
+	h ^= (bits[1] * 0xC2B2AE3D27D4EB4Full) ^ (bits[2] * 0x165667B19E3779F9ull);
+	return (size_t) (h ^ (h >> 29));
+}
+
+/* Vertices sharing their position with another vertex sit on a seam in the	*/
+/* normals or texcoords. Moving one side only would tear the mesh open.	*/
+static int lockSeams(struct Simplifier *s){
+	size_t vertexCount = s->mesh->vertexCount;
+	size_t capacity = 16;
+	while(capacity < vertexCount * 2)
+		capacity *= 2;
+
+	unsigned int *table = malloc(capacity * sizeof(unsigned int));
+	if(table == NULL)
+		return -1;
+	memset(table, 0xff, capacity * sizeof(unsigned int));
+
+	for(unsigned int v = 0; v < vertexCount; v++){
+		size_t slot = hashPosition(position(s, v)) & (capacity - 1);
+		while(table[slot] != UINT32_MAX){
+			if(memcmp(position(s, table[slot]), position(s, v), 3 * sizeof(float)) == 0){
+				s->locked[table[slot]] = 1;
+				s->locked[v] = 1;
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+		if(table[slot] == UINT32_MAX)
+			table[slot] = v;
+	}
+
+	free(table);
+	return 0;
+}
+
+static int edgeIsBorder(const struct Simplifier *s, unsigned int a, unsigned int b){
+	const struct TriangleList *list = &s->adjacency[a];
+	unsigned int shared = 0;
+
+	for(unsigned int i = 0; i < list->count; i++){
+		const unsigned int *t = s->triangles[list->items[i]];
+		if(t[0] == b || t[1] == b || t[2] == b)
+			shared++;
+	}
+	return shared == 1;
+}
+
+static void addBorderQuadrics(struct Simplifier *s, unsigned int triangle){
+	const unsigned int *t = s->triangles[triangle];
+	double normal[3];
+	faceNormal(position(s, t[0]), position(s, t[1]), position(s, t[2]), normal);
+
+	for(int e = 0; e < 3; e++){
+		unsigned int a = t[e], b = t[(e + 1) % 3];
+		if(!edgeIsBorder(s, a, b))
+			continue;
+
+		const float *pa = position(s, a), *pb = position(s, b);
+		double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+		double plane[3];
+		cross(edge, normal, plane);
+		double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if(length == 0.0)
+			continue;
+
+		plane[0] /= length; plane[1] /= length; plane[2] /= length;
+		double d = -(plane[0] * pa[0] + plane[1] * pa[1] + plane[2] * pa[2]);
+		double edgeLength2 = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+
+		struct Quadric q;
+		quadricFromPlane(&q, plane[0], plane[1], plane[2], d, BORDER_WEIGHT * edgeLength2);
+		quadricAdd(&s->quadrics[a], &q);
+		quadricAdd(&s->quadrics[b], &q);
+	}
+}
+
+/* Moving from onto to must not turn any of the remaining faces over. */
+static int collapseFlips(const struct Simplifier *s, unsigned int from, unsigned int to){
+	const struct TriangleList *list = &s->adjacency[from];
+
+	for(unsigned int i = 0; i < list->count; i++){
+		unsigned int triangle = list->items[i];
+		if(s->triangleDead[triangle])
+			continue;
+
+		const unsigned int *t = s->triangles[triangle];
+		if(t[0] == to || t[1] == to || t[2] == to)
+			continue;
+
+		const float *p[3], *moved[3];
+		for(int k = 0; k < 3; k++){
+			p[k] = position(s, t[k]);
+			moved[k] = t[k] == from ? position(s, to) : p[k];
+		}
+
+		double before[3], after[3];
+		faceNormal(p[0], p[1], p[2], before);
+		faceNormal(moved[0], moved[1], moved[2], after);
+		if(before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+			return 1;
+	}
+	return 0;
+}
+
+static int pushEdge(struct Simplifier *s, unsigned int a, unsigned int b){
+	if(s->locked[a] && s->locked[b])
+		return 0;
+
+	/* Locked vertices may only be the one that stays. */
+	struct Collapse collapse;
+	double costToA = s->locked[b] ? INFINITY : quadricError(&s->quadrics[a], &s->quadrics[b], position(s, a));
+	double costToB = s->locked[a] ? INFINITY : quadricError(&s->quadrics[a], &s->quadrics[b], position(s, b));
+
+	if(costToA <= costToB){
+		collapse.cost = costToA;
+		collapse.from = b;
+		collapse.to = a;
+	} else {
+		collapse.cost = costToB;
+		collapse.from = a;
+		collapse.to = b;
+	}
+	collapse.fromVersion = s->version[collapse.from];
+	collapse.toVersion = s->version[collapse.to];
+	return heapPush(&s->heap, collapse);
+}
+
+/* Queue the edges to the vertices after vertex in each of its faces, so */
+/* every edge of a closed mesh is pushed once from each side at most.    */
+static int pushVertexEdges(struct Simplifier *s, unsigned int vertex){
+	const struct TriangleList *list = &s->adjacency[vertex];
+
+	for(unsigned int i = 0; i < list->count; i++){
+		if(s->triangleDead[list->items[i]])
+			continue;
+		const unsigned int *t = s->triangles[list->items[i]];
+		for(int k = 0; k < 3; k++){
+			if(t[k] == vertex && pushEdge(s, vertex, t[(k + 1) % 3]) == -1)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+/* After a collapse every edge at vertex has a stale cost, whichever way	*/
+/* round its faces have it and whether or not it is a border, so queue	*/
+/* each neighbour once.							*/
+static int pushIncidentEdges(struct Simplifier *s, unsigned int vertex){
+	const struct TriangleList *list = &s->adjacency[vertex];
+	s->queuedStamp++;
+
+	for(unsigned int i = 0; i < list->count; i++){
+		if(s->triangleDead[list->items[i]])
+			continue;
+		const unsigned int *t = s->triangles[list->items[i]];
+		for(int k = 0; k < 3; k++){
+			unsigned int other = t[k];
+			if(other == vertex || s->queued[other] == s->queuedStamp)
+				continue;
+			s->queued[other] = s->queuedStamp;
+			if(pushEdge(s, vertex, other) == -1)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static int applyCollapse(struct Simplifier *s, unsigned int from, unsigned int to){
+	struct TriangleList *list = &s->adjacency[from];
+
+	for(unsigned int i = 0; i < list->count; i++){
+		unsigned int triangle = list->items[i];
+		if(s->triangleDead[triangle])
+			continue;
+
+		unsigned int *t = s->triangles[triangle];
+		if(t[0] == to || t[1] == to || t[2] == to){
+			s->triangleDead[triangle] = 1;
+			s->liveTriangles--;
+			continue;
+		}
+
+		for(int k = 0; k < 3; k++){
+			if(t[k] == from)
+				t[k] = to;
+		}
+		if(listAppend(&s->adjacency[to], triangle) == -1)
+			return -1;
+	}
+
+	quadricAdd(&s->quadrics[to], &s->quadrics[from]);
+	s->removed[from] = 1;
+	s->version[to]++;
+	free(list->items);
+	memset(list, 0, sizeof(*list));
+
+	return pushIncidentEdges(s, to);
+}
+
+/* ------------------------------------LODS----------------------------------- */
+
+static int appendLevel(struct Simplifier *s, struct Mesh *mesh, size_t triangleCount,
+		       struct MeshLOD *lod, double error){
+	size_t count = s->liveTriangles * 3;
+	unsigned int *indices = realloc(mesh->indices, (mesh->indexCount + count) * sizeof(unsigned int));
+	if(indices == NULL)
+		return -1;
+	mesh->indices = indices;
+
+	lod->indexOffset = (unsigned int) mesh->indexCount;
+	lod->indexCount = (unsigned int) count;
+	lod->error = (float) sqrt(error);
+
+	/* Live triangles already point at the vertices they were collapsed to. */
+	unsigned int *out = mesh->indices + mesh->indexCount;
+	for(size_t t = 0; t < triangleCount; t++){
+		if(s->triangleDead[t])
+			continue;
+		memcpy(out, s->triangles[t], 3 * sizeof(unsigned int));
+		out += 3;
+	}
+
+	mesh->indexCount += count;
+	return 0;
+}
+
+static void freeSimplifier(struct Simplifier *s){
+	if(s->adjacency){
+		for(size_t v = 0; v < s->mesh->vertexCount; v++)
+			free(s->adjacency[v].items);
+	}
+	free(s->triangles);
+	free(s->triangleDead);
+	free(s->quadrics);
+	free(s->adjacency);
+	free(s->version);
+	free(s->locked);
+	free(s->removed);
+	free(s->queued);
+	free(s->heap.items);
+}
+
+int meshGenerateLODs(struct Mesh *mesh, struct MeshLOD *lods, unsigned int maxLods, float ratio){
+	if(maxLods == 0)
+		return 0;
+
+	size_t triangleCount = mesh->indexCount / 3;
+	lods[0].indexOffset = 0;
+	lods[0].indexCount = (unsigned int) (triangleCount * 3);
+	lods[0].error = 0.0f;
+	if(maxLods == 1 || triangleCount == 0 || ratio <= 0.0f || ratio >= 1.0f)
+		return 1;
+
+	struct Simplifier s;
+	memset(&s, 0, sizeof(s));
+	s.mesh = mesh;
+	s.liveTriangles = triangleCount;
+	s.triangles = malloc(triangleCount * sizeof(*s.triangles));
+	s.triangleDead = calloc(triangleCount, 1);
+	s.quadrics = calloc(mesh->vertexCount, sizeof(*s.quadrics));
+	s.adjacency = calloc(mesh->vertexCount, sizeof(*s.adjacency));
+	s.version = calloc(mesh->vertexCount, sizeof(*s.version));
+	s.locked = calloc(mesh->vertexCount, 1);
+	s.removed = calloc(mesh->vertexCount, 1);
+	s.queued = calloc(mesh->vertexCount, sizeof(*s.queued));
+	if(s.triangles == NULL || s.triangleDead == NULL || s.quadrics == NULL || s.adjacency == NULL ||
+	   s.version == NULL || s.locked == NULL || s.removed == NULL || s.queued == NULL || lockSeams(&s) == -1)
+		goto fail;
+
+	memcpy(s.triangles, mesh->indices, triangleCount * 3 * sizeof(unsigned int));
+
+	for(unsigned int t = 0; t < triangleCount; t++){
+		const unsigned int *v = s.triangles[t];
+		double normal[3];
+		faceNormal(position(&s, v[0]), position(&s, v[1]), position(&s, v[2]), normal);
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+		if(length > 0.0){
+			const float *p = position(&s, v[0]);
+			double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+			struct Quadric q;
+			/* Weighted by area so big faces hold their shape better. */
+			quadricFromPlane(&q, a, b, c, -(a * p[0] + b * p[1] + c * p[2]), length * 0.5);
+			for(int k = 0; k < 3; k++)
+				quadricAdd(&s.quadrics[v[k]], &q);
+		}
+
+		for(int k = 0; k < 3; k++){
+			if(listAppend(&s.adjacency[v[k]], t) == -1)
+				goto fail;
+		}
+	}
+
+	for(unsigned int t = 0; t < triangleCount; t++)
+		addBorderQuadrics(&s, t);
+
+	for(unsigned int v = 0; v < mesh->vertexCount; v++){
+		if(pushVertexEdges(&s, v) == -1)
+			goto fail;
+	}
+
+	unsigned int levels = 1;
+	double target = triangleCount * ratio;
+	double maxError = 0.0;
+
+	while(levels < maxLods && s.heap.count > 0){
+		struct Collapse c = heapPop(&s.heap);
+		if(s.removed[c.from] || s.removed[c.to] ||
+		   c.fromVersion != s.version[c.from] || c.toVersion != s.version[c.to])
+			continue;
+		if(collapseFlips(&s, c.from, c.to))
+			continue;
+
+		if(c.cost > maxError)
+			maxError = c.cost;
+		if(applyCollapse(&s, c.from, c.to) == -1)
+			goto fail;
+
+		if(s.liveTriangles <= target){
+			if(appendLevel(&s, mesh, triangleCount, &lods[levels], maxError) == -1)
+				goto fail;
+			levels++;
+			target = s.liveTriangles * ratio;
+		}
+	}
+
+	/* Ran out of edges it was allowed to collapse before reaching the target. */
+	if(levels < maxLods && s.liveTriangles * 3 < lods[levels - 1].indexCount){
+		if(appendLevel(&s, mesh, triangleCount, &lods[levels], maxError) == -1)
+			goto fail;
+		levels++;
+	}
+
+	freeSimplifier(&s);
+	return (int) levels;
+
+fail:
+	freeSimplifier(&s);
+	return -1;
+}
+
+/* ----------------------------------SELECTION-------------------------------- */
+
+float meshLODProjectionScale(float fovy, float viewportHeight){
+	return viewportHeight / (2.0f * tanf(fovy * 0.5f));
+}
+
+unsigned int meshSelectLOD(const struct MeshLOD *lods, unsigned int count, float distance,
+			   float projectionScale, float maxPixelError){
+	if(count == 0 || distance <= 0.0f)
+		return 0;
+
+	/* Errors only grow along the chain, so walk until one is too big. */
+	float maxError = maxPixelError * distance / projectionScale;
+	unsigned int level = 0;
+	while(level + 1 < count && lods[level + 1].error <= maxError)
+		level++;
+	return level;
+}
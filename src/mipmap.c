@@ -0,0 +1,443 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <mipmap.h>
+#include <vecmath.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIPMAP_X86 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIPMAP_NEON 1
+#endif
+
+/* Half width of the Kaiser filter in pixels of the smaller level, and	*/
+/* how quickly its window falls off.					*/
+#define KAISER_RADIUS	3.0f
+#define KAISER_ALPHA	4.0f
+
+/* Rows per job. */
+#define ROW_GRAIN	16
+
+/* Fine enough that no 8 bit sRGB value is more than one step out. */
+#define LINEAR_TO_SRGB_SIZE	4096
+
+/* A level in linear float RGBA, what the filters read and write. */
+struct Level {
+	float *pixels;
+	unsigned int width;
+	unsigned int height;
+};
+
+/* The source pixels and weights of every output pixel along one axis. */
+struct Taps {
+	unsigned int count;		/* Per output pixel. */
+	unsigned int *index;
+	float *weight;
+};
+
+struct Pass {
+	const struct Image *image;
+	struct Level *source;
+	struct Level *target;
+	float *temporary;		/* Source height rows of target width. */
+	const struct Taps *horizontal;
+	const struct Taps *vertical;
+	struct Image *output;
+	unsigned int flags;
+	enum MathPath path;
+};
+
+/* ------------------------------------GAMMA---------------------------------- */
+
+static float srgbToLinear[256];
+static unsigned char linearToSrgb[LINEAR_TO_SRGB_SIZE];
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+static void buildTables(void){
+	for(int i = 0; i < 256; i++){
+		float c = i / 255.0f;
+		srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+	for(int i = 0; i < LINEAR_TO_SRGB_SIZE; i++){
+		float l = i / (float) (LINEAR_TO_SRGB_SIZE - 1);
+		float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+		linearToSrgb[i] = (unsigned char) (c * 255.0f + 0.5f);
+	}
+}
+
+static void expandRows(void *data, size_t first, size_t last){
+	const struct Pass *pass = data;
+	const struct Image *image = pass->image;
+	int srgb = pass->flags & MIPMAP_SRGB;
+
+	for(size_t y = first; y < last; y++){
+		const unsigned char *in = image->pixels + y * image->width * 4;
+		float *out = pass->target->pixels + y * image->width * 4;
+		for(size_t i = 0; i < (size_t) image->width * 4; i++)
+			out[i] = srgb && (i & 3) != 3 ? srgbToLinear[in[i]] : in[i] / 255.0f;
+	}
+}
+
+static void quantizeRows(void *data, size_t first, size_t last){
+	const struct Pass *pass = data;
+	const struct Level *level = pass->target;
+	int srgb = pass->flags & MIPMAP_SRGB;
+
+	/* The Kaiser filter's negative lobes can overshoot either way. */
+	for(size_t y = first; y < last; y++){
+		const float *in = level->pixels + y * level->width * 4;
+		unsigned char *out = pass->output->pixels + y * level->width * 4;
+		for(size_t i = 0; i < (size_t) level->width * 4; i++){
+			float value = in[i] < 0.0f ? 0.0f : in[i] > 1.0f ? 1.0f : in[i];
+			if(srgb && (i & 3) != 3)
+				out[i] = linearToSrgb[(int) (value * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)];
+			else
+				out[i] = (unsigned char) (value * 255.0f + 0.5f);
+		}
+	}
+}
+
+/* ------------------------------------TAPS----------------------------------- */
+
+static float bessel0(float x){
+	float sum = 1.0f, term = 1.0f;
+	for(int k = 1; k < 20; k++){
+		float factor = x / (2.0f * k);
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+/* t is in pixels of the smaller level. */
+static float kaiser(float t){
+	if(fabsf(t) >= KAISER_RADIUS)
+		return 0.0f;
+
+	float r = t / KAISER_RADIUS;
+	float window = bessel0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / bessel0(KAISER_ALPHA);
+	float x = (float) M_PI * t;
+	return (t == 0.0f ? 1.0f : sinf(x) / x) * window;
+}
+
+static unsigned int sourceIndex(long s, unsigned int size, int wrap){
+	if(wrap){
+		s %= (long) size;
+		return (unsigned int) (s < 0 ? s + size : s);
+	}
+	return s < 0 ? 0 : s >= (long) size ? size - 1 : (unsigned int) s;
+}
+
+static int buildTaps(struct Taps *taps, enum MipFilter filter, unsigned int source, unsigned int size, int wrap){
+	/* Output pixel i covers [i * scale, (i + 1) * scale) of the source. */
+	float scale = (float) source / (float) size;
+	float support = filter == MIP_FILTER_BOX ? scale * 0.5f : KAISER_RADIUS * scale;
+
+	/* An axis already 1 pixel long is copied. */
+	taps->count = source == size ? 1 : (unsigned int) ceilf(2.0f * support) + 1;
+	taps->index = malloc((size_t) size * taps->count * sizeof(unsigned int));
+	taps->weight = malloc((size_t) size * taps->count * sizeof(float));
+	if(taps->index == NULL || taps->weight == NULL)
+		return -1;
+
+	for(unsigned int i = 0; i < size; i++){
+		unsigned int *index = taps->index + (size_t) i * taps->count;
+		float *weight = taps->weight + (size_t) i * taps->count;
+		float center = (i + 0.5f) * scale;
+		long first = source == size ? (long) i : (long) floorf(center - support);
+		float total = 0.0f;
+
+		for(unsigned int k = 0; k < taps->count; k++){
+			long s = first + (long) k;
+			float w;
+			if(source == size)
+				w = 1.0f;
+			else if(filter == MIP_FILTER_BOX){
+				float low = fmaxf((float) s, center - support);
+				float high = fminf((float) s + 1.0f, center + support);
+				w = high > low ? high - low : 0.0f;
+			} else
+				w = kaiser(((float) s + 0.5f - center) / scale);
+
+			index[k] = sourceIndex(s, source, wrap);
+			weight[k] = w;
+			total += w;
+		}
+		for(unsigned int k = 0; k < taps->count; k++)
+			weight[k] /= total;
+	}
+	return 0;
+}
+
+static void freeTaps(struct Taps *taps){
+	free(taps->index);
+	free(taps->weight);
+	memset(taps, 0, sizeof(*taps));
+}
+
+/* -----------------------------------SCALAR---------------------------------- */
+
+static void horizontalScalar(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->horizontal;
+	unsigned int width = pass->target->width;
+
+	for(size_t y = first; y < last; y++){
+		const float *in = pass->source->pixels + y * pass->source->width * 4;
+		float *out = pass->temporary + y * width * 4;
+		for(unsigned int x = 0; x < width; x++, out += 4){
+			const unsigned int *index = taps->index + (size_t) x * taps->count;
+			const float *weight = taps->weight + (size_t) x * taps->count;
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for(unsigned int k = 0; k < taps->count; k++)
+				for(int c = 0; c < 4; c++)
+					sum[c] += weight[k] * in[index[k] * 4 + c];
+			memcpy(out, sum, sizeof(sum));
+		}
+	}
+}
+
+/* Whole rows at a time: every output row is a weighted sum of rows. */
+static void verticalScalar(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->vertical;
+	size_t length = (size_t) pass->target->width * 4;
+
+	for(size_t y = first; y < last; y++){
+		float *out = pass->target->pixels + y * length;
+		memset(out, 0, length * sizeof(float));
+		for(unsigned int k = 0; k < taps->count; k++){
+			const float *in = pass->temporary + taps->index[y * taps->count + k] * length;
+			float weight = taps->weight[y * taps->count + k];
+			for(size_t i = 0; i < length; i++)
+				out[i] += weight * in[i];
+		}
+	}
+}
+
+/* -------------------------------------SSE----------------------------------- */
+
+#ifdef MIPMAP_X86
+static void horizontalSSE(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->horizontal;
+	unsigned int width = pass->target->width;
+
+	for(size_t y = first; y < last; y++){
+		const float *in = pass->source->pixels + y * pass->source->width * 4;
+		float *out = pass->temporary + y * width * 4;
+		for(unsigned int x = 0; x < width; x++, out += 4){
+			const unsigned int *index = taps->index + (size_t) x * taps->count;
+			const float *weight = taps->weight + (size_t) x * taps->count;
+			__m128 sum = _mm_setzero_ps();
+			for(unsigned int k = 0; k < taps->count; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(in + index[k] * 4)));
+			_mm_storeu_ps(out, sum);
+		}
+	}
+}
+
+static void verticalSSE(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->vertical;
+	size_t length = (size_t) pass->target->width * 4;
+
+	/* Rows are whole pixels, so always a multiple of 4 floats. */
+	for(size_t y = first; y < last; y++){
+		float *out = pass->target->pixels + y * length;
+		memset(out, 0, length * sizeof(float));
+		for(unsigned int k = 0; k < taps->count; k++){
+			const float *in = pass->temporary + taps->index[y * taps->count + k] * length;
+			__m128 weight = _mm_set1_ps(taps->weight[y * taps->count + k]);
+			for(size_t i = 0; i < length; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(weight, _mm_loadu_ps(in + i))));
+		}
+	}
+}
+#endif
+
+/* ------------------------------------NEON----------------------------------- */
+
+#ifdef MIPMAP_NEON
+static void horizontalNEON(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->horizontal;
+	unsigned int width = pass->target->width;
+
+	for(size_t y = first; y < last; y++){
+		const float *in = pass->source->pixels + y * pass->source->width * 4;
+		float *out = pass->temporary + y * width * 4;
+		for(unsigned int x = 0; x < width; x++, out += 4){
+			const unsigned int *index = taps->index + (size_t) x * taps->count;
+			const float *weight = taps->weight + (size_t) x * taps->count;
+			float32x4_t sum = vdupq_n_f32(0.0f);
+			for(unsigned int k = 0; k < taps->count; k++)
+				sum = vmlaq_n_f32(sum, vld1q_f32(in + index[k] * 4), weight[k]);
+			vst1q_f32(out, sum);
+		}
+	}
+}
+
+static void verticalNEON(const struct Pass *pass, size_t first, size_t last){
+	const struct Taps *taps = pass->vertical;
+	size_t length = (size_t) pass->target->width * 4;
+
+	for(size_t y = first; y < last; y++){
+		float *out = pass->target->pixels + y * length;
+		memset(out, 0, length * sizeof(float));
+		for(unsigned int k = 0; k < taps->count; k++){
+			const float *in = pass->temporary + taps->index[y * taps->count + k] * length;
+			float weight = taps->weight[y * taps->count + k];
+			for(size_t i = 0; i < length; i += 4)
+				vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(in + i), weight));
+		}
+	}
+}
+#endif
+
+/* ----------------------------------PASSES----------------------------------- */
+
+/* One pixel is one 4 wide register, so AVX2 has nothing over SSE here. */
+static void horizontalRows(void *data, size_t first, size_t last){
+	const struct Pass *pass = data;
+	switch(pass->path){
+#ifdef MIPMAP_X86
+		case MATH_PATH_SSE:
+		case MATH_PATH_AVX2: horizontalSSE(pass, first, last); break;
+#endif
+#ifdef MIPMAP_NEON
+		case MATH_PATH_NEON: horizontalNEON(pass, first, last); break;
+#endif
+		default: horizontalScalar(pass, first, last); break;
+	}
+}
+
+static void verticalRows(void *data, size_t first, size_t last){
+	const struct Pass *pass = data;
+	switch(pass->path){
+#ifdef MIPMAP_X86
+		case MATH_PATH_SSE:
+		case MATH_PATH_AVX2: verticalSSE(pass, first, last); break;
+#endif
+#ifdef MIPMAP_NEON
+		case MATH_PATH_NEON: verticalNEON(pass, first, last); break;
+#endif
+		default: verticalScalar(pass, first, last); break;
+	}
+}
+
+static void runRows(struct JobSystem *jobs, size_t rows, JobRangeFunction function, struct Pass *pass){
+	if(jobs == NULL)
+		function(pass, 0, rows);
+	else
+		jobParallelFor(jobs, rows, ROW_GRAIN, function, pass);
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+static int downsample(struct Pass *pass, struct JobSystem *jobs, enum MipFilter filter){
+	struct Level *source = pass->source, *target = pass->target;
+	struct Taps horizontal = {0}, vertical = {0};
+	int wrap = pass->flags & MIPMAP_WRAP;
+	int status = -1;
+
+	target->pixels = malloc((size_t) target->width * target->height * 4 * sizeof(float));
+	pass->temporary = malloc((size_t) target->width * source->height * 4 * sizeof(float));
+	pass->output->pixels = malloc(IMAGE_SIZE(pass->output));
+	if(target->pixels == NULL || pass->temporary == NULL || pass->output->pixels == NULL ||
+	   buildTaps(&horizontal, filter, source->width, target->width, wrap) == -1 ||
+	   buildTaps(&vertical, filter, source->height, target->height, wrap) == -1)
+		goto done;
+
+	pass->horizontal = &horizontal;
+	pass->vertical = &vertical;
+	runRows(jobs, source->height, horizontalRows, pass);
+	runRows(jobs, target->height, verticalRows, pass);
+	runRows(jobs, target->height, quantizeRows, pass);
+	status = 0;
+
+done:
+	free(pass->temporary);
+	pass->temporary = NULL;
+	freeTaps(&horizontal);
+	freeTaps(&vertical);
+	return status;
+}
+
+int mipmapBuild(const struct Image *image, enum MipFilter filter, unsigned int flags,
+		struct JobSystem *jobs, struct MipChain *chain){
+	pthread_once(&tablesOnce, buildTables);
+	memset(chain, 0, sizeof(*chain));
+
+	struct Level levels[2] = {
+		{ NULL, image->width, image->height },
+		{ NULL, 0, 0 }
+	};
+	struct Pass pass = { .image = image, .flags = flags, .path = mathGetPath() };
+
+	/* Level 0 as it is, not through float and back. */
+	struct Image *base = &chain->levels[chain->levelCount++];
+	*base = *image;
+	base->pixels = malloc(IMAGE_SIZE(image));
+	levels[0].pixels = malloc((size_t) image->width * image->height * 4 * sizeof(float));
+	if(base->pixels == NULL || levels[0].pixels == NULL)
+		goto fail;
+	memcpy(base->pixels, image->pixels, IMAGE_SIZE(image));
+
+	pass.target = &levels[0];
+	runRows(jobs, image->height, expandRows, &pass);
+
+	/* Each level from the one before, swapping the two float levels. */
+	for(int current = 0; levels[current].width > 1 || levels[current].height > 1; current ^= 1){
+		struct Level *source = &levels[current], *target = &levels[current ^ 1];
+		free(target->pixels);
+		target->pixels = NULL;
+		target->width = source->width > 1 ? source->width / 2 : 1;
+		target->height = source->height > 1 ? source->height / 2 : 1;
+
+		struct Image *output = &chain->levels[chain->levelCount++];
+		output->width = target->width;
+		output->height = target->height;
+
+		pass.source = source;
+		pass.target = target;
+		pass.output = output;
+		if(downsample(&pass, jobs, filter) == -1)
+			goto fail;
+	}
+
+	free(levels[0].pixels);
+	free(levels[1].pixels);
+	return 0;
+
+fail:
+	fprintf(stderr, "ERROR: Out of memory building mipmaps.\n");
+	free(levels[0].pixels);
+	free(levels[1].pixels);
+	mipmapFree(chain);
+	return -1;
+}
+
+void mipmapFree(struct MipChain *chain){
+	for(unsigned int i = 0; i < chain->levelCount; i++)
+		imageFree(&chain->levels[i]);
+	memset(chain, 0, sizeof(*chain));
+}
@@ -0,0 +1,407 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <occlusion.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TILE_SIZE	(OCCLUSION_TILE_WIDTH * OCCLUSION_TILE_HEIGHT)
+#define ALIGNMENT	32
+
+/* Closer than this to the eye, w is not worth dividing by. */
+#define MIN_W		1e-6f
+
+/* Unlike fminf() and fmaxf() these compile to one instruction, NaNs aside. */
+static inline float minFloat(float a, float b){
+	return a < b ? a : b;
+}
+
+static inline float maxFloat(float a, float b){
+	return a > b ? a : b;
+}
+
+struct ScreenVertex {
+	float x;
+	float y;
+	float z;
+};
+
+int occlusionCreate(struct OcclusionBuffer *buffer, unsigned int width, unsigned int height){
+	memset(buffer, 0, sizeof(*buffer));
+	buffer->tilesX = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+	buffer->tilesY = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+	if(buffer->tilesX == 0 || buffer->tilesY == 0)
+		return -1;
+	buffer->width = buffer->tilesX * OCCLUSION_TILE_WIDTH;
+	buffer->height = buffer->tilesY * OCCLUSION_TILE_HEIGHT;
+
+	buffer->depth = aligned_alloc(ALIGNMENT, (size_t) buffer->width * buffer->height * sizeof(float));
+	if(buffer->depth == NULL)
+		return -1;
+
+	/* Sizes round up, so the last texel of an odd row still covers the */
+	/* last two of the level below.					    */
+	unsigned int w = buffer->tilesX, h = buffer->tilesY;
+	while(buffer->levelCount < OCCLUSION_MAX_LEVELS){
+		unsigned int level = buffer->levelCount++;
+		buffer->levelWidth[level] = w;
+		buffer->levelHeight[level] = h;
+		buffer->levels[level] = malloc((size_t) w * h * sizeof(float));
+		if(buffer->levels[level] == NULL){
+			occlusionFree(buffer);
+			return -1;
+		}
+		if(w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	occlusionClear(buffer);
+	return 0;
+}
+
+void occlusionClear(struct OcclusionBuffer *buffer){
+	size_t count = (size_t) buffer->width * buffer->height;
+	for(size_t i = 0; i < count; i++)
+		buffer->depth[i] = 1.0f;
+}
+
+/* ---------------------------------RASTERIZER-------------------------------- */
+
+static void transform(const float *m, const float *p, float *clip){
+	for(int r = 0; r < 4; r++)
+		clip[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+}
+
+static void toScreen(const struct OcclusionBuffer *buffer, const float *clip, struct ScreenVertex *v){
+	float inverseW = 1.0f / clip[3];
+	v->x = (clip[0] * inverseW * 0.5f + 0.5f) * buffer->width;
+	v->y = (clip[1] * inverseW * 0.5f + 0.5f) * buffer->height;
+	v->z = clip[2] * inverseW * 0.5f + 0.5f;
+}
+
+/* Edge function of a to b, positive on the left: e = a * x + b * y + c. */
+static void edgeSetup(const struct ScreenVertex *a, const struct ScreenVertex *b, float *edge){
+	edge[0] = a->y - b->y;
+	edge[1] = b->x - a->x;
+	edge[2] = -(edge[0] * a->x + edge[1] * a->y);
+}
+
+#ifdef __SSE2__
+static void rasterizeTile(float *tile, float x0, float y0, const float edges[3][3], const float *plane){
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for(int r = 0; r < OCCLUSION_TILE_HEIGHT; r++){
+		__m128 y = _mm_set1_ps(y0 + r + 0.5f);
+		for(int h = 0; h < OCCLUSION_TILE_WIDTH; h += 4){
+			__m128 x = _mm_add_ps(_mm_set1_ps(x0 + h), offsets);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for(int e = 0; e < 3; e++){
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[e][0]), x),
+								    _mm_mul_ps(_mm_set1_ps(edges[e][1]), y)),
+							 _mm_set1_ps(edges[e][2]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(value, _mm_setzero_ps()));
+			}
+			if(_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), x),
+							 _mm_mul_ps(_mm_set1_ps(plane[1]), y)),
+					      _mm_set1_ps(plane[2]));
+			float *row = tile + r * OCCLUSION_TILE_WIDTH + h;
+			__m128 old = _mm_load_ps(row);
+			__m128 nearest = _mm_min_ps(old, z);
+			_mm_store_ps(row, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+		}
+	}
+}
+#else
+static void rasterizeTile(float *tile, float x0, float y0, const float edges[3][3], const float *plane){
+	for(int r = 0; r < OCCLUSION_TILE_HEIGHT; r++){
+		float y = y0 + r + 0.5f;
+		for(int c = 0; c < OCCLUSION_TILE_WIDTH; c++){
+			float x = x0 + c + 0.5f;
+			int inside = 1;
+			for(int e = 0; e < 3; e++)
+				inside &= edges[e][0] * x + edges[e][1] * y + edges[e][2] >= 0.0f;
+			if(!inside)
+				continue;
+
+			float z = plane[0] * x + plane[1] * y + plane[2];
+			float *depth = tile + r * OCCLUSION_TILE_WIDTH + c;
+			if(z < *depth)
+				*depth = z;
+		}
+	}
+}
+#endif
+
+static void rasterizeTriangle(struct OcclusionBuffer *buffer, const struct ScreenVertex *v0,
+			      const struct ScreenVertex *v1, const struct ScreenVertex *v2){
+	float area = (v1->x - v0->x) * (v2->y - v0->y) - (v2->x - v0->x) * (v1->y - v0->y);
+	if(fabsf(area) < 1e-8f)
+		return;
+	if(area < 0.0f){
+		const struct ScreenVertex *swap = v1;
+		v1 = v2;
+		v2 = swap;
+		area = -area;
+	}
+
+	float minX = minFloat(v0->x, minFloat(v1->x, v2->x));
+	float maxX = maxFloat(v0->x, maxFloat(v1->x, v2->x));
+	float minY = minFloat(v0->y, minFloat(v1->y, v2->y));
+	float maxY = maxFloat(v0->y, maxFloat(v1->y, v2->y));
+	if(maxX < 0.0f || maxY < 0.0f || minX >= buffer->width || minY >= buffer->height)
+		return;
+
+	int tileX0 = minX < 0.0f ? 0 : (int) minX / OCCLUSION_TILE_WIDTH;
+	int tileY0 = minY < 0.0f ? 0 : (int) minY / OCCLUSION_TILE_HEIGHT;
+	int tileX1 = maxX >= buffer->width ? (int) buffer->tilesX - 1 : (int) maxX / OCCLUSION_TILE_WIDTH;
+	int tileY1 = maxY >= buffer->height ? (int) buffer->tilesY - 1 : (int) maxY / OCCLUSION_TILE_HEIGHT;
+
+	/* Edge i is opposite vertex i, so dividing by the area gives the	*/
+	/* barycentric weight of that vertex, and the depth is a plane too.	*/
+	float edges[3][3];
+	edgeSetup(v1, v2, edges[0]);
+	edgeSetup(v2, v0, edges[1]);
+	edgeSetup(v0, v1, edges[2]);
+
+	float plane[3];
+	for(int k = 0; k < 3; k++)
+		plane[k] = (edges[0][k] * v0->z + edges[1][k] * v1->z + edges[2][k] * v2->z) / area;
+
+	for(int ty = tileY0; ty <= tileY1; ty++){
+		float y0 = (float) ty * OCCLUSION_TILE_HEIGHT;
+		for(int tx = tileX0; tx <= tileX1; tx++){
+			float x0 = (float) tx * OCCLUSION_TILE_WIDTH;
+
+			/* Skip the tile if the corner furthest inside an edge is still out. */
+			int outside = 0;
+			for(int e = 0; e < 3 && !outside; e++){
+				float x = x0 + (edges[e][0] > 0.0f ? OCCLUSION_TILE_WIDTH - 0.5f : 0.5f);
+				float y = y0 + (edges[e][1] > 0.0f ? OCCLUSION_TILE_HEIGHT - 0.5f : 0.5f);
+				outside = edges[e][0] * x + edges[e][1] * y + edges[e][2] < 0.0f;
+			}
+			if(outside)
+				continue;
+
+			float *tile = buffer->depth + ((size_t) ty * buffer->tilesX + tx) * TILE_SIZE;
+			rasterizeTile(tile, x0, y0, edges, plane);
+		}
+	}
+}
+
+/* Cut the part in front of the near plane, where z + w >= 0. A triangle	*/
+/* becomes up to a quad. Returns the number of vertices left.		*/
+static int clipNear(float in[3][4], float out[4][4]){
+	int count = 0;
+	for(int i = 0; i < 3; i++){
+		const float *a = in[i];
+		const float *b = in[(i + 1) % 3];
+		float da = a[2] + a[3];
+		float db = b[2] + b[3];
+
+		if(da >= 0.0f)
+			memcpy(out[count++], a, sizeof(float) * 4);
+		if((da >= 0.0f) != (db >= 0.0f)){
+			float t = da / (da - db);
+			for(int k = 0; k < 4; k++)
+				out[count][k] = a[k] + (b[k] - a[k]) * t;
+			count++;
+		}
+	}
+	return count;
+}
+
+void occlusionRasterize(struct OcclusionBuffer *buffer, const float *matrix, const float *vertices,
+			unsigned int stride, const unsigned int *indices, size_t indexCount){
+	for(size_t i = 0; i + 2 < indexCount; i += 3){
+		float clip[3][4];
+		int behind = 0;
+		for(int k = 0; k < 3; k++){
+			transform(matrix, vertices + (size_t) indices[i + k] * stride, clip[k]);
+			behind += clip[k][2] + clip[k][3] < 0.0f;
+		}
+		if(behind == 3)
+			continue;
+
+		float polygon[4][4];
+		int count = 3;
+		if(behind == 0)
+			memcpy(polygon, clip, sizeof(clip));
+		else
+			count = clipNear(clip, polygon);
+
+		struct ScreenVertex screen[4];
+		int degenerate = 0;
+		for(int k = 0; k < count; k++){
+			if(polygon[k][3] < MIN_W)
+				degenerate = 1;
+			else
+				toScreen(buffer, polygon[k], &screen[k]);
+		}
+		if(degenerate)
+			continue;
+
+		for(int k = 2; k < count; k++)
+			rasterizeTriangle(buffer, &screen[0], &screen[k - 1], &screen[k]);
+	}
+}
+
+/* --------------------------------HIERARCHICAL-Z----------------------------- */
+
+void occlusionBuildHiZ(struct OcclusionBuffer *buffer){
+	size_t tiles = (size_t) buffer->tilesX * buffer->tilesY;
+	for(size_t t = 0; t < tiles; t++){
+		const float *tile = buffer->depth + t * TILE_SIZE;
+#ifdef __SSE2__
+		__m128 farthest = _mm_load_ps(tile);
+		for(int i = 4; i < TILE_SIZE; i += 4)
+			farthest = _mm_max_ps(farthest, _mm_load_ps(tile + i));
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+		buffer->levels[0][t] = _mm_cvtss_f32(farthest);
+#else
+		float farthest = tile[0];
+		for(int i = 1; i < TILE_SIZE; i++)
+			farthest = maxFloat(farthest, tile[i]);
+		buffer->levels[0][t] = farthest;
+#endif
+	}
+
+	for(unsigned int level = 1; level < buffer->levelCount; level++){
+		const float *source = buffer->levels[level - 1];
+		unsigned int sourceWidth = buffer->levelWidth[level - 1];
+		unsigned int sourceHeight = buffer->levelHeight[level - 1];
+		float *destination = buffer->levels[level];
+
+		for(unsigned int y = 0; y < buffer->levelHeight[level]; y++){
+			unsigned int y0 = 2 * y;
+			unsigned int y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+			for(unsigned int x = 0; x < buffer->levelWidth[level]; x++){
+				unsigned int x0 = 2 * x;
+				unsigned int x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+				destination[y * buffer->levelWidth[level] + x] =
+					maxFloat(maxFloat(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+					      maxFloat(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+			}
+		}
+	}
+}
+
+/* -----------------------------------TESTING--------------------------------- */
+
+int occlusionTestBox(const struct OcclusionBuffer *buffer, const float *matrix,
+		     const float *center, const float *extent){
+	float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+	float nearest = INFINITY;
+
+	/* The matrix is linear, so the corners are the transformed center	*/
+	/* plus or minus the transformed half axes.				*/
+	float middle[4], axes[3][4];
+	transform(matrix, center, middle);
+	for(int k = 0; k < 3; k++)
+		for(int r = 0; r < 4; r++)
+			axes[k][r] = matrix[4 * k + r] * extent[k];
+
+	float corners[8][4];
+	for(int r = 0; r < 4; r++){
+		float x0 = middle[r] - axes[0][r], x1 = middle[r] + axes[0][r];
+		float y = axes[1][r], z = axes[2][r];
+		corners[0][r] = x0 - y - z;
+		corners[1][r] = x1 - y - z;
+		corners[2][r] = x0 + y - z;
+		corners[3][r] = x1 + y - z;
+		corners[4][r] = x0 - y + z;
+		corners[5][r] = x1 - y + z;
+		corners[6][r] = x0 + y + z;
+		corners[7][r] = x1 + y + z;
+	}
+
+	for(int corner = 0; corner < 8; corner++){
+		const float *clip = corners[corner];
+
+		if(clip[3] < MIN_W || clip[2] + clip[3] < 0.0f)
+			return 1;
+
+		struct ScreenVertex v;
+		toScreen(buffer, clip, &v);
+		minX = minFloat(minX, v.x);
+		maxX = maxFloat(maxX, v.x);
+		minY = minFloat(minY, v.y);
+		maxY = maxFloat(maxY, v.y);
+		nearest = minFloat(nearest, v.z);
+	}
+
+	if(maxX < 0.0f || maxY < 0.0f || minX >= buffer->width || minY >= buffer->height || nearest > 1.0f)
+		return 0;
+
+	/* Texels of level 0 under the box, then up the pyramid until that	*/
+	/* is at most 2 by 2, which bounds the work for big boxes.		*/
+	unsigned int x0 = minX < 0.0f ? 0 : (unsigned int) minX / OCCLUSION_TILE_WIDTH;
+	unsigned int y0 = minY < 0.0f ? 0 : (unsigned int) minY / OCCLUSION_TILE_HEIGHT;
+	unsigned int x1 = maxX >= buffer->width ? buffer->tilesX - 1 : (unsigned int) maxX / OCCLUSION_TILE_WIDTH;
+	unsigned int y1 = maxY >= buffer->height ? buffer->tilesY - 1 : (unsigned int) maxY / OCCLUSION_TILE_HEIGHT;
+
+	unsigned int level = 0;
+	while((x1 - x0 > 1 || y1 - y0 > 1) && level + 1 < buffer->levelCount){
+		level++;
+		x0 >>= 1;
+		y0 >>= 1;
+		x1 >>= 1;
+		y1 >>= 1;
+	}
+
+	const float *texels = buffer->levels[level];
+	unsigned int width = buffer->levelWidth[level];
+	for(unsigned int y = y0; y <= y1; y++){
+		for(unsigned int x = x0; x <= x1; x++){
+			if(nearest <= texels[y * width + x])
+				return 1;
+		}
+	}
+	return 0;
+}
+
+size_t occlusionCull(const struct OcclusionBuffer *buffer, const float *matrix,
+		     const struct BoundsTable *bounds, const unsigned int *candidates,
+		     size_t count, unsigned int *visible){
+	size_t kept = 0;
+	for(size_t i = 0; i < count; i++){
+		unsigned int object = candidates[i];
+		float center[3] = { bounds->centerX[object], bounds->centerY[object], bounds->centerZ[object] };
+		float extent[3] = { bounds->extentX[object], bounds->extentY[object], bounds->extentZ[object] };
+		if(occlusionTestBox(buffer, matrix, center, extent))
+			visible[kept++] = object;
+	}
+	return kept;
+}
+
+void occlusionFree(struct OcclusionBuffer *buffer){
+	free(buffer->depth);
+	for(unsigned int level = 0; level < buffer->levelCount; level++)
+		free(buffer->levels[level]);
+	memset(buffer, 0, sizeof(*buffer));
+}
@@ -0,0 +1,256 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <profiler.h>
+#include <timer.h>
+#include <trace.h>
+#include <GLFW/glfw3.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_RECORD	(~0u)
+
+/* One begin/end pair as recorded during a frame. */
+struct Record {
+	unsigned int scope;
+	GLuint queries[2];
+	uint64_t cpu[2];
+};
+
+struct Frame {
+	struct Record records[PROFILER_MAX_SCOPES];
+	unsigned int count;
+	int pending;
+};
+
+struct Profiler {
+	struct Frame frames[PROFILER_FRAME_LATENCY];
+	unsigned int current;
+
+	struct ProfilerScope scopes[PROFILER_MAX_SCOPES];
+	unsigned int scopeCount;
+
+	/* Records of the scopes begun and not ended yet. */
+	unsigned int stack[PROFILER_MAX_SCOPES];
+	unsigned int depth;
+
+	int timestamps;
+	int gpuClock;			/* 0 if gpuToCpu could not be read. */
+	int64_t gpuToCpu;		/* Added to GPU timestamps for the trace. */
+};
+
+/* Timer queries are core since GL 3.3, where drivers need not list the	*/
+/* extension. glad only loads up to 3.0, so fetch them here, along with	*/
+/* glGetInteger64v for the GPU clock, which glad has only with ARB_sync.	*/
+static int loadTimerQuery(void){
+	if(glad_glGetInteger64v == NULL)
+		glad_glGetInteger64v = (PFNGLGETINTEGER64VPROC) glfwGetProcAddress("glGetInteger64v");
+	if(GLAD_GL_ARB_timer_query)
+		return 1;
+	if(GLVersion.major < 3 || (GLVersion.major == 3 && GLVersion.minor < 3))
+		return 0;
+
+	glad_glQueryCounter = (PFNGLQUERYCOUNTERPROC) glfwGetProcAddress("glQueryCounter");
+	glad_glGetQueryObjecti64v = (PFNGLGETQUERYOBJECTI64VPROC) glfwGetProcAddress("glGetQueryObjecti64v");
+	glad_glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC) glfwGetProcAddress("glGetQueryObjectui64v");
+	return glad_glQueryCounter != NULL && glad_glGetQueryObjecti64v != NULL && glad_glGetQueryObjectui64v != NULL;
+}
+
+struct Profiler *profilerCreate(void){
+	static int warned;
+	struct Profiler *profiler = calloc(1, sizeof(struct Profiler));
+	if(profiler == NULL)
+		return NULL;
+
+	profiler->timestamps = loadTimerQuery();
+	if(!profiler->timestamps && !warned){
+		fprintf(stderr, "No timer queries on GL %d.%d, the profiler reports CPU times only.\n",
+			GLVersion.major, GLVersion.minor);
+		warned = 1;
+	}
+	if(profiler->timestamps){
+		for(int f = 0; f < PROFILER_FRAME_LATENCY; f++){
+			for(int r = 0; r < PROFILER_MAX_SCOPES; r++)
+				glGenQueries(2, profiler->frames[f].records[r].queries);
+		}
+
+		/* Both clocks now, to put GPU scopes on the CPU timeline. Without	*/
+		/* them GPU scopes are still timed, only left out of the trace.	*/
+		if(glad_glGetInteger64v != NULL){
+			GLint64 gpu;
+			glGetInteger64v(GL_TIMESTAMP, &gpu);
+			profiler->gpuToCpu = (int64_t) timerNow() - gpu;
+			profiler->gpuClock = 1;
+		}
+	}
+	return profiler;
+}
+
+static unsigned int findScope(struct Profiler *profiler, const char *name, unsigned int depth){
+	for(unsigned int i = 0; i < profiler->scopeCount; i++){
+		const struct ProfilerScope *scope = &profiler->scopes[i];
+		if(scope->depth == depth && (scope->name == name || strcmp(scope->name, name) == 0))
+			return i;
+	}
+	if(profiler->scopeCount == PROFILER_MAX_SCOPES)
+		return NO_RECORD;
+
+	struct ProfilerScope *scope = &profiler->scopes[profiler->scopeCount];
+	memset(scope, 0, sizeof(*scope));
+	scope->name = name;
+	scope->depth = depth;
+	scope->gpuMilliseconds = -1.0;
+	return profiler->scopeCount++;
+}
+
+/* Only if every query of the frame is done, otherwise the GPU times of	*/
+/* that frame are dropped rather than waited for.			*/
+static int resultsAvailable(const struct Frame *frame){
+	for(unsigned int r = 0; r < frame->count; r++){
+		GLint available;
+		glGetQueryObjectiv(frame->records[r].queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available)
+			return 0;
+	}
+	return 1;
+}
+
+static void readBack(struct Profiler *profiler, struct Frame *frame){
+	double gpu[PROFILER_MAX_SCOPES] = {0};
+	double cpu[PROFILER_MAX_SCOPES] = {0};
+	int seen[PROFILER_MAX_SCOPES] = {0};
+	int gpuKnown = profiler->timestamps && resultsAvailable(frame);
+
+	/* A scope begun several times in a frame adds up. */
+	for(unsigned int r = 0; r < frame->count; r++){
+		const struct Record *record = &frame->records[r];
+		seen[record->scope] = 1;
+		cpu[record->scope] += TIMER_MILLISECONDS((double) (record->cpu[1] - record->cpu[0]));
+		if(gpuKnown){
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(record->queries[0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(record->queries[1], GL_QUERY_RESULT, &end);
+			gpu[record->scope] += TIMER_MILLISECONDS((double) (end - begin));
+			if(traceActive && profiler->gpuClock)
+				traceComplete(profiler->scopes[record->scope].name, TRACE_TRACK_GPU,
+					      begin + profiler->gpuToCpu, end - begin);
+		}
+	}
+
+	for(unsigned int s = 0; s < profiler->scopeCount; s++){
+		if(!seen[s])
+			continue;
+		struct ProfilerScope *scope = &profiler->scopes[s];
+		scope->cpuMilliseconds = cpu[s];
+		scope->cpuTotal += cpu[s];
+		scope->cpuFrames++;
+		scope->gpuMilliseconds = gpuKnown ? gpu[s] : -1.0;
+		if(gpuKnown){
+			scope->gpuTotal += gpu[s];
+			scope->gpuFrames++;
+		}
+	}
+}
+
+void profilerBeginFrame(struct Profiler *profiler){
+	struct Frame *frame = &profiler->frames[profiler->current];
+	if(frame->pending)
+		readBack(profiler, frame);
+
+	frame->count = 0;
+	frame->pending = 0;
+	profiler->depth = 0;
+}
+
+void profilerEndFrame(struct Profiler *profiler){
+	/* Close what was left open, so the frame can still be read. */
+	while(profiler->depth > 0)
+		profilerEnd(profiler);
+
+	profiler->frames[profiler->current].pending = 1;
+	profiler->current = (profiler->current + 1) % PROFILER_FRAME_LATENCY;
+}
+
+void profilerBegin(struct Profiler *profiler, const char *name){
+	struct Frame *frame = &profiler->frames[profiler->current];
+	if(profiler->depth == PROFILER_MAX_SCOPES)
+		return;
+
+	/* Out of records or scopes: still push, so profilerEnd() pairs up. */
+	unsigned int scope = findScope(profiler, name, profiler->depth);
+	if(scope == NO_RECORD || frame->count == PROFILER_MAX_SCOPES){
+		profiler->stack[profiler->depth++] = NO_RECORD;
+		return;
+	}
+
+	struct Record *record = &frame->records[frame->count];
+	record->scope = scope;
+	if(profiler->timestamps)
+		glQueryCounter(record->queries[0], GL_TIMESTAMP);
+	record->cpu[0] = timerNow();
+	profiler->stack[profiler->depth++] = frame->count++;
+}
+
+void profilerEnd(struct Profiler *profiler){
+	if(profiler->depth == 0)
+		return;
+
+	unsigned int index = profiler->stack[--profiler->depth];
+	if(index == NO_RECORD)
+		return;
+
+	struct Record *record = &profiler->frames[profiler->current].records[index];
+	record->cpu[1] = timerNow();
+	if(profiler->timestamps)
+		glQueryCounter(record->queries[1], GL_TIMESTAMP);
+}
+
+const struct ProfilerScope *profilerScopes(const struct Profiler *profiler, unsigned int *count){
+	*count = profiler->scopeCount;
+	return profiler->scopes;
+}
+
+void profilerPrint(const struct Profiler *profiler, FILE *file){
+	fprintf(file, "%-24s %10s %10s %10s %10s\n", "scope", "gpu ms", "gpu avg", "cpu ms", "cpu avg");
+	for(unsigned int s = 0; s < profiler->scopeCount; s++){
+		const struct ProfilerScope *scope = &profiler->scopes[s];
+		int indent = 2 * scope->depth;
+
+		fprintf(file, "%*s%-*s", indent, "", 24 - indent, scope->name);
+		if(scope->gpuFrames > 0)
+			fprintf(file, " %10.3f %10.3f", scope->gpuMilliseconds, scope->gpuTotal / scope->gpuFrames);
+		else
+			fprintf(file, " %10s %10s", "-", "-");
+		if(scope->cpuFrames > 0)
+			fprintf(file, " %10.3f %10.3f\n", scope->cpuMilliseconds, scope->cpuTotal / scope->cpuFrames);
+		else
+			fprintf(file, " %10s %10s\n", "-", "-");
+	}
+}
+
+void profilerDestroy(struct Profiler *profiler){
+	if(profiler == NULL)
+		return;
+
+	if(profiler->timestamps){
+		for(int f = 0; f < PROFILER_FRAME_LATENCY; f++){
+			for(int r = 0; r < PROFILER_MAX_SCOPES; r++)
+				glDeleteQueries(2, profiler->frames[f].records[r].queries);
+		}
+	}
+	free(profiler);
+}
@@ -0,0 +1,171 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <scene.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The node's own transform changed, or only one above it. */
+#define FLAG_LOCAL	0x1
+#define FLAG_WORLD	0x2
+
+enum {
+	TRANSLATION_X, TRANSLATION_Y, TRANSLATION_Z,
+	ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+	SCALE_X, SCALE_Y, SCALE_Z
+};
+
+static int grow(void **array, size_t size){
+	void *fresh = realloc(*array, size);
+	if(fresh == NULL)
+		return -1;
+	*array = fresh;
+	return 0;
+}
+
+int sceneReserve(struct SceneGraph *graph, size_t capacity){
+	if(capacity <= graph->capacity)
+		return 0;
+
+	/* Arrays that did grow are kept, only the capacity says how much is usable. */
+	for(int i = 0; i < 10; i++)
+		if(grow((void **) &graph->transforms[i], capacity * sizeof(float)) == -1)
+			return -1;
+	if(grow((void **) &graph->parents, capacity * sizeof(uint32_t)) == -1 ||
+	   grow((void **) &graph->locals, capacity * sizeof(struct Mat4)) == -1 ||
+	   grow((void **) &graph->worlds, capacity * sizeof(struct Mat4)) == -1 ||
+	   grow((void **) &graph->flags, capacity) == -1)
+		return -1;
+
+	graph->capacity = capacity;
+	return 0;
+}
+
+static void markDirty(struct SceneGraph *graph, uint32_t node){
+	graph->flags[node] = FLAG_LOCAL | FLAG_WORLD;
+	if(node < graph->firstDirty)
+		graph->firstDirty = node;
+}
+
+void sceneSetTranslation(struct SceneGraph *graph, uint32_t node, struct Vec3 translation){
+	graph->transforms[TRANSLATION_X][node] = translation.x;
+	graph->transforms[TRANSLATION_Y][node] = translation.y;
+	graph->transforms[TRANSLATION_Z][node] = translation.z;
+	markDirty(graph, node);
+}
+
+void sceneSetRotation(struct SceneGraph *graph, uint32_t node, struct Quat rotation){
+	graph->transforms[ROTATION_X][node] = rotation.x;
+	graph->transforms[ROTATION_Y][node] = rotation.y;
+	graph->transforms[ROTATION_Z][node] = rotation.z;
+	graph->transforms[ROTATION_W][node] = rotation.w;
+	markDirty(graph, node);
+}
+
+void sceneSetTransform(struct SceneGraph *graph, uint32_t node, struct Vec3 translation,
+		       struct Quat rotation, struct Vec3 scale){
+	sceneSetTranslation(graph, node, translation);
+	sceneSetRotation(graph, node, rotation);
+	graph->transforms[SCALE_X][node] = scale.x;
+	graph->transforms[SCALE_Y][node] = scale.y;
+	graph->transforms[SCALE_Z][node] = scale.z;
+}
+
+long sceneAddNode(struct SceneGraph *graph, uint32_t parent, struct Vec3 translation,
+		  struct Quat rotation, struct Vec3 scale){
+	if(parent != SCENE_NO_PARENT && parent >= graph->count){
+		fprintf(stderr, "ERROR: Scene node %u does not exist.\n", parent);
+		return -1;
+	}
+	if(graph->count == graph->capacity &&
+	   sceneReserve(graph, graph->capacity ? graph->capacity * 2 : 256) == -1)
+		return -1;
+
+	uint32_t node = (uint32_t) graph->count++;
+	graph->parents[node] = parent;
+	sceneSetTransform(graph, node, translation, rotation, scale);
+	return node;
+}
+
+/* Compose the local matrices of each run of flagged nodes in one go. */
+static void composeLocals(struct SceneGraph *graph){
+	const unsigned char *flags = graph->flags;
+
+	for(size_t i = graph->firstDirty; i < graph->count; i++){
+		if(!(flags[i] & FLAG_LOCAL))
+			continue;
+
+		size_t first = i;
+		while(i < graph->count && (flags[i] & FLAG_LOCAL))
+			i++;
+
+		struct TRSArrays trs;
+		for(int k = 0; k < 3; k++){
+			trs.translation[k] = graph->transforms[TRANSLATION_X + k] + first;
+			trs.scale[k] = graph->transforms[SCALE_X + k] + first;
+		}
+		for(int k = 0; k < 4; k++)
+			trs.rotation[k] = graph->transforms[ROTATION_X + k] + first;
+		mathComposeTRS(graph->locals + first, &trs, i - first);
+	}
+}
+
+size_t sceneUpdate(struct SceneGraph *graph){
+	graph->changedFirst = graph->changedEnd = 0;
+	if(graph->firstDirty >= graph->count){
+		graph->firstDirty = graph->count;
+		return 0;
+	}
+
+	composeLocals(graph);
+
+	/* Parents come first, so their world matrix and flags are final by	*/
+	/* the time their children are reached.					*/
+	unsigned char *flags = graph->flags;
+	size_t updated = 0, last = graph->firstDirty;
+	for(size_t i = graph->firstDirty; i < graph->count; i++){
+		uint32_t parent = graph->parents[i];
+		if(parent != SCENE_NO_PARENT && (flags[parent] & FLAG_WORLD))
+			flags[i] |= FLAG_WORLD;
+		if(!(flags[i] & FLAG_WORLD))
+			continue;
+
+		if(parent == SCENE_NO_PARENT)
+			graph->worlds[i] = graph->locals[i];
+		else
+			mat4Multiply(&graph->worlds[i], &graph->worlds[parent], &graph->locals[i]);
+		updated++;
+		last = i;
+	}
+
+	graph->changedFirst = graph->firstDirty;
+	graph->changedEnd = last + 1;
+	memset(flags + graph->changedFirst, 0, graph->changedEnd - graph->changedFirst);
+	graph->firstDirty = graph->count;
+	return updated;
+}
+
+void sceneFree(struct SceneGraph *graph){
+	for(int i = 0; i < 10; i++)
+		free(graph->transforms[i]);
+	free(graph->parents);
+	free(graph->locals);
+	free(graph->worlds);
+	free(graph->flags);
+	memset(graph, 0, sizeof(*graph));
+}
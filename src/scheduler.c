@@ -0,0 +1,144 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <scheduler.h>
+#include <GLFW/glfw3.h>
+#include <timer.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+/* Woken this much before the time asked for, the rest is spun. */
+#define SPIN_MARGIN		100000
+/* Extra time left between polling input and the deadline. */
+#define INPUT_MARGIN		500000
+#define INITIAL_OVERSLEEP	200000
+
+void schedulerInit(struct Scheduler *scheduler, double stepRate, double frameCap){
+	memset(scheduler, 0, sizeof(*scheduler));
+	scheduler->step = (uint64_t) (1e9 / stepRate);
+	scheduler->cap = frameCap > 0.0 ? (uint64_t) (1e9 / frameCap) : 0;
+	scheduler->lastFrame = timerNow();
+	scheduler->inputTime = scheduler->lastFrame;
+	scheduler->oversleep = INITIAL_OVERSLEEP;
+}
+
+void schedulerSetSwapInterval(struct Scheduler *scheduler, int interval){
+	glfwSwapInterval(interval);
+	scheduler->swapInterval = interval;
+	scheduler->swapPeriod = 0;
+	scheduler->lastSwap = 0;
+	scheduler->deadline = 0;
+}
+
+static uint64_t framePeriod(const struct Scheduler *scheduler){
+	if(scheduler->cap != 0)
+		return scheduler->cap;
+	if(scheduler->swapInterval > 0)
+		return scheduler->swapPeriod;
+	return 0;
+}
+
+void schedulerSleepUntil(struct Scheduler *scheduler, uint64_t time){
+	uint64_t now = timerNow();
+	if(time <= now)
+		return;
+
+	if(time - now > scheduler->oversleep + SPIN_MARGIN){
+		uint64_t wake = time - scheduler->oversleep - SPIN_MARGIN;
+		struct timespec until = { (time_t) (wake / 1000000000u), (long) (wake % 1000000000u) };
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+			;
+
+		/* Follow how late the timer wakes: up at once, down slowly. */
+		uint64_t late = timerNow() - wake;
+		if(late > scheduler->oversleep)
+			scheduler->oversleep = late;
+		else
+			scheduler->oversleep -= (scheduler->oversleep - late) / 8;
+	}
+
+	while(timerNow() < time)
+		sched_yield();
+}
+
+void schedulerWaitForInput(struct Scheduler *scheduler){
+	uint64_t period = framePeriod(scheduler);
+	if(period != 0 && scheduler->deadline != 0){
+		/* Late enough that the input is fresh, early enough to make it. */
+		uint64_t needed = scheduler->frameCost + scheduler->frameCost / 4 + INPUT_MARGIN;
+		if(scheduler->deadline > needed)
+			schedulerSleepUntil(scheduler, scheduler->deadline - needed);
+	}
+	scheduler->inputTime = timerNow();
+}
+
+unsigned int schedulerBeginFrame(struct Scheduler *scheduler){
+	uint64_t now = timerNow();
+	uint64_t elapsed = now - scheduler->lastFrame;
+	scheduler->lastFrame = now;
+
+	if(elapsed > scheduler->step * SCHEDULER_MAX_STEPS)
+		elapsed = scheduler->step * SCHEDULER_MAX_STEPS;
+
+	scheduler->accumulator += elapsed;
+	unsigned int steps = (unsigned int) (scheduler->accumulator / scheduler->step);
+	scheduler->accumulator -= steps * scheduler->step;
+	return steps;
+}
+
+float schedulerAlpha(const struct Scheduler *scheduler){
+	return (float) scheduler->accumulator / (float) scheduler->step;
+}
+
+void schedulerEndFrame(struct Scheduler *scheduler){
+	uint64_t now = timerNow();
+
+	/* Missing the deadline costs a whole frame, so the estimate follows */
+	/* slow frames at once and fast ones slowly.			     */
+	uint64_t cost = now - scheduler->inputTime;
+	if(cost > scheduler->frameCost)
+		scheduler->frameCost = cost;
+	else
+		scheduler->frameCost -= (scheduler->frameCost - cost) / 8;
+}
+
+void schedulerPresented(struct Scheduler *scheduler){
+	uint64_t now = timerNow();
+
+	if(scheduler->lastSwap != 0){
+		uint64_t interval = now - scheduler->lastSwap;
+		/* A missed blank doubles an interval, so only trust the short ones */
+		/* quickly. A period too short only wakes the input a bit early.    */
+		if(scheduler->swapPeriod == 0 || interval < scheduler->swapPeriod)
+			scheduler->swapPeriod = interval;
+		else
+			scheduler->swapPeriod += (interval - scheduler->swapPeriod) / 16;
+	}
+	scheduler->lastSwap = now;
+
+	/* With vsync the swap just returned at a vertical blank, and the next */
+	/* one is a period away. With a cap the deadlines keep their rhythm,  */
+	/* unless the frame ran so late that it is better to start over.      */
+	uint64_t period = framePeriod(scheduler);
+	if(period == 0)
+		scheduler->deadline = 0;
+	else if(scheduler->cap == 0 || scheduler->deadline == 0 || now > scheduler->deadline + period)
+		scheduler->deadline = now + period;
+	else
+		scheduler->deadline += period;
+}
@@ -0,0 +1,166 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <startup.h>
+#include <glad/glad.h>
+#include <timer.h>
+#include <trace.h>
+#include <string.h>
+
+struct Phase {
+	const char *name;
+	unsigned int depth;
+	uint64_t start;
+	uint64_t end;
+};
+
+static uint64_t processStart;
+static uint64_t firstFrame;
+
+static struct Phase phases[STARTUP_MAX_PHASES];
+static unsigned int phaseCount;
+
+/* Phases begun and not ended yet, NO_PHASE if there was no room. */
+#define NO_PHASE	(~0u)
+static unsigned int openPhases[STARTUP_MAX_DEPTH];
+static unsigned int depth;
+
+/* The loader startupLoadGL() wraps, and how far glad has got with it. */
+enum GladStep {
+	GLAD_START,
+	GLAD_FIND_CORE,
+	GLAD_LOAD_VERSIONS,
+	GLAD_FIND_EXTENSIONS,
+	GLAD_LOAD_EXTENSIONS
+};
+static GLADloadproc loadProc;
+static enum GladStep gladStep;
+
+__attribute__((constructor)) static void startClock(void){
+	processStart = timerNow();
+}
+
+void startupBegin(const char *name){
+	if(depth == STARTUP_MAX_DEPTH)
+		return;
+
+	TRACE_BEGIN(name);
+	if(phaseCount == STARTUP_MAX_PHASES){
+		openPhases[depth++] = NO_PHASE;
+		return;
+	}
+
+	struct Phase *phase = &phases[phaseCount];
+	phase->name = name;
+	phase->depth = depth;
+	phase->start = timerNow();
+	phase->end = 0;
+	openPhases[depth++] = phaseCount++;
+}
+
+void startupEnd(void){
+	if(depth == 0)
+		return;
+
+	TRACE_END();
+	unsigned int index = openPhases[--depth];
+	if(index != NO_PHASE)
+		phases[index].end = timerNow();
+}
+
+/* glad gives no hook between its steps, so they are told apart by the	*/
+/* lookups: glGetString comes before find_coreGL(), glCullFace opens	*/
+/* load_GL_VERSION_1_0() and glIsVertexArray closes load_GL_VERSION_3_0().	*/
+/* Anything looked up after that is an extension, so the gap before it	*/
+/* is find_extensionsGL().							*/
+static void *timedLookup(const char *name){
+	if(gladStep == GLAD_FIND_CORE && strcmp(name, "glCullFace") == 0){
+		startupEnd();
+		startupBegin("load_GL_VERSION_*");
+		gladStep = GLAD_LOAD_VERSIONS;
+	}else if(gladStep == GLAD_FIND_EXTENSIONS){
+		startupEnd();
+		startupBegin("load extensions");
+		gladStep = GLAD_LOAD_EXTENSIONS;
+	}
+
+	void *proc = loadProc(name);
+
+	if(gladStep == GLAD_START){
+		startupBegin("find_coreGL");
+		gladStep = GLAD_FIND_CORE;
+	}else if(gladStep == GLAD_LOAD_VERSIONS && strcmp(name, "glIsVertexArray") == 0){
+		startupEnd();
+		startupBegin("find_extensionsGL");
+		gladStep = GLAD_FIND_EXTENSIONS;
+	}
+	return proc;
+}
+
+int startupLoadGL(GLADloadproc load){
+	unsigned int outer = depth;
+	startupBegin("gladLoadGLLoader");
+	loadProc = load;
+	gladStep = GLAD_START;
+
+	int loaded = gladLoadGLLoader(timedLookup);
+
+	/* Closed on every path, failed or not. Whichever step glad stopped	*/
+	/* in, including find_extensionsGL() when no extension was loaded,	*/
+	/* ends here.								*/
+	while(depth > outer)
+		startupEnd();
+	return loaded;
+}
+
+int startupFrame(void){
+	if(firstFrame != 0)
+		return 0;
+
+	/* Close anything left open, so it does not run into the frames. */
+	while(depth > 0)
+		startupEnd();
+
+	firstFrame = timerNow();
+	return 1;
+}
+
+int startupOnlyRequested(int argc, char *argv[]){
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--startup-only") == 0)
+			return 1;
+	}
+	return 0;
+}
+
+void startupPrint(FILE *file){
+	fprintf(file, "%-32s %10s %10s\n", "startup phase", "start ms", "took ms");
+	for(unsigned int i = 0; i < phaseCount; i++){
+		const struct Phase *phase = &phases[i];
+		int indent = 2 * phase->depth;
+
+		fprintf(file, "%*s%-*s %10.3f", indent, "", 32 - indent, phase->name,
+			TIMER_MILLISECONDS((double) (phase->start - processStart)));
+		if(phase->end != 0)
+			fprintf(file, " %10.3f\n", TIMER_MILLISECONDS((double) (phase->end - phase->start)));
+		else
+			fprintf(file, " %10s\n", "-");
+	}
+	if(firstFrame != 0)
+		fprintf(file, "%-32s %10.3f\n", "first frame presented",
+			TIMER_MILLISECONDS((double) (firstFrame - processStart)));
+}
@@ -0,0 +1,633 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <texture_compress.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Rows of blocks per job. */
+#define ROW_GRAIN	4
+
+/* Power iterations to find the main axis of a block's colours. */
+#define AXIS_ITERATIONS	8
+
+/* Least squares passes moving the endpoints onto the chosen indices. */
+#define REFINE_PASSES	2
+
+#define BLOCKS(size)	(((size) + 3) / 4)
+
+struct Task {
+	const struct Image *image;
+	unsigned char *blocks;
+	unsigned char *pixels;
+	enum BlockFormat format;
+	unsigned int width;
+	unsigned int height;
+};
+
+static inline int clampInt(int value, int low, int high){
+	return value < low ? low : value > high ? high : value;
+}
+
+/* Main axis of count points of size channels, through their mean.	*/
+/* Returns 0 if the points are all the same and there is no axis.	*/
+static int principalAxis(const float (*points)[4], unsigned int count, unsigned int channels,
+			 float *mean, float *axis){
+	float covariance[4][4] = {{0}};
+
+	memset(mean, 0, 4 * sizeof(float));
+	for(unsigned int i = 0; i < count; i++)
+		for(unsigned int c = 0; c < channels; c++)
+			mean[c] += points[i][c] / count;
+
+	for(unsigned int i = 0; i < count; i++){
+		for(unsigned int a = 0; a < channels; a++)
+			for(unsigned int b = a; b < channels; b++)
+				covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+	}
+	for(unsigned int a = 0; a < channels; a++)
+		for(unsigned int b = 0; b < a; b++)
+			covariance[a][b] = covariance[b][a];
+
+	/* Start from the widest channel, it is never orthogonal to the axis. */
+	unsigned int widest = 0;
+	for(unsigned int c = 1; c < channels; c++)
+		if(covariance[c][c] > covariance[widest][widest])
+			widest = c;
+	if(covariance[widest][widest] < 1e-3f)
+		return 0;
+
+	for(unsigned int c = 0; c < 4; c++)
+		axis[c] = c == widest;
+	for(int iteration = 0; iteration < AXIS_ITERATIONS; iteration++){
+		float next[4] = {0}, length = 0;
+		for(unsigned int a = 0; a < channels; a++){
+			for(unsigned int b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+		if(length < 1e-12f)
+			return 0;
+		length = 1 / sqrtf(length);
+		for(unsigned int c = 0; c < channels; c++)
+			axis[c] = next[c] * length;
+	}
+	return 1;
+}
+
+/* Solve for the two endpoints that best give the points when blended	*/
+/* by weights, the share of the second endpoint in each. Points with a	*/
+/* negative weight are left out. Returns 0 if the system is singular.	*/
+static int leastSquares(const float (*points)[4], const float *weights, unsigned int channels,
+			float (*endpoints)[4]){
+	float aa = 0, ab = 0, bb = 0, ap[4] = {0}, bp[4] = {0};
+
+	for(unsigned int i = 0; i < 16; i++){
+		if(weights[i] < 0)
+			continue;
+		float b = weights[i], a = 1 - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for(unsigned int c = 0; c < channels; c++){
+			ap[c] += a * points[i][c];
+			bp[c] += b * points[i][c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if(fabsf(determinant) < 1e-6f)
+		return 0;
+	determinant = 1 / determinant;
+	for(unsigned int c = 0; c < channels; c++){
+		endpoints[0][c] = (ap[c] * bb - bp[c] * ab) * determinant;
+		endpoints[1][c] = (bp[c] * aa - ap[c] * ab) * determinant;
+	}
+	return 1;
+}
+
+/* The block at (x, y), repeating the last row and column past the edges. */
+static void loadBlock(const struct Image *image, unsigned int x, unsigned int y, unsigned char (*pixels)[4]){
+	for(unsigned int row = 0; row < 4; row++){
+		unsigned int source = y * 4 + row < image->height ? y * 4 + row : image->height - 1;
+		for(unsigned int column = 0; column < 4; column++){
+			unsigned int sourceColumn = x * 4 + column < image->width ? x * 4 + column : image->width - 1;
+			memcpy(pixels[row * 4 + column], image->pixels + ((size_t) source * image->width + sourceColumn) * 4, 4);
+		}
+	}
+}
+
+static void storeBlock(unsigned char *image, unsigned int width, unsigned int height, unsigned int x,
+		       unsigned int y, const unsigned char (*pixels)[4]){
+	for(unsigned int row = 0; row < 4 && y * 4 + row < height; row++){
+		unsigned int columns = width - x * 4 < 4 ? width - x * 4 : 4;
+		memcpy(image + ((size_t) (y * 4 + row) * width + x * 4) * 4, pixels[row * 4], columns * 4);
+	}
+}
+
+/* ------------------------------------BC1------------------------------------ */
+
+struct ColorFit {
+	uint16_t endpoints[2];
+	unsigned char indices[16];
+	unsigned int error;
+};
+
+static uint16_t pack565(const float *color){
+	int r = clampInt((int) lrintf(color[0] * 31 / 255), 0, 31);
+	int g = clampInt((int) lrintf(color[1] * 63 / 255), 0, 63);
+	int b = clampInt((int) lrintf(color[2] * 31 / 255), 0, 31);
+	return (uint16_t) (r << 11 | g << 5 | b);
+}
+
+static void unpack565(uint16_t packed, int *color){
+	int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = r << 3 | r >> 2;
+	color[1] = g << 2 | g >> 4;
+	color[2] = b << 3 | b >> 2;
+}
+
+/* The four colours a BC1 block can pick from. In three colour mode the	*/
+/* last one is transparent black.					*/
+static void colorPalette(uint16_t first, uint16_t second, int threeColor, int (*palette)[4]){
+	unpack565(first, palette[0]);
+	unpack565(second, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+	for(int c = 0; c < 3; c++){
+		if(threeColor){
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		} else {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = threeColor ? 0 : 255;
+}
+
+static void fitColors(const unsigned char (*pixels)[4], int threeColor, struct ColorFit *fit){
+	int palette[4][4];
+	colorPalette(fit->endpoints[0], fit->endpoints[1], threeColor, palette);
+
+	fit->error = 0;
+	for(int i = 0; i < 16; i++){
+		if(threeColor && pixels[i][3] < 128){
+			fit->indices[i] = 3;
+			continue;
+		}
+
+		unsigned int best = ~0u;
+		for(int k = 0; k < (threeColor ? 3 : 4); k++){
+			unsigned int error = 0;
+			for(int c = 0; c < 3; c++)
+				error += (unsigned int) ((pixels[i][c] - palette[k][c]) * (pixels[i][c] - palette[k][c]));
+			if(error < best){
+				best = error;
+				fit->indices[i] = (unsigned char) k;
+			}
+		}
+		fit->error += best;
+	}
+}
+
+/* Endpoints along the main axis of the opaque colours, then moved	*/
+/* closer with least squares on the indices they got.			*/
+static void encodeColors(const unsigned char (*pixels)[4], int threeColor, unsigned char *block){
+	float points[16][4], mean[4], axis[4];
+	unsigned int count = 0;
+
+	for(int i = 0; i < 16; i++){
+		if(threeColor && pixels[i][3] < 128)
+			continue;
+		for(int c = 0; c < 4; c++)
+			points[count][c] = pixels[i][c];
+		count++;
+	}
+
+	struct ColorFit best = { {0, 0}, {0}, ~0u };
+	if(count == 0){
+		/* Nothing to see, every index the transparent one. */
+		memset(best.indices, 3, sizeof(best.indices));
+	} else if(!principalAxis((const float (*)[4]) points, count, 3, mean, axis)){
+		best.endpoints[0] = best.endpoints[1] = pack565(mean);
+		fitColors(pixels, threeColor, &best);
+	} else {
+		float low = 0, high = 0, endpoints[2][4];
+		for(unsigned int i = 0; i < count; i++){
+			float t = 0;
+			for(int c = 0; c < 3; c++)
+				t += (points[i][c] - mean[c]) * axis[c];
+			low = t < low ? t : low;
+			high = t > high ? t : high;
+		}
+		for(int c = 0; c < 3; c++){
+			endpoints[0][c] = mean[c] + axis[c] * high;
+			endpoints[1][c] = mean[c] + axis[c] * low;
+		}
+
+		/* Share of the second endpoint for each index. */
+		static const float shares[2][4] = { {0, 1, 1.0f / 3, 2.0f / 3}, {0, 1, 0.5f, -1} };
+		for(int pass = 0; pass <= REFINE_PASSES; pass++){
+			struct ColorFit fit = { {pack565(endpoints[0]), pack565(endpoints[1])}, {0}, 0 };
+			fitColors(pixels, threeColor, &fit);
+			if(fit.error >= best.error)
+				break;
+			best = fit;
+
+			float weights[16], all[16][4];
+			for(int i = 0; i < 16; i++){
+				weights[i] = shares[threeColor][fit.indices[i]];
+				for(int c = 0; c < 3; c++)
+					all[i][c] = pixels[i][c];
+			}
+			if(!leastSquares((const float (*)[4]) all, weights, 3, endpoints))
+				break;
+		}
+	}
+
+	/* The order of the endpoints picks the mode: the first larger for	*/
+	/* four colours, otherwise three and transparent.			*/
+	uint16_t first = best.endpoints[0], second = best.endpoints[1];
+	if(threeColor ? first > second : first < second){
+		first = best.endpoints[1];
+		second = best.endpoints[0];
+		for(int i = 0; i < 16; i++)
+			if(!threeColor || best.indices[i] < 2)
+				best.indices[i] ^= 1;
+	} else if(!threeColor && first == second)
+		memset(best.indices, 0, sizeof(best.indices));
+
+	uint32_t indices = 0;
+	for(int i = 0; i < 16; i++)
+		indices |= (uint32_t) best.indices[i] << (i * 2);
+	block[0] = (unsigned char) first;
+	block[1] = (unsigned char) (first >> 8);
+	block[2] = (unsigned char) second;
+	block[3] = (unsigned char) (second >> 8);
+	for(int i = 0; i < 4; i++)
+		block[4 + i] = (unsigned char) (indices >> (i * 8));
+}
+
+/* Always four colours for BC3, whatever the order of the endpoints. */
+static void decodeColors(const unsigned char *block, int fourColor, unsigned char (*pixels)[4]){
+	uint16_t first = (uint16_t) (block[0] | block[1] << 8), second = (uint16_t) (block[2] | block[3] << 8);
+	uint32_t indices = (uint32_t) block[4] | (uint32_t) block[5] << 8 | (uint32_t) block[6] << 16 |
+			   (uint32_t) block[7] << 24;
+	int palette[4][4];
+
+	colorPalette(first, second, !fourColor && first <= second, palette);
+	for(int i = 0; i < 16; i++){
+		const int *color = palette[(indices >> (i * 2)) & 3];
+		for(int c = 0; c < 4; c++)
+			pixels[i][c] = (unsigned char) color[c];
+	}
+}
+
+/* ------------------------------------BC3------------------------------------ */
+
+static void alphaPalette(int first, int second, int *palette){
+	palette[0] = first;
+	palette[1] = second;
+	if(first > second){
+		for(int k = 2; k < 8; k++)
+			palette[k] = ((8 - k) * first + (k - 1) * second + 3) / 7;
+	} else {
+		for(int k = 2; k < 6; k++)
+			palette[k] = ((6 - k) * first + (k - 1) * second + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+/* The alpha range split in eight, the endpoints the extremes. */
+static void encodeAlpha(const unsigned char (*pixels)[4], unsigned char *block){
+	int low = 255, high = 0, palette[8];
+	for(int i = 0; i < 16; i++){
+		low = pixels[i][3] < low ? pixels[i][3] : low;
+		high = pixels[i][3] > high ? pixels[i][3] : high;
+	}
+	alphaPalette(high, low, palette);
+
+	uint64_t indices = 0;
+	for(int i = 0; i < 16 && high > low; i++){
+		int best = 0;
+		for(int k = 1; k < 8; k++)
+			if(abs(pixels[i][3] - palette[k]) < abs(pixels[i][3] - palette[best]))
+				best = k;
+		indices |= (uint64_t) best << (i * 3);
+	}
+
+	block[0] = (unsigned char) high;
+	block[1] = (unsigned char) low;
+	for(int i = 0; i < 6; i++)
+		block[2 + i] = (unsigned char) (indices >> (i * 8));
+}
+
+static void decodeAlpha(const unsigned char *block, unsigned char (*pixels)[4]){
+	uint64_t indices = 0;
+	int palette[8];
+
+	alphaPalette(block[0], block[1], palette);
+	for(int i = 0; i < 6; i++)
+		indices |= (uint64_t) block[2 + i] << (i * 8);
+	for(int i = 0; i < 16; i++)
+		pixels[i][3] = (unsigned char) palette[(indices >> (i * 3)) & 7];
+}
+
+/* ------------------------------------BC7------------------------------------ */
+
+/* Blocks are a little endian bit stream. */
+struct Bits {
+	unsigned char *data;
+	unsigned int position;
+};
+
+static void putBits(struct Bits *bits, unsigned int value, unsigned int count){
+	for(unsigned int i = 0; i < count; i++, bits->position++)
+		bits->data[bits->position / 8] |= (unsigned char) (((value >> i) & 1) << (bits->position % 8));
+}
+
+static unsigned int getBits(struct Bits *bits, unsigned int count){
+	unsigned int value = 0;
+	for(unsigned int i = 0; i < count; i++, bits->position++)
+		value |= (unsigned int) ((bits->data[bits->position / 8] >> (bits->position % 8)) & 1) << i;
+	return value;
+}
+
+/* Share of the second endpoint in 64ths, by index size. */
+static const unsigned char bc7Weights2[4] = {0, 21, 43, 64};
+static const unsigned char bc7Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const unsigned char bc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static inline int bc7Blend(int first, int second, int weight){
+	return ((64 - weight) * first + weight * second + 32) >> 6;
+}
+
+/* Mode 6 endpoints are 7 bits per channel and a shared low bit. */
+struct Mode6Fit {
+	int endpoints[2][4];
+	unsigned char indices[16];
+	unsigned int error;
+};
+
+/* Round the endpoints to 7 bits above the given low bits. */
+static void quantizeMode6(const float (*endpoints)[4], const int *low, int (*quantized)[4]){
+	for(int e = 0; e < 2; e++)
+		for(int c = 0; c < 4; c++)
+			quantized[e][c] = clampInt((int) lrintf((endpoints[e][c] - low[e]) / 2), 0, 127) << 1 | low[e];
+}
+
+/* Project each pixel on the line for a first guess, then try the	*/
+/* indices around it since the weights are not evenly spaced.		*/
+static void fitMode6(const unsigned char (*pixels)[4], struct Mode6Fit *fit){
+	int palette[16][4], direction[4], length = 0;
+	for(int c = 0; c < 4; c++){
+		for(int k = 0; k < 16; k++)
+			palette[k][c] = bc7Blend(fit->endpoints[0][c], fit->endpoints[1][c], bc7Weights4[k]);
+		direction[c] = fit->endpoints[1][c] - fit->endpoints[0][c];
+		length += direction[c] * direction[c];
+	}
+
+	fit->error = 0;
+	for(int i = 0; i < 16; i++){
+		int guess = 0;
+		if(length > 0){
+			int dot = 0;
+			for(int c = 0; c < 4; c++)
+				dot += (pixels[i][c] - fit->endpoints[0][c]) * direction[c];
+			guess = clampInt((int) lrintf((float) dot * 15 / length), 0, 15);
+		}
+
+		unsigned int best = ~0u;
+		for(int k = guess > 0 ? guess - 1 : 0; k <= guess + 1 && k < 16; k++){
+			unsigned int error = 0;
+			for(int c = 0; c < 4; c++)
+				error += (unsigned int) ((pixels[i][c] - palette[k][c]) * (pixels[i][c] - palette[k][c]));
+			if(error < best){
+				best = error;
+				fit->indices[i] = (unsigned char) k;
+			}
+		}
+		fit->error += best;
+	}
+}
+
+static void encodeMode6(const unsigned char (*pixels)[4], unsigned char *block){
+	float points[16][4], mean[4], axis[4], endpoints[2][4];
+	for(int i = 0; i < 16; i++)
+		for(int c = 0; c < 4; c++)
+			points[i][c] = pixels[i][c];
+
+	if(principalAxis((const float (*)[4]) points, 16, 4, mean, axis)){
+		float low = 0, high = 0;
+		for(int i = 0; i < 16; i++){
+			float t = 0;
+			for(int c = 0; c < 4; c++)
+				t += (points[i][c] - mean[c]) * axis[c];
+			low = t < low ? t : low;
+			high = t > high ? t : high;
+		}
+		for(int c = 0; c < 4; c++){
+			endpoints[0][c] = mean[c] + axis[c] * low;
+			endpoints[1][c] = mean[c] + axis[c] * high;
+		}
+	} else {
+		memcpy(endpoints[0], mean, sizeof(mean));
+		memcpy(endpoints[1], mean, sizeof(mean));
+	}
+
+	/* The low bits move every channel at once, so try them all. */
+	struct Mode6Fit best = { {{0}}, {0}, ~0u };
+	for(int pass = 0; pass <= REFINE_PASSES; pass++){
+		struct Mode6Fit fit = { {{0}}, {0}, ~0u };
+		for(int bits = 0; bits < 4; bits++){
+			struct Mode6Fit candidate;
+			int low[2] = { bits & 1, bits >> 1 };
+			quantizeMode6((const float (*)[4]) endpoints, low, candidate.endpoints);
+			fitMode6(pixels, &candidate);
+			if(candidate.error < fit.error)
+				fit = candidate;
+		}
+		if(fit.error >= best.error)
+			break;
+		best = fit;
+
+		float weights[16];
+		for(int i = 0; i < 16; i++)
+			weights[i] = bc7Weights4[fit.indices[i]] / 64.0f;
+		if(!leastSquares((const float (*)[4]) points, weights, 4, endpoints))
+			break;
+	}
+
+	/* The first index has no top bit, it is implied to be 0. */
+	if(best.indices[0] & 8){
+		for(int c = 0; c < 4; c++){
+			int swap = best.endpoints[0][c];
+			best.endpoints[0][c] = best.endpoints[1][c];
+			best.endpoints[1][c] = swap;
+		}
+		for(int i = 0; i < 16; i++)
+			best.indices[i] = (unsigned char) (15 - best.indices[i]);
+	}
+
+	struct Bits bits = { block, 0 };
+	memset(block, 0, 16);
+	putBits(&bits, 1 << 6, 7);
+	for(int c = 0; c < 4; c++)
+		for(int e = 0; e < 2; e++)
+			putBits(&bits, (unsigned int) best.endpoints[e][c] >> 1, 7);
+	for(int e = 0; e < 2; e++)
+		putBits(&bits, (unsigned int) best.endpoints[e][0] & 1, 1);
+	for(int i = 0; i < 16; i++)
+		putBits(&bits, best.indices[i], i == 0 ? 3 : 4);
+}
+
+/* Modes 4 to 6, the ones with a single subset. Modes 4 and 5 have	*/
+/* separate colour and alpha indices, and may swap alpha with one of	*/
+/* the colour channels.							*/
+static void decodeBC7(const unsigned char *block, unsigned char (*pixels)[4]){
+	unsigned int mode = 0;
+	while(mode < 8 && !(block[0] & (1 << mode)))
+		mode++;
+	if(mode < 4 || mode > 6){
+		memset(pixels, 0, 16 * 4);
+		return;
+	}
+
+	struct Bits bits = { (unsigned char*) block, mode + 1 };
+	unsigned int rotation = mode == 6 ? 0 : getBits(&bits, 2);
+	unsigned int swapIndices = mode == 4 ? getBits(&bits, 1) : 0;
+	unsigned int colorBits = mode == 4 ? 5 : 7, alphaBits = mode == 4 ? 6 : mode == 5 ? 8 : 7;
+
+	int endpoints[2][4];
+	for(int c = 0; c < 4; c++)
+		for(int e = 0; e < 2; e++)
+			endpoints[e][c] = (int) getBits(&bits, c < 3 ? colorBits : alphaBits);
+	if(mode == 6){
+		for(int e = 0; e < 2; e++){
+			unsigned int low = getBits(&bits, 1);
+			for(int c = 0; c < 4; c++)
+				endpoints[e][c] = endpoints[e][c] << 1 | (int) low;
+		}
+		colorBits = alphaBits = 8;
+	}
+	for(int c = 0; c < 4; c++){
+		int size = (int) (c < 3 ? colorBits : alphaBits);
+		for(int e = 0; e < 2; e++)
+			endpoints[e][c] = endpoints[e][c] << (8 - size) | endpoints[e][c] >> (2 * size - 8);
+	}
+
+	/* Colour indices first, then alpha ones if the mode has them. */
+	unsigned int sizes[2] = { mode == 6 ? 4 : 2, mode == 4 ? 3 : 2 };
+	unsigned char indices[2][16];
+	for(int set = 0; set < (mode == 6 ? 1 : 2); set++)
+		for(int i = 0; i < 16; i++)
+			indices[set][i] = (unsigned char) getBits(&bits, i == 0 ? sizes[set] - 1 : sizes[set]);
+
+	unsigned int colorSet = swapIndices, alphaSet = mode == 6 ? 0 : !swapIndices;
+	const unsigned char *colorWeights = sizes[colorSet] == 4 ? bc7Weights4 : sizes[colorSet] == 3 ? bc7Weights3 : bc7Weights2;
+	const unsigned char *alphaWeights = sizes[alphaSet] == 4 ? bc7Weights4 : sizes[alphaSet] == 3 ? bc7Weights3 : bc7Weights2;
+
+	for(int i = 0; i < 16; i++){
+		for(int c = 0; c < 4; c++){
+			int weight = c < 3 ? colorWeights[indices[colorSet][i]] : alphaWeights[indices[alphaSet][i]];
+			pixels[i][c] = (unsigned char) bc7Blend(endpoints[0][c], endpoints[1][c], weight);
+		}
+		if(rotation){
+			unsigned char swap = pixels[i][3];
+			pixels[i][3] = pixels[i][rotation - 1];
+			pixels[i][rotation - 1] = swap;
+		}
+	}
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+size_t textureCompressedSize(enum BlockFormat format, unsigned int width, unsigned int height){
+	return (size_t) BLOCKS(width) * BLOCKS(height) * BLOCK_BYTES(format);
+}
+
+static void compressRows(void *data, size_t first, size_t last){
+	struct Task *task = data;
+	unsigned int columns = BLOCKS(task->image->width);
+	unsigned char pixels[16][4];
+
+	for(size_t y = first; y < last; y++){
+		unsigned char *block = task->blocks + y * columns * BLOCK_BYTES(task->format);
+		for(unsigned int x = 0; x < columns; x++, block += BLOCK_BYTES(task->format)){
+			loadBlock(task->image, x, (unsigned int) y, pixels);
+			switch(task->format){
+				case BLOCK_BC1: {
+					int transparent = 0;
+					for(int i = 0; i < 16; i++)
+						transparent |= pixels[i][3] < 128;
+					encodeColors((const unsigned char (*)[4]) pixels, transparent, block);
+					break;
+				}
+				case BLOCK_BC3:
+					encodeAlpha((const unsigned char (*)[4]) pixels, block);
+					encodeColors((const unsigned char (*)[4]) pixels, 0, block + 8);
+					break;
+				case BLOCK_BC7: encodeMode6((const unsigned char (*)[4]) pixels, block); break;
+			}
+		}
+	}
+}
+
+static void decompressRows(void *data, size_t first, size_t last){
+	struct Task *task = data;
+	unsigned int columns = BLOCKS(task->width);
+	unsigned char pixels[16][4];
+
+	for(size_t y = first; y < last; y++){
+		const unsigned char *block = task->blocks + y * columns * BLOCK_BYTES(task->format);
+		for(unsigned int x = 0; x < columns; x++, block += BLOCK_BYTES(task->format)){
+			switch(task->format){
+				case BLOCK_BC1: decodeColors(block, 0, pixels); break;
+				case BLOCK_BC3:
+					decodeColors(block + 8, 1, pixels);
+					decodeAlpha(block, pixels);
+					break;
+				case BLOCK_BC7: decodeBC7(block, pixels); break;
+			}
+			storeBlock(task->pixels, task->width, task->height, x, (unsigned int) y,
+				   (const unsigned char (*)[4]) pixels);
+		}
+	}
+}
+
+static void runRows(struct JobSystem *jobs, size_t rows, JobRangeFunction function, struct Task *task){
+	if(jobs == NULL)
+		function(task, 0, rows);
+	else
+		jobParallelFor(jobs, rows, ROW_GRAIN, function, task);
+}
+
+void textureCompress(const struct Image *image, enum BlockFormat format, struct JobSystem *jobs,
+		     void *blocks){
+	struct Task task = { image, blocks, NULL, format, image->width, image->height };
+	runRows(jobs, BLOCKS(image->height), compressRows, &task);
+}
+
+void textureDecompress(const void *blocks, enum BlockFormat format, unsigned int width, unsigned int height,
+		       struct JobSystem *jobs, unsigned char *pixels){
+	struct Task task = { NULL, (unsigned char*) blocks, pixels, format, width, height };
+	runRows(jobs, BLOCKS(height), decompressRows, &task);
+}
@@ -0,0 +1,169 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <texture_file.h>
+#include <texture_compress.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ALIGN(offset)	(((offset) + TEXTURE_FILE_ALIGNMENT - 1) / TEXTURE_FILE_ALIGNMENT * TEXTURE_FILE_ALIGNMENT)
+
+size_t textureFileLevelSize(enum TextureFileFormat format, unsigned int width, unsigned int height){
+	switch(format){
+		case TEXTURE_FILE_RGBA8:
+		case TEXTURE_FILE_SRGB8_ALPHA8: return (size_t) width * height * 4;
+		case TEXTURE_FILE_BC1:
+		case TEXTURE_FILE_BC1_SRGB: return textureCompressedSize(BLOCK_BC1, width, height);
+		case TEXTURE_FILE_BC3:
+		case TEXTURE_FILE_BC3_SRGB: return textureCompressedSize(BLOCK_BC3, width, height);
+		case TEXTURE_FILE_BC7:
+		case TEXTURE_FILE_BC7_SRGB: return textureCompressedSize(BLOCK_BC7, width, height);
+		default: return 0;
+	}
+}
+
+int textureFileIsCompressed(enum TextureFileFormat format){
+	return format >= TEXTURE_FILE_BC1 && format <= TEXTURE_FILE_BC7_SRGB;
+}
+
+int textureFileIsSRGB(enum TextureFileFormat format){
+	return format == TEXTURE_FILE_SRGB8_ALPHA8 || format == TEXTURE_FILE_BC1_SRGB ||
+	       format == TEXTURE_FILE_BC3_SRGB || format == TEXTURE_FILE_BC7_SRGB;
+}
+
+int textureFileWrite(const char *path, enum TextureFileFormat format,
+		     const struct TextureLevel *levels, unsigned int levelCount){
+	if(levelCount == 0 || levelCount > TEXTURE_FILE_MAX_LEVELS){
+		fprintf(stderr, "ERROR: %s: %u levels, at most %d fit.\n", path, levelCount, TEXTURE_FILE_MAX_LEVELS);
+		return -1;
+	}
+
+	struct TextureFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic));
+	header.version = TEXTURE_FILE_VERSION;
+	header.format = format;
+	header.levelCount = levelCount;
+
+	uint64_t offset = ALIGN(sizeof(header));
+	for(unsigned int i = 0; i < levelCount; i++){
+		if(levels[i].size != textureFileLevelSize(format, levels[i].width, levels[i].height)){
+			fprintf(stderr, "ERROR: %s: level %u is the wrong size for its format.\n", path, i);
+			return -1;
+		}
+		header.levels[i] = (struct TextureFileLevel) { levels[i].width, levels[i].height, offset, levels[i].size };
+		offset = ALIGN(offset + levels[i].size);
+	}
+
+	FILE *file = fopen(path, "wb");
+	if(file == NULL){
+		perror(path);
+		return -1;
+	}
+
+	static const unsigned char padding[TEXTURE_FILE_ALIGNMENT];
+	size_t gap = ALIGN(sizeof(header)) - sizeof(header);
+	int failed = fwrite(&header, sizeof(header), 1, file) != 1 ||
+		     fwrite(padding, 1, gap, file) != gap;
+	for(unsigned int i = 0; i < levelCount && !failed; i++){
+		size_t size = levels[i].size;
+		failed = fwrite(levels[i].data, 1, size, file) != size ||
+			 fwrite(padding, 1, ALIGN(size) - size, file) != ALIGN(size) - size;
+	}
+
+	if(fclose(file) != 0 || failed){
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static int checkHeader(const char *path, const struct TextureFile *file){
+	const struct TextureFileHeader *header = file->header;
+	if(file->size < sizeof(*header) || memcmp(header->magic, TEXTURE_FILE_MAGIC, sizeof(header->magic)) != 0){
+		fprintf(stderr, "ERROR: %s is not a texture file.\n", path);
+		return -1;
+	}
+	if(header->version != TEXTURE_FILE_VERSION){
+		fprintf(stderr, "ERROR: %s is version %u, only %d is supported.\n", path, header->version,
+			TEXTURE_FILE_VERSION);
+		return -1;
+	}
+	if(header->levelCount == 0 || header->levelCount > TEXTURE_FILE_MAX_LEVELS){
+		fprintf(stderr, "ERROR: %s has %u levels.\n", path, header->levelCount);
+		return -1;
+	}
+
+	for(unsigned int i = 0; i < header->levelCount; i++){
+		const struct TextureFileLevel *level = &header->levels[i];
+		size_t size = textureFileLevelSize(header->format, level->width, level->height);
+		if(size == 0 || level->size != size || level->offset % TEXTURE_FILE_ALIGNMENT != 0 ||
+		   level->offset > file->size || level->size > file->size - level->offset){
+			fprintf(stderr, "ERROR: %s: level %u is corrupt.\n", path, i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int textureFileOpen(const char *path, struct TextureFile *file){
+	memset(file, 0, sizeof(*file));
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1){
+		perror(path);
+		return -1;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1){
+		perror(path);
+		close(fd);
+		return -1;
+	}
+	if((size_t) info.st_size < sizeof(struct TextureFileHeader)){
+		fprintf(stderr, "ERROR: %s is not a texture file.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED){
+		perror(path);
+		return -1;
+	}
+
+	file->data = data;
+	file->header = data;
+	file->size = (size_t) info.st_size;
+	if(checkHeader(path, file) == -1){
+		textureFileClose(file);
+		return -1;
+	}
+	return 0;
+}
+
+void textureFileClose(struct TextureFile *file){
+	if(file->data != NULL)
+		munmap((void *) file->data, file->size);
+	memset(file, 0, sizeof(*file));
+}
@@ -0,0 +1,520 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <texture_loader.h>
+#include <fence.h>
+#include <texture_compress.h>
+#include <texture_file.h>
+#include <trace.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+/* Pixel unpack buffers the upload thread cycles through. While the GPU	*/
+/* still copies out of one, the next texture is written into another.	*/
+#define UPLOAD_BUFFERS	3
+
+struct LoadJob {
+	struct LoadJob *next;
+	char *path;
+	unsigned int flags;
+	void *user;
+
+	/* Decoded from an image, or mapped from a texture file. */
+	struct Image image;
+	struct TextureFile file;
+
+	/* What to upload, pointing into one of the above, or into	*/
+	/* decompressed if the driver lacks the file's block format.	*/
+	struct TextureLevel levels[TEXTURE_FILE_MAX_LEVELS];
+	unsigned int levelCount;
+	GLenum internalFormat;
+	int compressed;
+	unsigned char *decompressed;
+
+	unsigned int texture;
+	GLsync fence;
+	int failed;
+};
+
+struct JobQueue {
+	struct LoadJob *head;
+	struct LoadJob *tail;
+};
+
+struct UploadBuffer {
+	unsigned int name;
+	size_t size;
+	GLsync fence;		/* Last copy out of the buffer. */
+};
+
+struct TextureLoader {
+	GLFWwindow *context;
+
+	pthread_t *decodeThreads;
+	unsigned int decodeCount;
+	pthread_t uploadThread;
+
+	/* One lock for all the queues, jobs only move a few times per texture. */
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	struct JobQueue requested;
+	struct JobQueue decoded;
+	struct JobQueue uploaded;
+	size_t pending;
+	int stopping;
+
+	/* Only touched by the upload thread. */
+	struct UploadBuffer buffers[UPLOAD_BUFFERS];
+	unsigned int nextBuffer;
+};
+
+static void pushJob(struct JobQueue *queue, struct LoadJob *job){
+	job->next = NULL;
+	if(queue->tail)
+		queue->tail->next = job;
+	else
+		queue->head = job;
+	queue->tail = job;
+}
+
+static struct LoadJob *popJob(struct JobQueue *queue){
+	struct LoadJob *job = queue->head;
+	if(job){
+		queue->head = job->next;
+		if(queue->head == NULL)
+			queue->tail = NULL;
+	}
+	return job;
+}
+
+static void freeJob(struct LoadJob *job){
+	free(job->path);
+	imageFree(&job->image);
+	textureFileClose(&job->file);
+	free(job->decompressed);
+	free(job);
+}
+
+/* Block until the queue has a job. Returns NULL once the loader is stopping. */
+static struct LoadJob *waitJob(struct TextureLoader *loader, struct JobQueue *queue){
+	struct LoadJob *job = NULL;
+	int stopping;
+
+	pthread_mutex_lock(&loader->lock);
+	while(!loader->stopping && (job = popJob(queue)) == NULL)
+		pthread_cond_wait(&loader->changed, &loader->lock);
+	stopping = loader->stopping;
+	pthread_mutex_unlock(&loader->lock);
+
+	if(stopping && job != NULL){
+		freeJob(job);
+		job = NULL;
+	}
+	return job;
+}
+
+static void stopThreads(struct TextureLoader *loader){
+	pthread_mutex_lock(&loader->lock);
+	loader->stopping = 1;
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+static void passJob(struct TextureLoader *loader, struct JobQueue *queue, struct LoadJob *job){
+	pthread_mutex_lock(&loader->lock);
+	pushJob(queue, job);
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/* ------------------------------------STAGES--------------------------------- */
+
+/* GL's name for a file format, 0 if the driver cannot take it. The	*/
+/* decode threads ask too, the extension flags never change once	*/
+/* gladLoadGLLoader() has set them.					*/
+static GLenum internalFormat(enum TextureFileFormat format, int srgb){
+	int s3tc = GLAD_GL_EXT_texture_compression_s3tc && (!srgb || GLAD_GL_EXT_texture_sRGB);
+	switch(format){
+		case TEXTURE_FILE_RGBA8:
+		case TEXTURE_FILE_SRGB8_ALPHA8: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		case TEXTURE_FILE_BC1:
+		case TEXTURE_FILE_BC1_SRGB:
+			if(!s3tc)
+				return 0;
+			return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		case TEXTURE_FILE_BC3:
+		case TEXTURE_FILE_BC3_SRGB:
+			if(!s3tc)
+				return 0;
+			return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case TEXTURE_FILE_BC7:
+		case TEXTURE_FILE_BC7_SRGB:
+			if(!GLAD_GL_ARB_texture_compression_bptc)
+				return 0;
+			return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB : GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+		default: return 0;
+	}
+}
+
+/* Decode every level into one buffer and upload that instead. Slower	*/
+/* to load and four to eight times the memory, but it still works.	*/
+static int decompressLevels(struct LoadJob *job, enum TextureFileFormat format){
+	enum BlockFormat block = format <= TEXTURE_FILE_BC1_SRGB ? BLOCK_BC1 :
+				 format <= TEXTURE_FILE_BC3_SRGB ? BLOCK_BC3 : BLOCK_BC7;
+
+	size_t size = 0;
+	for(unsigned int i = 0; i < job->levelCount; i++)
+		size += (size_t) job->levels[i].width * job->levels[i].height * 4;
+	job->decompressed = malloc(size);
+	if(job->decompressed == NULL){
+		fprintf(stderr, "ERROR: Out of memory decompressing %s.\n", job->path);
+		return -1;
+	}
+
+	unsigned char *pixels = job->decompressed;
+	for(unsigned int i = 0; i < job->levelCount; i++){
+		struct TextureLevel *level = &job->levels[i];
+		textureDecompress(level->data, block, level->width, level->height, NULL, pixels);
+		level->data = pixels;
+		level->size = (size_t) level->width * level->height * 4;
+		pixels += level->size;
+	}
+	textureFileClose(&job->file);
+	return 0;
+}
+
+static int openTextureFile(struct LoadJob *job){
+	if(textureFileOpen(job->path, &job->file) == -1)
+		return -1;
+
+	const struct TextureFileHeader *header = job->file.header;
+	job->image.width = header->levels[0].width;
+	job->image.height = header->levels[0].height;
+	job->levelCount = header->levelCount;
+	for(unsigned int i = 0; i < header->levelCount; i++)
+		job->levels[i] = (struct TextureLevel) { header->levels[i].width, header->levels[i].height,
+							 textureFileLevelData(&job->file, i), header->levels[i].size };
+
+	int srgb = (job->flags & TEXTURE_LOAD_SRGB) || textureFileIsSRGB(header->format);
+	job->internalFormat = internalFormat(header->format, srgb);
+	job->compressed = textureFileIsCompressed(header->format);
+	if(job->internalFormat == 0 && job->compressed){
+		job->internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		job->compressed = 0;
+		return decompressLevels(job, header->format);
+	}
+	if(job->internalFormat == 0){
+		fprintf(stderr, "ERROR: %s has an unknown format.\n", job->path);
+		return -1;
+	}
+	return 0;
+}
+
+static int importImage(struct LoadJob *job){
+	if(imageImportFile(job->path, &job->image) == -1)
+		return -1;
+
+	job->levelCount = 1;
+	job->levels[0] = (struct TextureLevel) { job->image.width, job->image.height, job->image.pixels,
+						 IMAGE_SIZE(&job->image) };
+	job->internalFormat = job->flags & TEXTURE_LOAD_SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	return 0;
+}
+
+static void *decodeMain(void *arg){
+	struct TextureLoader *loader = arg;
+	struct LoadJob *job;
+
+	TRACE_THREAD_NAME("texture loader decode");
+	while((job = waitJob(loader, &loader->requested)) != NULL){
+		TRACE_BEGIN("decode");
+		const char *extension = strrchr(job->path, '.');
+		if(extension && strcasecmp(extension, TEXTURE_FILE_EXTENSION) == 0)
+			job->failed = openTextureFile(job) == -1;
+		else
+			job->failed = importImage(job) == -1;
+		TRACE_END();
+		passJob(loader, &loader->decoded, job);
+	}
+	return NULL;
+}
+
+/* Fill the next unpack buffer with the levels and leave it bound. Each	*/
+/* level starts on an aligned offset, returned in offsets.		*/
+static void stageLevels(struct TextureLoader *loader, const struct TextureLevel *levels, unsigned int count,
+			size_t *offsets){
+	struct UploadBuffer *buffer = &loader->buffers[loader->nextBuffer];
+	loader->nextBuffer = (loader->nextBuffer + 1) % UPLOAD_BUFFERS;
+
+	size_t size = 0;
+	for(unsigned int i = 0; i < count; i++){
+		offsets[i] = size;
+		size += (levels[i].size + TEXTURE_FILE_ALIGNMENT - 1) / TEXTURE_FILE_ALIGNMENT * TEXTURE_FILE_ALIGNMENT;
+	}
+
+	/* Only stalls if the GPU is UPLOAD_BUFFERS textures behind. */
+	if(buffer->fence){
+		fenceWait(buffer->fence);
+		glDeleteSync(buffer->fence);
+		buffer->fence = NULL;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->name);
+	if(size > buffer->size){
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) size, NULL, GL_STREAM_DRAW);
+		buffer->size = size;
+	}
+
+	unsigned char *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) size,
+						 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if(mapped != NULL){
+		for(unsigned int i = 0; i < count; i++)
+			memcpy(mapped + offsets[i], levels[i].data, levels[i].size);
+		if(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+			return;
+	}
+	/* The mapping failed or its contents were lost, copy through GL instead. */
+	for(unsigned int i = 0; i < count; i++)
+		glBufferSubData(GL_PIXEL_UNPACK_BUFFER, (GLintptr) offsets[i], (GLsizeiptr) levels[i].size, levels[i].data);
+}
+
+static void uploadTexture(struct TextureLoader *loader, struct LoadJob *job){
+	const struct TextureLevel *levels = job->levels;
+	unsigned int count = job->levelCount;
+
+	size_t offsets[TEXTURE_FILE_MAX_LEVELS];
+	stageLevels(loader, levels, count, offsets);
+
+	/* A file's own levels win over generating them, and GL cannot	*/
+	/* generate them for block formats anyway.				*/
+	int generate = count == 1 && !job->compressed && (job->flags & TEXTURE_LOAD_MIPMAPS);
+	glGenTextures(1, &job->texture);
+	glBindTexture(GL_TEXTURE_2D, job->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, count > 1 || generate ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if(!generate)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) count - 1);
+
+	/* With an unpack buffer bound the pointer is an offset into it. */
+	for(unsigned int i = 0; i < count; i++){
+		if(job->compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) i, job->internalFormat, (GLsizei) levels[i].width,
+					       (GLsizei) levels[i].height, 0, (GLsizei) levels[i].size, (void*) offsets[i]);
+		else
+			glTexImage2D(GL_TEXTURE_2D, (GLint) i, (GLint) job->internalFormat, (GLsizei) levels[i].width,
+				     (GLsizei) levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*) offsets[i]);
+	}
+	if(generate)
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	/* The flush makes sure the fences actually reach the GPU, the	*/
+	/* render thread only ever polls them.				*/
+	if(GLAD_GL_ARB_sync){
+		job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		struct UploadBuffer *buffer = &loader->buffers[(loader->nextBuffer + UPLOAD_BUFFERS - 1) % UPLOAD_BUFFERS];
+		buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	} else {
+		glFinish();
+	}
+}
+
+static void *uploadMain(void *arg){
+	struct TextureLoader *loader = arg;
+	struct LoadJob *job;
+
+	TRACE_THREAD_NAME("texture loader upload");
+	glfwMakeContextCurrent(loader->context);
+	for(int i = 0; i < UPLOAD_BUFFERS; i++)
+		glGenBuffers(1, &loader->buffers[i].name);
+
+	while((job = waitJob(loader, &loader->decoded)) != NULL){
+		if(!job->failed){
+			TRACE_BEGIN("upload");
+			uploadTexture(loader, job);
+			/* The size is still needed by textureLoaderPoll(). */
+			free(job->image.pixels);
+			job->image.pixels = NULL;
+			free(job->decompressed);
+			job->decompressed = NULL;
+			textureFileClose(&job->file);
+			TRACE_END();
+		}
+		passJob(loader, &loader->uploaded, job);
+	}
+
+	for(int i = 0; i < UPLOAD_BUFFERS; i++){
+		if(loader->buffers[i].fence)
+			glDeleteSync(loader->buffers[i].fence);
+		glDeleteBuffers(1, &loader->buffers[i].name);
+	}
+	glfwMakeContextCurrent(NULL);
+	return NULL;
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+struct TextureLoader *textureLoaderCreate(GLFWwindow *window, unsigned int threads){
+	if(threads == 0){
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 1 ? (unsigned int) online / 2 : 1;
+	}
+
+	struct TextureLoader *loader = calloc(1, sizeof(*loader));
+	if(loader == NULL || (loader->decodeThreads = calloc(threads, sizeof(pthread_t))) == NULL){
+		free(loader);
+		return NULL;
+	}
+
+	/* Same hints as the window, so the contexts are compatible, but hidden. */
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	loader->context = glfwCreateWindow(1, 1, "Texture loader", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if(loader->context == NULL){
+		fprintf(stderr, "ERROR: Failed to create the texture loader context.\n");
+		free(loader->decodeThreads);
+		free(loader);
+		return NULL;
+	}
+
+	pthread_mutex_init(&loader->lock, NULL);
+	pthread_cond_init(&loader->changed, NULL);
+
+	for(; loader->decodeCount < threads; loader->decodeCount++){
+		if(pthread_create(&loader->decodeThreads[loader->decodeCount], NULL, decodeMain, loader) != 0){
+			perror("Failed to start a texture decode thread");
+			goto fail;
+		}
+	}
+	if(pthread_create(&loader->uploadThread, NULL, uploadMain, loader) != 0){
+		perror("Failed to start the texture upload thread");
+		goto fail;
+	}
+
+	return loader;
+
+fail:
+	stopThreads(loader);
+	for(unsigned int i = 0; i < loader->decodeCount; i++)
+		pthread_join(loader->decodeThreads[i], NULL);
+	pthread_cond_destroy(&loader->changed);
+	pthread_mutex_destroy(&loader->lock);
+	glfwDestroyWindow(loader->context);
+	free(loader->decodeThreads);
+	free(loader);
+	return NULL;
+}
+
+int textureLoaderRequest(struct TextureLoader *loader, const char *path, unsigned int flags, void *user){
+	struct LoadJob *job = calloc(1, sizeof(*job));
+	if(job == NULL || (job->path = strdup(path)) == NULL){
+		free(job);
+		return -1;
+	}
+	job->flags = flags;
+	job->user = user;
+
+	pthread_mutex_lock(&loader->lock);
+	if(loader->stopping){
+		pthread_mutex_unlock(&loader->lock);
+		freeJob(job);
+		return -1;
+	}
+	pushJob(&loader->requested, job);
+	loader->pending++;
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+	return 0;
+}
+
+int textureLoaderPoll(struct TextureLoader *loader, struct LoadedTexture *texture){
+	struct LoadJob *job, *previous = NULL;
+
+	pthread_mutex_lock(&loader->lock);
+	for(job = loader->uploaded.head; job; previous = job, job = job->next){
+		if(job->failed || fenceSignaled(job->fence))
+			break;
+	}
+	if(job){
+		if(previous)
+			previous->next = job->next;
+		else
+			loader->uploaded.head = job->next;
+		if(loader->uploaded.tail == job)
+			loader->uploaded.tail = previous;
+		loader->pending--;
+	}
+	pthread_mutex_unlock(&loader->lock);
+
+	if(job == NULL)
+		return 0;
+
+	memset(texture, 0, sizeof(*texture));
+	texture->user = job->user;
+	texture->failed = job->failed;
+	if(!job->failed){
+		texture->texture = job->texture;
+		texture->width = job->image.width;
+		texture->height = job->image.height;
+	}
+
+	if(job->fence)
+		glDeleteSync(job->fence);
+	freeJob(job);
+	return 1;
+}
+
+size_t textureLoaderPending(struct TextureLoader *loader){
+	pthread_mutex_lock(&loader->lock);
+	size_t pending = loader->pending;
+	pthread_mutex_unlock(&loader->lock);
+	return pending;
+}
+
+void textureLoaderDestroy(struct TextureLoader *loader){
+	stopThreads(loader);
+
+	for(unsigned int i = 0; i < loader->decodeCount; i++)
+		pthread_join(loader->decodeThreads[i], NULL);
+	pthread_join(loader->uploadThread, NULL);
+
+	struct JobQueue *queues[] = { &loader->requested, &loader->decoded, &loader->uploaded };
+	for(size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++){
+		struct LoadJob *job;
+		while((job = popJob(queues[i])) != NULL){
+			/* Textures are shared, so they can go from this context. */
+			if(job->texture)
+				glDeleteTextures(1, &job->texture);
+			if(job->fence)
+				glDeleteSync(job->fence);
+			freeJob(job);
+		}
+	}
+
+	glfwDestroyWindow(loader->context);
+	pthread_cond_destroy(&loader->changed);
+	pthread_mutex_destroy(&loader->lock);
+	free(loader->decodeThreads);
+	free(loader);
+}
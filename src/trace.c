@@ -0,0 +1,265 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <trace.h>
+#include <timer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Thread ids below this are left for the TRACE_TRACK_ pseudo threads. */
+#define FIRST_THREAD	16
+
+struct TraceEvent {
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+	unsigned int track;		/* 0 for the thread itself. */
+};
+
+struct TraceBuffer {
+	struct TraceBuffer *next;
+	unsigned int thread;
+	const char *threadName;
+
+	struct TraceEvent events[TRACE_BUFFER_EVENTS];
+	size_t written;
+
+	/* Scopes begun and not ended yet. */
+	const char *names[TRACE_MAX_DEPTH];
+	uint64_t starts[TRACE_MAX_DEPTH];
+	unsigned int depth;
+
+	int exited;			/* Its thread is gone, free once written. */
+};
+
+_Atomic int traceActive = 0;
+
+static pthread_mutex_t buffersLock = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceBuffer *buffers;
+static unsigned int nextThread = FIRST_THREAD;
+static const char *tracePath;
+static uint64_t traceStartTime;
+
+static pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t exitKey;
+static int exitKeyCreated;
+
+static _Thread_local struct TraceBuffer *threadBuffer;
+static _Thread_local const char *threadName;
+
+/* Called with buffersLock held. */
+static void unlinkBuffer(struct TraceBuffer *buffer){
+	struct TraceBuffer **link = &buffers;
+	while(*link != buffer)
+		link = &(*link)->next;
+	*link = buffer->next;
+	free(buffer);
+}
+
+/* At thread exit. While recording the events still have to be written,	*/
+/* so traceStop() frees the buffer after that; otherwise it goes now.	*/
+static void releaseBuffer(void *data){
+	struct TraceBuffer *buffer = data;
+	threadBuffer = NULL;
+
+	pthread_mutex_lock(&buffersLock);
+	if(traceActive)
+		buffer->exited = 1;
+	else
+		unlinkBuffer(buffer);
+	pthread_mutex_unlock(&buffersLock);
+}
+
+static void createExitKey(void){
+	exitKeyCreated = pthread_key_create(&exitKey, releaseBuffer) == 0;
+}
+
+/* A buffer lives as long as its thread, so one that stops and starts	*/
+/* tracing again keeps it.						*/
+static struct TraceBuffer *getBuffer(void){
+	if(threadBuffer != NULL)
+		return threadBuffer;
+
+	struct TraceBuffer *buffer = calloc(1, sizeof(struct TraceBuffer));
+	if(buffer == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&buffersLock);
+	buffer->thread = nextThread++;
+	buffer->threadName = threadName;
+	buffer->next = buffers;
+	buffers = buffer;
+	pthread_mutex_unlock(&buffersLock);
+
+	/* Without the key the buffer is only freed with the process. */
+	pthread_once(&exitKeyOnce, createExitKey);
+	if(exitKeyCreated)
+		pthread_setspecific(exitKey, buffer);
+
+	threadBuffer = buffer;
+	return buffer;
+}
+
+static void record(struct TraceBuffer *buffer, const char *name, unsigned int track,
+		   uint64_t start, uint64_t duration){
+	struct TraceEvent *event = &buffer->events[buffer->written++ % TRACE_BUFFER_EVENTS];
+	event->name = name;
+	event->start = start;
+	event->duration = duration;
+	event->track = track;
+}
+
+void traceBegin(const char *name){
+	struct TraceBuffer *buffer = getBuffer();
+	if(buffer == NULL || buffer->depth == TRACE_MAX_DEPTH)
+		return;
+
+	buffer->names[buffer->depth] = name;
+	buffer->starts[buffer->depth] = timerNow();
+	buffer->depth++;
+}
+
+/* Scopes are stored whole on end, so the ring never holds half a pair. */
+void traceEnd(void){
+	struct TraceBuffer *buffer = getBuffer();
+	if(buffer == NULL || buffer->depth == 0)
+		return;
+
+	buffer->depth--;
+	uint64_t start = buffer->starts[buffer->depth];
+	record(buffer, buffer->names[buffer->depth], 0, start, timerNow() - start);
+}
+
+/* Only remembered until the thread records something, so threads that	*/
+/* never do while tracing is on never get a buffer.			*/
+void traceThreadName(const char *name){
+	threadName = name;
+	if(threadBuffer != NULL)
+		threadBuffer->threadName = name;
+}
+
+void traceComplete(const char *name, unsigned int track, uint64_t start, uint64_t duration){
+	struct TraceBuffer *buffer = getBuffer();
+	if(buffer != NULL)
+		record(buffer, name, track, start, duration);
+}
+
+int traceStart(const char *path){
+	if(path == NULL)
+		return 0;
+	if(traceActive)
+		return -1;
+
+	pthread_mutex_lock(&buffersLock);
+	for(struct TraceBuffer *buffer = buffers; buffer != NULL; buffer = buffer->next){
+		buffer->written = 0;
+		buffer->depth = 0;
+	}
+	pthread_mutex_unlock(&buffersLock);
+
+	tracePath = path;
+	traceStartTime = timerNow();
+	traceActive = 1;
+	return 0;
+}
+
+/* Names are meant to be literals, but quotes would still break the file. */
+static void writeString(FILE *file, const char *string){
+	fputc('"', file);
+	for(; *string != '\0'; string++){
+		if(*string == '"' || *string == '\\')
+			fputc('\\', file);
+		if((unsigned char) *string >= 0x20)
+			fputc(*string, file);
+	}
+	fputc('"', file);
+}
+
+static void writeThreadName(FILE *file, unsigned int thread, const char *name, int *first){
+	fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+		*first ? "" : ",", thread);
+	writeString(file, name);
+	fprintf(file, "}}");
+	*first = 0;
+}
+
+/* Called with buffersLock held. */
+static int writeTrace(void){
+	FILE *file = fopen(tracePath, "w");
+	if(file == NULL){
+		perror("ERROR: Could not open the trace file");
+		return -1;
+	}
+
+	int first = 1;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	writeThreadName(file, TRACE_TRACK_GPU, "GPU", &first);
+
+	for(struct TraceBuffer *buffer = buffers; buffer != NULL; buffer = buffer->next){
+		if(buffer->written == 0)
+			continue;
+
+		char fallback[32];
+		snprintf(fallback, sizeof(fallback), "thread %u", buffer->thread - FIRST_THREAD);
+		writeThreadName(file, buffer->thread, buffer->threadName ? buffer->threadName : fallback, &first);
+
+		size_t count = buffer->written < TRACE_BUFFER_EVENTS ? buffer->written : TRACE_BUFFER_EVENTS;
+		for(size_t i = buffer->written - count; i < buffer->written; i++){
+			const struct TraceEvent *event = &buffer->events[i % TRACE_BUFFER_EVENTS];
+
+			/* GPU times are read back late and may be from before the start. */
+			if(event->start < traceStartTime)
+				continue;
+
+			fprintf(file, ",\n{\"name\":");
+			writeString(file, event->name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event->track ? event->track : buffer->thread,
+				(event->start - traceStartTime) * 1e-3, event->duration * 1e-3);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	if(fclose(file) != 0){
+		perror("ERROR: Could not write the trace file");
+		return -1;
+	}
+	return 0;
+}
+
+int traceStop(void){
+	if(!traceActive)
+		return 0;
+
+	/* Under the lock, so a thread exiting meanwhile either still sees	*/
+	/* tracing on and leaves its buffer to be written and freed here, or	*/
+	/* sees it off and frees the buffer itself.				*/
+	pthread_mutex_lock(&buffersLock);
+	traceActive = 0;
+	int status = writeTrace();
+
+	struct TraceBuffer **link = &buffers;
+	while(*link != NULL){
+		if((*link)->exited)
+			unlinkBuffer(*link);
+		else
+			link = &(*link)->next;
+	}
+	pthread_mutex_unlock(&buffersLock);
+	return status;
+}
@@ -0,0 +1,534 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <vecmath.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MATH_X86 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATH_NEON 1
+#endif
+
+/* ----------------------------------MATRICES--------------------------------- */
+
+void mat4Identity(struct Mat4 *out){
+	memset(out, 0, sizeof(*out));
+	out->m[0] = out->m[5] = out->m[10] = out->m[15] = 1.0f;
+}
+
+void mat4Multiply(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b){
+	mathMultiplyMatrices(out, a, b, 1);
+}
+
+/* The 16 values of translation * rotation * scale. The vector paths	*/
+/* compute the same expressions a register at a time.			*/
+static void composeScalar(float *m, float tx, float ty, float tz, float qx, float qy, float qz, float qw,
+			  float sx, float sy, float sz){
+	float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+	m[0] = (1.0f - 2.0f * (yy + zz)) * sx;
+	m[1] = 2.0f * (xy + wz) * sx;
+	m[2] = 2.0f * (xz - wy) * sx;
+	m[3] = 0.0f;
+	m[4] = 2.0f * (xy - wz) * sy;
+	m[5] = (1.0f - 2.0f * (xx + zz)) * sy;
+	m[6] = 2.0f * (yz + wx) * sy;
+	m[7] = 0.0f;
+	m[8] = 2.0f * (xz + wy) * sz;
+	m[9] = 2.0f * (yz - wx) * sz;
+	m[10] = (1.0f - 2.0f * (xx + yy)) * sz;
+	m[11] = 0.0f;
+	m[12] = tx;
+	m[13] = ty;
+	m[14] = tz;
+	m[15] = 1.0f;
+}
+
+void mat4FromTRS(struct Mat4 *out, struct Vec3 translation, struct Quat rotation, struct Vec3 scale){
+	composeScalar(out->m, translation.x, translation.y, translation.z,
+		      rotation.x, rotation.y, rotation.z, rotation.w, scale.x, scale.y, scale.z);
+}
+
+void mat4Perspective(struct Mat4 *out, float fovy, float aspect, float near, float far){
+	float f = 1.0f / tanf(fovy * 0.5f);
+	memset(out, 0, sizeof(*out));
+	out->m[0] = f / aspect;
+	out->m[5] = f;
+	out->m[10] = (far + near) / (near - far);
+	out->m[11] = -1.0f;
+	out->m[14] = 2.0f * far * near / (near - far);
+}
+
+void mat4LookAt(struct Mat4 *out, struct Vec3 eye, struct Vec3 target, struct Vec3 up){
+	struct Vec3 f = vec3Normalize(vec3Sub(target, eye));
+	struct Vec3 s = vec3Normalize(vec3Cross(f, up));
+	struct Vec3 u = vec3Cross(s, f);
+
+	float *m = out->m;
+	m[0] = s.x;	m[4] = s.y;	m[8] = s.z;	m[12] = -vec3Dot(s, eye);
+	m[1] = u.x;	m[5] = u.y;	m[9] = u.z;	m[13] = -vec3Dot(u, eye);
+	m[2] = -f.x;	m[6] = -f.y;	m[10] = -f.z;	m[14] = vec3Dot(f, eye);
+	m[3] = 0.0f;	m[7] = 0.0f;	m[11] = 0.0f;	m[15] = 1.0f;
+}
+
+void mat4InverseAffine(struct Mat4 *out, const struct Mat4 *in){
+	const float *m = in->m;
+
+	/* Inverse of the upper 3x3 from its cofactors, which handles scales	*/
+	/* that differ per axis, then the translation brought back through it. */
+	float c00 = m[5] * m[10] - m[9] * m[6];
+	float c01 = m[9] * m[2] - m[1] * m[10];
+	float c02 = m[1] * m[6] - m[5] * m[2];
+	float determinant = m[0] * c00 + m[4] * c01 + m[8] * c02;
+	float d = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+	struct Mat4 r;
+	r.m[0] = c00 * d;
+	r.m[1] = c01 * d;
+	r.m[2] = c02 * d;
+	r.m[4] = (m[8] * m[6] - m[4] * m[10]) * d;
+	r.m[5] = (m[0] * m[10] - m[8] * m[2]) * d;
+	r.m[6] = (m[4] * m[2] - m[0] * m[6]) * d;
+	r.m[8] = (m[4] * m[9] - m[8] * m[5]) * d;
+	r.m[9] = (m[8] * m[1] - m[0] * m[9]) * d;
+	r.m[10] = (m[0] * m[5] - m[4] * m[1]) * d;
+	r.m[3] = r.m[7] = r.m[11] = 0.0f;
+
+	for(int row = 0; row < 3; row++)
+		r.m[12 + row] = -(r.m[row] * m[12] + r.m[4 + row] * m[13] + r.m[8 + row] * m[14]);
+	r.m[15] = 1.0f;
+	*out = r;
+}
+
+struct Vec4 mat4Transform(const struct Mat4 *matrix, struct Vec4 v){
+	const float *m = matrix->m;
+	return vec4(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+		    m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+		    m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+		    m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w);
+}
+
+struct Vec3 mat4TransformPoint(const struct Mat4 *matrix, struct Vec3 p){
+	const float *m = matrix->m;
+	return vec3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+		    m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+		    m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+}
+
+/* -----------------------------------SCALAR---------------------------------- */
+
+/* The vector paths finish their last few items with these. */
+
+static void transformScalar(const float *m, const float *const in[3], float *const out[3], size_t first, size_t count){
+	for(size_t i = first; i < count; i++){
+		float x = in[0][i], y = in[1][i], z = in[2][i];
+		out[0][i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+		out[1][i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+		out[2][i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+	}
+}
+
+static void multiplyScalar(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t first, size_t count){
+	for(size_t i = first; i < count; i++){
+		float r[16];
+		for(int column = 0; column < 4; column++){
+			for(int row = 0; row < 4; row++){
+				r[4 * column + row] = a[i].m[row] * b[i].m[4 * column]
+						    + a[i].m[4 + row] * b[i].m[4 * column + 1]
+						    + a[i].m[8 + row] * b[i].m[4 * column + 2]
+						    + a[i].m[12 + row] * b[i].m[4 * column + 3];
+			}
+		}
+		memcpy(out[i].m, r, sizeof(r));
+	}
+}
+
+static void composeRange(struct Mat4 *out, const struct TRSArrays *t, size_t first, size_t count){
+	for(size_t i = first; i < count; i++){
+		composeScalar(out[i].m, t->translation[0][i], t->translation[1][i], t->translation[2][i],
+			      t->rotation[0][i], t->rotation[1][i], t->rotation[2][i], t->rotation[3][i],
+			      t->scale[0][i], t->scale[1][i], t->scale[2][i]);
+	}
+}
+
+/* ------------------------------------SSE------------------------------------ */
+
+/* Arrays come from the caller, so every load and store is unaligned. */
+
+#ifdef MATH_X86
+
+__attribute__((target("sse2")))
+static void transformSSE(const float *m, const float *const in[3], float *const out[3], size_t count){
+	__m128 c[12];
+	for(int k = 0; k < 12; k++)
+		c[k] = _mm_set1_ps(m[(k / 3) * 4 + k % 3]);
+
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4){
+		__m128 x = _mm_loadu_ps(in[0] + i);
+		__m128 y = _mm_loadu_ps(in[1] + i);
+		__m128 z = _mm_loadu_ps(in[2] + i);
+		for(int row = 0; row < 3; row++){
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[row], x), _mm_mul_ps(c[3 + row], y)),
+					      _mm_add_ps(_mm_mul_ps(c[6 + row], z), c[9 + row]));
+			_mm_storeu_ps(out[row] + i, r);
+		}
+	}
+	transformScalar(m, in, out, i, count);
+}
+
+__attribute__((target("sse2")))
+static void multiplySSE(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count){
+	for(size_t i = 0; i < count; i++){
+		__m128 a0 = _mm_load_ps(a[i].m);
+		__m128 a1 = _mm_load_ps(a[i].m + 4);
+		__m128 a2 = _mm_load_ps(a[i].m + 8);
+		__m128 a3 = _mm_load_ps(a[i].m + 12);
+
+		/* A column of b is only read before the same column of out is written. */
+		for(int column = 0; column < 4; column++){
+			__m128 bc = _mm_load_ps(b[i].m + 4 * column);
+			__m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00)), _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55))),
+				_mm_add_ps(_mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xAA)), _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xFF))));
+			_mm_store_ps(out[i].m + 4 * column, r);
+		}
+	}
+}
+
+__attribute__((target("sse2")))
+static void composeSSE(struct Mat4 *out, const struct TRSArrays *t, size_t count){
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4){
+		__m128 qx = _mm_loadu_ps(t->rotation[0] + i), qy = _mm_loadu_ps(t->rotation[1] + i);
+		__m128 qz = _mm_loadu_ps(t->rotation[2] + i), qw = _mm_loadu_ps(t->rotation[3] + i);
+		__m128 sx = _mm_loadu_ps(t->scale[0] + i), sy = _mm_loadu_ps(t->scale[1] + i);
+		__m128 sz = _mm_loadu_ps(t->scale[2] + i);
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		/* Element k of the matrices of the 4 items. */
+		__m128 e[16];
+		e[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		e[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		e[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		e[3] = zero;
+		e[4] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		e[5] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		e[6] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		e[7] = zero;
+		e[8] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		e[9] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		e[10] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		e[11] = zero;
+		e[12] = _mm_loadu_ps(t->translation[0] + i);
+		e[13] = _mm_loadu_ps(t->translation[1] + i);
+		e[14] = _mm_loadu_ps(t->translation[2] + i);
+		e[15] = one;
+
+		/* Turn each group of 4 elements into a column of each matrix. */
+		for(int column = 0; column < 4; column++){
+			__m128 *c = e + 4 * column;
+			_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+			for(int k = 0; k < 4; k++)
+				_mm_store_ps(out[i + k].m + 4 * column, c[k]);
+		}
+	}
+	composeRange(out, t, i, count);
+}
+
+/* ------------------------------------AVX2----------------------------------- */
+
+__attribute__((target("avx2,fma")))
+static void transformAVX2(const float *m, const float *const in[3], float *const out[3], size_t count){
+	__m256 c[12];
+	for(int k = 0; k < 12; k++)
+		c[k] = _mm256_set1_ps(m[(k / 3) * 4 + k % 3]);
+
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8){
+		__m256 x = _mm256_loadu_ps(in[0] + i);
+		__m256 y = _mm256_loadu_ps(in[1] + i);
+		__m256 z = _mm256_loadu_ps(in[2] + i);
+		for(int row = 0; row < 3; row++){
+			__m256 r = _mm256_fmadd_ps(c[row], x, _mm256_fmadd_ps(c[3 + row], y, _mm256_fmadd_ps(c[6 + row], z, c[9 + row])));
+			_mm256_storeu_ps(out[row] + i, r);
+		}
+	}
+	transformScalar(m, in, out, i, count);
+}
+
+__attribute__((target("avx2,fma")))
+static void multiplyAVX2(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count){
+	for(size_t i = 0; i < count; i++){
+		/* Each column of a in both halves, two columns of out at a time. */
+		__m256 a0 = _mm256_broadcast_ps((const __m128 *) a[i].m);
+		__m256 a1 = _mm256_broadcast_ps((const __m128 *) (a[i].m + 4));
+		__m256 a2 = _mm256_broadcast_ps((const __m128 *) (a[i].m + 8));
+		__m256 a3 = _mm256_broadcast_ps((const __m128 *) (a[i].m + 12));
+
+		__m256 b01 = _mm256_loadu_ps(b[i].m);
+		__m256 b23 = _mm256_loadu_ps(b[i].m + 8);
+		__m256 r01 = _mm256_fmadd_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00),
+			     _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55),
+			     _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA),
+			     _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)))));
+		__m256 r23 = _mm256_fmadd_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00),
+			     _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55),
+			     _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA),
+			     _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF)))));
+		_mm256_storeu_ps(out[i].m, r01);
+		_mm256_storeu_ps(out[i].m + 8, r23);
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void composeAVX2(struct Mat4 *out, const struct TRSArrays *t, size_t count){
+	const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8){
+		__m256 qx = _mm256_loadu_ps(t->rotation[0] + i), qy = _mm256_loadu_ps(t->rotation[1] + i);
+		__m256 qz = _mm256_loadu_ps(t->rotation[2] + i), qw = _mm256_loadu_ps(t->rotation[3] + i);
+		__m256 sx = _mm256_loadu_ps(t->scale[0] + i), sy = _mm256_loadu_ps(t->scale[1] + i);
+		__m256 sz = _mm256_loadu_ps(t->scale[2] + i);
+
+		__m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+		__m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+		__m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+
+		__m256 e[16];
+		e[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+		e[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+		e[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+		e[3] = zero;
+		e[4] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+		e[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+		e[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+		e[7] = zero;
+		e[8] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+		e[9] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+		e[10] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+		e[11] = zero;
+		e[12] = _mm256_loadu_ps(t->translation[0] + i);
+		e[13] = _mm256_loadu_ps(t->translation[1] + i);
+		e[14] = _mm256_loadu_ps(t->translation[2] + i);
+		e[15] = one;
+
+		/* A 4x4 transpose in each half: items 0 to 3 end up in the low	*/
+		/* halves, 4 to 7 in the high ones.				*/
+		for(int column = 0; column < 4; column++){
+			__m256 *c = e + 4 * column;
+			__m256 t0 = _mm256_unpacklo_ps(c[0], c[1]), t1 = _mm256_unpackhi_ps(c[0], c[1]);
+			__m256 t2 = _mm256_unpacklo_ps(c[2], c[3]), t3 = _mm256_unpackhi_ps(c[2], c[3]);
+			__m256 r[4] = {
+				_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+				_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+				_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+				_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2))
+			};
+			for(int k = 0; k < 4; k++){
+				_mm_store_ps(out[i + k].m + 4 * column, _mm256_castps256_ps128(r[k]));
+				_mm_store_ps(out[i + 4 + k].m + 4 * column, _mm256_extractf128_ps(r[k], 1));
+			}
+		}
+	}
+	composeRange(out, t, i, count);
+}
+
+#endif
+
+/* ------------------------------------NEON----------------------------------- */
+
+#ifdef MATH_NEON
+
+static void transformNEON(const float *m, const float *const in[3], float *const out[3], size_t count){
+	float32x4_t c[12];
+	for(int k = 0; k < 12; k++)
+		c[k] = vdupq_n_f32(m[(k / 3) * 4 + k % 3]);
+
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4){
+		float32x4_t x = vld1q_f32(in[0] + i);
+		float32x4_t y = vld1q_f32(in[1] + i);
+		float32x4_t z = vld1q_f32(in[2] + i);
+		for(int row = 0; row < 3; row++){
+			float32x4_t r = vfmaq_f32(vfmaq_f32(vfmaq_f32(c[9 + row], c[6 + row], z), c[3 + row], y), c[row], x);
+			vst1q_f32(out[row] + i, r);
+		}
+	}
+	transformScalar(m, in, out, i, count);
+}
+
+static void multiplyNEON(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count){
+	for(size_t i = 0; i < count; i++){
+		float32x4_t a0 = vld1q_f32(a[i].m);
+		float32x4_t a1 = vld1q_f32(a[i].m + 4);
+		float32x4_t a2 = vld1q_f32(a[i].m + 8);
+		float32x4_t a3 = vld1q_f32(a[i].m + 12);
+
+		for(int column = 0; column < 4; column++){
+			float32x4_t bc = vld1q_f32(b[i].m + 4 * column);
+			float32x4_t r = vmulq_laneq_f32(a0, bc, 0);
+			r = vfmaq_laneq_f32(r, a1, bc, 1);
+			r = vfmaq_laneq_f32(r, a2, bc, 2);
+			r = vfmaq_laneq_f32(r, a3, bc, 3);
+			vst1q_f32(out[i].m + 4 * column, r);
+		}
+	}
+}
+
+static void composeNEON(struct Mat4 *out, const struct TRSArrays *t, size_t count){
+	const float32x4_t one = vdupq_n_f32(1.0f), two = vdupq_n_f32(2.0f), zero = vdupq_n_f32(0.0f);
+
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4){
+		float32x4_t qx = vld1q_f32(t->rotation[0] + i), qy = vld1q_f32(t->rotation[1] + i);
+		float32x4_t qz = vld1q_f32(t->rotation[2] + i), qw = vld1q_f32(t->rotation[3] + i);
+		float32x4_t sx = vld1q_f32(t->scale[0] + i), sy = vld1q_f32(t->scale[1] + i);
+		float32x4_t sz = vld1q_f32(t->scale[2] + i);
+
+		float32x4_t xx = vmulq_f32(qx, qx), yy = vmulq_f32(qy, qy), zz = vmulq_f32(qz, qz);
+		float32x4_t xy = vmulq_f32(qx, qy), xz = vmulq_f32(qx, qz), yz = vmulq_f32(qy, qz);
+		float32x4_t wx = vmulq_f32(qw, qx), wy = vmulq_f32(qw, qy), wz = vmulq_f32(qw, qz);
+
+		float32x4_t e[16];
+		e[0] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(yy, zz))), sx);
+		e[1] = vmulq_f32(vmulq_f32(two, vaddq_f32(xy, wz)), sx);
+		e[2] = vmulq_f32(vmulq_f32(two, vsubq_f32(xz, wy)), sx);
+		e[3] = zero;
+		e[4] = vmulq_f32(vmulq_f32(two, vsubq_f32(xy, wz)), sy);
+		e[5] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, zz))), sy);
+		e[6] = vmulq_f32(vmulq_f32(two, vaddq_f32(yz, wx)), sy);
+		e[7] = zero;
+		e[8] = vmulq_f32(vmulq_f32(two, vaddq_f32(xz, wy)), sz);
+		e[9] = vmulq_f32(vmulq_f32(two, vsubq_f32(yz, wx)), sz);
+		e[10] = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, yy))), sz);
+		e[11] = zero;
+		e[12] = vld1q_f32(t->translation[0] + i);
+		e[13] = vld1q_f32(t->translation[1] + i);
+		e[14] = vld1q_f32(t->translation[2] + i);
+		e[15] = one;
+
+		for(int column = 0; column < 4; column++){
+			float32x4_t *c = e + 4 * column;
+			float32x4x2_t t01 = vtrnq_f32(c[0], c[1]);
+			float32x4x2_t t23 = vtrnq_f32(c[2], c[3]);
+			vst1q_f32(out[i].m + 4 * column, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+			vst1q_f32(out[i + 1].m + 4 * column, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+			vst1q_f32(out[i + 2].m + 4 * column, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+			vst1q_f32(out[i + 3].m + 4 * column, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+		}
+	}
+	composeRange(out, t, i, count);
+}
+
+#endif
+
+/* -----------------------------------DISPATCH-------------------------------- */
+
+static enum MathPath activePath = MATH_PATH_AUTO;
+
+static int pathSupported(enum MathPath path){
+	switch(path){
+		case MATH_PATH_SCALAR: return 1;
+#ifdef MATH_X86
+		case MATH_PATH_SSE: return __builtin_cpu_supports("sse2");
+		case MATH_PATH_AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#ifdef MATH_NEON
+		/* Always there on AArch64. */
+		case MATH_PATH_NEON: return 1;
+#endif
+		default: return 0;
+	}
+}
+
+int mathSetPath(enum MathPath path){
+	if(path == MATH_PATH_AUTO){
+		if(pathSupported(MATH_PATH_AVX2))
+			path = MATH_PATH_AVX2;
+		else if(pathSupported(MATH_PATH_SSE))
+			path = MATH_PATH_SSE;
+		else if(pathSupported(MATH_PATH_NEON))
+			path = MATH_PATH_NEON;
+		else
+			path = MATH_PATH_SCALAR;
+	}
+
+	if(!pathSupported(path))
+		return -1;
+
+	activePath = path;
+	return 0;
+}
+
+enum MathPath mathGetPath(void){
+	if(activePath == MATH_PATH_AUTO)
+		mathSetPath(MATH_PATH_AUTO);
+	return activePath;
+}
+
+void mathTransformPoints(const struct Mat4 *m, const float *const in[3], float *const out[3], size_t count){
+	switch(mathGetPath()){
+#ifdef MATH_X86
+		case MATH_PATH_SSE: transformSSE(m->m, in, out, count); break;
+		case MATH_PATH_AVX2: transformAVX2(m->m, in, out, count); break;
+#endif
+#ifdef MATH_NEON
+		case MATH_PATH_NEON: transformNEON(m->m, in, out, count); break;
+#endif
+		default: transformScalar(m->m, in, out, 0, count); break;
+	}
+}
+
+void mathMultiplyMatrices(struct Mat4 *out, const struct Mat4 *a, const struct Mat4 *b, size_t count){
+	switch(mathGetPath()){
+#ifdef MATH_X86
+		case MATH_PATH_SSE: multiplySSE(out, a, b, count); break;
+		case MATH_PATH_AVX2: multiplyAVX2(out, a, b, count); break;
+#endif
+#ifdef MATH_NEON
+		case MATH_PATH_NEON: multiplyNEON(out, a, b, count); break;
+#endif
+		default: multiplyScalar(out, a, b, 0, count); break;
+	}
+}
+
+void mathComposeTRS(struct Mat4 *out, const struct TRSArrays *trs, size_t count){
+	switch(mathGetPath()){
+#ifdef MATH_X86
+		case MATH_PATH_SSE: composeSSE(out, trs, count); break;
+		case MATH_PATH_AVX2: composeAVX2(out, trs, count); break;
+#endif
+#ifdef MATH_NEON
+		case MATH_PATH_NEON: composeNEON(out, trs, count); break;
+#endif
+		default: composeRange(out, trs, 0, count); break;
+	}
+}
@@ -0,0 +1,903 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <virtual_texture.h>
+#include <fence.h>
+#include <mipmap.h>
+#include <trace.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ALIGN(offset)	(((offset) + VT_FILE_ALIGNMENT - 1) / VT_FILE_ALIGNMENT * VT_FILE_ALIGNMENT)
+
+#define NO_TILE		UINT32_MAX
+#define NO_SLOT		(-1)
+
+struct VTLoaded {
+	uint32_t tile;
+	unsigned char *data;
+};
+
+struct VirtualTexture {
+	/* The mapped file. */
+	const struct VTFileHeader *header;
+	const unsigned char *data;
+	size_t size;
+
+	/* Slots of the cache texture. Slot 0 holds the single page of the	*/
+	/* last level for good, the fallback of every other page. The rest	*/
+	/* are in a list, most recently seen first and free ones last.	*/
+	GLuint cache;
+	unsigned int slotsX;
+	unsigned int slotsY;
+	unsigned int slotCount;
+	uint32_t *slotTile;
+	uint64_t *slotSeen;
+	int32_t *prev;
+	int32_t *next;
+	int32_t head;
+	int32_t tail;
+
+	/* Per tile: its slot, the feedback it was last seen in and	*/
+	/* whether the loader has it.					*/
+	int32_t *tileSlot;
+	uint64_t *tileSeen;
+	unsigned char *tileLoading;
+
+	/* Every level side by side in one RGBA8 texture, level 0 first:	*/
+	/* slot x, slot y and level of the page it ends up using, 255.	*/
+	GLuint pageTable;
+	uint32_t *entries;
+	unsigned int tableWidth;
+	unsigned int tableHeight;
+	int levelOffsets[VT_MAX_LEVELS];
+	unsigned int dirtyFirst;	/* Rows to upload. */
+	unsigned int dirtyEnd;
+
+	GLuint feedbackFramebuffer;
+	GLuint feedbackColor;
+	GLuint feedbackDepth;
+	unsigned int feedbackWidth;
+	unsigned int feedbackHeight;
+	float feedbackBias;
+	GLuint feedbackBuffers[VT_FEEDBACK_BUFFERS];
+	GLsync feedbackFences[VT_FEEDBACK_BUFFERS];
+	int feedbackPending[VT_FEEDBACK_BUFFERS];
+	unsigned int feedbackNext;	/* Written next, so the oldest. */
+	GLint savedFramebuffer;
+	GLint savedViewport[4];
+	uint64_t generation;		/* Feedbacks read so far. */
+
+	/* Missing tiles of the last feedback, coarsest first. */
+	uint32_t *wanted;
+	size_t wantedCount;
+
+	/* Loader thread. Requests and loaded pages are rings, both	*/
+	/* bounded by the buffers: outstanding counts the ones in use.	*/
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	uint32_t requests[VT_MAX_IN_FLIGHT];
+	size_t requestFirst;
+	size_t requestCount;
+	struct VTLoaded loaded[VT_MAX_IN_FLIGHT];
+	size_t loadedFirst;
+	size_t loadedCount;
+	unsigned char *buffers[VT_MAX_IN_FLIGHT];
+	size_t freeBuffers;
+	size_t outstanding;
+	int stopping;
+	int running;
+
+	struct VTStats stats;
+};
+
+/* ------------------------------------BAKE----------------------------------- */
+
+static unsigned int paddedSize(unsigned int size){
+	unsigned int padded = VT_PAGE_SIZE;
+	while(padded < size)
+		padded *= 2;
+	return padded;
+}
+
+/* A page with its border, clamping at the edges of the level. */
+static void cutTile(const struct Image *level, unsigned int pageX, unsigned int pageY, unsigned char *tile){
+	for(unsigned int row = 0; row < VT_TILE_SIZE; row++){
+		long y = (long) pageY * VT_PAGE_SIZE + row - VT_PAGE_BORDER;
+		y = y < 0 ? 0 : y >= (long) level->height ? (long) level->height - 1 : y;
+		for(unsigned int column = 0; column < VT_TILE_SIZE; column++){
+			long x = (long) pageX * VT_PAGE_SIZE + column - VT_PAGE_BORDER;
+			x = x < 0 ? 0 : x >= (long) level->width ? (long) level->width - 1 : x;
+			memcpy(tile + ((size_t) row * VT_TILE_SIZE + column) * 4,
+			       level->pixels + ((size_t) y * level->width + (size_t) x) * 4, 4);
+		}
+	}
+}
+
+static int writeTiles(FILE *file, const struct VTFileHeader *header, const struct MipChain *chain){
+	static const unsigned char padding[VT_FILE_ALIGNMENT];
+	size_t gap = ALIGN(sizeof(*header)) - sizeof(*header);
+	if(fwrite(header, sizeof(*header), 1, file) != 1 || fwrite(padding, 1, gap, file) != gap)
+		return -1;
+
+	unsigned char *tile = malloc(VT_TILE_BYTES);
+	if(tile == NULL)
+		return -1;
+
+	int failed = 0;
+	for(unsigned int level = 0; level < header->levelCount && !failed; level++){
+		const struct VTLevel *info = &header->levels[level];
+		for(unsigned int y = 0; y < info->pagesY && !failed; y++){
+			for(unsigned int x = 0; x < info->pagesX && !failed; x++){
+				cutTile(&chain->levels[level], x, y, tile);
+				failed = fwrite(tile, VT_TILE_BYTES, 1, file) != 1;
+			}
+		}
+	}
+	free(tile);
+	return failed ? -1 : 0;
+}
+
+int vtBake(const struct Image *image, const char *path, int srgb, struct JobSystem *jobs){
+	unsigned int width = paddedSize(image->width), height = paddedSize(image->height);
+	if(width > VT_MAX_PAGES * VT_PAGE_SIZE || height > VT_MAX_PAGES * VT_PAGE_SIZE || width > IMAGE_MAX_DIMENSION ||
+	   height > IMAGE_MAX_DIMENSION){
+		fprintf(stderr, "ERROR: %s: %ux%u is too big for a virtual texture.\n", path, image->width, image->height);
+		return -1;
+	}
+
+	/* Repeat the last column and row out to the padded size. */
+	struct Image padded = { malloc((size_t) width * height * 4), width, height };
+	if(padded.pixels == NULL){
+		fprintf(stderr, "ERROR: Out of memory baking %s.\n", path);
+		return -1;
+	}
+	for(unsigned int y = 0; y < height; y++){
+		const unsigned char *source = image->pixels + (size_t) (y < image->height ? y : image->height - 1) *
+					      image->width * 4;
+		unsigned char *row = padded.pixels + (size_t) y * width * 4;
+		memcpy(row, source, (size_t) image->width * 4);
+		for(unsigned int x = image->width; x < width; x++)
+			memcpy(row + (size_t) x * 4, source + (size_t) (image->width - 1) * 4, 4);
+	}
+
+	struct MipChain chain;
+	int status = mipmapBuild(&padded, MIP_FILTER_BOX, srgb ? MIPMAP_SRGB : 0, jobs, &chain);
+	imageFree(&padded);
+	if(status == -1)
+		return -1;
+
+	struct VTFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, VT_FILE_MAGIC, sizeof(header.magic));
+	header.version = VT_FILE_VERSION;
+	header.width = image->width;
+	header.height = image->height;
+	header.paddedWidth = width;
+	header.paddedHeight = height;
+	header.srgb = srgb != 0;
+
+	/* Down to the first level that fits a single page. */
+	for(unsigned int level = 0; level < chain.levelCount; level++){
+		const struct Image *mip = &chain.levels[level];
+		header.levels[level] = (struct VTLevel) { (mip->width + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE,
+							  (mip->height + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE, header.tileCount };
+		header.tileCount += header.levels[level].pagesX * header.levels[level].pagesY;
+		header.levelCount++;
+		if(mip->width <= VT_PAGE_SIZE && mip->height <= VT_PAGE_SIZE)
+			break;
+	}
+
+	FILE *file = fopen(path, "wb");
+	if(file == NULL){
+		perror(path);
+		mipmapFree(&chain);
+		return -1;
+	}
+	int failed = writeTiles(file, &header, &chain) == -1;
+	if(fclose(file) != 0 || failed){
+		perror(path);
+		status = -1;
+	}
+	mipmapFree(&chain);
+	return status;
+}
+
+/* ------------------------------------FILE----------------------------------- */
+
+static int checkHeader(const char *path, const struct VTFileHeader *header, size_t size){
+	if(size < sizeof(*header) || memcmp(header->magic, VT_FILE_MAGIC, sizeof(header->magic)) != 0){
+		fprintf(stderr, "ERROR: %s is not a virtual texture.\n", path);
+		return -1;
+	}
+	if(header->version != VT_FILE_VERSION){
+		fprintf(stderr, "ERROR: %s is version %u, only %d is supported.\n", path, header->version,
+			VT_FILE_VERSION);
+		return -1;
+	}
+	if(header->levelCount == 0 || header->levelCount > VT_MAX_LEVELS){
+		fprintf(stderr, "ERROR: %s has %u levels.\n", path, header->levelCount);
+		return -1;
+	}
+
+	uint32_t tiles = 0;
+	for(unsigned int i = 0; i < header->levelCount; i++){
+		const struct VTLevel *level = &header->levels[i];
+		uint32_t pagesX = header->levels[0].pagesX, pagesY = header->levels[0].pagesY;
+		if(level->firstTile != tiles || level->pagesX == 0 || level->pagesY == 0 ||
+		   level->pagesX > VT_MAX_PAGES || level->pagesY > VT_MAX_PAGES ||
+		   (i > 0 && (level->pagesX != ((pagesX >> i) ? (pagesX >> i) : 1) ||
+			      level->pagesY != ((pagesY >> i) ? (pagesY >> i) : 1)))){
+			fprintf(stderr, "ERROR: %s: level %u is corrupt.\n", path, i);
+			return -1;
+		}
+		tiles += level->pagesX * level->pagesY;
+	}
+
+	const struct VTLevel *last = &header->levels[header->levelCount - 1];
+	if(tiles != header->tileCount || last->pagesX != 1 || last->pagesY != 1 || size < ALIGN(sizeof(*header)) ||
+	   (size - ALIGN(sizeof(*header))) / VT_TILE_BYTES < tiles){
+		fprintf(stderr, "ERROR: %s is truncated.\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int mapFile(struct VirtualTexture *vt, const char *path){
+	int fd = open(path, O_RDONLY);
+	if(fd == -1){
+		perror(path);
+		return -1;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1 || info.st_size == 0){
+		fprintf(stderr, "ERROR: %s is not a virtual texture.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED){
+		perror(path);
+		return -1;
+	}
+
+	vt->data = data;
+	vt->header = data;
+	vt->size = (size_t) info.st_size;
+	return checkHeader(path, vt->header, vt->size);
+}
+
+static const unsigned char *tileData(const struct VirtualTexture *vt, uint32_t tile){
+	return vt->data + ALIGN(sizeof(struct VTFileHeader)) + (size_t) tile * VT_TILE_BYTES;
+}
+
+static unsigned int tileLevel(const struct VirtualTexture *vt, uint32_t tile){
+	unsigned int level = 0;
+	while(level + 1 < vt->header->levelCount && vt->header->levels[level + 1].firstTile <= tile)
+		level++;
+	return level;
+}
+
+/* ------------------------------------LOADER--------------------------------- */
+
+/* Copying out of the mapping is what pulls the page in from disk. */
+static void *loaderMain(void *arg){
+	struct VirtualTexture *vt = arg;
+
+	TRACE_THREAD_NAME("virtual texture loader");
+	pthread_mutex_lock(&vt->lock);
+	for(;;){
+		while(!vt->stopping && vt->requestCount == 0)
+			pthread_cond_wait(&vt->changed, &vt->lock);
+		if(vt->stopping)
+			break;
+
+		uint32_t tile = vt->requests[vt->requestFirst];
+		vt->requestFirst = (vt->requestFirst + 1) % VT_MAX_IN_FLIGHT;
+		vt->requestCount--;
+		unsigned char *buffer = vt->buffers[--vt->freeBuffers];
+		pthread_mutex_unlock(&vt->lock);
+
+		TRACE_BEGIN("load page");
+		memcpy(buffer, tileData(vt, tile), VT_TILE_BYTES);
+		TRACE_END();
+
+		pthread_mutex_lock(&vt->lock);
+		vt->loaded[(vt->loadedFirst + vt->loadedCount) % VT_MAX_IN_FLIGHT] = (struct VTLoaded) { tile, buffer };
+		vt->loadedCount++;
+	}
+	pthread_mutex_unlock(&vt->lock);
+	return NULL;
+}
+
+static void requestTiles(struct VirtualTexture *vt){
+	size_t i = 0;
+
+	/* Every page in is in view, none could make room for them. */
+	int32_t last = vt->tail;
+	if(last == NO_SLOT || (vt->slotTile[last] != NO_TILE && vt->slotSeen[last] == vt->generation))
+		vt->wantedCount = 0;
+
+	pthread_mutex_lock(&vt->lock);
+	for(; i < vt->wantedCount && vt->outstanding < VT_MAX_IN_FLIGHT; i++){
+		uint32_t tile = vt->wanted[i];
+		if(vt->tileLoading[tile] || vt->tileSlot[tile] != NO_SLOT)
+			continue;
+		vt->tileLoading[tile] = 1;
+		vt->requests[(vt->requestFirst + vt->requestCount) % VT_MAX_IN_FLIGHT] = tile;
+		vt->requestCount++;
+		vt->outstanding++;
+		vt->stats.requested++;
+	}
+	if(i > 0)
+		pthread_cond_signal(&vt->changed);
+	pthread_mutex_unlock(&vt->lock);
+
+	/* What did not fit waits for the next feedback to ask again. */
+	vt->wantedCount = 0;
+}
+
+/* -----------------------------------CACHE----------------------------------- */
+
+static void unlinkSlot(struct VirtualTexture *vt, int32_t slot){
+	if(vt->prev[slot] != NO_SLOT)
+		vt->next[vt->prev[slot]] = vt->next[slot];
+	else
+		vt->head = vt->next[slot];
+	if(vt->next[slot] != NO_SLOT)
+		vt->prev[vt->next[slot]] = vt->prev[slot];
+	else
+		vt->tail = vt->prev[slot];
+}
+
+static void pushFront(struct VirtualTexture *vt, int32_t slot){
+	vt->prev[slot] = NO_SLOT;
+	vt->next[slot] = vt->head;
+	if(vt->head != NO_SLOT)
+		vt->prev[vt->head] = slot;
+	else
+		vt->tail = slot;
+	vt->head = slot;
+}
+
+static void touchSlot(struct VirtualTexture *vt, int32_t slot){
+	vt->slotSeen[slot] = vt->generation;
+	if(slot == 0 || vt->head == slot)
+		return;
+	unlinkSlot(vt, slot);
+	pushFront(vt, slot);
+}
+
+static inline uint32_t packEntry(const struct VirtualTexture *vt, int32_t slot, unsigned int level){
+	return (uint32_t) slot % vt->slotsX | ((uint32_t) slot / vt->slotsX) << 8 | (uint32_t) level << 16 | 0xFFu << 24;
+}
+
+/* Point every entry under the page, on its level and all finer ones,	*/
+/* at the page itself or the closest coarser page that is in. Coarse	*/
+/* levels go first so a parent entry is always right when read.		*/
+static void refreshEntries(struct VirtualTexture *vt, unsigned int level, unsigned int x, unsigned int y){
+	const struct VTFileHeader *header = vt->header;
+
+	for(int k = (int) level; k >= 0; k--){
+		const struct VTLevel *info = &header->levels[k];
+		unsigned int shift = level - (unsigned int) k;
+		unsigned int firstX = x << shift, firstY = y << shift;
+		unsigned int endX = (x + 1) << shift, endY = (y + 1) << shift;
+		endX = endX < info->pagesX ? endX : info->pagesX;
+		endY = endY < info->pagesY ? endY : info->pagesY;
+
+		for(unsigned int row = firstY; row < endY; row++){
+			uint32_t *entries = vt->entries + (size_t) row * vt->tableWidth + vt->levelOffsets[k];
+			const uint32_t *parents = vt->entries + (size_t) (row >> 1) * vt->tableWidth;
+			for(unsigned int column = firstX; column < endX; column++){
+				int32_t slot = vt->tileSlot[info->firstTile + row * info->pagesX + column];
+				if(slot != NO_SLOT)
+					entries[column] = packEntry(vt, slot, (unsigned int) k);
+				else
+					entries[column] = parents[vt->levelOffsets[k + 1] + (column >> 1)];
+			}
+		}
+	}
+
+	unsigned int end = (y + 1) << level;
+	end = end < vt->tableHeight ? end : vt->tableHeight;
+	if(vt->dirtyFirst >= vt->dirtyEnd){
+		vt->dirtyFirst = y;
+		vt->dirtyEnd = end;
+	} else {
+		vt->dirtyFirst = y < vt->dirtyFirst ? y : vt->dirtyFirst;
+		vt->dirtyEnd = end > vt->dirtyEnd ? end : vt->dirtyEnd;
+	}
+}
+
+static void refreshTile(struct VirtualTexture *vt, uint32_t tile){
+	unsigned int level = tileLevel(vt, tile);
+	const struct VTLevel *info = &vt->header->levels[level];
+	uint32_t index = tile - info->firstTile;
+	refreshEntries(vt, level, index % info->pagesX, index / info->pagesX);
+}
+
+/* A free slot, or the least recently seen page's. None if even that	*/
+/* one was in the last feedback: the cache is too small for the view	*/
+/* and evicting would only bring it straight back.			*/
+static int32_t takeSlot(struct VirtualTexture *vt){
+	int32_t slot = vt->tail;
+	if(slot == NO_SLOT)
+		return NO_SLOT;
+
+	uint32_t old = vt->slotTile[slot];
+	if(old != NO_TILE){
+		if(vt->slotSeen[slot] == vt->generation)
+			return NO_SLOT;
+		vt->tileSlot[old] = NO_SLOT;
+		vt->slotTile[slot] = NO_TILE;
+		vt->stats.resident--;
+		vt->stats.evicted++;
+		refreshTile(vt, old);
+	}
+	return slot;
+}
+
+static void uploadTile(const struct VirtualTexture *vt, int32_t slot, const unsigned char *data){
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint) ((unsigned int) slot % vt->slotsX * VT_TILE_SIZE),
+			(GLint) ((unsigned int) slot / vt->slotsX * VT_TILE_SIZE), VT_TILE_SIZE, VT_TILE_SIZE, GL_RGBA,
+			GL_UNSIGNED_BYTE, data);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void placeTile(struct VirtualTexture *vt, uint32_t tile, int32_t slot, const unsigned char *data){
+	uploadTile(vt, slot, data);
+	vt->slotTile[slot] = tile;
+	vt->tileSlot[tile] = slot;
+	vt->stats.resident++;
+	vt->stats.uploaded++;
+	if(slot != 0)
+		touchSlot(vt, slot);
+	refreshTile(vt, tile);
+}
+
+static void uploadLoaded(struct VirtualTexture *vt){
+	struct VTLoaded batch[VT_UPLOADS_PER_FRAME];
+	size_t count = 0;
+
+	pthread_mutex_lock(&vt->lock);
+	for(; count < VT_UPLOADS_PER_FRAME && vt->loadedCount > 0; count++){
+		batch[count] = vt->loaded[vt->loadedFirst];
+		vt->loadedFirst = (vt->loadedFirst + 1) % VT_MAX_IN_FLIGHT;
+		vt->loadedCount--;
+	}
+	pthread_mutex_unlock(&vt->lock);
+
+	for(size_t i = 0; i < count; i++){
+		int32_t slot = takeSlot(vt);
+		if(slot != NO_SLOT)
+			placeTile(vt, batch[i].tile, slot, batch[i].data);
+		vt->tileLoading[batch[i].tile] = 0;
+	}
+
+	pthread_mutex_lock(&vt->lock);
+	for(size_t i = 0; i < count; i++)
+		vt->buffers[vt->freeBuffers++] = batch[i].data;
+	vt->outstanding -= count;
+	pthread_mutex_unlock(&vt->lock);
+}
+
+static void uploadEntries(struct VirtualTexture *vt){
+	if(vt->dirtyFirst >= vt->dirtyEnd)
+		return;
+
+	glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint) vt->dirtyFirst, (GLsizei) vt->tableWidth,
+			(GLsizei) (vt->dirtyEnd - vt->dirtyFirst), GL_RGBA, GL_UNSIGNED_BYTE,
+			vt->entries + (size_t) vt->dirtyFirst * vt->tableWidth);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	vt->dirtyFirst = vt->dirtyEnd = 0;
+}
+
+/* -----------------------------------FEEDBACK-------------------------------- */
+
+static int compareTiles(const void *a, const void *b){
+	uint32_t first = *(const uint32_t*) a, second = *(const uint32_t*) b;
+	return first < second ? 1 : first > second ? -1 : 0;
+}
+
+/* Every page a pixel asked for and the pages above it, the fallbacks	*/
+/* while it loads, count as seen. The missing ones are wanted, coarse	*/
+/* levels first since they stand in for the most pages.		*/
+static void readFeedback(struct VirtualTexture *vt, const unsigned char *pixels){
+	const struct VTFileHeader *header = vt->header;
+	size_t count = (size_t) vt->feedbackWidth * vt->feedbackHeight;
+
+	vt->generation++;
+	for(size_t i = 0; i < count; i++){
+		const unsigned char *pixel = pixels + i * 4;
+		unsigned int x = pixel[0], y = pixel[1], level = pixel[2];
+		if(pixel[3] == 0 || level >= header->levelCount || x >= header->levels[level].pagesX ||
+		   y >= header->levels[level].pagesY)
+			continue;
+
+		for(; level < header->levelCount; level++, x >>= 1, y >>= 1){
+			const struct VTLevel *info = &header->levels[level];
+			uint32_t tile = info->firstTile + y * info->pagesX + x;
+			if(vt->tileSeen[tile] == vt->generation)
+				break;
+			vt->tileSeen[tile] = vt->generation;
+
+			if(vt->tileSlot[tile] != NO_SLOT)
+				touchSlot(vt, vt->tileSlot[tile]);
+			else if(!vt->tileLoading[tile])
+				vt->wanted[vt->wantedCount++] = tile;
+		}
+	}
+
+	/* Tiles are stored finest level first. */
+	qsort(vt->wanted, vt->wantedCount, sizeof(uint32_t), compareTiles);
+}
+
+static int feedbackReady(const struct VirtualTexture *vt, unsigned int buffer){
+	if(!vt->feedbackPending[buffer])
+		return 0;
+	return fenceSignaled(vt->feedbackFences[buffer]);
+}
+
+static void releaseFeedback(struct VirtualTexture *vt, unsigned int buffer){
+	if(vt->feedbackFences[buffer])
+		glDeleteSync(vt->feedbackFences[buffer]);
+	vt->feedbackFences[buffer] = NULL;
+	vt->feedbackPending[buffer] = 0;
+}
+
+/* The oldest readback, if the GPU has finished it. */
+static void pollFeedback(struct VirtualTexture *vt){
+	unsigned int buffer = vt->feedbackNext;
+	for(int i = 0; i < VT_FEEDBACK_BUFFERS && !vt->feedbackPending[buffer]; i++)
+		buffer = (buffer + 1) % VT_FEEDBACK_BUFFERS;
+	if(!feedbackReady(vt, buffer))
+		return;
+
+	TRACE_BEGIN("read feedback");
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedbackBuffers[buffer]);
+	const unsigned char *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+						       (GLsizeiptr) vt->feedbackWidth * vt->feedbackHeight * 4,
+						       GL_MAP_READ_BIT);
+	if(pixels != NULL){
+		readFeedback(vt, pixels);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	releaseFeedback(vt, buffer);
+	TRACE_END();
+}
+
+void vtBeginFeedback(struct VirtualTexture *vt){
+	static const GLfloat nothing[4] = {0.0f, 0.0f, 0.0f, 0.0f}, far = 1.0f;
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &vt->savedFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, vt->savedViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, vt->feedbackFramebuffer);
+	glViewport(0, 0, (GLsizei) vt->feedbackWidth, (GLsizei) vt->feedbackHeight);
+
+	/* Leaves the clear colour of the caller alone. */
+	glClearBufferfv(GL_COLOR, 0, nothing);
+	glClearBufferfv(GL_DEPTH, 0, &far);
+}
+
+void vtEndFeedback(struct VirtualTexture *vt){
+	unsigned int buffer = vt->feedbackNext;
+	vt->feedbackNext = (buffer + 1) % VT_FEEDBACK_BUFFERS;
+
+	/* Still unread after a whole ring of frames, it is stale anyway. */
+	if(vt->feedbackPending[buffer])
+		releaseFeedback(vt, buffer);
+
+	/* Into the pack buffer, so glReadPixels() returns straight away. */
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedbackBuffers[buffer]);
+	glReadPixels(0, 0, (GLsizei) vt->feedbackWidth, (GLsizei) vt->feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	vt->feedbackPending[buffer] = 1;
+	if(GLAD_GL_ARB_sync)
+		vt->feedbackFences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) vt->savedFramebuffer);
+	glViewport(vt->savedViewport[0], vt->savedViewport[1], vt->savedViewport[2], vt->savedViewport[3]);
+}
+
+/* -----------------------------------PUBLIC---------------------------------- */
+
+void vtUpdate(struct VirtualTexture *vt){
+	TRACE_BEGIN("vtUpdate");
+	pollFeedback(vt);
+	uploadLoaded(vt);
+	requestTiles(vt);
+	uploadEntries(vt);
+	TRACE_END();
+}
+
+static int createObjects(struct VirtualTexture *vt){
+	GLint maxSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if(vt->slotsX * VT_TILE_SIZE > (unsigned int) maxSize || vt->slotsY * VT_TILE_SIZE > (unsigned int) maxSize ||
+	   vt->tableWidth > (unsigned int) maxSize){
+		fprintf(stderr, "ERROR: The virtual texture cache is bigger than a texture can be.\n");
+		return -1;
+	}
+
+	/* Bilinear inside a tile, the borders keep it from reading the next one. */
+	glGenTextures(1, &vt->cache);
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, vt->header->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, (GLsizei) (vt->slotsX * VT_TILE_SIZE),
+		     (GLsizei) (vt->slotsY * VT_TILE_SIZE), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glGenTextures(1, &vt->pageTable);
+	glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei) vt->tableWidth, (GLsizei) vt->tableHeight, 0, GL_RGBA,
+		     GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &vt->feedbackColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, vt->feedbackColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei) vt->feedbackWidth, (GLsizei) vt->feedbackHeight);
+	glGenRenderbuffers(1, &vt->feedbackDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, vt->feedbackDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, (GLsizei) vt->feedbackWidth,
+			      (GLsizei) vt->feedbackHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint saved;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &saved);
+	glGenFramebuffers(1, &vt->feedbackFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, vt->feedbackFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, vt->feedbackColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, vt->feedbackDepth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) saved);
+	if(status != GL_FRAMEBUFFER_COMPLETE){
+		fprintf(stderr, "ERROR: The feedback framebuffer is incomplete (0x%x).\n", status);
+		return -1;
+	}
+
+	glGenBuffers(VT_FEEDBACK_BUFFERS, vt->feedbackBuffers);
+	for(int i = 0; i < VT_FEEDBACK_BUFFERS; i++){
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedbackBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) vt->feedbackWidth * vt->feedbackHeight * 4, NULL,
+			     GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return 0;
+}
+
+struct VirtualTexture *vtCreate(const char *path, unsigned int slots, unsigned int screenWidth,
+				unsigned int screenHeight, unsigned int scale){
+	struct VirtualTexture *vt = calloc(1, sizeof(*vt));
+	if(vt == NULL)
+		return NULL;
+	if(mapFile(vt, path) == -1){
+		vtDestroy(vt);
+		return NULL;
+	}
+
+	const struct VTFileHeader *header = vt->header;
+	slots = slots > 2 ? slots : 2;
+	vt->slotCount = slots < header->tileCount ? slots : header->tileCount;
+	vt->slotsX = (unsigned int) ceil(sqrt(vt->slotCount));
+	vt->slotsY = (vt->slotCount + vt->slotsX - 1) / vt->slotsX;
+
+	scale = scale > 0 ? scale : 1;
+	vt->feedbackWidth = screenWidth / scale > 0 ? screenWidth / scale : 1;
+	vt->feedbackHeight = screenHeight / scale > 0 ? screenHeight / scale : 1;
+	vt->feedbackBias = -log2f((float) scale);
+
+	for(unsigned int i = 0; i < header->levelCount; i++){
+		vt->levelOffsets[i] = (int) vt->tableWidth;
+		vt->tableWidth += header->levels[i].pagesX;
+	}
+	vt->tableHeight = header->levels[0].pagesY;
+
+	vt->slotTile = malloc(vt->slotCount * sizeof(uint32_t));
+	vt->slotSeen = calloc(vt->slotCount, sizeof(uint64_t));
+	vt->prev = malloc(vt->slotCount * sizeof(int32_t));
+	vt->next = malloc(vt->slotCount * sizeof(int32_t));
+	vt->tileSlot = malloc(header->tileCount * sizeof(int32_t));
+	vt->tileSeen = calloc(header->tileCount, sizeof(uint64_t));
+	vt->tileLoading = calloc(header->tileCount, 1);
+	vt->wanted = malloc(header->tileCount * sizeof(uint32_t));
+	vt->entries = malloc((size_t) vt->tableWidth * vt->tableHeight * sizeof(uint32_t));
+	int failed = vt->slotTile == NULL || vt->slotSeen == NULL || vt->prev == NULL || vt->next == NULL ||
+		     vt->tileSlot == NULL || vt->tileSeen == NULL || vt->tileLoading == NULL || vt->wanted == NULL ||
+		     vt->entries == NULL;
+	for(int i = 0; i < VT_MAX_IN_FLIGHT && !failed; i++)
+		failed = (vt->buffers[vt->freeBuffers++] = malloc(VT_TILE_BYTES)) == NULL;
+	if(failed){
+		fprintf(stderr, "ERROR: Out of memory creating the virtual texture.\n");
+		vtDestroy(vt);
+		return NULL;
+	}
+
+	for(unsigned int i = 0; i < header->tileCount; i++)
+		vt->tileSlot[i] = NO_SLOT;
+	vt->head = vt->tail = NO_SLOT;
+	for(unsigned int i = 0; i < vt->slotCount; i++){
+		vt->slotTile[i] = NO_TILE;
+		if(i > 0)
+			pushFront(vt, (int32_t) i);
+	}
+	vt->stats.slots = vt->slotCount;
+
+	if(createObjects(vt) == -1){
+		vtDestroy(vt);
+		return NULL;
+	}
+
+	/* Every entry starts at the last level's page, loaded right away. */
+	unsigned int last = header->levelCount - 1;
+	for(size_t i = 0; i < (size_t) vt->tableWidth * vt->tableHeight; i++)
+		vt->entries[i] = packEntry(vt, 0, last);
+	vt->dirtyFirst = 0;
+	vt->dirtyEnd = vt->tableHeight;
+	placeTile(vt, header->levels[last].firstTile, 0, tileData(vt, header->levels[last].firstTile));
+	uploadEntries(vt);
+
+	pthread_mutex_init(&vt->lock, NULL);
+	pthread_cond_init(&vt->changed, NULL);
+	if(pthread_create(&vt->thread, NULL, loaderMain, vt) != 0){
+		perror("Failed to start the virtual texture loader");
+		pthread_cond_destroy(&vt->changed);
+		pthread_mutex_destroy(&vt->lock);
+		vtDestroy(vt);
+		return NULL;
+	}
+	vt->running = 1;
+	return vt;
+}
+
+void vtBind(const struct VirtualTexture *vt, GLuint program, unsigned int unit, int feedback){
+	const struct VTFileHeader *header = vt->header;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+	glActiveTexture(GL_TEXTURE0 + unit + 1);
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(glGetUniformLocation(program, "vtPageTable"), (GLint) unit);
+	glUniform1i(glGetUniformLocation(program, "vtCache"), (GLint) unit + 1);
+	glUniform2f(glGetUniformLocation(program, "vtSize"), (float) header->paddedWidth, (float) header->paddedHeight);
+	glUniform2f(glGetUniformLocation(program, "vtScale"), (float) header->width / header->paddedWidth,
+		    (float) header->height / header->paddedHeight);
+	glUniform2f(glGetUniformLocation(program, "vtCacheSize"), (float) (vt->slotsX * VT_TILE_SIZE),
+		    (float) (vt->slotsY * VT_TILE_SIZE));
+	glUniform1f(glGetUniformLocation(program, "vtMaxLevel"), (float) (header->levelCount - 1));
+	glUniform1f(glGetUniformLocation(program, "vtLodBias"), feedback ? vt->feedbackBias : 0.0f);
+	glUniform1iv(glGetUniformLocation(program, "vtLevelOffsets"), (GLsizei) header->levelCount, vt->levelOffsets);
+}
+
+void vtGetStats(const struct VirtualTexture *vt, struct VTStats *stats){
+	*stats = vt->stats;
+}
+
+void vtDestroy(struct VirtualTexture *vt){
+	if(vt->running){
+		pthread_mutex_lock(&vt->lock);
+		vt->stopping = 1;
+		pthread_cond_broadcast(&vt->changed);
+		pthread_mutex_unlock(&vt->lock);
+		pthread_join(vt->thread, NULL);
+		pthread_cond_destroy(&vt->changed);
+		pthread_mutex_destroy(&vt->lock);
+	}
+
+	for(int i = 0; i < VT_FEEDBACK_BUFFERS; i++)
+		if(vt->feedbackFences[i])
+			glDeleteSync(vt->feedbackFences[i]);
+	if(vt->feedbackBuffers[0])
+		glDeleteBuffers(VT_FEEDBACK_BUFFERS, vt->feedbackBuffers);
+	if(vt->feedbackFramebuffer)
+		glDeleteFramebuffers(1, &vt->feedbackFramebuffer);
+	if(vt->feedbackColor)
+		glDeleteRenderbuffers(1, &vt->feedbackColor);
+	if(vt->feedbackDepth)
+		glDeleteRenderbuffers(1, &vt->feedbackDepth);
+	if(vt->pageTable)
+		glDeleteTextures(1, &vt->pageTable);
+	if(vt->cache)
+		glDeleteTextures(1, &vt->cache);
+
+	/* Loaded pages hold buffers too. */
+	for(size_t i = 0; i < vt->loadedCount; i++)
+		free(vt->loaded[(vt->loadedFirst + i) % VT_MAX_IN_FLIGHT].data);
+	for(size_t i = 0; i < vt->freeBuffers; i++)
+		free(vt->buffers[i]);
+
+	free(vt->entries);
+	free(vt->wanted);
+	free(vt->tileLoading);
+	free(vt->tileSeen);
+	free(vt->tileSlot);
+	free(vt->next);
+	free(vt->prev);
+	free(vt->slotSeen);
+	free(vt->slotTile);
+	if(vt->data)
+		munmap((void *) vt->data, vt->size);
+	free(vt);
+}
+
+/* ------------------------------------GLSL----------------------------------- */
+
+#define STRINGIFY(value)	#value
+#define STRING(value)		STRINGIFY(value)
+
+const char vtShaderSource[] =
+	"const float vtPageSize = " STRING(VT_PAGE_SIZE) ".0;\n"
+	"const float vtBorder = " STRING(VT_PAGE_BORDER) ".0;\n"
+	"const float vtTileSize = vtPageSize + 2.0 * vtBorder;\n"
+	"uniform sampler2D vtPageTable;\n"
+	"uniform sampler2D vtCache;\n"
+	"uniform vec2 vtSize;\n"
+	"uniform vec2 vtScale;\n"
+	"uniform vec2 vtCacheSize;\n"
+	"uniform float vtMaxLevel;\n"
+	"uniform float vtLodBias;\n"
+	"uniform int vtLevelOffsets[" STRING(VT_MAX_LEVELS) "];\n"
+	"\n"
+	"float vtLevel(vec2 texel){\n"
+	"	vec2 dx = dFdx(texel), dy = dFdy(texel);\n"
+	"	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + vtLodBias;\n"
+	"	return clamp(floor(lod + 0.5), 0.0, vtMaxLevel);\n"
+	"}\n"
+	"\n"
+	"vec2 vtPage(vec2 uv, float level, out vec2 texel){\n"
+	"	vec2 size = max(floor(vtSize / exp2(level)), vec2(1.0));\n"
+	"	texel = uv * size;\n"
+	"	return min(floor(texel / vtPageSize), ceil(size / vtPageSize) - 1.0);\n"
+	"}\n"
+	"\n"
+	"vec4 vtFeedback(vec2 uv){\n"
+	"	uv = clamp(uv, 0.0, 1.0) * vtScale;\n"
+	"	vec2 texel;\n"
+	"	float level = vtLevel(uv * vtSize);\n"
+	"	return vec4(vtPage(uv, level, texel), level, 255.0) / 255.0;\n"
+	"}\n"
+	"\n"
+	"vec4 vtSample(vec2 uv){\n"
+	"	uv = clamp(uv, 0.0, 1.0) * vtScale;\n"
+	"	vec2 texel;\n"
+	"	float level = vtLevel(uv * vtSize);\n"
+	"	ivec2 entry = ivec2(vtPage(uv, level, texel)) + ivec2(vtLevelOffsets[int(level)], 0);\n"
+	"	vec3 page = floor(texelFetch(vtPageTable, entry, 0).rgb * 255.0 + 0.5);\n"
+	"	vec2 pageAt = vtPage(uv, page.b, texel);\n"
+	"	vec2 inPage = clamp(texel - pageAt * vtPageSize, 0.0, vtPageSize);\n"
+	"	return textureLod(vtCache, (page.rg * vtTileSize + vtBorder + inPage) / vtCacheSize, 0.0);\n"
+	"}\n";
@@ -0,0 +1,170 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Packs images into atlas pages and writes each page as a texture file	*/
+/* with the table of where every image went, see atlas.h. The pages	*/
+/* keep only the mip levels their gutters cover, so smaller levels do	*/
+/* not blend neighbouring images together.				*/
+/* Usage: atlas_bake [options] <image.tga|ppm>...			*/
+/*	--output P	atlas table to write, atlas.atlas by default	*/
+/*	--size N	page width and height, 2048 by default		*/
+/*	--padding N	gutter around each image, 4 by default		*/
+/*	--srgb		colours are sRGB, filter them in linear light	*/
+/*	--threads N	threads to use, 0 for one per CPU, the default	*/
+
+#include <atlas.h>
+#include <mipmap.h>
+#include <texture_file.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Levels until the gutter is down to a pixel. */
+static unsigned int gutterLevels(unsigned int padding){
+	unsigned int levels = 1;
+	while(padding >> levels)
+		levels++;
+	return levels;
+}
+
+static int writePage(const char *output, unsigned int page, struct Image *image, unsigned int padding,
+		     unsigned int flags, struct JobSystem *jobs){
+	char path[4096];
+	if(atlasPagePath(output, page, path, sizeof(path)) == -1){
+		fprintf(stderr, "ERROR: %s: path too long.\n", output);
+		return -1;
+	}
+
+	struct MipChain chain;
+	if(mipmapBuild(image, MIP_FILTER_BOX, flags, jobs, &chain) == -1)
+		return -1;
+
+	struct TextureLevel levels[MIPMAP_MAX_LEVELS];
+	unsigned int count = gutterLevels(padding);
+	count = count < chain.levelCount ? count : chain.levelCount;
+	for(unsigned int i = 0; i < count; i++)
+		levels[i] = (struct TextureLevel) { chain.levels[i].width, chain.levels[i].height,
+						    chain.levels[i].pixels, IMAGE_SIZE(&chain.levels[i]) };
+
+	int status = textureFileWrite(path, flags & MIPMAP_SRGB ? TEXTURE_FILE_SRGB8_ALPHA8 : TEXTURE_FILE_RGBA8,
+				      levels, count);
+	mipmapFree(&chain);
+	if(status == 0)
+		printf("%s, %u levels\n", path, count);
+	return status;
+}
+
+int main(int argc, char *argv[]){
+	const char *output = "atlas" ATLAS_FILE_EXTENSION;
+	unsigned int size = 2048, padding = 4, flags = 0, threads = 0;
+	int first = 1;
+
+	for(; first < argc && strncmp(argv[first], "--", 2) == 0; first++){
+		if(strcmp(argv[first], "--output") == 0 && first + 1 < argc)
+			output = argv[++first];
+		else if(strcmp(argv[first], "--size") == 0 && first + 1 < argc)
+			size = (unsigned int) atoi(argv[++first]);
+		else if(strcmp(argv[first], "--padding") == 0 && first + 1 < argc)
+			padding = (unsigned int) atoi(argv[++first]);
+		else if(strcmp(argv[first], "--srgb") == 0)
+			flags |= MIPMAP_SRGB;
+		else if(strcmp(argv[first], "--threads") == 0 && first + 1 < argc)
+			threads = (unsigned int) atoi(argv[++first]);
+		else {
+			fprintf(stderr, "ERROR: Unknown option %s.\n", argv[first]);
+			return -1;
+		}
+	}
+	if(first == argc || size == 0 || size > IMAGE_MAX_DIMENSION){
+		fprintf(stderr, "Usage: %s [--output P] [--size N] [--padding N] [--srgb] [--threads N] "
+			"<image.tga|ppm>...\n", argv[0]);
+		return -1;
+	}
+
+	size_t count = (size_t) (argc - first);
+	struct Image *images = calloc(count, sizeof(struct Image));
+	struct AtlasRect *rects = calloc(count, sizeof(struct AtlasRect));
+	struct AtlasEntry *entries = calloc(count, sizeof(struct AtlasEntry));
+	if(images == NULL || rects == NULL || entries == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		const char *path = argv[first + (int) i], *name = strrchr(path, '/');
+		name = name ? name + 1 : path;
+		if(strlen(name) >= ATLAS_NAME_SIZE){
+			fprintf(stderr, "ERROR: %s: names are at most %d characters.\n", path, ATLAS_NAME_SIZE - 1);
+			return -1;
+		}
+		if(imageImportFile(path, &images[i]) == -1)
+			return -1;
+		strcpy(entries[i].name, name);
+		rects[i].width = images[i].width;
+		rects[i].height = images[i].height;
+	}
+
+	unsigned int pageCount;
+	if(atlasPack(rects, count, size, size, padding, &pageCount) == -1)
+		return -1;
+
+	struct JobSystem *jobs = jobSystemCreate(threads);
+	struct Image page = { malloc((size_t) size * size * 4), size, size };
+	if(jobs == NULL || page.pixels == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	int failed = 0;
+	size_t used = 0;
+	for(unsigned int p = 0; p < pageCount && !failed; p++){
+		memset(page.pixels, 0, IMAGE_SIZE(&page));
+		for(size_t i = 0; i < count; i++){
+			if(rects[i].page != p)
+				continue;
+			atlasCopy(page.pixels, size, &images[i], rects[i].x, rects[i].y, padding);
+			used += (size_t) rects[i].width * rects[i].height;
+		}
+		failed = writePage(output, p, &page, padding, flags, jobs) == -1;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		struct AtlasEntry *entry = &entries[i];
+		entry->page = rects[i].page;
+		entry->x = rects[i].x;
+		entry->y = rects[i].y;
+		entry->width = rects[i].width;
+		entry->height = rects[i].height;
+		atlasTransform(&rects[i], size, size, entry->transform);
+		imageFree(&images[i]);
+	}
+
+	struct AtlasFileHeader header = { ATLAS_FILE_MAGIC, ATLAS_FILE_VERSION, size, size, pageCount,
+					  (uint32_t) count };
+	if(!failed)
+		failed = atlasFileWrite(output, &header, entries) == -1;
+	if(!failed)
+		printf("%s: %zu images on %u pages, %.1f%% used\n", output, count, pageCount,
+		       100.0 * used / ((double) size * size * pageCount));
+
+	jobSystemDestroy(jobs);
+	imageFree(&page);
+	free(entries);
+	free(rects);
+	free(images);
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,159 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Generates a LOD chain for a mesh and writes one OBJ file per level.	*/
+/* Usage: mesh_lod [--check-scale] <input.obj|ply> <output prefix>	*/
+/*		   [levels] [ratio]					*/
+/*	--check-scale	also simplify the mesh scaled up CHECK_SCALE times	*/
+/*			and fail unless every error grew as much, as an	*/
+/*			object space distance must				*/
+
+#include <mesh_lod.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEVELS 16
+
+/* A power of 2 scales the positions exactly, so the same edges collapse. */
+#define CHECK_SCALE 8.0f
+
+static int writeLevel(const char *path, const struct Mesh *mesh, const struct MeshLOD *lod){
+	FILE *file = fopen(path, "w");
+	if(file == NULL){
+		perror(path);
+		return -1;
+	}
+
+	int hasNormals = mesh->attributes & MESH_ATTRIB_NORMAL;
+	int hasTexcoords = mesh->attributes & MESH_ATTRIB_TEXCOORD;
+
+	/* Every level keeps all the vertices, so the indices need no remapping. */
+	fprintf(file, "# error %g\n", lod->error);
+	for(size_t v = 0; v < mesh->vertexCount; v++){
+		const float *vertex = mesh->vertices + v * mesh->stride;
+		fprintf(file, "v %g %g %g\n", vertex[0], vertex[1], vertex[2]);
+		vertex += 3;
+		if(hasNormals){
+			fprintf(file, "vn %g %g %g\n", vertex[0], vertex[1], vertex[2]);
+			vertex += 3;
+		}
+		if(hasTexcoords)
+			fprintf(file, "vt %g %g\n", vertex[0], vertex[1]);
+	}
+
+	const unsigned int *indices = mesh->indices + lod->indexOffset;
+	for(unsigned int i = 0; i < lod->indexCount; i += 3){
+		fputc('f', file);
+		for(int k = 0; k < 3; k++){
+			unsigned int index = indices[i + k] + 1;
+			if(hasNormals && hasTexcoords)
+				fprintf(file, " %u/%u/%u", index, index, index);
+			else if(hasNormals)
+				fprintf(file, " %u//%u", index, index);
+			else if(hasTexcoords)
+				fprintf(file, " %u/%u", index, index);
+			else
+				fprintf(file, " %u", index);
+		}
+		fputc('\n', file);
+	}
+
+	if(fclose(file) != 0){
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static int checkScale(const char *path, unsigned int levels, float ratio, const struct MeshLOD *lods, int count){
+	struct Mesh mesh;
+	if(meshImportFile(path, &mesh, 0) == -1)
+		return -1;
+	for(size_t v = 0; v < mesh.vertexCount; v++){
+		float *position = mesh.vertices + v * mesh.stride;
+		position[0] *= CHECK_SCALE;
+		position[1] *= CHECK_SCALE;
+		position[2] *= CHECK_SCALE;
+	}
+
+	struct MeshLOD scaled[MAX_LEVELS];
+	int scaledCount = meshGenerateLODs(&mesh, scaled, levels, ratio);
+	meshFree(&mesh);
+	if(scaledCount != count){
+		fprintf(stderr, "ERROR: %d levels scaled by %g, %d before.\n", scaledCount, CHECK_SCALE, count);
+		return -1;
+	}
+
+	int failed = 0;
+	for(int i = 0; i < count; i++){
+		float expected = lods[i].error * CHECK_SCALE;
+		printf("LOD %d scaled by %g: error %g, expected %g\n", i, CHECK_SCALE, scaled[i].error, expected);
+		if(fabsf(scaled[i].error - expected) > expected * 1e-3f){
+			fprintf(stderr, "ERROR: LOD %d error does not scale with the mesh.\n", i);
+			failed = 1;
+		}
+	}
+	return failed ? -1 : 0;
+}
+
+int main(int argc, char *argv[]){
+	const char *program = argv[0];
+	int check = argc > 1 && strcmp(argv[1], "--check-scale") == 0;
+	if(check){
+		argc--;
+		argv++;
+	}
+	if(argc < 3){
+		fprintf(stderr, "Usage: %s [--check-scale] <input.obj|ply> <output prefix> [levels] [ratio]\n",
+			program);
+		return -1;
+	}
+
+	unsigned int levels = argc > 3 ? (unsigned int) atoi(argv[3]) : 4;
+	float ratio = argc > 4 ? (float) atof(argv[4]) : 0.5f;
+	if(levels < 1 || levels > MAX_LEVELS || ratio <= 0.0f || ratio >= 1.0f){
+		fprintf(stderr, "ERROR: levels must be 1 to %d and ratio between 0 and 1.\n", MAX_LEVELS);
+		return -1;
+	}
+
+	struct Mesh mesh;
+	if(meshImportFile(argv[1], &mesh, 0) == -1)
+		return -1;
+
+	struct MeshLOD lods[MAX_LEVELS];
+	int count = meshGenerateLODs(&mesh, lods, levels, ratio);
+	if(count == -1){
+		fprintf(stderr, "ERROR: Out of memory generating LODs.\n");
+		meshFree(&mesh);
+		return -1;
+	}
+
+	for(int i = 0; i < count; i++){
+		char path[4096];
+		snprintf(path, sizeof(path), "%s_lod%d.obj", argv[2], i);
+		printf("LOD %d: %u triangles, error %g -> %s\n", i, lods[i].indexCount / 3, lods[i].error, path);
+		if(writeLevel(path, &mesh, &lods[i]) == -1){
+			meshFree(&mesh);
+			return -1;
+		}
+	}
+
+	meshFree(&mesh);
+	return check ? checkScale(argv[1], levels, ratio, lods, count) : 0;
+}
@@ -0,0 +1,202 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Builds the mip chain of each image and writes it beside the image as	*/
+/* a texture file, ready for the texture loader. Images are baked in	*/
+/* parallel, and the rows of each level across the same threads.	*/
+/* Usage: texture_bake [options] <image.tga|ppm>...			*/
+/*	--kaiser	Kaiser filter instead of a box			*/
+/*	--srgb		colours are sRGB, filter them in linear light	*/
+/*	--wrap		the texture repeats				*/
+/*	--format F	rgba8, the default, or block compressed with	*/
+/*			bc1, bc3 or bc7					*/
+/*	--threads N	threads to use, 0 for one per CPU, the default	*/
+
+#include <mipmap.h>
+#include <texture_compress.h>
+#include <texture_file.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct Bake {
+	const char *input;
+	char output[4096];
+	enum MipFilter filter;
+	unsigned int flags;
+	int compressed;
+	enum BlockFormat format;
+	struct JobSystem *jobs;
+	double seconds;
+	unsigned int levels;
+	int failed;
+};
+
+static double now(void){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static enum TextureFileFormat fileFormat(const struct Bake *bake){
+	int srgb = bake->flags & MIPMAP_SRGB;
+	if(!bake->compressed)
+		return srgb ? TEXTURE_FILE_SRGB8_ALPHA8 : TEXTURE_FILE_RGBA8;
+
+	switch(bake->format){
+		case BLOCK_BC1: return srgb ? TEXTURE_FILE_BC1_SRGB : TEXTURE_FILE_BC1;
+		case BLOCK_BC3: return srgb ? TEXTURE_FILE_BC3_SRGB : TEXTURE_FILE_BC3;
+		default: return srgb ? TEXTURE_FILE_BC7_SRGB : TEXTURE_FILE_BC7;
+	}
+}
+
+static int bake(struct Bake *bake){
+	struct Image image;
+	if(imageImportFile(bake->input, &image) == -1)
+		return -1;
+
+	struct MipChain chain;
+	int status = mipmapBuild(&image, bake->filter, bake->flags, bake->jobs, &chain);
+	imageFree(&image);
+	if(status == -1)
+		return -1;
+
+	struct TextureLevel levels[MIPMAP_MAX_LEVELS];
+	void *blocks[MIPMAP_MAX_LEVELS] = {NULL};
+	for(unsigned int i = 0; i < chain.levelCount; i++){
+		const struct Image *level = &chain.levels[i];
+		levels[i] = (struct TextureLevel) { level->width, level->height, level->pixels, IMAGE_SIZE(level) };
+		if(!bake->compressed)
+			continue;
+
+		levels[i].size = textureCompressedSize(bake->format, level->width, level->height);
+		if((blocks[i] = malloc(levels[i].size)) == NULL){
+			fprintf(stderr, "ERROR: Out of memory compressing %s.\n", bake->input);
+			status = -1;
+			break;
+		}
+		textureCompress(level, bake->format, bake->jobs, blocks[i]);
+		levels[i].data = blocks[i];
+	}
+	bake->levels = chain.levelCount;
+
+	if(status == 0)
+		status = textureFileWrite(bake->output, fileFormat(bake), levels, chain.levelCount);
+	for(unsigned int i = 0; i < chain.levelCount; i++)
+		free(blocks[i]);
+	mipmapFree(&chain);
+	return status;
+}
+
+static void bakeJob(void *data){
+	struct Bake *job = data;
+	double start = now();
+	job->failed = bake(job) == -1;
+	job->seconds = now() - start;
+}
+
+int main(int argc, char *argv[]){
+	enum MipFilter filter = MIP_FILTER_BOX;
+	enum BlockFormat format = BLOCK_BC1;
+	unsigned int flags = 0, threads = 0;
+	int compressed = 0;
+	int first = 1;
+
+	for(; first < argc && strncmp(argv[first], "--", 2) == 0; first++){
+		if(strcmp(argv[first], "--kaiser") == 0)
+			filter = MIP_FILTER_KAISER;
+		else if(strcmp(argv[first], "--srgb") == 0)
+			flags |= MIPMAP_SRGB;
+		else if(strcmp(argv[first], "--wrap") == 0)
+			flags |= MIPMAP_WRAP;
+		else if(strcmp(argv[first], "--threads") == 0 && first + 1 < argc)
+			threads = (unsigned int) atoi(argv[++first]);
+		else if(strcmp(argv[first], "--format") == 0 && first + 1 < argc){
+			const char *name = argv[++first];
+			compressed = strcmp(name, "rgba8") != 0;
+			if(strcmp(name, "bc1") == 0)
+				format = BLOCK_BC1;
+			else if(strcmp(name, "bc3") == 0)
+				format = BLOCK_BC3;
+			else if(strcmp(name, "bc7") == 0)
+				format = BLOCK_BC7;
+			else if(compressed){
+				fprintf(stderr, "ERROR: Unknown format %s.\n", name);
+				return -1;
+			}
+		}
+		else {
+			fprintf(stderr, "ERROR: Unknown option %s.\n", argv[first]);
+			return -1;
+		}
+	}
+	if(first == argc){
+		fprintf(stderr, "Usage: %s [--kaiser] [--srgb] [--wrap] [--format rgba8|bc1|bc3|bc7] [--threads N] <image.tga|ppm>...\n", argv[0]);
+		return -1;
+	}
+
+	struct JobSystem *jobs = jobSystemCreate(threads);
+	if(jobs == NULL)
+		return -1;
+
+	size_t count = (size_t) (argc - first);
+	struct Bake *bakes = calloc(count, sizeof(struct Bake));
+	struct Job *work = calloc(count, sizeof(struct Job));
+	if(bakes == NULL || work == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		struct Bake *job = &bakes[i];
+		job->input = argv[first + (int) i];
+		job->filter = filter;
+		job->flags = flags;
+		job->compressed = compressed;
+		job->format = format;
+		job->jobs = jobs;
+
+		const char *extension = strrchr(job->input, '.');
+		int stem = extension && !strchr(extension, '/') ? (int) (extension - job->input) : (int) strlen(job->input);
+		snprintf(job->output, sizeof(job->output), "%.*s%s", stem, job->input, TEXTURE_FILE_EXTENSION);
+		work[i] = (struct Job) { bakeJob, job };
+	}
+
+	double start = now();
+	struct JobCounter counter;
+	jobCounterInit(&counter);
+	jobRun(jobs, work, count, &counter);
+	jobWait(jobs, &counter);
+	jobCounterDestroy(&counter);
+
+	int failed = 0;
+	for(size_t i = 0; i < count; i++){
+		if(bakes[i].failed){
+			failed = 1;
+			continue;
+		}
+		printf("%s -> %s, %u levels, %.1f ms\n", bakes[i].input, bakes[i].output, bakes[i].levels,
+		       bakes[i].seconds * 1e3);
+	}
+	printf("%zu images in %.1f ms on %u threads\n", count, (now() - start) * 1e3, jobSystemThreads(jobs));
+
+	jobSystemDestroy(jobs);
+	free(work);
+	free(bakes);
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,69 @@
+/*  Copyright 2020 Karmjit Mahil.
+    This file is part of C-openGL.
+
+    C-openGL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    C-openGL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with C-openGL. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Pages an image and its mip chain into a virtual texture file beside	*/
+/* it, see virtual_texture.h.						*/
+/* Usage: vt_bake [options] <image.tga|ppm>				*/
+/*	--srgb		colours are sRGB, filter them in linear light	*/
+/*	--threads N	threads to use, 0 for one per CPU, the default	*/
+
+#include <virtual_texture.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]){
+	unsigned int threads = 0;
+	int srgb = 0, first = 1;
+
+	for(; first < argc && strncmp(argv[first], "--", 2) == 0; first++){
+		if(strcmp(argv[first], "--srgb") == 0)
+			srgb = 1;
+		else if(strcmp(argv[first], "--threads") == 0 && first + 1 < argc)
+			threads = (unsigned int) atoi(argv[++first]);
+		else {
+			fprintf(stderr, "ERROR: Unknown option %s.\n", argv[first]);
+			return -1;
+		}
+	}
+	if(first + 1 != argc){
+		fprintf(stderr, "Usage: %s [--srgb] [--threads N] <image.tga|ppm>\n", argv[0]);
+		return -1;
+	}
+
+	const char *input = argv[first], *extension = strrchr(input, '.');
+	int stem = extension && !strchr(extension, '/') ? (int) (extension - input) : (int) strlen(input);
+	char output[4096];
+	snprintf(output, sizeof(output), "%.*s%s", stem, input, VT_FILE_EXTENSION);
+
+	struct Image image;
+	if(imageImportFile(input, &image) == -1)
+		return -1;
+	struct JobSystem *jobs = jobSystemCreate(threads);
+	if(jobs == NULL){
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+
+	int status = vtBake(&image, output, srgb, jobs);
+	if(status == 0)
+		printf("%s -> %s\n", input, output);
+
+	jobSystemDestroy(jobs);
+	imageFree(&image);
+	return status;
+}